@@ -0,0 +1,864 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Loopback benchmark of SNMPSession.
+ *
+ * A SNMPAgentSimulator is started on its own thread and port, with the given
+ * latency, jitter, loss and MIB size, and a session on 127.0.0.1 keeps a fixed
+ * number of gets, sets or bulk walks in flight against it until the requested
+ * number of operations has completed. The report is a JSON object with the
+ * operations per second and the p50/p99/p999 latency of the operations:
+ *
+ *     snmpbench --operation get --requests 100000 --concurrency 64
+ *               --latency 0 --jitter 0 --loss 0 --mib-size 1000
+ *               --version 2c --batched --output report.json
+ *
+ * With --operation engine, the gets go through a SNMPEngine instead, once
+ * for each of the given thread counts, each worker polling a simulator of
+ * its own; the report has the polls per second of every thread count and
+ * the speedup over the first:
+ *
+ *     snmpbench --operation engine --threads 1,2,4,8 --requests 200000
+ *
+ * With --operation agent, the agent itself is measured: get-requests encoded
+ * beforehand are sent to the simulator over a batched transport, without a
+ * session, and the report has the requests it answered per second:
+ *
+ *     snmpbench --operation agent --requests 1000000 --concurrency 256
+ *
+ * With --operation traps, SNMPv2c traps and informs are sent in bursts to a
+ * SNMPTrapReceiver on its own thread; the report has the notifications
+ * received, the informs acknowledged and the datagrams dropped per second:
+ *
+ *     snmpbench --operation traps --requests 1000000 --burst 10000 --interval 0
+ *               --informs 0.1
+ *
+ * The exit status is 1 if an operation failed although no loss was
+ * configured, so that short runs double as loopback checks.
+ *
+ */
+
+
+#include <QCommandLineParser>
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include "qtsnmp.h"
+#include "snmpagentsimulator.h"
+#include "snmpdatagramtransport.h"
+#include "snmpengine.h"
+#include "snmptrapreceiver.h"
+
+struct BenchmarkOptions {
+    QString operation;
+    int requests;
+    int concurrency;
+    int latency;
+    int jitter;
+    double loss;
+    int mibSize;
+    int version;
+    int repetitions;
+    bool batched;
+    QList<int> threads;
+    int burst;
+    int interval;
+    double informs;
+    QString output;
+};
+
+// A SNMPAgentSimulator on a thread of its own, created there so that its timers are too
+class AgentThread {
+
+public:
+    AgentThread() : simulator(NULL), port(0) {}
+    ~AgentThread() { stop(); }
+
+    bool start(const BenchmarkOptions &options);
+    void stop();
+
+    SNMPAgentSimulator *simulator;
+    quint16 port;
+    QVector<SNMPOid> objects;
+
+private:
+    QThread thread;
+    QObject context;
+};
+
+class LoopbackBenchmark : public QObject {
+
+public:
+    LoopbackBenchmark(SNMPSession &session, const BenchmarkOptions &options,
+                      const QVector<SNMPOid> &objects);
+
+    void start();
+    QJsonObject report() const;
+    int failedCount() const { return failed; }
+
+private:
+    void sendNext();
+    quint32 issue();
+    void finish(quint32 id, bool succeeded);
+
+    SNMPSession &session;
+    const BenchmarkOptions &options;
+    QVector<SNMPOid> objects;
+    const QString readCommunity;
+    const QString writeCommunity;
+    const QString setValue;
+    QHash<quint32, qint64> startedAt;
+    QVector<qint64> latencies;
+    QElapsedTimer clock;
+    qint64 elapsed;
+    int sent;
+    int completed;
+    int failed;
+    quint64 varbinds;
+};
+
+//----[ AgentThread ]-------------------------------------------------------------------
+
+/**
+*   This method will start the thread and a simulator with the agent options in it.
+*   Returns false if the simulator cannot listen.
+*/
+bool AgentThread::start(const BenchmarkOptions &options)
+{
+    context.moveToThread(&thread);
+    thread.start();
+
+    QMetaObject::invokeMethod(&context, [&]() {
+        simulator = new SNMPAgentSimulator;
+        simulator->populate(options.mibSize);
+        simulator->setLatency(options.latency, options.jitter);
+        simulator->setLossRate(options.loss);
+        simulator->setWriteCommunity("private");
+        if(simulator->listen(0))
+            port = simulator->getLocalPort();
+        for(int object = 0; object < simulator->objectCount(); object++)
+            objects.append(simulator->getObjectOid(object));
+    }, Qt::BlockingQueuedConnection);
+
+    return port != 0;
+}
+
+void AgentThread::stop()
+{
+    if(!thread.isRunning())
+        return;
+
+    QMetaObject::invokeMethod(&context, [this]() { delete simulator; },
+                              Qt::BlockingQueuedConnection);
+    simulator = NULL;
+    thread.quit();
+    thread.wait();
+}
+
+
+//----[ LoopbackBenchmark ]--------------------------------------------------------------
+
+LoopbackBenchmark::LoopbackBenchmark(SNMPSession &session, const BenchmarkOptions &options,
+                                     const QVector<SNMPOid> &objects)
+        : session(session), options(options), objects(objects),
+          readCommunity("public"), writeCommunity("private"), setValue("simulator")
+{
+    this->elapsed = 0;
+    this->sent = 0;
+    this->completed = 0;
+    this->failed = 0;
+    this->varbinds = 0;
+
+    startedAt.reserve(options.concurrency * 2);
+    latencies.reserve(options.requests);
+
+    connect(&session, &SNMPSession::responseValueReceived, this,
+            [this](quint32 requestId, int errorStatus, const SNMPValue &) {
+        finish(requestId, errorStatus == 0);
+    });
+    connect(&session, &SNMPSession::requestFailed, this,
+            [this](quint32 requestId, int) {
+        finish(requestId, false);
+    });
+    connect(&session, &SNMPSession::walkValueReceived, this,
+            [this](quint32, const SNMPValue &, const SNMPValue &) {
+        varbinds++;
+    });
+    connect(&session, &SNMPSession::walkFinished, this,
+            [this](quint32 walkId, int errorStatus) {
+        finish(walkId, errorStatus == 0);
+    });
+}
+
+/**
+*   This method will put the first operations in flight; every completed operation
+*   sends the next one, until options.requests have completed.
+*/
+void LoopbackBenchmark::start()
+{
+    clock.start();
+    for(int i = 0; i < options.concurrency; i++)
+        sendNext();
+}
+
+QJsonObject LoopbackBenchmark::report() const
+{
+    QVector<qint64> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+
+    // latencies are kept in nanoseconds and reported in microseconds
+    auto percentile = [&sorted](double fraction) {
+        if(sorted.isEmpty())
+            return 0.0;
+        const int index = int(std::ceil(fraction * sorted.size())) - 1;
+        return sorted[qBound(0, index, sorted.size() - 1)] / 1000.0;
+    };
+
+    const double seconds = elapsed / 1e9;
+
+    QJsonObject latency;
+    latency["p50"] = percentile(0.50);
+    latency["p99"] = percentile(0.99);
+    latency["p999"] = percentile(0.999);
+    latency["max"] = percentile(1.0);
+
+    QJsonObject result;
+    result["operation"] = options.operation;
+    result["version"] = options.version == SNMPBer::Version1 ? "1" : "2c";
+    result["transport"] = options.batched ? "batched" : "qudpsocket";
+    result["requests"] = options.requests;
+    result["concurrency"] = options.concurrency;
+    result["agent_latency_ms"] = options.latency;
+    result["agent_jitter_ms"] = options.jitter;
+    result["agent_loss"] = options.loss;
+    result["mib_size"] = options.mibSize;
+    result["completed"] = completed;
+    result["failed"] = failed;
+    result["seconds"] = seconds;
+    result["requests_per_second"] = seconds > 0 ? (completed + failed) / seconds : 0.0;
+    if(options.operation == "walk")
+    {
+        result["varbinds"] = double(varbinds);
+        result["varbinds_per_second"] = seconds > 0 ? varbinds / seconds : 0.0;
+    }
+    result["latency_us"] = latency;
+    return result;
+}
+
+/**
+*   This method will start the next operation, unless all have been started, and
+*   stop the event loop once all have completed.
+*/
+void LoopbackBenchmark::sendNext()
+{
+    while(sent < options.requests)
+    {
+        sent++;
+
+        const qint64 now = clock.nsecsElapsed();
+        const quint32 id = issue();
+        if(id != 0)
+        {
+            startedAt.insert(id, now);
+            return;
+        }
+
+        // refused by the session, counted as failed right away
+        failed++;
+        latencies.append(0);
+    }
+
+    if(completed + failed == options.requests && elapsed == 0)
+    {
+        elapsed = clock.nsecsElapsed();
+        QCoreApplication::quit();
+    }
+}
+
+/**
+*   Starts one operation and returns its request or walk ID. Gets go round the
+*   objects of the simulator, sets write sysName and walks cover the whole MIB.
+*/
+quint32 LoopbackBenchmark::issue()
+{
+    static const SNMPOid sysName = "1.3.6.1.2.1.1.5.0"_oid;
+    static const SNMPOid mib2 = "1.3.6.1.2.1"_oid;
+
+    if(options.operation == "set")
+        return session.sendSetRequestAsync(writeCommunity, sysName, setValue);
+    if(options.operation == "walk")
+        return session.bulkWalk(readCommunity, mib2, options.repetitions);
+    return session.sendGetRequestAsync(readCommunity, objects[sent % objects.size()]);
+}
+
+void LoopbackBenchmark::finish(quint32 id, bool succeeded)
+{
+    QHash<quint32, qint64>::iterator started = startedAt.find(id);
+    if(started == startedAt.end())
+        return;
+
+    latencies.append(clock.nsecsElapsed() - started.value());
+    startedAt.erase(started);
+    if(succeeded)
+        completed++;
+    else
+        failed++;
+
+    sendNext();
+}
+
+
+//----[ Engine benchmark ]--------------------------------------------------------------
+
+/**
+*   Polls with a SNMPEngine of each thread count in options.threads: one target per
+*   worker, each on a simulator thread of its own so that the agents do not share a
+*   core bottleneck, with options.concurrency gets in flight per target until
+*   options.requests have completed. Reports the polls per second of each run and
+*   its speedup over the first one. failed receives the number of failed polls.
+*/
+static QJsonObject runEngineBenchmark(const BenchmarkOptions &options, int &failed)
+{
+    const int maxThreads = *std::max_element(options.threads.begin(), options.threads.end());
+    QVector<AgentThread *> agents;
+    QJsonArray runs;
+    double firstRate = 0.0;
+    failed = 0;
+
+    for(int i = 0; i < maxThreads; i++)
+    {
+        agents.append(new AgentThread);
+        if(!agents.last()->start(options))
+        {
+            fprintf(stderr, "snmpbench: the simulator cannot listen\n");
+            failed = options.requests;
+            qDeleteAll(agents);
+            return QJsonObject();
+        }
+    }
+
+    for(int threads : options.threads)
+    {
+        SNMPEngine engine(threads, qMax(4096, options.concurrency * 2));
+        for(int i = 0; i < threads; i++)
+            engine.addTarget(QHostAddress::LocalHost, agents[i]->port, "public", options.version);
+        engine.start();
+
+        const QVector<SNMPOid> &objects = agents[0]->objects;
+        QVector<SNMPCompletion> completions;
+        QEventLoop loop;
+        QElapsedTimer clock;
+        int sent = 0;
+        int completed = 0;
+        int runFailed = 0;
+
+        // every completion sends the next get to its target
+        auto issue = [&](int target) {
+            if(sent < options.requests && engine.get(target, objects[sent % objects.size()]) != 0)
+                sent++;
+        };
+        QObject::connect(&engine, &SNMPEngine::completionsReady, &loop, [&]() {
+            completions.clear();
+            engine.takeCompletions(completions);
+            for(const SNMPCompletion &completion : completions)
+            {
+                completed++;
+                if(completion.errorStatus != 0)
+                    runFailed++;
+                issue(completion.target);
+            }
+            // nothing left in flight: all were sent, or a worker queue refused one
+            if(completed >= sent)
+                loop.quit();
+        });
+
+        clock.start();
+        for(int i = 0; i < options.concurrency; i++)
+        {
+            for(int target = 0; target < threads; target++)
+                issue(target);
+        }
+        loop.exec();
+        const qint64 elapsed = clock.nsecsElapsed();
+        engine.stop();
+
+        const double rate = elapsed > 0 ? completed * 1e9 / elapsed : 0.0;
+        if(firstRate == 0.0)
+            firstRate = rate;
+
+        QJsonObject run;
+        run["threads"] = threads;
+        run["completed"] = completed;
+        run["failed"] = runFailed;
+        run["seconds"] = elapsed / 1e9;
+        run["polls_per_second"] = rate;
+        run["polls_per_second_per_thread"] = rate / threads;
+        run["speedup"] = firstRate > 0 ? rate / firstRate : 0.0;
+        runs.append(run);
+        failed += runFailed;
+    }
+
+    qDeleteAll(agents);
+
+    QJsonObject result;
+    result["operation"] = options.operation;
+    result["version"] = options.version == SNMPBer::Version1 ? "1" : "2c";
+    result["requests"] = options.requests;
+    result["concurrency_per_thread"] = options.concurrency;
+    result["cores"] = QThread::idealThreadCount();
+    result["runs"] = runs;
+    return result;
+}
+
+
+//----[ Agent benchmark ]---------------------------------------------------------------
+
+/**
+*   Sends get-requests straight to a simulator from a SNMPDatagramTransport, so that
+*   what is timed is the agent decoding and answering them: the requests, one for
+*   each object of the MIB, are encoded beforehand, options.concurrency of them are
+*   kept in flight and every response sends the next one, until options.requests
+*   have been answered. A response must be a GetResponse without error. Requests
+*   left unanswered for a second, as with loss, are counted as failed and replaced.
+*   failed receives the number of failed requests, or -1 if nothing could run.
+*/
+static QJsonObject runAgentBenchmark(const BenchmarkOptions &options, int &failed)
+{
+    AgentThread agent;
+    if(!agent.start(options))
+    {
+        fprintf(stderr, "snmpbench: the simulator cannot listen\n");
+        failed = -1;
+        return QJsonObject();
+    }
+
+    SNMPDatagramTransport transport(64, 65507);
+    if(!SNMPDatagramTransport::isSupported() || !transport.bind(0))
+    {
+        fprintf(stderr, "snmpbench: agent needs the sendmmsg/recvmmsg transport\n");
+        failed = -1;
+        return QJsonObject();
+    }
+
+    const QByteArray community("public");
+    QVector<QByteArray> requests;
+    SNMPBerWriter encoder;
+    for(const SNMPOid &oid : agent.objects)
+    {
+        encoder.reset();
+        const int varbindEnd = encoder.mark();
+        encoder.writeNull();
+        encoder.writeOctetString(oid.encoded(), SNMPBer::ObjectIdentifier);
+        encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+        encoder.writeMessageHeader(options.version, community, SNMPBer::GetRequest,
+                                   quint32(requests.size() + 1));
+        requests.append(encoder.toByteArray());
+    }
+
+    const QHostAddress agentAddress(QHostAddress::LocalHost);
+    QEventLoop loop;
+    QTimer watchdog;
+    QElapsedTimer clock;
+    SNMPMessageView response;
+    int sent = 0;
+    int inFlight = 0;
+    int completed = 0;
+    int answered = 0;
+    failed = 0;
+
+    auto sendNext = [&]() {
+        const QByteArray &request = requests[sent % requests.size()];
+        transport.queueDatagram(request.constData(), request.size(), agentAddress, agent.port);
+        sent++;
+        inFlight++;
+    };
+    auto finished = [&]() {
+        return completed + failed >= options.requests;
+    };
+
+    QObject::connect(&transport, &SNMPDatagramTransport::readyRead, &loop, [&]() {
+        do
+        {
+            const int count = transport.receive();
+            for(int i = 0; i < count; i++)
+            {
+                if(response.decode(transport.datagramData(i), transport.datagramSize(i))
+                   && response.pduType == SNMPBer::GetResponse && response.errorStatus == 0)
+                    completed++;
+                else
+                    failed++;
+
+                // a late answer to a request already counted as failed does not send one
+                if(inFlight > 0)
+                {
+                    inFlight--;
+                    if(sent < options.requests)
+                        sendNext();
+                }
+            }
+            transport.flush();
+        } while(transport.hasPendingDatagrams());
+
+        if(finished())
+            loop.quit();
+    });
+    QObject::connect(&watchdog, &QTimer::timeout, &loop, [&]() {
+        if(completed + failed == answered)
+        {
+            failed += inFlight;
+            inFlight = 0;
+            while(inFlight < options.concurrency && sent < options.requests)
+                sendNext();
+            transport.flush();
+            if(finished())
+                loop.quit();
+        }
+        answered = completed + failed;
+    });
+
+    clock.start();
+    while(inFlight < options.concurrency && sent < options.requests)
+        sendNext();
+    transport.flush();
+    watchdog.start(1000);
+    loop.exec();
+    const qint64 elapsed = clock.nsecsElapsed();
+
+    const double seconds = elapsed / 1e9;
+    QJsonObject result;
+    result["operation"] = options.operation;
+    result["version"] = options.version == SNMPBer::Version1 ? "1" : "2c";
+    result["requests"] = options.requests;
+    result["concurrency"] = options.concurrency;
+    result["agent_latency_ms"] = options.latency;
+    result["agent_jitter_ms"] = options.jitter;
+    result["agent_loss"] = options.loss;
+    result["mib_size"] = options.mibSize;
+    result["completed"] = completed;
+    result["failed"] = failed;
+    result["seconds"] = seconds;
+    result["requests_per_second"] = seconds > 0 ? completed / seconds : 0.0;
+    result["datagrams_per_receive_call"] = transport.datagramsPerReceiveCall();
+    return result;
+}
+
+
+//----[ Trap benchmark ]----------------------------------------------------------------
+
+/**
+*   Sends options.requests SNMPv2c notifications to a SNMPTrapReceiver on a thread of
+*   its own, options.burst at a time with one sendmmsg call per ring, waiting
+*   options.interval milliseconds between bursts while acknowledgements are read.
+*   A fraction options.informs of them are InformRequests, the others SNMPv2-Traps.
+*   Once nothing more arrives for half a second, reports the notifications delivered
+*   by the receiver, the informs acknowledged back to the sender and the datagrams
+*   lost in between, as counts and per second of the time until the last one.
+*   failed receives the number dropped or left unacknowledged, or -1 if nothing
+*   could run.
+*/
+static QJsonObject runTrapBenchmark(const BenchmarkOptions &options, int &failed)
+{
+    static const SNMPOid sysUpTime = "1.3.6.1.2.1.1.3.0"_oid;
+    static const SNMPOid snmpTrapOid = "1.3.6.1.6.3.1.1.4.1.0"_oid;
+    static const SNMPOid linkDown = "1.3.6.1.6.3.1.1.5.3"_oid;
+    static const SNMPOid ifIndex = "1.3.6.1.2.1.2.2.1.1"_oid;
+
+    QThread receiverThread;
+    QObject receiverContext;
+    SNMPTrapReceiver *receiver = NULL;
+    quint16 receiverPort = 0;
+    QElapsedTimer clock;
+    QAtomicInteger<qint64> delivered(0);
+    QAtomicInteger<qint64> lastDelivery(0);
+
+    // the receiver is created in its thread, and counts the batches it delivers there
+    receiverContext.moveToThread(&receiverThread);
+    receiverThread.start();
+    QMetaObject::invokeMethod(&receiverContext, [&]() {
+        receiver = new SNMPTrapReceiver;
+        QObject::connect(receiver, &SNMPTrapReceiver::notificationsReceived, receiver,
+                         [&](const QVector<SNMPTrapView> &notifications) {
+            delivered.fetchAndAddOrdered(notifications.size());
+            lastDelivery.storeRelease(clock.nsecsElapsed());
+        }, Qt::DirectConnection);
+        if(receiver->listen(0))
+            receiverPort = receiver->getLocalPort();
+    }, Qt::BlockingQueuedConnection);
+
+    auto stopReceiver = [&]() {
+        QMetaObject::invokeMethod(&receiverContext, [&]() { delete receiver; },
+                                  Qt::BlockingQueuedConnection);
+        receiverThread.quit();
+        receiverThread.wait();
+    };
+
+    SNMPDatagramTransport transport(64, 65507);
+    if(receiverPort == 0 || !SNMPDatagramTransport::isSupported() || !transport.bind(0))
+    {
+        fprintf(stderr, "snmpbench: traps needs the sendmmsg/recvmmsg transport\n");
+        stopReceiver();
+        failed = -1;
+        return QJsonObject();
+    }
+    transport.setSocketReceiveBufferSize(4 * 1024 * 1024);
+
+    const QByteArray community("public");
+    const QHostAddress receiverAddress(QHostAddress::LocalHost);
+    SNMPBerWriter encoder;
+    SNMPMessageView acknowledgement;
+    QEventLoop loop;
+    QTimer drained;
+    int sent = 0;
+    int informsSent = 0;
+    int acknowledged = 0;
+    qint64 sendTime = 0;
+    qint64 lastAcknowledgement = 0;
+    qint64 progress = -1;
+
+    auto sendNotification = [&]() {
+        // informs spread evenly: a fraction options.informs of every run of notifications
+        const bool inform = int((sent + 1) * options.informs) > int(sent * options.informs);
+
+        encoder.reset();
+        int varbindEnd = encoder.mark();
+        encoder.writeInteger(sent % 48 + 1);
+        encoder.writeOctetString(ifIndex.encoded(), SNMPBer::ObjectIdentifier);
+        encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+        varbindEnd = encoder.mark();
+        encoder.writeOctetString(linkDown.encoded(), SNMPBer::ObjectIdentifier);
+        encoder.writeOctetString(snmpTrapOid.encoded(), SNMPBer::ObjectIdentifier);
+        encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+        varbindEnd = encoder.mark();
+        encoder.writeUnsigned(quint64(sent), SNMPBer::TimeTicks);
+        encoder.writeOctetString(sysUpTime.encoded(), SNMPBer::ObjectIdentifier);
+        encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+        encoder.writeMessageHeader(SNMPBer::Version2c, community,
+                                   inform ? SNMPBer::InformRequest : SNMPBer::SNMPv2Trap,
+                                   quint32(sent + 1));
+
+        transport.queueDatagram(encoder.data(), encoder.size(), receiverAddress, receiverPort);
+        sent++;
+        if(inform)
+            informsSent++;
+    };
+
+    std::function<void()> sendBurst = [&]() {
+        for(int i = 0; i < options.burst && sent < options.requests; i++)
+            sendNotification();
+        transport.flush();
+
+        if(sent < options.requests)
+            QTimer::singleShot(options.interval, &loop, sendBurst);
+        else
+            sendTime = clock.nsecsElapsed();
+    };
+
+    QObject::connect(&transport, &SNMPDatagramTransport::readyRead, &loop, [&]() {
+        do
+        {
+            const int count = transport.receive();
+            for(int i = 0; i < count; i++)
+            {
+                if(acknowledgement.decode(transport.datagramData(i), transport.datagramSize(i))
+                   && acknowledgement.pduType == SNMPBer::GetResponse)
+                    acknowledged++;
+            }
+        } while(transport.hasPendingDatagrams());
+        lastAcknowledgement = clock.nsecsElapsed();
+    });
+
+    // done once everything was sent and nothing came in for half a second
+    QObject::connect(&drained, &QTimer::timeout, &loop, [&]() {
+        const qint64 now = delivered.loadAcquire() + acknowledged;
+        if(sent == options.requests && now == progress)
+            loop.quit();
+        progress = now;
+    });
+
+    clock.start();
+    QTimer::singleShot(0, &loop, sendBurst);
+    drained.start(500);
+    loop.exec();
+
+    quint64 acknowledgedByReceiver = 0;
+    quint64 malformed = 0;
+    QMetaObject::invokeMethod(&receiverContext, [&]() {
+        acknowledgedByReceiver = receiver->getInformsAcknowledged();
+        malformed = receiver->getMalformedDatagrams() + receiver->getRejectedDatagrams();
+    }, Qt::BlockingQueuedConnection);
+    stopReceiver();
+
+    const qint64 received = delivered.loadAcquire();
+    const qint64 dropped = sent - received;
+    const double seconds = lastDelivery.loadAcquire() / 1e9;
+    const double acknowledgementSeconds = lastAcknowledgement / 1e9;
+    failed = int(dropped + informsSent - acknowledged);
+
+    QJsonObject result;
+    result["operation"] = options.operation;
+    result["version"] = "2c";
+    result["notifications"] = sent;
+    result["informs"] = informsSent;
+    result["burst"] = options.burst;
+    result["send_seconds"] = sendTime / 1e9;
+    result["sent_per_second"] = sendTime > 0 ? sent * 1e9 / sendTime : 0.0;
+    result["received"] = double(received);
+    result["dropped"] = double(dropped);
+    result["malformed"] = double(malformed);
+    result["acknowledged_by_receiver"] = double(acknowledgedByReceiver);
+    result["acknowledged"] = acknowledged;
+    result["seconds"] = seconds;
+    result["received_per_second"] = seconds > 0 ? received / seconds : 0.0;
+    result["dropped_per_second"] = seconds > 0 ? dropped / seconds : 0.0;
+    result["acknowledged_per_second"] = acknowledgementSeconds > 0 ? acknowledged / acknowledgementSeconds : 0.0;
+    return result;
+}
+
+
+//----[ main ]---------------------------------------------------------------------------
+
+static bool parseOptions(const QCoreApplication &application, BenchmarkOptions &options)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Loopback benchmark of SNMPSession against SNMPAgentSimulator");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "operation", "get, set, walk, engine for SNMPEngine gets, agent for the agent alone, "
+          "or traps for SNMPTrapReceiver (get).", "operation", "get" },
+        { "requests", "Operations to complete (100000).", "count", "100000" },
+        { "concurrency", "Operations kept in flight, per thread for engine (64).", "count", "64" },
+        { "latency", "Agent response latency in milliseconds (0).", "ms", "0" },
+        { "jitter", "Random extra agent latency in milliseconds (0).", "ms", "0" },
+        { "loss", "Probability that the agent drops a response (0).", "rate", "0" },
+        { "mib-size", "Objects published by the agent (1000).", "count", "1000" },
+        { "version", "SNMP version, 1 or 2c (2c).", "version", "2c" },
+        { "repetitions", "GetBulk max-repetitions of walks (10).", "count", "10" },
+        { "batched", "Use the sendmmsg/recvmmsg transport." },
+        { "threads", "Comma separated SNMPEngine thread counts to run, for engine (1).", "list", "1" },
+        { "burst", "Notifications sent at once, for traps (1000).", "count", "1000" },
+        { "interval", "Milliseconds between bursts, for traps (0).", "ms", "0" },
+        { "informs", "Fraction of the notifications sent as informs, for traps (0.5).", "rate", "0.5" },
+        { "output", "Write the JSON report to a file instead of stdout.", "file" }
+    });
+    parser.process(application);
+
+    options.operation = parser.value("operation");
+    options.requests = parser.value("requests").toInt();
+    options.concurrency = parser.value("concurrency").toInt();
+    options.latency = parser.value("latency").toInt();
+    options.jitter = parser.value("jitter").toInt();
+    options.loss = parser.value("loss").toDouble();
+    options.mibSize = parser.value("mib-size").toInt();
+    options.version = parser.value("version") == "1" ? SNMPBer::Version1 : SNMPBer::Version2c;
+    options.repetitions = parser.value("repetitions").toInt();
+    options.batched = parser.isSet("batched");
+    options.burst = parser.value("burst").toInt();
+    options.interval = qMax(0, parser.value("interval").toInt());
+    options.informs = qBound(0.0, parser.value("informs").toDouble(), 1.0);
+    options.output = parser.value("output");
+
+    for(const QString &count : parser.value("threads").split(','))
+    {
+        const int threads = count.trimmed().toInt();
+        if(threads < 1)
+        {
+            fprintf(stderr, "snmpbench: thread counts must be positive\n");
+            return false;
+        }
+        options.threads.append(threads);
+    }
+
+    if(options.operation != "get" && options.operation != "set" && options.operation != "walk"
+       && options.operation != "engine" && options.operation != "agent" && options.operation != "traps")
+    {
+        fprintf(stderr, "snmpbench: unknown operation %s\n", qPrintable(options.operation));
+        return false;
+    }
+    if(options.requests < 1 || options.concurrency < 1 || options.burst < 1 || options.mibSize < 4)
+    {
+        fprintf(stderr, "snmpbench: requests, concurrency and burst must be positive, mib-size at least 4\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+*   Runs the session benchmark: one session against one simulator.
+*   failed receives the number of failed operations, or -1 if nothing could run.
+*/
+static QJsonObject runSessionBenchmark(BenchmarkOptions &options, int &failed)
+{
+    AgentThread agent;
+    if(!agent.start(options))
+    {
+        fprintf(stderr, "snmpbench: the simulator cannot listen\n");
+        failed = -1;
+        return QJsonObject();
+    }
+
+    SNMPSession session;
+    session.setAgentAddress("127.0.0.1");
+    session.setAgentPort(qint16(agent.port));
+    session.setVersion(options.version);
+    if(options.batched && !session.setBatchedTransport(true))
+    {
+        fprintf(stderr, "snmpbench: the batched transport is not supported here\n");
+        options.batched = false;
+    }
+
+    LoopbackBenchmark benchmark(session, options, agent.objects);
+    QTimer::singleShot(0, &benchmark, [&benchmark]() { benchmark.start(); });
+    QCoreApplication::exec();
+
+    failed = benchmark.failedCount();
+    return benchmark.report();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    BenchmarkOptions options;
+    if(!parseOptions(application, options))
+        return 2;
+
+    int failed = 0;
+    QJsonObject report;
+    if(options.operation == "engine")
+        report = runEngineBenchmark(options, failed);
+    else if(options.operation == "agent")
+        report = runAgentBenchmark(options, failed);
+    else if(options.operation == "traps")
+        report = runTrapBenchmark(options, failed);
+    else
+        report = runSessionBenchmark(options, failed);
+
+    if(failed < 0 || report.isEmpty())
+        return 2;
+
+    QFile output;
+    if(options.output.isEmpty())
+        output.open(stdout, QIODevice::WriteOnly);
+    else
+    {
+        output.setFileName(options.output);
+        output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+    output.write(QJsonDocument(report).toJson());
+
+    return failed > 0 && options.loss == 0.0 ? 1 : 0;
+}
@@ -0,0 +1,814 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Microbenchmarks of the building blocks of the library, each timed in a
+ * tight loop. Every case reports its operations per second and nanoseconds
+ * per operation as a member of one JSON object:
+ *
+ *     snmpmicrobench --iterations 1000000 --output report.json encode
+ *
+ * Without case names every case runs. Each case also checks what it
+ * produced, and the exit status is 1 if a check fails, so that short runs
+ * double as regression checks.
+ *
+ */
+
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "snmpber.h"
+#include "snmpdatagramtransport.h"
+#include "snmpmetrics.h"
+#include "snmpoid.h"
+#include "snmprateengine.h"
+#include "snmpspscqueue.h"
+#include "snmptimerwheel.h"
+#include "snmptrapreceiver.h"
+#include "snmpusm.h"
+
+#ifndef QTSNMP_CORPUS_DIR
+#define QTSNMP_CORPUS_DIR "fuzz/corpus"
+#endif
+
+typedef bool (*BenchmarkCase)(int iterations, QJsonObject &result);
+
+// Directory of the datagrams the decode case replays, see --corpus
+static QString corpusDirectory;
+
+static void reportRate(QJsonObject &result, qint64 operations, qint64 nanoseconds)
+{
+    result["operations"] = double(operations);
+    result["seconds"] = nanoseconds / 1e9;
+    result["operations_per_second"] = nanoseconds > 0 ? operations * 1e9 / nanoseconds : 0.0;
+    result["ns_per_operation"] = operations > 0 ? double(nanoseconds) / operations : 0.0;
+}
+
+//----[ Cases ]--------------------------------------------------------------------------
+
+/**
+*   Encodes get-requests with 1 and 10 varbinds the way SNMPSession does: the varbinds
+*   then the message header, back to front into one reused SNMPBerWriter.
+*/
+static bool benchmarkEncode(int iterations, QJsonObject &result)
+{
+    static const SNMPOid ifInOctets = "1.3.6.1.2.1.2.2.1.10.1"_oid;
+    const QByteArray community("public");
+    SNMPBerWriter encoder;
+    bool valid = true;
+
+    for(int varbinds : { 1, 10 })
+    {
+        QElapsedTimer clock;
+        qint64 bytes = 0;
+
+        clock.start();
+        for(int i = 1; i <= iterations; i++)
+        {
+            encoder.reset();
+            for(int varbind = 0; varbind < varbinds; varbind++)
+            {
+                const int varbindEnd = encoder.mark();
+                encoder.writeNull();
+                encoder.writeOctetString(ifInOctets.encoded(), SNMPBer::ObjectIdentifier);
+                encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+            }
+            encoder.writeMessageHeader(SNMPBer::Version2c, community, SNMPBer::GetRequest, quint32(i));
+            bytes += encoder.size();
+        }
+        const qint64 elapsed = clock.nsecsElapsed();
+
+        // the last message must decode to what was written
+        SNMPMessageView message;
+        SNMPVarbindView varbind;
+        int decoded = 0;
+        if(message.decode(encoder.data(), encoder.size()) && message.requestId == quint32(iterations))
+        {
+            while(message.nextVarbind(varbind))
+                decoded++;
+        }
+        valid = valid && decoded == varbinds;
+
+        QJsonObject run;
+        reportRate(run, iterations, elapsed);
+        run["bytes_per_message"] = double(bytes) / iterations;
+        result[QString("varbinds_%1").arg(varbinds)] = run;
+    }
+
+    return valid;
+}
+
+/**
+*   Reports the decoding throughput of a run over messages of bytes in all.
+*/
+static void reportThroughput(QJsonObject &result, qint64 messages, qint64 bytes, qint64 nanoseconds)
+{
+    reportRate(result, messages, nanoseconds);
+    result["bytes_per_message"] = messages > 0 ? double(bytes) / messages : 0.0;
+    result["megabytes_per_second"] = nanoseconds > 0 ? bytes * 1e3 / nanoseconds : 0.0;
+}
+
+// How a datagram of the corpus is decoded, the way the receiver of its kind does
+enum CorpusDecoder {
+    CorpusNotification,     // SNMPTrapReceiver: SNMPTrapView
+    CorpusMessage,          // SNMPSession and SNMPAgent: SNMPBer::decodeMessage
+    CorpusUsm               // everything else as SNMPv3, to SNMPUsm
+};
+
+struct CorpusDatagram {
+    QByteArray data;
+    int decoder;
+    int status;             // the outcome of its decoder, which every decode must repeat
+    qint64 varbinds;
+};
+
+/**
+*   This method will read every file of the directory as one datagram, in the
+*   order of their names, and pick the decoder of each.
+*/
+static std::vector<CorpusDatagram> loadCorpus(const QString &directory)
+{
+    std::vector<CorpusDatagram> corpus;
+    const QDir corpusDir(directory);
+
+    for(const QString &name : corpusDir.entryList(QDir::Files, QDir::Name))
+    {
+        QFile file(corpusDir.filePath(name));
+        if(!file.open(QIODevice::ReadOnly))
+            continue;
+
+        CorpusDatagram datagram;
+        datagram.data = file.readAll();
+        datagram.status = 0;
+        datagram.varbinds = 0;
+
+        SNMPTrapView notification;
+        SNMPMessageView message;
+        if(notification.decode(datagram.data.constData(), datagram.data.size()))
+            datagram.decoder = CorpusNotification;
+        else if(SNMPBer::decodeMessage(datagram.data.constData(), datagram.data.size(), message) == SNMPBer::DecodeOk)
+            datagram.decoder = CorpusMessage;
+        else
+            datagram.decoder = CorpusUsm;
+        corpus.push_back(datagram);
+    }
+
+    return corpus;
+}
+
+/**
+*   Decodes, with every check the receivers make, and iterates the varbinds of:
+*   - response: a get-response with one varbind of each common type, as
+*     SNMPSession does with SNMPBer::decodeMessage;
+*   - inform: an InformRequest, as SNMPTrapReceiver does with SNMPTrapView;
+*   - corpus: the datagrams of the fuzzing seed corpus (fuzz/corpus, or --corpus)
+*     in turn, each with the decoder of its receiver, as a manager with a SNMPv3
+*     user for the SNMPv3 ones. Its megabytes per second are over those datagrams.
+*   Every iteration must see all the varbinds, and the corpus decode as it did
+*   before the timing.
+*/
+static bool benchmarkDecode(int iterations, QJsonObject &result)
+{
+    const QByteArray community("public");
+    SNMPBerWriter encoder;
+    bool valid = true;
+
+    static const struct {
+        const char *oid;
+        int type;
+        quint64 value;
+    } values[] = {
+        { "1.3.6.1.2.1.1.3.0", SNMPBer::TimeTicks, 123456789 },
+        { "1.3.6.1.2.1.1.7.0", SNMPBer::Integer, 72 },
+        { "1.3.6.1.2.1.2.2.1.10.1", SNMPBer::Counter32, 4294967295u },
+        { "1.3.6.1.2.1.2.2.1.5.1", SNMPBer::Gauge32, 1000000000 },
+        { "1.3.6.1.2.1.31.1.1.1.6.1", SNMPBer::Counter64, Q_UINT64_C(18446744073709551615) }
+    };
+    const int responseVarbinds = int(sizeof(values) / sizeof(values[0])) + 2;
+    for(const auto &entry : values)
+    {
+        const int varbindEnd = encoder.mark();
+        if(entry.type == SNMPBer::Integer)
+            encoder.writeInteger(qint64(entry.value));
+        else
+            encoder.writeUnsigned(entry.value, entry.type);
+        encoder.writeObjectIdentifier(QByteArray(entry.oid));
+        encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+    }
+    int varbindEnd = encoder.mark();
+    encoder.writeObjectIdentifier(QByteArray("1.3.6.1.4.1.8072.3.2.10"));
+    encoder.writeObjectIdentifier(QByteArray("1.3.6.1.2.1.1.2.0"));
+    encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+    varbindEnd = encoder.mark();
+    encoder.writeOctetString(QByteArray("Linux router 5.10"));
+    encoder.writeObjectIdentifier(QByteArray("1.3.6.1.2.1.1.1.0"));
+    encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+    encoder.writeMessageHeader(SNMPBer::Version2c, community, SNMPBer::GetResponse, 1);
+    const QByteArray response = encoder.toByteArray();
+
+    encoder.reset();
+    varbindEnd = encoder.mark();
+    encoder.writeInteger(1);
+    encoder.writeObjectIdentifier(QByteArray("1.3.6.1.2.1.2.2.1.8.3"));
+    encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+    varbindEnd = encoder.mark();
+    encoder.writeObjectIdentifier(QByteArray("1.3.6.1.6.3.1.1.5.4"));
+    encoder.writeObjectIdentifier(QByteArray("1.3.6.1.6.3.1.1.4.1.0"));
+    encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+    varbindEnd = encoder.mark();
+    encoder.writeUnsigned(360000, SNMPBer::TimeTicks);
+    encoder.writeObjectIdentifier(QByteArray("1.3.6.1.2.1.1.3.0"));
+    encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+    encoder.writeMessageHeader(SNMPBer::Version2c, community, SNMPBer::InformRequest, 2);
+    const QByteArray inform = encoder.toByteArray();
+
+    {
+        SNMPMessageView message;
+        SNMPVarbindView varbind;
+        qint64 seen = 0;
+        QElapsedTimer clock;
+
+        clock.start();
+        for(int i = 0; i < iterations; i++)
+        {
+            if(SNMPBer::decodeMessage(response.constData(), response.size(), message) != SNMPBer::DecodeOk)
+                break;
+            while(message.nextVarbind(varbind))
+                seen++;
+        }
+        const qint64 elapsed = clock.nsecsElapsed();
+
+        valid = valid && seen == qint64(iterations) * responseVarbinds;
+
+        QJsonObject run;
+        reportThroughput(run, iterations, qint64(iterations) * response.size(), elapsed);
+        result["response"] = run;
+    }
+
+    {
+        SNMPTrapView notification;
+        SNMPVarbindView varbind;
+        qint64 seen = 0;
+        QElapsedTimer clock;
+
+        clock.start();
+        for(int i = 0; i < iterations; i++)
+        {
+            if(!notification.decode(inform.constData(), inform.size()))
+                break;
+            while(notification.nextVarbind(varbind))
+                seen++;
+        }
+        const qint64 elapsed = clock.nsecsElapsed();
+
+        valid = valid && seen == qint64(iterations) * 3 && notification.timeStamp == 360000;
+
+        QJsonObject run;
+        reportThroughput(run, iterations, qint64(iterations) * inform.size(), elapsed);
+        result["inform"] = run;
+    }
+
+    {
+        std::vector<CorpusDatagram> corpus = loadCorpus(corpusDirectory);
+        SNMPTrapView notification;
+        SNMPMessageView message;
+        SNMPVarbindView varbind;
+        SNMPUsm usm;
+        usm.setUser("bench", "authentication password", "privacy password");
+
+        auto decode = [&](const CorpusDatagram &datagram, qint64 &varbinds) -> int {
+            const char *data = datagram.data.constData();
+            const int size = datagram.data.size();
+            int status;
+
+            if(datagram.decoder == CorpusNotification)
+            {
+                status = notification.decode(data, size) ? 0 : -1;
+                while(status == 0 && notification.nextVarbind(varbind))
+                    varbinds++;
+                return status;
+            }
+
+            if(datagram.decoder == CorpusMessage)
+                status = SNMPBer::decodeMessage(data, size, message) == SNMPBer::DecodeOk ? 0 : -1;
+            else
+                status = usm.decode(data, size, message);
+
+            const bool decoded = datagram.decoder == CorpusMessage
+                                 ? status == 0
+                                 : status == SNMPUsm::Accepted || status == SNMPUsm::ReportReceived;
+            if(decoded)
+            {
+                while(message.nextVarbind(varbind))
+                    varbinds++;
+            }
+            return status;
+        };
+
+        // twice: a report teaches the engine ID the first time only
+        for(int pass = 0; pass < 2; pass++)
+        {
+            for(CorpusDatagram &datagram : corpus)
+            {
+                datagram.varbinds = 0;
+                datagram.status = decode(datagram, datagram.varbinds);
+            }
+        }
+
+        qint64 seen = 0;
+        qint64 expected = 0;
+        qint64 bytes = 0;
+        int changed = 0;
+        QElapsedTimer clock;
+
+        clock.start();
+        for(int i = 0; i < iterations && !corpus.empty(); i++)
+        {
+            const CorpusDatagram &datagram = corpus[size_t(i) % corpus.size()];
+            if(decode(datagram, seen) != datagram.status)
+                changed++;
+            expected += datagram.varbinds;
+            bytes += datagram.data.size();
+        }
+        const qint64 elapsed = clock.nsecsElapsed();
+
+        valid = valid && !corpus.empty() && changed == 0 && seen == expected;
+
+        QJsonObject run;
+        reportThroughput(run, corpus.empty() ? 0 : iterations, bytes, elapsed);
+        run["datagrams"] = int(corpus.size());
+        result["corpus"] = run;
+    }
+
+    return valid;
+}
+
+/**
+*   Records into SNMPMetrics what a session records per request, from one thread:
+*   - count: SNMPMetrics::count of a counter, as for every retry or timeout;
+*   - response: recordResponse with a round-trip time, as for every response.
+*   The snapshot must hold every count and every round-trip time.
+*/
+static bool benchmarkMetrics(int iterations, QJsonObject &result)
+{
+    const QHostAddress agent(QHostAddress::LocalHost);
+    SNMPMetrics metrics;
+    const int agentIndex = metrics.agentIndex(agent);
+    QElapsedTimer clock;
+
+    // the first call creates the shard and the histogram of the thread
+    metrics.count(SNMPMetrics::Retries, 0);
+    metrics.recordResponse(agentIndex, 0, 0);
+
+    clock.start();
+    for(int i = 0; i < iterations; i++)
+        metrics.count(SNMPMetrics::Retries);
+    qint64 elapsed = clock.nsecsElapsed();
+
+    QJsonObject run;
+    reportRate(run, iterations, elapsed);
+    result["count"] = run;
+
+    clock.start();
+    for(int i = 0; i < iterations; i++)
+        metrics.recordResponse(agentIndex, 100, 100 + (i & 1023));
+    elapsed = clock.nsecsElapsed();
+
+    run = QJsonObject();
+    reportRate(run, iterations, elapsed);
+    result["response"] = run;
+
+    const SNMPMetricsSnapshot snapshot = metrics.snapshot();
+    return snapshot.counter(SNMPMetrics::Retries) == quint64(iterations)
+           && snapshot.counter(SNMPMetrics::ResponsesReceived) == quint64(iterations) + 1
+           && snapshot.roundTripTimes.value(agent).count() == quint64(iterations) + 1;
+}
+
+/**
+*   Updates 10000 Counter64 series of SNMPRateEngine round-robin, 100 agents of 100
+*   ifHCInOctets rows: by series index, then looking every series up by agent and
+*   encoded OID the way a response handler does. Every update must be valid, with
+*   the delta the counters were given.
+*/
+static bool benchmarkRate(int iterations, QJsonObject &result)
+{
+    const int agents = 100;
+    const int rows = 100;
+    const int seriesCount = agents * rows;
+    SNMPRateEngine engine(seriesCount);
+    std::vector<int> series;
+    std::vector<quint32> seriesAgents;
+    std::vector<QByteArray> seriesOids;
+    bool valid = true;
+
+    for(int agent = 0; agent < agents; agent++)
+    {
+        for(int row = 1; row <= rows; row++)
+        {
+            const SNMPOid oid = SNMPOid::fromString(QString("1.3.6.1.2.1.31.1.1.1.6.%1").arg(row));
+            series.push_back(engine.series(quint32(agent), oid));
+            seriesAgents.push_back(quint32(agent));
+            seriesOids.push_back(oid.encoded());
+            engine.update(series.back(), 0, SNMPBer::Counter64, 0);
+        }
+    }
+
+    // every round advances all the counters by 100 and the clock by a second
+    qint64 round = 0;
+    for(bool lookup : { false, true })
+    {
+        QElapsedTimer clock;
+        quint64 deltas = 0;
+        int invalid = 0;
+
+        clock.start();
+        for(int i = 0; i < iterations; i++)
+        {
+            const int index = i % seriesCount;
+            if(index == 0)
+                round++;
+
+            const int target = lookup ? engine.series(seriesAgents[index], seriesOids[index].constData(),
+                                                      seriesOids[index].size())
+                                      : series[index];
+            const SNMPRate rate = engine.update(target, quint64(round) * 100, SNMPBer::Counter64,
+                                                round * 1000);
+            deltas += rate.delta;
+            if(!rate.isValid())
+                invalid++;
+        }
+        const qint64 elapsed = clock.nsecsElapsed();
+
+        // the rest of the round, so that the next run starts with every series a round behind
+        for(int index = iterations % seriesCount; index != 0 && index < seriesCount; index++)
+            engine.update(series[index], quint64(round) * 100, SNMPBer::Counter64, round * 1000);
+
+        QJsonObject run;
+        reportRate(run, iterations, elapsed);
+        result[lookup ? "lookup" : "indexed"] = run;
+        valid = valid && invalid == 0 && deltas == quint64(iterations) * 100;
+    }
+
+    return valid && engine.size() == seriesCount;
+}
+
+/**
+*   Echoes datagrams over loopback between two SNMPDatagramTransports: a client keeps
+*   a window of them in flight, a responder sends back every batch it receives. Both
+*   send with sendmmsg and receive with recvmmsg. Every echo must carry a sequence
+*   number the client sent, and none may be lost.
+*/
+static bool benchmarkTransport(int iterations, QJsonObject &result)
+{
+    const int window = 128;
+    const int datagramSize = 100;
+
+    SNMPDatagramTransport client(64, 2048);
+    SNMPDatagramTransport responder(64, 2048);
+    if(!client.bind(0) || !responder.bind(0))
+    {
+        result["skipped"] = "sendmmsg/recvmmsg are not available";
+        return true;
+    }
+    client.setSocketReceiveBufferSize(1 << 20);
+    responder.setSocketReceiveBufferSize(1 << 20);
+
+    const QHostAddress loopback(QHostAddress::LocalHost);
+    const quint16 clientPort = client.localPort();
+    const quint16 responderPort = responder.localPort();
+
+    char datagram[datagramSize];
+    memset(datagram, 0, sizeof(datagram));
+    quint32 sent = 0;
+    quint32 received = 0;
+    bool valid = true;
+
+    QElapsedTimer clock;
+    QElapsedTimer sinceProgress;
+    clock.start();
+    sinceProgress.start();
+
+    while(received < quint32(iterations))
+    {
+        while(sent < quint32(iterations) && sent - received < quint32(window))
+        {
+            memcpy(datagram, &sent, sizeof(sent));
+            client.queueDatagram(datagram, datagramSize, loopback, responderPort);
+            sent++;
+        }
+        client.flush();
+
+        do
+        {
+            const int count = responder.receive();
+            for(int i = 0; i < count; i++)
+                responder.queueDatagram(responder.datagramData(i), responder.datagramSize(i),
+                                        loopback, clientPort);
+            responder.flush();
+        } while(responder.hasPendingDatagrams());
+
+        const quint32 before = received;
+        do
+        {
+            const int count = client.receive();
+            for(int i = 0; i < count; i++)
+            {
+                quint32 sequence;
+                memcpy(&sequence, client.datagramData(i), sizeof(sequence));
+                valid = valid && client.datagramSize(i) == datagramSize && sequence < sent;
+                received++;
+            }
+        } while(client.hasPendingDatagrams());
+
+        if(received != before)
+            sinceProgress.restart();
+        else if(sinceProgress.elapsed() > 2000)
+        {
+            // loopback does not lose datagrams unless a socket buffer overflowed
+            valid = false;
+            break;
+        }
+    }
+    const qint64 elapsed = clock.nsecsElapsed();
+
+    reportRate(result, received, elapsed);
+    result["lost"] = double(sent - received);
+    result["client_datagrams_per_send_call"] = client.datagramsPerSendCall();
+    result["client_datagrams_per_receive_call"] = client.datagramsPerReceiveCall();
+    result["responder_datagrams_per_send_call"] = responder.datagramsPerSendCall();
+    result["responder_datagrams_per_receive_call"] = responder.datagramsPerReceiveCall();
+    return valid;
+}
+
+/**
+*   Passes sequence numbers from a producer thread to the consumer, the calling
+*   thread, through an SNMPSpscQueue of the default SNMPEngine size. A side which finds
+*   the queue full or empty yields and tries again. The consumer must receive every
+*   number once, in order.
+*/
+static bool benchmarkSpscQueue(int iterations, QJsonObject &result)
+{
+    SNMPSpscQueue<quint32> queue(4096);
+    quint64 fullRetries = 0;
+    quint64 emptyRetries = 0;
+    bool valid = true;
+
+    QThread *producer = QThread::create([&queue, &fullRetries, iterations]() {
+        for(quint32 i = 1; i <= quint32(iterations); i++)
+        {
+            while(!queue.push(i))
+            {
+                fullRetries++;
+                QThread::yieldCurrentThread();
+            }
+        }
+    });
+
+    QElapsedTimer clock;
+    clock.start();
+    producer->start();
+
+    for(quint32 expected = 1; expected <= quint32(iterations); expected++)
+    {
+        quint32 value;
+        while(!queue.pop(value))
+        {
+            emptyRetries++;
+            QThread::yieldCurrentThread();
+        }
+        valid = valid && value == expected;
+    }
+    const qint64 elapsed = clock.nsecsElapsed();
+
+    producer->wait();
+    delete producer;
+    valid = valid && queue.isEmpty();
+
+    reportRate(result, iterations, elapsed);
+    result["full_retries"] = double(fullRetries);
+    result["empty_retries"] = double(emptyRetries);
+    return valid;
+}
+
+/**
+*   Drives an SNMPTimerWheel the way a session does, one simulated millisecond per
+*   step, with 10 ms ticks and timeouts spread over 3 to 5 seconds:
+*   - schedule_cancel: every step schedules a timer and cancels the one scheduled
+*     2048 steps before, as for requests which are answered;
+*   - schedule_expire: every step schedules a timer and expires the due ones, as for
+*     requests which time out, until all of them expired.
+*   Every cancel must find its timer, and every timer must expire once, in the tick
+*   of its deadline.
+*/
+static bool benchmarkTimerWheel(int iterations, QJsonObject &result)
+{
+    const int tickInterval = 10;
+    const int outstanding = 2048;
+    bool valid = true;
+
+    {
+        SNMPTimerWheel wheel(tickInterval, outstanding);
+        std::vector<int> timers(outstanding, -1);
+        QElapsedTimer clock;
+
+        clock.start();
+        for(int i = 0; i < iterations; i++)
+        {
+            const int index = i % outstanding;
+            if(timers[index] != -1)
+                valid = wheel.cancel(timers[index], quint32(i - outstanding)) && valid;
+            timers[index] = wheel.schedule(i + 3000 + (i * 7919) % 2000, quint32(i));
+            wheel.expire(i, [&valid](quint32) { valid = false; });
+        }
+        const qint64 elapsed = clock.nsecsElapsed();
+
+        valid = valid && wheel.size() == qMin(iterations, outstanding);
+
+        QJsonObject run;
+        reportRate(run, iterations, elapsed);
+        result["schedule_cancel"] = run;
+    }
+
+    {
+        SNMPTimerWheel wheel(tickInterval, outstanding);
+        std::vector<qint64> deadlines(iterations);
+        qint64 now = 0;
+        int scheduled = 0;
+        int expired = 0;
+        QElapsedTimer clock;
+
+        clock.start();
+        for(; expired < iterations; now++)
+        {
+            if(scheduled < iterations)
+            {
+                deadlines[scheduled] = now + 3000 + (scheduled * 7919) % 2000;
+                wheel.schedule(deadlines[scheduled], quint32(scheduled));
+                scheduled++;
+            }
+            expired += wheel.expire(now, [&](quint32 key) {
+                const qint64 deadline = deadlines[key];
+                valid = valid && deadline <= now && now - deadline < tickInterval;
+                deadlines[key] = -1;
+            });
+        }
+        const qint64 elapsed = clock.nsecsElapsed();
+
+        valid = valid && wheel.isEmpty();
+
+        QJsonObject run;
+        reportRate(run, iterations, elapsed);
+        run["simulated_seconds"] = now / 1e3;
+        result["schedule_expire"] = run;
+    }
+
+    return valid;
+}
+
+/**
+*   Encodes get-requests with one varbind and decodes them on the other side, as
+*   a manager and an agent would, once as SNMPv2c messages and once as SNMPv3
+*   messages with authPriv security (HMAC-SHA-96 and AES-128). Both SNMPUsm learn
+*   the same engine from a discovery report first. Reports the cost of each and
+*   the ratio of authPriv to SNMPv2c; every message must decode to its request ID.
+*/
+static bool benchmarkUsm(int iterations, QJsonObject &result)
+{
+    static const SNMPOid ifInOctets = "1.3.6.1.2.1.2.2.1.10.1"_oid;
+    const QByteArray community("public");
+    const QByteArray report = QByteArray::fromHex(
+        "3064020103300d02014d020205c0040100020103041f301d040d80001f8880e9630000d61ff449"
+        "020103020301e240040004000400302f040d80001f8880e9630000d61ff4490400a81c02014d"
+        "0201000201003011300f060a2b060106030f01010400410101");
+    SNMPBerWriter encoder;
+    SNMPMessageView message;
+    SNMPVarbindView varbind;
+    bool valid = true;
+
+    SNMPUsm manager, agent;
+    for(SNMPUsm *usm : { &manager, &agent })
+    {
+        usm->setUser("bench", "authentication password", "privacy password");
+        valid = valid && usm->decode(report.constData(), report.size(), message) == SNMPUsm::Resynchronized;
+    }
+
+    qint64 elapsed[2];
+    for(int secure = 0; secure < 2; secure++)
+    {
+        qint64 seen = 0;
+        QElapsedTimer clock;
+
+        clock.start();
+        for(int i = 1; i <= iterations; i++)
+        {
+            encoder.reset();
+            const int varbindEnd = encoder.mark();
+            encoder.writeNull();
+            encoder.writeOctetString(ifInOctets.encoded(), SNMPBer::ObjectIdentifier);
+            encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+
+            if(secure)
+            {
+                encoder.writePduHeader(SNMPBer::GetRequest, quint32(i));
+                manager.encode(encoder, quint32(i));
+                if(agent.decode(encoder.data(), encoder.size(), message) != SNMPUsm::Accepted)
+                    break;
+            }
+            else
+            {
+                encoder.writeMessageHeader(SNMPBer::Version2c, community, SNMPBer::GetRequest, quint32(i));
+                if(SNMPBer::decodeMessage(encoder.data(), encoder.size(), message) != SNMPBer::DecodeOk)
+                    break;
+            }
+
+            if(message.requestId == quint32(i) && message.nextVarbind(varbind))
+                seen++;
+        }
+        elapsed[secure] = clock.nsecsElapsed();
+        valid = valid && seen == iterations;
+
+        QJsonObject run;
+        reportRate(run, iterations, elapsed[secure]);
+        run["bytes_per_message"] = encoder.size();
+        result[secure ? "authpriv" : "v2c"] = run;
+    }
+
+    result["authpriv_to_v2c"] = elapsed[0] > 0 ? double(elapsed[1]) / elapsed[0] : 0.0;
+    return valid;
+}
+
+
+//----[ main ]---------------------------------------------------------------------------
+
+static const struct {
+    const char *name;
+    BenchmarkCase run;
+} benchmarkCases[] = {
+    { "decode", benchmarkDecode },
+    { "encode", benchmarkEncode },
+    { "metrics", benchmarkMetrics },
+    { "rate", benchmarkRate },
+    { "spsc", benchmarkSpscQueue },
+    { "timerwheel", benchmarkTimerWheel },
+    { "transport", benchmarkTransport },
+    { "usm", benchmarkUsm }
+};
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Microbenchmarks of the SNMP library");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "iterations", "Operations per case (1000000).", "count", "1000000" },
+        { "corpus", "Directory of the datagrams the decode case replays (" QTSNMP_CORPUS_DIR ").",
+          "directory", QTSNMP_CORPUS_DIR },
+        { "output", "Write the JSON report to a file instead of stdout.", "file" }
+    });
+    parser.addPositionalArgument("cases", "Cases to run, all of them by default.", "[case...]");
+    parser.process(application);
+
+    const int iterations = qMax(1, parser.value("iterations").toInt());
+    corpusDirectory = parser.value("corpus");
+    const QStringList selected = parser.positionalArguments();
+    QJsonObject report;
+    int status = 0;
+
+    for(const auto &benchmark : benchmarkCases)
+    {
+        if(!selected.isEmpty() && !selected.contains(benchmark.name))
+            continue;
+
+        QJsonObject result;
+        if(!benchmark.run(iterations, result))
+        {
+            fprintf(stderr, "snmpmicrobench: %s produced a wrong result\n", benchmark.name);
+            status = 1;
+        }
+        report[benchmark.name] = result;
+    }
+
+    QFile output;
+    if(parser.value("output").isEmpty())
+        output.open(stdout, QIODevice::WriteOnly);
+    else
+    {
+        output.setFileName(parser.value("output"));
+        output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+    output.write(QJsonDocument(report).toJson());
+
+    return status;
+}
@@ -0,0 +1,78 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * libFuzzer harness of the decoders which read datagrams from the network:
+ * v1/v2c messages and PDUs (SNMPBer::decodeMessage and decodePdu), the
+ * values and OIDs of their varbinds, notifications (SNMPTrapView) and SNMPv3
+ * messages (SNMPUsm). Built with -DQTSNMP_BUILD_FUZZER=ON and clang:
+ *
+ *     snmpberfuzzer -max_len=1472 corpus-copy
+ *
+ * where corpus-copy starts as a copy of fuzz/corpus, the seed messages.
+ *
+ * Besides the sanitizers, it aborts when a decoder accepts a varbind list
+ * which then cannot be iterated to its end.
+ *
+ */
+
+
+#include <QString>
+#include <cstdint>
+#include <cstdlib>
+#include "snmpber.h"
+#include "snmpoid.h"
+#include "snmptrapreceiver.h"
+#include "snmpusm.h"
+#include "snmpvalue.h"
+
+static void readVarbinds(SNMPMessageView &message)
+{
+    SNMPVarbindView varbind;
+    SNMPValue value;
+    QString text;
+
+    while(message.nextVarbind(varbind))
+    {
+        SNMPBer::objectIdentifierToString(varbind.oid.value, varbind.oid.length);
+        SNMPBer::valueToString(varbind.value, text);
+        if(value.decode(varbind.value))
+            value.toString();
+    }
+
+    if(!message.varbinds.atEnd())
+        abort();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    const char *datagram = reinterpret_cast<const char *>(data);
+    const int length = int(size > 65535 ? 65535 : size);
+    SNMPMessageView message;
+
+    if(SNMPBer::decodeMessage(datagram, length, message) == SNMPBer::DecodeOk)
+        readVarbinds(message);
+
+    if(SNMPBer::decodePdu(datagram, length, message) == SNMPBer::DecodeOk)
+        readVarbinds(message);
+
+    SNMPTrapView notification;
+    if(notification.decode(datagram, length))
+    {
+        SNMPVarbindView varbind;
+        while(notification.nextVarbind(varbind))
+            SNMPOid::fromEncoded(varbind.oid.value, varbind.oid.length);
+
+        if(!notification.varbinds.atEnd())
+            abort();
+    }
+
+    // a fresh user each time, so that an input does not depend on the ones before
+    SNMPUsm usm;
+    usm.setUser("fuzzer", "authentication", "privacy");
+    if(usm.decode(datagram, length, message) == SNMPUsm::Accepted)
+        readVarbinds(message);
+
+    return 0;
+}
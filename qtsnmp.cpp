@@ -1,12 +1,32 @@
 #include "qtsnmp.h"
+#include "snmpbufferpool.h"
 #include <QObject>
-#include <QThread>
+#include <QEventLoop>
+#include <QMetaMethod>
+#include <QRandomGenerator>
+#include <string.h>
+
+// Resolution of the retry deadlines, in milliseconds: the tick of the timer wheel
+static const int retryTimerInterval = 10;
+
+// Largest UDP payload, the receive buffer is allocated once with this size
+static const int maxDatagramSize = 65507;
+
+// Upper bound for everything in a message but its varbinds: the message, PDU and
+// varbind list headers, version, request ID, error status and error index,
+// plus the community header. The community string itself comes on top.
+static const int messageOverhead = 32;
 
 //----[ Constructors/Destructors ]-----------------------------------------------------
 
 SNMPSession::SNMPSession()
-        : QObject()
+        : QObject(), retryTimers(retryTimerInterval)
 {
+    this->agentAddress = NULL;
+    this->agentPort = 0;
+    this->socketPort = 0;
+    this->batchedTransport = NULL;
+    initSession();
 }
 
 /**
@@ -15,12 +35,14 @@ SNMPSession::SNMPSession()
 *   This allows the socket to emit the readyRead signal on datagram arrival.
 */
 SNMPSession::SNMPSession(const QString &agentAddress, qint16 agentPort, qint16 socketPort)
-        : QObject()
+        : QObject(), retryTimers(retryTimerInterval)
 {
     this->agentAddress = new QHostAddress(agentAddress);
     this->agentPort = agentPort;
     this->socketPort = socketPort;
+    this->batchedTransport = NULL;
     udpSocket.bind(socketPort);
+    initSession();
 }
 
 SNMPSession::~SNMPSession()
@@ -34,12 +56,17 @@ SNMPSession::~SNMPSession()
 
 void SNMPSession::setAgentAddress(const QString &agentAddress)
 {
+    delete this->agentAddress;
     this->agentAddress = new QHostAddress(agentAddress);
+    if(metrics)
+        metricsAgent = metrics->agentIndex(*this->agentAddress);
+    pduLimits.reset();
 }
 
 void SNMPSession::setAgentPort(qint16 agentPort)
 {
     this->agentPort = agentPort;
+    pduLimits.reset();
 }
 
 void SNMPSession::setSocketPort(qint16 socketPort)
@@ -61,688 +88,1513 @@ qint16 SNMPSession::getSocketPort() const
     return socketPort;
 }
 
+int SNMPSession::getVersion() const
+{
+    return version;
+}
 
-//----[ SNMP set-request/get-request methods ]-------------------------------------------------
+/**
+*   Selects the message version, SNMPBer::Version1 (the default), SNMPBer::Version2c
+*   or SNMPBer::Version3. With SNMPBer::Version3 requests are sent as the user set with
+*   SNMPSession::setUser, and the community string arguments are ignored.
+*/
+void SNMPSession::setVersion(int version)
+{
+    this->version = version;
+}
 
+/**
+*   Sets the SNMPv3 user of the session. An empty authentication password sends
+*   noAuthNoPriv messages, an empty privacy password authNoPriv (HMAC-SHA-96), both
+*   passwords authPriv (HMAC-SHA-96 and AES-128). The first request discovers the
+*   engine ID of the agent; requests wait for it, then go out in order.
+*/
+void SNMPSession::setUser(const QString &userName, const QString &authPassword,
+                          const QString &privPassword)
+{
+    usm.setUser(userName.toUtf8(), authPassword.toUtf8(), privPassword.toUtf8());
+}
 
 /**
-*   This method will send a SNMP set-request with the specified community string,
-*   OID and integer value.
-*   Returns 0 on success or one of the following error codes on failture :
-*   1 -- Response message too large to transport
-*   2 -- The name of the requested object was not found
-*   3 -- A data type in the request did not match the data type in the SNMP agent
-*   4 -- The SNMP manager attempted to set a read-only parameter
-*   5 -- General Error (some error other than the ones listed above)
-*   6 -- Timeout, no response from agent (5 seconds)
+*   Returns the engine ID of the agent once it is discovered, or an empty array.
 */
-int SNMPSession::sendSetRequest(const QString &communityStringParameter, const QString oidParameter, int value)
+QByteArray SNMPSession::getEngineId() const
+{
+    return usm.getEngineId();
+}
+
+int SNMPSession::getMaxMessageSize() const
 {
-    QByteArray communityString = communityStringParameter.toLatin1();
-    QByteArray oid = oidParameter.toLatin1();
+    return pduLimits.getMessageSizeCeiling();
+}
 
-    QByteArray datagram; // the datagram to send
-    QByteArray receivedDatagram; // the received value
-    const int errorIndex = 14 + communityString.size();
+/**
+*   Sets the largest size multi-varbind requests are packed to, 1472 bytes by default
+*   and never less than 484. The session packs them to the size it learned the agent
+*   copes with, see SNMPSession::getPduLimits.
+*/
+void SNMPSession::setMaxMessageSize(int maxMessageSize)
+{
+    pduLimits.setCeilings(pduLimits.getVarbindCeiling(), pduLimits.getRepetitionCeiling(),
+                          maxMessageSize);
+}
 
-// include Value field
-    int currentLength = 0;
-    if(value > 256)
-    {
-        unsigned char secondByte = value;
-        int firstByte = value >> 8;
-        datagram.push_back(firstByte);
-        datagram.push_back(secondByte);
-        datagram.push_front(0x02);
-        datagram.push_front(0x02);
-        currentLength += 4;
-    } else
+/**
+*   Returns what the session learned about the agent: the varbinds per request, the
+*   GetBulk repetitions and the message size it currently uses.
+*   They grow while the agent answers and are halved when it answers tooBig or when a
+*   large request times out while smaller ones get through; the requests of a batch
+*   or a bulk walk which were too large are split or shrunk and sent again.
+*/
+const SNMPPduLimits &SNMPSession::getPduLimits() const
+{
+    return pduLimits;
+}
+
+/**
+*   Sets how many varbinds per request and GetBulk repetitions the session may grow
+*   to, 64 and 100 by default. A bulk walk never asks for more repetitions than given
+*   to SNMPSession::bulkWalk either.
+*/
+void SNMPSession::setPduLimitCeilings(int maxVarbinds, int maxRepetitions)
+{
+    pduLimits.setCeilings(maxVarbinds, maxRepetitions, pduLimits.getMessageSizeCeiling());
+}
+
+/**
+*   Moves the session to a SNMPDatagramTransport on the same socket port, which
+*   sends the requests of one event loop iteration with a single sendmmsg call and
+*   reads replies with recvmmsg. Disabling it goes back to the QUdpSocket.
+*   Returns false if batching is not supported on this system or the port cannot
+*   be bound; the session then keeps its current transport.
+*/
+bool SNMPSession::setBatchedTransport(bool enabled)
+{
+    if(enabled == (batchedTransport != NULL))
+        return true;
+
+    if(!enabled)
     {
-        datagram.push_front(value);
-        datagram.push_front(0x01);
-        datagram.push_front(0x02);
-        currentLength += 3;
+        // may be called from a slot connected to one of our signals, which runs
+        // while the transport is delivering datagrams
+        flushBatchedTransport();
+        batchedTransport->close();
+        batchedTransport->deleteLater();
+        batchedTransport = NULL;
+        udpSocket.bind(socketPort);
+        return true;
     }
-	
-    convertOIDAccordingToBER(oid);
-	
-// include Object Identifier field
-    datagram.push_front(oid);
-    datagram.push_front(oid.size());
-    datagram.push_front(0x6);
-    currentLength += oid.size();
-    currentLength += 2;
-	
-// include Varbind field
-    datagram.push_front(currentLength);
-    datagram.push_front(0x30);
-    currentLength += 2;
-	
-// include Varbind List field
-    datagram.push_front(currentLength);
-    datagram.push_front(0x30);
-    currentLength += 2;
-	
-// include Error Index field
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x1);
-    datagram.push_front(0x2);
-    currentLength += 3;
-	
-// include Error field
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x1);
-    datagram.push_front(0x2);
-    currentLength += 3;
-	
-// include Request ID
-    datagram.push_front((rand() % 100 + 1));
-    datagram.push_front(0x1);
-    datagram.push_front(0x2);
-    currentLength += 3;
-	
-// include PDU field
-    datagram.push_front(currentLength);
-    datagram.push_front(0xA3);
-    currentLength += 2;
-	
-// include Community string
-    datagram.push_front(communityString);
-    datagram.push_front(communityString.size());
-    datagram.push_front(0x04);
-    currentLength += communityString.size();
-    currentLength += 2;
-	
-// include SNMP version
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x01);
-    datagram.push_front(0x02);
-    currentLength += 3;
-	
-// finish the construction with the SNMP Message lenght and type code
-    datagram.push_front(currentLength);
-    datagram.push_front(0x30);
 
-// sending
-    udpSocket.writeDatagram(datagram, datagram.size(), *agentAddress, agentPort);
-	
-// Receive if there is an answer. Timeout after 5 seconds
-    int timeoutTimer = 0;
-    while(timeoutTimer <= 3000)
+    if(!SNMPDatagramTransport::isSupported())
+        return false;
+
+    // the port is only free once the QUdpSocket lets go of it
+    udpSocket.close();
+    // slots as large as the msgMaxSize advertised, as for the QUdpSocket; the ring's
+    // pages are only touched as far as the datagrams received reach
+    batchedTransport = new SNMPDatagramTransport(32, maxDatagramSize, this);
+    if(!batchedTransport->bind(socketPort))
     {
-        if(udpSocket.hasPendingDatagrams())
-        {
-            receivedDatagram.resize(udpSocket.pendingDatagramSize());
-            udpSocket.readDatagram(receivedDatagram.data(), receivedDatagram.size());
+        delete batchedTransport;
+        batchedTransport = NULL;
+        udpSocket.bind(socketPort);
+        return false;
+    }
 
-            decodeSNMP(receivedDatagram);
-            return errorStatus();
-        }
-		
-        QThread::msleep(1);
-        timeoutTimer++;
-    }
-	
-    // sending second try
-    udpSocket.writeDatagram(datagram, datagram.size(), *agentAddress, agentPort);
-    timeoutTimer = 0;
-	
-    while(timeoutTimer <= 3000)
-    {
-        if(udpSocket.hasPendingDatagrams())
-        {
-            receivedDatagram.resize(udpSocket.pendingDatagramSize());
-            udpSocket.readDatagram(receivedDatagram.data(), receivedDatagram.size());
+    connect(batchedTransport, &SNMPDatagramTransport::readyRead,
+            this, &SNMPSession::readBatchedDatagrams);
+    return true;
+}
 
-            decodeSNMP(receivedDatagram);
-            return errorStatus();
-        }
-		
-        QThread::msleep(1);
-        timeoutTimer++;
-    }
-	
-    // sending third try
-    udpSocket.writeDatagram(datagram, datagram.size(), *agentAddress, agentPort);
-    timeoutTimer = 0;
-	
-    while(timeoutTimer <= 500)
-    {
-        if(udpSocket.hasPendingDatagrams())
-        {
-            receivedDatagram.resize(udpSocket.pendingDatagramSize());
-            udpSocket.readDatagram(receivedDatagram.data(), receivedDatagram.size());
+QSharedPointer<SNMPRetryPolicy> SNMPSession::getRetryPolicy() const
+{
+    return retryPolicy;
+}
 
-            decodeSNMP(receivedDatagram);
-            return errorStatus();
-        }
-        QThread::msleep(1);
-        timeoutTimer++;
-    }
-	
-    return 6;
+/**
+*   Sets the policy which decides the timeouts and the number of attempts of the
+*   requests sent from now on, a SNMPAdaptiveRetryPolicy by default. A policy may
+*   be shared by several sessions, in other threads too if it is thread-safe as the
+*   library's own policies are. A null policy restores the default one.
+*/
+void SNMPSession::setRetryPolicy(const QSharedPointer<SNMPRetryPolicy> &retryPolicy)
+{
+    if(retryPolicy.isNull())
+        this->retryPolicy = QSharedPointer<SNMPRetryPolicy>(new SNMPAdaptiveRetryPolicy);
+    else
+        this->retryPolicy = retryPolicy;
 }
 
+QSharedPointer<SNMPMetrics> SNMPSession::getMetrics() const
+{
+    return metrics;
+}
+
+/**
+*   Records what the session sends and receives into metrics, which may be shared
+*   with other sessions and managers in any thread. Nothing is recorded by default,
+*   or after setting a null pointer.
+*/
+void SNMPSession::setMetrics(const QSharedPointer<SNMPMetrics> &metrics)
+{
+    this->metrics = metrics;
+    this->metricsAgent = metrics && agentAddress ? metrics->agentIndex(*agentAddress) : -1;
+}
+
+/**
+*   Returns the batched transport, for its datagrams-per-call counters, or NULL
+*   if the session uses its QUdpSocket.
+*/
+SNMPDatagramTransport *SNMPSession::getBatchedTransport() const
+{
+    return batchedTransport;
+}
+
+
+//----[ SNMP set-request/get-request methods ]-------------------------------------------------
+
 
 /**
 *   This method will send a SNMP set-request with the specified community string,
-*   OID and string value.
+*   OID and integer value, and wait for the response.
 *   Returns 0 on success or one of the following error codes on failture :
 *   1 -- Response message too large to transport
 *   2 -- The name of the requested object was not found
 *   3 -- A data type in the request did not match the data type in the SNMP agent
 *   4 -- The SNMP manager attempted to set a read-only parameter
 *   5 -- General Error (some error other than the ones listed above)
-*   6 -- Timeout, no response from agent (5 seconds)
+*   6 -- Timeout, no response from agent (see SNMPSession::setRetryPolicy)
+*   16 -- SNMPv3 request rejected by the security model of the agent
+*/
+int SNMPSession::sendSetRequest(const QString &communityStringParameter, const QString oidParameter, int value)
+{
+    return waitForRequest(sendSetRequestAsync(communityStringParameter, oidParameter, value), NULL);
+}
+
+
+/**
+*   This method will send a SNMP set-request with the specified community string,
+*   OID and string value, and wait for the response.
+*   Returns 0 on success or one of the following error codes on failture :
+*   1 -- Response message too large to transport
+*   2 -- The name of the requested object was not found
+*   3 -- A data type in the request did not match the data type in the SNMP agent
+*   4 -- The SNMP manager attempted to set a read-only parameter
+*   5 -- General Error (some error other than the ones listed above)
+*   6 -- Timeout, no response from agent (see SNMPSession::setRetryPolicy)
+*   16 -- SNMPv3 request rejected by the security model of the agent
 */
 int SNMPSession::sendSetRequest(const QString &communityStringParameter,
                        const QString oidParameter, const QString &valueParameter)
 {
-    QByteArray communityString = communityStringParameter.toLatin1();
-    QByteArray oid = oidParameter.toLatin1();
-    QByteArray value = valueParameter.toLatin1();
+    return waitForRequest(sendSetRequestAsync(communityStringParameter, oidParameter, valueParameter), NULL);
+}
+
+/**
+*   This method will send a SNMP get-request with the specified community string and OID
+*   and then place the received get-response value in the receivedValue variable.
+*   Returns 0 on success or one of the following error codes on failture :
+*   1 -- Response message too large to transport
+*   2 -- The name of the requested object was not found
+*   3 -- A data type in the request did not match the data type in the SNMP agent
+*   4 -- The SNMP manager attempted to set a read-only parameter
+*   5 -- General Error (some error other than the ones listed above)
+*   6 -- Timeout, no response from agent (see SNMPSession::setRetryPolicy)
+*   16 -- SNMPv3 request rejected by the security model of the agent
+*/
+int SNMPSession::sendGetRequest(QString &receivedValue,
+                                const QString &communityStringParameter, const QString &oidParameter)
+{
+    return waitForRequest(sendGetRequestAsync(communityStringParameter, oidParameter), &receivedValue);
+}
+
+
+//----[ Asynchronous set-request/get-request methods ]-------------------------------------------
+
+
+/**
+*   This method will send a SNMP set-request with the specified community string,
+*   OID and integer value, and return immediately.
+*   Returns the request ID. The outcome is reported later through the responseReceived
+*   signal, or through the requestFailed signal if the agent does not answer.
+*   Returns 0, and sends nothing, if the OID is malformed or no agent address is set.
+*/
+quint32 SNMPSession::sendSetRequestAsync(const QString &communityStringParameter,
+                                         const QString &oidParameter, int value)
+{
+    return sendSetRequestAsync(communityStringParameter, SNMPOid::intern(oidParameter), value);
+}
+
+quint32 SNMPSession::sendSetRequestAsync(const QString &communityStringParameter,
+                                         const SNMPOid &oid, int value)
+{
+    encoder.reset();
+
+// include Value field
+    encoder.writeInteger(value);
+
+    return startRequest(SNMPBer::SetRequest, communityStringParameter, oid);
+}
+
+/**
+*   This method will send a SNMP set-request with the specified community string,
+*   OID and string value, and return immediately.
+*   A value made of four dot separated numbers is sent as an IP address.
+*   Returns the request ID, see SNMPSession::sendSetRequestAsync.
+*/
+quint32 SNMPSession::sendSetRequestAsync(const QString &communityStringParameter,
+                                         const QString &oidParameter, const QString &valueParameter)
+{
+    return sendSetRequestAsync(communityStringParameter, SNMPOid::intern(oidParameter), valueParameter);
+}
+
+quint32 SNMPSession::sendSetRequestAsync(const QString &communityStringParameter,
+                                         const SNMPOid &oid, const QString &valueParameter)
+{
+// include Value field
+    encoder.reset();
+    writeStringValue(encoder, valueParameter.toLatin1());
 
-    QByteArray datagram; // the datagram to send
-    QByteArray receivedDatagram; // the received value
-    const int errorIndex = 14 + communityString.size();
+    return startRequest(SNMPBer::SetRequest, communityStringParameter, oid);
+}
 
+/**
+*   This method will write a string set value, as an IP address when it is made of
+*   four dot separated numbers and as an octet string otherwise.
+*/
+void SNMPSession::writeStringValue(SNMPBerWriter &writer, const QByteArray &value)
+{
     // check if the string is  Address
     bool isIPAddress = false;
     int dots = 0;
-	
+
     for(int i=0;i<value.length();i++)
     {
         if(value.at(i) == '.')
             dots++;
     }
-	
-    if(dots == 3)
-	{
-		isIPAddress = true;
-	}
 
-// include Value field
-    int currentLength = 0;
-    if(isIPAddress)
-    {
-        QList<QByteArray> octets = value.split('.');
-        for(int i=0;i<4;i++)
-            datagram.push_back(octets[i].toInt());
-        currentLength = 4;
-        datagram.push_front(currentLength);
-        datagram.push_front(0x40);
-        currentLength += 2;
-    } else
+    if(dots == 3)
     {
-        for(int i=0;i<value.size();i++)
-        {
-            datagram.push_back(value.at(i));
-            currentLength++;
-        }
-		
-        datagram.push_front(currentLength);
-        datagram.push_front(0x04);
-        currentLength += 2;
+        isIPAddress = true;
     }
 
-    convertOIDAccordingToBER(oid);
-	
-// include Object Identifier field
-    datagram.push_front(oid);
-    currentLength += oid.size();
-    datagram.push_front(oid.size());
-    datagram.push_front(0x6);
-    currentLength += 2;
-	
-// include Varbind field
-    datagram.push_front(currentLength);
-    datagram.push_front(0x30);
-    currentLength += 2;
-	
-// include Varbind List field
-    datagram.push_front(currentLength);
-    datagram.push_front(0x30);
-    currentLength += 2;
-	
-// include Error Index field
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x1);
-    datagram.push_front(0x2);
-    currentLength += 3;
-	
-// include Error field
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x1);
-    datagram.push_front(0x2);
-    currentLength += 3;
-	
-// include Request ID
-    datagram.push_front((rand() % 100 + 1));
-    datagram.push_front(0x1);
-    datagram.push_front(0x2);
-    currentLength += 3;
-	
-// include PDU field
-    datagram.push_front(currentLength);
-    datagram.push_front(0xA3);
-    currentLength += 2;
-	
-// include Community string
-    datagram.push_front(communityString);
-    datagram.push_front(communityString.size());
-    datagram.push_front(0x04);
-    currentLength += communityString.size();
-    currentLength += 2;
-	
-// include SNMP version
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x01);
-    datagram.push_front(0x02);
-    currentLength += 3;
-	
-// finish the construction with the SNMP Message lenght and type code
-    datagram.push_front(currentLength);
-    datagram.push_front(0x30);
-
-// sending
-    udpSocket.writeDatagram(datagram, datagram.size(), *agentAddress, agentPort);
-    int timeoutTimer = 0;
-	
-    while(timeoutTimer <= 3000)
+    if(isIPAddress)
     {
-        if(udpSocket.hasPendingDatagrams())
-        {
-            receivedDatagram.resize(udpSocket.pendingDatagramSize());
-            udpSocket.readDatagram(receivedDatagram.data(), receivedDatagram.size());
-
-            decodeSNMP(receivedDatagram);
-            return errorStatus();
-        }
-		
-        QThread::msleep(1);
-        timeoutTimer++;
-    }
-	
-    // sending second attempt
-    udpSocket.writeDatagram(datagram, datagram.size(), *agentAddress, agentPort);
-    timeoutTimer = 0;
-	
-    while(timeoutTimer <= 3000)
-    {
-        if(udpSocket.hasPendingDatagrams())
-        {
-            receivedDatagram.resize(udpSocket.pendingDatagramSize());
-            udpSocket.readDatagram(receivedDatagram.data(), receivedDatagram.size());
-
-            decodeSNMP(receivedDatagram);
-            return errorStatus();
-        }
-		
-        QThread::msleep(1);
-        timeoutTimer++;
-    }
-	
-    // sending third attempt
-    udpSocket.writeDatagram(datagram, datagram.size(), *agentAddress, agentPort);
-    timeoutTimer = 0;
-	
-    while(timeoutTimer <= 500)
-    {
-        if(udpSocket.hasPendingDatagrams())
+        char octets[4] = { 0, 0, 0, 0 };
+        int octet = 0;
+        for(int i=0;i<value.length();i++)
         {
-            receivedDatagram.resize(udpSocket.pendingDatagramSize());
-            udpSocket.readDatagram(receivedDatagram.data(), receivedDatagram.size());
-
-            decodeSNMP(receivedDatagram);
-            return errorStatus();
+            if(value.at(i) == '.')
+                octet++;
+            else
+                octets[octet] = octets[octet] * 10 + (value.at(i) - '0');
         }
-		
-        QThread::msleep(1);
-        timeoutTimer++;
+        writer.writeOctetString(octets, 4, SNMPBer::IpAddress);
+    } else
+    {
+        writer.writeOctetString(value);
     }
-	
-    return 6;
 }
 
 /**
-*   This method will send a SNMP get-request with the specified community string and OID
-*   and then place the received get-response value in the receivedValue variable.
-*   Returns 0 on success or one of the following error codes on failture :
-*   1 -- Response message too large to transport
-*   2 -- The name of the requested object was not found
-*   3 -- A data type in the request did not match the data type in the SNMP agent
-*   4 -- The SNMP manager attempted to set a read-only parameter
-*   5 -- General Error (some error other than the ones listed above)
-*   6 -- Timeout, no response from agent (5 seconds)
+*   This method will send a SNMP get-request with the specified community string and OID,
+*   and return immediately.
+*   Returns the request ID. The received value is delivered through the responseReceived
+*   signal, or the requestFailed signal is emitted if the agent does not answer.
+*   Returns 0 like SNMPSession::sendSetRequestAsync.
 */
-int SNMPSession::sendGetRequest(QString &receivedValue,
-                                const QString &communityStringParameter, const QString &oidParameter)
+quint32 SNMPSession::sendGetRequestAsync(const QString &communityStringParameter,
+                                         const QString &oidParameter)
 {
-    QByteArray communityString = communityStringParameter.toLatin1();
-    QByteArray oid = oidParameter.toLatin1();
+    return sendGetRequestAsync(communityStringParameter, SNMPOid::intern(oidParameter));
+}
 
-    QByteArray datagram; // the datagram to send
-    QByteArray receivedDatagram; // the received datagram
+/**
+*   Same as above, with an OID which is already encoded. Pollers sending the same OIDs
+*   over and over should keep them as SNMPOid, or as _oid literals.
+*/
+quint32 SNMPSession::sendGetRequestAsync(const QString &communityStringParameter, const SNMPOid &oid)
+{
+    encoder.reset();
 
 // include Value field
-    int currentLength = 2;
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x05);
+    encoder.writeNull();
 
-    convertOIDAccordingToBER(oid);
-	
-// include Object Identifier field
-    datagram.push_front(oid);
-    currentLength += oid.size();
-    datagram.push_front(oid.size());
-    datagram.push_front(0x6);
-    currentLength += 2;
-	
-// include Varbind field
-    datagram.push_front(currentLength);
-    datagram.push_front(0x30);
-    currentLength += 2;
-	
-// include Varbind List field
-    datagram.push_front(currentLength);
-    datagram.push_front(0x30);
-    currentLength += 2;
-	
-// include Error Index field
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x1);
-    datagram.push_front(0x2);
-    currentLength += 3;
-// include Error field
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x1);
-    datagram.push_front(0x2);
-    currentLength += 3;
-	
-// include Request ID
-    datagram.push_front((rand() % 100 + 1));
-    datagram.push_front(0x1);
-    datagram.push_front(0x2);
-    currentLength += 3;
-	
-// include PDU field
-    datagram.push_front(currentLength);
-    datagram.push_front(0xA0);
-    currentLength += 2;
-	
-// include Community string
-    datagram.push_front(communityString);
-    datagram.push_front(communityString.size());
-    datagram.push_front(0x04);
-    currentLength += communityString.size();
-    currentLength += 2;
-	
-// include SNMP version
-    datagram.push_front((char)0x0);
-    datagram.push_front(0x01);
-    datagram.push_front(0x02);
-    currentLength += 3;
-	
-// finish the construction with the SNMP Message lenght and type code
-    datagram.push_front(currentLength);
-    datagram.push_front(0x30);
-
-// SEND IT !!!
-    udpSocket.writeDatagram(datagram, datagram.size(), *agentAddress, agentPort);
-	
-// Receive it
-    int result = 0;
-
-    int timeoutTimer = 0;
-    while(timeoutTimer <= 3000)
-    {
-        if(udpSocket.hasPendingDatagrams())
-        {
-            return result = getValueFromGetResponse(receivedValue, receivedDatagram);
-        }
-		
-        QThread::msleep(1);
-        timeoutTimer++;
-    }
-	
-    // sending second attempt
-    udpSocket.writeDatagram(datagram, datagram.size(), *agentAddress, agentPort);
-    timeoutTimer = 0;
-	
-    while(timeoutTimer <= 3000)
-    {
-        if(udpSocket.hasPendingDatagrams())
-        {
-            return result = getValueFromGetResponse(receivedValue, receivedDatagram);
-        }
-		
-        QThread::msleep(1);
-        timeoutTimer++;
-    }
-	
-    // sending third attempt
-    udpSocket.writeDatagram(datagram, datagram.size(), *agentAddress, agentPort);
-    timeoutTimer = 0;
-	
-    while(timeoutTimer <= 500)
-    {
-        if(udpSocket.hasPendingDatagrams())
-        {
-            return result = getValueFromGetResponse(receivedValue, receivedDatagram);
-        }
-		
-        QThread::msleep(1);
-        timeoutTimer++;
-    }
-	
-    return 6;
+    return startRequest(SNMPBer::GetRequest, communityStringParameter, oid);
 }
 
+/**
+*   This method will forget about an outstanding request. A response arriving later
+*   for it is discarded and no signal is emitted.
+*   Returns false if the request was not pending.
+*/
+bool SNMPSession::cancelRequest(quint32 requestId)
+{
+    return takePendingRequest(requestId, NULL);
+}
 
-//----[ Additional public methods ]-------------------------------------------------
+int SNMPSession::pendingRequestCount() const
+{
+    return pendingRequests.size();
+}
 
 
+//----[ Multi-varbind requests ]---------------------------------------------------------
 
-//----[ Other private methods ]-----------------------------------------------------
 
-int SNMPSession::buildInt(int numBytes, QByteArray dataPart)
+/**
+*   This method will get all the given OIDs, packing as many varbinds per get-request
+*   as the limits learned for the agent allow (see SNMPSession::getPduLimits), and
+*   return immediately. Requests the agent answers with tooBig are split and sent again.
+*   Every OID is answered by one batchValueReceived signal carrying its index in
+*   oidParameters, then batchFinished is emitted. A varbind the agent rejects
+*   (error-index) is reported with the error status and the rest of its request
+*   is sent again without it.
+*   Returns the batch ID, or 0 if the list is empty, an OID is malformed or no agent
+*   address is set.
+*/
+quint32 SNMPSession::getBatch(const QString &communityStringParameter, const QStringList &oidParameters)
 {
-    int total = 0;
-    int swift = 0;
+    QVector<SNMPOid> oids;
+    oids.reserve(oidParameters.size());
 
-    for( int n = numBytes; n > 0; n --)
-    {
-       total += dataPart.at(n-1) & 0xff << swift;
-       swift += 8;
-    }
-    return total;
+    for(int i = 0; i < oidParameters.size(); i++)
+        oids.append(SNMPOid::intern(oidParameters[i]));
+
+    return getBatch(communityStringParameter, oids);
 }
 
-bool SNMPSession::decodeSNMP( QByteArray data)
+quint32 SNMPSession::getBatch(const QString &communityStringParameter, const QVector<SNMPOid> &oids)
 {
-    int i = 0;
-    while( i < data.length() )
+    varbindEncoder.reset();
+
+    // written from the last varbind to the first, so they end up in order
+    for(int i = oids.size() - 1; i >= 0; i--)
     {
-        struct tlv part;
-        part.type = data.at(i++) & 0xff;
-        part.len = data.at(i) & 0xff;
-        if( part.len > 0x80 ) // long form
-        {
-            int numBytes = part.len & 0x7f;
-            part.len = buildInt( numBytes, data.mid(++i));
-            i+=numBytes;
-        }
-        else
-            i++;
-        part.value = data.mid(i,part.len);
-        if( part.type == 0x02 || part.type == 0x04 || part.type  == 0x06 )
-           i += part.len;
-        snmpTlvParts.push_back(part);
+        if(!oids[i].isValid())
+            return 0;
+
+        const int varbindEnd = varbindEncoder.mark();
+        varbindEncoder.writeNull();
+        varbindEncoder.writeOctetString(oids[i].encoded(), SNMPBer::ObjectIdentifier);
+        varbindEncoder.endConstructed(varbindEnd, SNMPBer::Sequence);
     }
+
+    return startBatch(SNMPBer::GetRequest, communityStringParameter, varbindEncoder, oids.size());
 }
 
 /**
-*   This method will extract the value from the specified GetResponse datagram.
-*   Returns 0 on success or one of the following error codes on failture :
-*   1 -- Response message too large to transport
-*   2 -- The name of the requested object was not found
-*   3 -- A data type in the request did not match the data type in the SNMP agent
-*   4 -- The SNMP manager attempted to set a read-only parameter
-*   5 -- General Error (some error other than the ones listed above)
-*   6 -- Timeout, no response from agent (5 seconds)
+*   This method will encode a get-request for the given OIDs once, for sending it again
+*   and again with SNMPSession::sendPreparedRequest. The community and the session
+*   version are fixed at this point. All the varbinds go in one request, whatever the
+*   maximum message size; only if the agent answers tooBig are they split like a batch.
+*   Returns an invalid request if the list is empty or an OID is invalid.
 */
-int SNMPSession::getValueFromGetResponse(QString &receivedValue, QByteArray &receivedDatagram)
+SNMPPreparedRequest SNMPSession::prepareGetRequest(const QString &communityStringParameter,
+                                                   const QVector<SNMPOid> &oids)
 {
+    SNMPPreparedRequest request;
+    SNMPBerWriter varbinds;
 
-    receivedDatagram.resize(udpSocket.pendingDatagramSize());
-    int len = udpSocket.readDatagram(receivedDatagram.data(), receivedDatagram.size());
-    decodeSNMP(receivedDatagram);
+    if(oids.isEmpty())
+        return request;
 
-    int valueType = snmpTlvParts[10].type;
-    int valueLenght = snmpTlvParts[10].len;
-    QByteArray data = snmpTlvParts[10].value;
-	
-    // if there is a problem, return the error code
-    if( errorStatus() != 0)
-	{
-        return errorStatus();
-	}
-		
-    // if it's integer
-    if( valueType == 0x02)
-    {
-        receivedValue = QString::number(buildInt(valueLenght,snmpTlvParts[10].value));
-        return 0;
-    }
-	
-    // if it's an  IP address
-    if( valueType == 0x40)
+    for(int i = oids.size() - 1; i >= 0; i--)
     {
-        QString octet;
-        for(int i = 0;i < valueLenght; i++){
-            octet = QString::number((unsigned char)snmpTlvParts[10].value.at(i), 10);
-            receivedValue.push_back(octet);
-            receivedValue.push_back(".");
-        }
-		
-        receivedValue.truncate(receivedValue.size()-1);
-		
-        return 0;
+        if(!oids[i].isValid())
+            return request;
+
+        const int varbindEnd = varbinds.mark();
+        varbinds.writeNull();
+        varbinds.writeOctetString(oids[i].encoded(), SNMPBer::ObjectIdentifier);
+        varbinds.endConstructed(varbindEnd, SNMPBer::Sequence);
     }
-	
-   // if it's an octet string
-   if( valueType == 0x04)
+
+    QSharedPointer<SNMPPreparedRequest::Data> d(new SNMPPreparedRequest::Data);
+    d->pduType = SNMPBer::GetRequest;
+    d->communityString = communityStringParameter.toLatin1();
+    d->varbinds = varbinds.toByteArray();
+
+    SNMPBerReader reader(d->varbinds.constData(), d->varbinds.size());
+    SNMPBerElement element;
+    d->offsets.append(0);
+    while(reader.next(element))
     {
-        receivedValue = data;
-        return 0;
+        d->indexes.append(d->offsets.size() - 1);
+        d->offsets.append(int(element.value + element.length - d->varbinds.constData()));
     }
-	
-    return 6;
-}
 
+    // any ID whose minimal encoding takes four bytes, which most of the 32-bit space does
+    const quint32 placeholderId = 0x01000000;
+
+    encoder.reset();
+    encoder.writeRaw(d->varbinds.constData(), d->varbinds.size());
+    const int requestIdEnd = encoder.writeMessageHeader(version, d->communityString, d->pduType,
+                                                        placeholderId);
+
+    d->message = encoder.toByteArray();
+    d->requestIdLength = 4;
+    d->requestIdOffset = encoder.size() - requestIdEnd - d->requestIdLength;
+
+    request.d = d;
+    return request;
+}
 
 /**
-*   This method will return the bytes of an integer bigger than 127,
-*   according to the Basic Encoding Rules (BER).
+*   This method will send a prepared request, only replacing its request ID.
+*   The values are reported like those of a SNMPSession::getBatch of the same OIDs:
+*   one batchValueReceived per OID, then batchFinished.
+*   The request is only read: sessions on other threads may send it at the same time.
+*   Returns the batch ID, or 0 if the request is invalid or no agent address is set.
 */
-QByteArray SNMPSession::convertIntAccordingToBER(int valueToConvert)
+quint32 SNMPSession::sendPreparedRequest(const SNMPPreparedRequest &request)
 {
-    QByteArray convertedValue;
-    QString binValue = QString::number(valueToConvert, 2);
-	
-    if(binValue.size()>14)
-    {
-        QString firstByte;
-        QString secondByte;
-        QString thirdByte;
+    if(!request.isValid() || !agentAddress)
+        return 0;
 
-        thirdByte = binValue.right(7);
-        binValue.truncate(binValue.size()-7);
-        secondByte = binValue.right(7);
-            secondByte.push_front("1");
-        binValue.truncate(binValue.size()-7);
-        firstByte = binValue;
-		
-        while(firstByte.size()<7)
-		{
-			firstByte.push_front("0");
-		}
-        firstByte.push_front("1");
+    Batch batch;
+    batch.pduType = request.d->pduType;
+    batch.communityString = request.d->communityString;
+    batch.varbinds = request.d->varbinds;
+    batch.offsets = request.d->offsets;
+    batch.outstanding = 1;
+    const quint32 batchId = batches.insert(batch);
 
-        convertedValue.push_front(thirdByte.toInt(NULL, 2));
-        convertedValue.push_front(secondByte.toInt(NULL, 2));
-        convertedValue.push_front(firstByte.toInt(NULL, 2));
-    } else
-    {
-		QString secondByte;
-		QString firstByte;
-		secondByte = binValue.right(7);
-		binValue.truncate(binValue.size()-7);
-		firstByte = binValue;
-		while(firstByte.size()<7)
-		{
-			firstByte.push_front("0");
-		}
-		
-		firstByte.push_front("1");
+    PendingRequest pending;
+    pending.pduType = request.d->pduType;
+    pending.batchId = batchId;
+    pending.indexes = request.d->indexes;
+    pending.prepared = request.d;
+    pending.size = request.d->message.size();
 
-		convertedValue.push_front(secondByte.toInt(NULL, 2));
-		convertedValue.push_front(firstByte.toInt(NULL, 2));
-    }
-	
-    return convertedValue;
+    const quint32 requestId = pendingRequests.insert(pending);
+    PendingRequest *stored = pendingRequests.find(requestId);
+    scheduleRetry(requestId, *stored, clock.elapsed());
+    transmitPrepared(requestId, *stored);
+
+    if(!retryTimer.isActive())
+        retryTimer.start();
+
+    return batchId;
 }
 
 /**
-*   This method will convert a given OID according to the Basic Encoding Rules (BER).
-*   It uses SNMPSession::convertIntAccordingToBER.
+*   This method will set all the given OIDs like SNMPSession::getBatch. Values holding
+*   a number are sent as integers, anything else as a string (see sendSetRequestAsync).
+*   A set-request is applied by the agent as a whole: when it is rejected the
+*   offending varbind gets the error status and the others of that request get 5.
 */
-void SNMPSession::convertOIDAccordingToBER(QByteArray &oid)
+quint32 SNMPSession::setBatch(const QString &communityStringParameter,
+                              const QList<QPair<QString, QVariant> > &values)
 {
-    QList<QByteArray> oidPartsList = oid.split('.');
-    int currentValue = 0;
-    int addedNumbers = 0;
-    oidPartsList.removeFirst();
-    oid[0] = 0x2B;
-	
-    for(int i = 1;i < oidPartsList.size();i++)
+    SNMPBerWriter varbinds;
+
+    for(int i = values.size() - 1; i >= 0; i--)
     {
-        if((oidPartsList[i].size())>1)
-        {
-            QString tempValue;
-            for(int j = 0;j<oidPartsList[i].size();j++)
-            {
-               tempValue.push_back(oidPartsList[i].at(j));
-            }
-            currentValue = tempValue.toInt(NULL, 10);
-        } else
-        {
-            QString tempValue;
-            tempValue = oidPartsList[i].at(0);
-            currentValue = tempValue.toInt(NULL, 10);
-        }
-        if(currentValue<=127)
-        {
-            oid[i+addedNumbers] = currentValue;
-        } else
-        {
-            QByteArray convertedValue = convertIntAccordingToBER(currentValue);
-			
-            if(convertedValue.size() == 2)
-            {
-                oid[i+addedNumbers] = convertedValue[0];
-                oid[i+1+addedNumbers] = convertedValue[1];
-                addedNumbers++;
-            } else
-            {
-                oid[i+addedNumbers] = convertedValue[0];
-                oid[i+1+addedNumbers] = convertedValue[1];
-                oid[i+2+addedNumbers] = convertedValue[2];
-                addedNumbers =+ 2;
-            }
+        const QVariant &value = values[i].second;
+        const int varbindEnd = varbinds.mark();
 
-        }
+        if(value.type() == QVariant::Int || value.type() == QVariant::UInt
+           || value.type() == QVariant::LongLong || value.type() == QVariant::ULongLong)
+            varbinds.writeInteger(value.toLongLong());
+        else
+            writeStringValue(varbinds, value.toString().toLatin1());
+
+        const SNMPOid oid = SNMPOid::intern(values[i].first);
+        if(!oid.isValid())
+            return 0;
+
+        varbinds.writeOctetString(oid.encoded(), SNMPBer::ObjectIdentifier);
+        varbinds.endConstructed(varbindEnd, SNMPBer::Sequence);
     }
-	
-    oid.resize(oidPartsList.size()+addedNumbers);
+
+    return startBatch(SNMPBer::SetRequest, communityStringParameter, varbinds, values.size());
 }
+
+
+//----[ Subtree walks ]------------------------------------------------------------------
+
+
+/**
+*   This method will walk the subtree below rootOidParameter with GetNextRequests,
+*   one varbind per round trip, and return immediately.
+*   Every varbind found is reported through walkVarbindReceived, in order. The walk
+*   ends with walkFinished, with 0 once the agent leaves the subtree or its MIB ends,
+*   otherwise with the error status of the failed response (6 on timeout).
+*   Returns the walk ID, or 0 if the root OID is malformed or no agent address is set.
+*/
+quint32 SNMPSession::walk(const QString &communityStringParameter, const QString &rootOidParameter)
+{
+    return startWalk(communityStringParameter, SNMPOid::intern(rootOidParameter), 0);
+}
+
+quint32 SNMPSession::walk(const QString &communityStringParameter, const SNMPOid &rootOid)
+{
+    return startWalk(communityStringParameter, rootOid, 0);
+}
+
+/**
+*   This method will walk the subtree below rootOidParameter like SNMPSession::walk,
+*   but with GetBulkRequests asking for up to maxRepetitions varbinds per round trip,
+*   as many as the limits learned for the agent allow.
+*   SNMPv1 has no GetBulkRequest, so on a version 1 session this is a plain walk.
+*/
+quint32 SNMPSession::bulkWalk(const QString &communityStringParameter, const QString &rootOidParameter,
+                              int maxRepetitions)
+{
+    return bulkWalk(communityStringParameter, SNMPOid::intern(rootOidParameter), maxRepetitions);
+}
+
+quint32 SNMPSession::bulkWalk(const QString &communityStringParameter, const SNMPOid &rootOid,
+                              int maxRepetitions)
+{
+    if(version == SNMPBer::Version1)
+        maxRepetitions = 0;
+
+    return startWalk(communityStringParameter, rootOid, qMax(maxRepetitions, 0));
+}
+
+/**
+*   This method will stop a walk. No further signal is emitted for it.
+*   Returns false if the walk was not running.
+*/
+bool SNMPSession::cancelWalk(quint32 walkId)
+{
+    Walk *walk = walks.find(walkId);
+    if(!walk)
+        return false;
+
+    takePendingRequest(walk->requestId, NULL);
+    SNMPBufferPool::release(walk->lastOid);
+    walks.remove(walkId);
+    return true;
+}
+
+
+//----[ Additional public methods ]-------------------------------------------------
+
+
+
+//----[ Private slots ]-------------------------------------------------------------
+
+/**
+*   Called on readyRead. Reads every datagram waiting on the socket and hands it
+*   over to the matching pending request.
+*/
+void SNMPSession::readPendingDatagrams()
+{
+    while(udpSocket.hasPendingDatagrams())
+    {
+        const qint64 size = udpSocket.readDatagram(receiveBuffer.data(), receiveBuffer.size());
+        if(size >= 0)
+            handleDatagram(receiveBuffer.constData(), int(size));
+    }
+}
+
+/**
+*   Called when the batched transport has datagrams. Drains them a ring at a time;
+*   requests sent while handling them go out together once all are handled, without
+*   the flush timer, whose every start registers a timer with the event dispatcher.
+*/
+void SNMPSession::readBatchedDatagrams()
+{
+    const bool nested = receivingBatch;
+    receivingBatch = true;
+
+    do
+    {
+        const int count = batchedTransport->receive();
+        for(int i = 0; i < count && batchedTransport; i++)
+            handleDatagram(batchedTransport->datagramData(i), batchedTransport->datagramSize(i));
+    } while(batchedTransport && batchedTransport->hasPendingDatagrams());
+
+    receivingBatch = nested;
+    flushBatchedTransport();
+}
+
+/**
+*   Called once control is back in the event loop. Sends everything queued on the
+*   batched transport in the meantime.
+*/
+void SNMPSession::flushBatchedTransport()
+{
+    if(batchedTransport)
+        batchedTransport->flush();
+}
+
+/**
+*   Called by the retry timer on every tick of the timer wheel. Resends every request
+*   whose deadline has passed, and reports the ones which used all their attempts
+*   as timed out.
+*/
+void SNMPSession::checkRequestTimeouts()
+{
+    const qint64 now = clock.elapsed();
+
+    retryTimers.expire(now, [&](quint32 requestId) {
+        PendingRequest *request = pendingRequests.find(requestId);
+        if(!request)
+            return;
+
+        request->timer = -1;
+        request->attempt++;
+        if(request->attempt < retryPolicy->maxAttempts(*agentAddress))
+        {
+            if(metrics)
+                metrics->count(SNMPMetrics::Retries);
+            if(request->prepared)
+                transmitPrepared(requestId, *request);
+            else if(!request->pdu.isEmpty())
+                transmitSecure(*request);
+            else
+                transmit(request->datagram.constData(), request->datagram.size());
+            scheduleRetry(requestId, *request, now);
+            return;
+        }
+
+        PendingRequest expired;
+        takePendingRequest(requestId, &expired);
+        retryPolicy->requestTimedOut(*agentAddress);
+        if(metrics)
+            metrics->count(SNMPMetrics::Timeouts);
+
+        // a large request lost while the agent answers others: try smaller ones
+        const bool fragmented = pduLimits.requestTimedOut(varbindCount(expired), expired.repetitions,
+                                                          expired.size, expired.sentAt);
+
+        if(expired.walkId)
+        {
+            Walk *walk = walks.find(expired.walkId);
+            if(fragmented && walk)
+                sendWalkRequest(expired.walkId, *walk);
+            else
+                finishWalk(expired.walkId, 6);
+        }
+        else if(expired.batchId)
+        {
+            Batch *batch = batches.find(expired.batchId);
+            if(fragmented && batch)
+            {
+                sendBatchRequests(expired.batchId, *batch, expired.indexes, (expired.indexes.size() + 1) / 2);
+                completeBatchRequest(expired.batchId);
+            }
+            else
+                failBatchRequest(expired, 6);
+        }
+        else
+            emit requestFailed(requestId, 6);
+    });
+
+    if(retryTimers.isEmpty())
+        retryTimer.stop();
+}
+
+
+//----[ Other private methods ]-----------------------------------------------------
+
+void SNMPSession::initSession()
+{
+    version = SNMPBer::Version1;
+    retryPolicy = QSharedPointer<SNMPRetryPolicy>(new SNMPAdaptiveRetryPolicy);
+    metricsAgent = -1;
+    nextMessageId = QRandomGenerator::global()->generate();
+    discoverySentAt = -retryTimerInterval;
+    clock.start();
+    receiveBuffer.resize(maxDatagramSize);
+
+    retryTimer.setInterval(retryTimerInterval);
+    connect(&retryTimer, &QTimer::timeout, this, &SNMPSession::checkRequestTimeouts);
+    receivingBatch = false;
+    flushTimer.setSingleShot(true);
+    flushTimer.setInterval(0);
+    connect(&flushTimer, &QTimer::timeout, this, &SNMPSession::flushBatchedTransport);
+    connect(&udpSocket, &QUdpSocket::readyRead, this, &SNMPSession::readPendingDatagrams);
+}
+
+/**
+*   This method will complete the message whose Value field the caller has already
+*   written into the encoder, send it to the agent and register it as pending.
+*   The message is written back to front, so each field goes in front of the previous one.
+*   Returns the request ID, or 0 if the OID is invalid or there is no agent to send to.
+*/
+quint32 SNMPSession::startRequest(int pduType, const QString &communityStringParameter, const SNMPOid &oid)
+{
+// include Object Identifier field
+    if(!oid.isValid() || !agentAddress)
+        return 0;
+    encoder.writeOctetString(oid.encoded(), SNMPBer::ObjectIdentifier);
+
+// include Varbind field
+    encoder.endConstructed(0, SNMPBer::Sequence);
+
+    PendingRequest pending;
+    pending.pduType = pduType;
+    return sendRequest(latin1Community(communityStringParameter), pending);
+}
+
+/**
+*   Returns the community string in the form it is sent in. The conversion of the
+*   last string is kept, since a session mostly uses one community.
+*/
+const QByteArray &SNMPSession::latin1Community(const QString &communityStringParameter)
+{
+    if(communityStringParameter != lastCommunityString)
+    {
+        lastCommunityString = communityStringParameter;
+        lastCommunityBytes = communityStringParameter.toLatin1();
+    }
+    return lastCommunityBytes;
+}
+
+/**
+*   This method will complete the message whose varbinds the caller has already
+*   written into the encoder, send it and register it as pending.
+*   The PDU type and the owner of the request are taken from pending.
+*   For a GetBulkRequest errorStatus and errorIndex carry non-repeaters and
+*   max-repetitions. Returns the request ID.
+*/
+quint32 SNMPSession::sendRequest(const QByteArray &communityString, const PendingRequest &pending,
+                                 int errorStatus, int errorIndex)
+{
+    const quint32 requestId = pendingRequests.insert(pending);
+    PendingRequest *request = pendingRequests.find(requestId);
+    scheduleRetry(requestId, *request, clock.elapsed());
+
+    if(version == SNMPBer::Version3)
+    {
+        // the PDU is kept, to be wrapped again for each transmission
+        encoder.writePduHeader(pending.pduType, requestId, errorStatus, errorIndex);
+        request->pdu = SNMPBufferPool::acquire(encoder.data(), encoder.size());
+        request->size = request->pdu.size() + usm.messageOverhead();
+        transmitSecure(*request);
+    }
+    else
+    {
+        encoder.writeMessageHeader(version, communityString, pending.pduType, requestId,
+                                   errorStatus, errorIndex);
+
+// sending
+        request->datagram = SNMPBufferPool::acquire(encoder.data(), encoder.size());
+        request->size = encoder.size();
+        transmit(encoder.data(), encoder.size());
+    }
+
+    if(!retryTimer.isActive())
+        retryTimer.start();
+
+    return requestId;
+}
+
+/**
+*   This method will send a datagram to the agent, or queue it on the batched
+*   transport until control is back in the event loop.
+*/
+void SNMPSession::transmit(const char *data, int size)
+{
+    if(metrics)
+        metrics->recordTransmission(size);
+
+    if(!batchedTransport)
+    {
+        udpSocket.writeDatagram(data, size, *agentAddress, agentPort);
+        return;
+    }
+
+    // readBatchedDatagrams() flushes what its handlers send
+    batchedTransport->queueDatagram(data, size, *agentAddress, agentPort);
+    if(!receivingBatch && !flushTimer.isActive())
+        flushTimer.start();
+}
+
+/**
+*   This method will wrap the PDU of a SNMPv3 request for the engine of the agent,
+*   with the current engine time and a new message ID, and send it. Until the engine
+*   is discovered the request waits and a discovery probe goes out in its place.
+*/
+void SNMPSession::transmitSecure(PendingRequest &request)
+{
+    request.messageId = allocateMessageId();
+    if(!usm.isDiscovered())
+    {
+        sendDiscovery(request.messageId);
+        return;
+    }
+
+    encoder.reset();
+    encoder.writeRaw(request.pdu.constData(), request.pdu.size());
+    usm.encode(encoder, request.messageId);
+    transmit(encoder.data(), encoder.size());
+}
+
+/**
+*   Returns the next SNMPv3 message ID: a counter of its own, as the msgID of
+*   RFC 3412 has 31 bits only, which runs from 1 to 2^31 - 1 and starts at random.
+*   0 is left out, it marks a request which did not go out as SNMPv3 message.
+*/
+quint32 SNMPSession::allocateMessageId()
+{
+    nextMessageId = (nextMessageId + 1) & 0x7fffffff;
+    if(nextMessageId == 0)
+        nextMessageId = 1;
+    return nextMessageId;
+}
+
+/**
+*   This method will send a SNMPv3 engine discovery probe, unless one went out
+*   during the last tick of the retry timer.
+*/
+void SNMPSession::sendDiscovery(quint32 messageId)
+{
+    const qint64 now = clock.elapsed();
+    if(now - discoverySentAt < retryTimerInterval)
+        return;
+    discoverySentAt = now;
+
+    usm.encodeDiscovery(encoder, messageId);
+    transmit(encoder.data(), encoder.size());
+}
+
+/**
+*   Called when a report taught us the engine ID or time of the agent. Sends every
+*   SNMPv3 request again, wrapped for the new engine state; their timers go on.
+*/
+void SNMPSession::resendSecureRequests()
+{
+    pendingRequests.forEach([&](quint32, PendingRequest &request) {
+        if(!request.pdu.isEmpty())
+            transmitSecure(request);
+    });
+}
+
+/**
+*   Called on an error report from the security model of the agent, which carries
+*   the message ID of the reported message, and the request ID of the request unless
+*   the agent could not read the PDU and sent 0. Fails the request with error 16
+*   (authorizationError).
+*/
+void SNMPSession::failReportedRequest(quint32 requestId, quint32 messageId)
+{
+    PendingRequest request;
+    if(!requestId || !pendingRequests.find(requestId))
+    {
+        // reports are rare, the request is looked up by its last message ID
+        requestId = 0;
+        pendingRequests.forEach([&](quint32 pendingId, PendingRequest &pending) {
+            if(pending.messageId && pending.messageId == messageId)
+                requestId = pendingId;
+        });
+    }
+
+    if(!requestId || !takePendingRequest(requestId, &request))
+        return;
+
+    if(request.walkId)
+        finishWalk(request.walkId, 16);
+    else if(request.batchId)
+        failBatchRequest(request, 16);
+    else
+        emit requestFailed(requestId, 16);
+}
+
+/**
+*   This method will note that the request has just been (re)transmitted and start
+*   the timer of its current attempt, with the timeout from the retry policy.
+*/
+void SNMPSession::scheduleRetry(quint32 requestId, PendingRequest &request, qint64 now)
+{
+    // stamped with or without metrics, which may be set while the request is pending
+    request.sentAt = now;
+    request.sentAtNanoseconds = clock.nsecsElapsed();
+    request.timer = retryTimers.schedule(now + retryPolicy->timeout(*agentAddress, request.attempt),
+                                         requestId);
+}
+
+/**
+*   This method will remove an outstanding request and stop its timer.
+*   Returns false if the request was not pending.
+*/
+bool SNMPSession::takePendingRequest(quint32 requestId, PendingRequest *request)
+{
+    PendingRequest *pending = pendingRequests.find(requestId);
+    if(!pending)
+        return false;
+
+    retryTimers.cancel(pending->timer, requestId);
+    SNMPBufferPool::release(pending->datagram);
+    SNMPBufferPool::release(pending->pdu);
+    return pendingRequests.take(requestId, request);
+}
+
+/**
+*   This method will send a prepared request under the given request ID. The ID is
+*   patched into a copy of the prepared message in the encoder, the shared message is
+*   only read; if the ID does not fit there, the request is encoded around the
+*   prepared varbinds and keeps that copy for its retries.
+*/
+void SNMPSession::transmitPrepared(quint32 requestId, PendingRequest &request)
+{
+    SNMPPreparedRequest prepared;
+    prepared.d = request.prepared;
+
+    if(version == SNMPBer::Version3)
+    {
+        encoder.reset();
+        encoder.writeRaw(prepared.d->varbinds.constData(), prepared.d->varbinds.size());
+        encoder.writePduHeader(prepared.d->pduType, requestId);
+
+        request.pdu = SNMPBufferPool::acquire(encoder.data(), encoder.size());
+        request.prepared.clear();
+        transmitSecure(request);
+        return;
+    }
+
+    encoder.reset();
+    encoder.writeRaw(prepared.d->message.constData(), prepared.d->message.size());
+    if(prepared.patchRequestId(encoder.data(), requestId))
+    {
+        transmit(encoder.data(), encoder.size());
+        return;
+    }
+
+    encoder.reset();
+    encoder.writeRaw(prepared.d->varbinds.constData(), prepared.d->varbinds.size());
+    encoder.writeMessageHeader(version, prepared.d->communityString, prepared.d->pduType, requestId);
+
+    request.datagram = SNMPBufferPool::acquire(encoder.data(), encoder.size());
+    request.prepared.clear();
+    transmit(encoder.data(), encoder.size());
+}
+
+/**
+*   This method will run a local event loop until the given request is answered
+*   or times out, and return its result.
+*/
+int SNMPSession::waitForRequest(quint32 requestId, QString *receivedValue)
+{
+    if(requestId == 0)
+        return 5;
+
+    QEventLoop loop;
+    int result = 6;
+
+    connect(this, &SNMPSession::responseReceived, &loop,
+            [&](quint32 id, int errorStatus, const QString &value) {
+        if(id != requestId)
+            return;
+        result = errorStatus;
+        if(receivedValue)
+            *receivedValue = value;
+        loop.quit();
+    });
+    connect(this, &SNMPSession::requestFailed, &loop,
+            [&](quint32 id, int errorCode) {
+        if(id != requestId)
+            return;
+        result = errorCode;
+        loop.quit();
+    });
+
+    // called from a slot while a batch is handled, the request must not wait for its end
+    const bool nested = receivingBatch;
+    receivingBatch = false;
+    flushBatchedTransport();
+    loop.exec();
+    receivingBatch = nested;
+    return result;
+}
+
+/**
+*   This method will match a received datagram to its pending request and emit
+*   responseReceived. Malformed datagrams and responses to unknown or already
+*   answered requests are dropped after decoding the header only.
+*/
+void SNMPSession::handleDatagram(const char *data, int size)
+{
+    SNMPMessageView response;
+    bool decoded;
+
+    if(version == SNMPBer::Version3)
+    {
+        quint32 messageId = 0;
+        const SNMPUsm::DecodeStatus status = usm.decode(data, size, response, &messageId);
+        if(status == SNMPUsm::Resynchronized || status == SNMPUsm::ReportReceived)
+        {
+            if(metrics)
+                metrics->recordReception(size, SNMPMetrics::StrayResponses);
+            if(status == SNMPUsm::Resynchronized)
+                resendSecureRequests();
+            else
+                failReportedRequest(response.requestId, messageId);
+            return;
+        }
+        decoded = status == SNMPUsm::Accepted;
+    }
+    else
+        decoded = response.decode(data, size);
+
+    if(!decoded)
+    {
+        if(metrics)
+            metrics->recordReception(size, SNMPMetrics::DecodeErrors);
+        return;
+    }
+
+    PendingRequest request;
+    if(response.pduType != SNMPBer::GetResponse || !takePendingRequest(response.requestId, &request))
+    {
+        if(metrics)
+            metrics->recordReception(size, SNMPMetrics::StrayResponses);
+        return;
+    }
+
+    retryPolicy->responseReceived(*agentAddress, request.attempt, clock.elapsed() - request.sentAt);
+    if(metrics)
+        metrics->recordResponse(metricsAgent, size, (clock.nsecsElapsed() - request.sentAtNanoseconds) / 1000);
+
+    // error status 1 is tooBig: the response would not fit the buffers of the agent
+    if(response.errorStatus == 1)
+        pduLimits.requestTooBig(varbindCount(request), request.repetitions, request.size);
+    else
+        pduLimits.requestSucceeded(varbindCount(request), request.repetitions, request.size,
+                                   clock.elapsed());
+
+    if(request.walkId)
+    {
+        handleWalkResponse(request.walkId, response);
+        return;
+    }
+
+    if(request.batchId)
+    {
+        handleBatchResponse(request, response);
+        return;
+    }
+
+    static const QMetaMethod textSignal = QMetaMethod::fromSignal(&SNMPSession::responseReceived);
+    SNMPValue value;
+    int result;
+
+    if(request.pduType == SNMPBer::GetRequest)
+        result = getValueFromGetResponse(value, response);
+    else
+        result = response.errorStatus;
+
+    emit responseValueReceived(response.requestId, result, value);
+
+    if(isSignalConnected(textSignal))
+    {
+        QString receivedValue;
+        if(result == 0 && value.isValid())
+            result = SNMPBer::valueToString(value.element(), receivedValue);
+        emit responseReceived(response.requestId, result, receivedValue);
+    }
+}
+
+/**
+*   Returns the number of varbinds a request carried, for the PDU size limits.
+*/
+int SNMPSession::varbindCount(const PendingRequest &request)
+{
+    return request.indexes.isEmpty() ? 1 : request.indexes.size();
+}
+
+/**
+*   This method will register a batch whose varbinds have been encoded, in order,
+*   into varbinds, and send them in as few requests as the maximum message size allows.
+*/
+quint32 SNMPSession::startBatch(int pduType, const QString &communityStringParameter,
+                                const SNMPBerWriter &varbinds, int count)
+{
+    if(count == 0 || !agentAddress)
+        return 0;
+
+    Batch batch;
+    batch.pduType = pduType;
+    batch.communityString = latin1Community(communityStringParameter);
+    batch.varbinds = SNMPBufferPool::acquire(varbinds.data(), varbinds.size());
+    batch.outstanding = 0;
+
+    // offsets[i] is where varbind i starts, offsets[count] the end of the last one
+    SNMPBerReader reader(batch.varbinds.constData(), batch.varbinds.size());
+    SNMPBerElement element;
+    batch.offsets.reserve(count + 1);
+    batch.offsets.append(0);
+    while(reader.next(element))
+        batch.offsets.append(int(element.value + element.length - batch.varbinds.constData()));
+
+    const quint32 batchId = batches.insert(batch);
+
+    QVector<int> indexes(count);
+    for(int i = 0; i < count; i++)
+        indexes[i] = i;
+    sendBatchRequests(batchId, *batches.find(batchId), indexes, count);
+
+    return batchId;
+}
+
+/**
+*   This method will send the varbinds of the batch at the given indexes in as few
+*   requests as the learned limits of the agent allow, with at most maxVarbinds in each.
+*/
+void SNMPSession::sendBatchRequests(quint32 batchId, Batch &batch, const QVector<int> &indexes,
+                                    int maxVarbinds)
+{
+    const int headerSize = version == SNMPBer::Version3 ? usm.messageOverhead()
+                                                        : batch.communityString.size();
+    const int budget = pduLimits.getMaxMessageSize() - messageOverhead - headerSize;
+    maxVarbinds = qMin(maxVarbinds, pduLimits.getMaxVarbinds());
+
+    QVector<int> request;
+    int requestSize = 0;
+
+    for(int i = 0; i < indexes.size(); i++)
+    {
+        const int varbindSize = batch.offsets[indexes[i] + 1] - batch.offsets[indexes[i]];
+
+        // a varbind too large for the limit on its own still goes, alone
+        if(!request.isEmpty() && (requestSize + varbindSize > budget || request.size() == maxVarbinds))
+        {
+            sendBatchRequest(batchId, batch, request);
+            request.clear();
+            requestSize = 0;
+        }
+
+        request.append(indexes[i]);
+        requestSize += varbindSize;
+    }
+    sendBatchRequest(batchId, batch, request);
+}
+
+/**
+*   This method will send one request carrying the varbinds of the batch at the given
+*   indexes. Runs of consecutive varbinds are copied in one piece.
+*/
+void SNMPSession::sendBatchRequest(quint32 batchId, Batch &batch, const QVector<int> &indexes)
+{
+    encoder.reset();
+
+    // the encoder works back to front, so start with the last run
+    int last = indexes.size() - 1;
+    while(last >= 0)
+    {
+        int first = last;
+        while(first > 0 && indexes[first - 1] == indexes[first] - 1)
+            first--;
+
+        const int from = batch.offsets[indexes[first]];
+        const int to = batch.offsets[indexes[last] + 1];
+        encoder.writeRaw(batch.varbinds.constData() + from, to - from);
+        last = first - 1;
+    }
+
+    PendingRequest pending;
+    pending.pduType = batch.pduType;
+    pending.batchId = batchId;
+    pending.indexes = indexes;
+
+    sendRequest(batch.communityString, pending);
+    batch.outstanding++;
+}
+
+/**
+*   This method will map the varbinds of a batch response, or its error-index, back
+*   to the caller's indexes.
+*/
+void SNMPSession::handleBatchResponse(const PendingRequest &request, SNMPMessageView &response)
+{
+    const QVector<int> &indexes = request.indexes;
+
+    if(!batches.find(request.batchId))
+        return;
+
+    // tooBig: send the varbinds again, at least halved over smaller requests; the agent
+    // did not apply a set-request it answered so
+    if(response.errorStatus == 1 && indexes.size() > 1)
+    {
+        sendBatchRequests(request.batchId, *batches.find(request.batchId), indexes, (indexes.size() + 1) / 2);
+        completeBatchRequest(request.batchId);
+        return;
+    }
+
+    if(response.errorStatus != 0)
+    {
+        const int failed = int(response.errorIndex) - 1;
+        if(failed < 0 || failed >= indexes.size())
+        {
+            failBatchRequest(request, response.errorStatus);
+            return;
+        }
+
+        reportBatchValue(request.batchId, indexes[failed], response.errorStatus, SNMPValue());
+
+        if(request.pduType == SNMPBer::GetRequest)
+        {
+            // the agent stops at the first bad varbind, ask again for the others
+            QVector<int> remaining = indexes;
+            remaining.remove(failed);
+            if(!remaining.isEmpty())
+                sendBatchRequest(request.batchId, *batches.find(request.batchId), remaining);
+        } else
+        {
+            // a rejected set-request is not applied at all
+            for(int j = 0; j < indexes.size(); j++)
+            {
+                if(j != failed)
+                    reportBatchValue(request.batchId, indexes[j], 5, SNMPValue());
+            }
+        }
+
+        completeBatchRequest(request.batchId);
+        return;
+    }
+
+    SNMPVarbindView varbind;
+    for(int j = 0; j < indexes.size(); j++)
+    {
+        SNMPValue value;
+        int errorStatus = 0;
+
+        if(!response.nextVarbind(varbind) || !value.decode(varbind.value))
+            errorStatus = 5;
+        else if(value.isException())
+            errorStatus = 2;
+
+        reportBatchValue(request.batchId, indexes[j], errorStatus, value);
+    }
+
+    completeBatchRequest(request.batchId);
+}
+
+/**
+*   Reports one varbind of a batch, as a typed value and, if anyone listens, as text.
+*/
+void SNMPSession::reportBatchValue(quint32 batchId, int index, int errorStatus, const SNMPValue &value)
+{
+    static const QMetaMethod textSignal = QMetaMethod::fromSignal(&SNMPSession::batchValueReceived);
+
+    emit batchTypedValueReceived(batchId, index, errorStatus, value);
+
+    if(!isSignalConnected(textSignal))
+        return;
+
+    QString text;
+    if(errorStatus == 0 && value.isValid())
+        errorStatus = SNMPBer::valueToString(value.element(), text);
+    emit batchValueReceived(batchId, index, errorStatus, text);
+}
+
+/**
+*   Reports every varbind of a batch request as failed with the given error status.
+*/
+void SNMPSession::failBatchRequest(const PendingRequest &request, int errorStatus)
+{
+    if(!batches.find(request.batchId))
+        return;
+
+    for(int j = 0; j < request.indexes.size(); j++)
+        reportBatchValue(request.batchId, request.indexes[j], errorStatus, SNMPValue());
+
+    completeBatchRequest(request.batchId);
+}
+
+void SNMPSession::completeBatchRequest(quint32 batchId)
+{
+    Batch *batch = batches.find(batchId);
+    if(!batch)
+        return;
+
+    if(--batch->outstanding == 0)
+    {
+        SNMPBufferPool::release(batch->varbinds);
+        batches.remove(batchId);
+        emit batchFinished(batchId);
+    }
+}
+
+/**
+*   This method will register a walk and send its first request.
+*   A maxRepetitions of 0 walks with GetNextRequests.
+*/
+quint32 SNMPSession::startWalk(const QString &communityStringParameter, const SNMPOid &rootOid,
+                               int maxRepetitions)
+{
+    if(!rootOid.isValid() || !agentAddress)
+        return 0;
+
+    Walk walk;
+    walk.communityString = latin1Community(communityStringParameter);
+    walk.rootOid = rootOid.encoded();
+    walk.lastOid = SNMPBufferPool::acquire(walk.rootOid.constData(), walk.rootOid.size());
+    walk.maxRepetitions = maxRepetitions;
+    walk.repetitions = 0;
+
+    const quint32 walkId = walks.insert(walk);
+    sendWalkRequest(walkId, *walks.find(walkId));
+
+    return walkId;
+}
+
+/**
+*   This method will ask the agent for the varbinds following the last one received.
+*/
+bool SNMPSession::sendWalkRequest(quint32 walkId, Walk &walk)
+{
+    encoder.reset();
+
+// include Value field
+    encoder.writeNull();
+
+// include Object Identifier field
+    encoder.writeOctetString(walk.lastOid, SNMPBer::ObjectIdentifier);
+
+// include Varbind field
+    encoder.endConstructed(0, SNMPBer::Sequence);
+
+    PendingRequest pending;
+    pending.walkId = walkId;
+
+    if(walk.maxRepetitions > 0)
+    {
+        walk.repetitions = qMin(walk.maxRepetitions, pduLimits.getMaxRepetitions());
+        pending.pduType = SNMPBer::GetBulkRequest;
+        pending.repetitions = walk.repetitions;
+        walk.requestId = sendRequest(walk.communityString, pending, 0, walk.repetitions);
+    } else
+    {
+        pending.pduType = SNMPBer::GetNextRequest;
+        walk.requestId = sendRequest(walk.communityString, pending);
+    }
+
+    return walk.requestId != 0;
+}
+
+/**
+*   This method will report the varbinds of a walk response which are still inside
+*   the subtree, then either ask for the next ones or end the walk.
+*/
+void SNMPSession::handleWalkResponse(quint32 walkId, SNMPMessageView &response)
+{
+    static const QMetaMethod walkTextSignal = QMetaMethod::fromSignal(&SNMPSession::walkVarbindReceived);
+
+    Walk *walk = walks.find(walkId);
+    if(!walk)
+        return;
+
+    // SNMPv1 agents report the end of their MIB as noSuchName
+    if(response.errorStatus == 2 && version == SNMPBer::Version1)
+    {
+        finishWalk(walkId, 0);
+        return;
+    }
+
+    // tooBig: ask again for fewer repetitions, the limit has just been halved
+    if(response.errorStatus == 1 && walk->repetitions > 1)
+    {
+        sendWalkRequest(walkId, *walk);
+        return;
+    }
+
+    if(response.errorStatus != 0)
+    {
+        finishWalk(walkId, response.errorStatus);
+        return;
+    }
+
+    SNMPVarbindView varbind;
+    int received = 0;
+
+    while(response.nextVarbind(varbind))
+    {
+        received++;
+
+        if(varbind.value.type == SNMPBer::EndOfMibView
+           || !SNMPBer::isInSubtree(varbind.oid.value, varbind.oid.length,
+                                    walk->rootOid.constData(), walk->rootOid.size()))
+        {
+            finishWalk(walkId, 0);
+            return;
+        }
+
+        // an agent which does not move forward would keep the walk going forever
+        if(SNMPBer::compareObjectIdentifiers(varbind.oid.value, varbind.oid.length,
+                                             walk->lastOid.constData(), walk->lastOid.size()) <= 0)
+        {
+            finishWalk(walkId, 5);
+            return;
+        }
+
+        // the buffer from the pool keeps its capacity
+        walk->lastOid.resize(varbind.oid.length);
+        memcpy(walk->lastOid.data(), varbind.oid.value, varbind.oid.length);
+
+        SNMPValue oid, value;
+        oid.decode(varbind.oid);
+        value.decode(varbind.value);
+        emit walkValueReceived(walkId, oid, value);
+
+        if(isSignalConnected(walkTextSignal))
+        {
+            QString text;
+            SNMPBer::valueToString(varbind.value, text);
+            emit walkVarbindReceived(walkId,
+                                     SNMPBer::objectIdentifierToString(varbind.oid.value, varbind.oid.length),
+                                     text);
+        }
+
+        // the receiver may have cancelled this walk or started others
+        walk = walks.find(walkId);
+        if(!walk)
+            return;
+    }
+
+    if(received == 0)
+    {
+        finishWalk(walkId, 0);
+        return;
+    }
+
+    sendWalkRequest(walkId, *walk);
+}
+
+void SNMPSession::finishWalk(quint32 walkId, int errorStatus)
+{
+    Walk *walk = walks.find(walkId);
+    if(!walk)
+        return;
+
+    SNMPBufferPool::release(walk->lastOid);
+    walks.remove(walkId);
+    emit walkFinished(walkId, errorStatus);
+}
+
+/**
+*   This method will extract the value from the first varbind of a GetResponse.
+*   Returns 0 on success or one of the following error codes on failture :
+*   1 -- Response message too large to transport
+*   2 -- The name of the requested object was not found
+*   3 -- A data type in the request did not match the data type in the SNMP agent
+*   4 -- The SNMP manager attempted to set a read-only parameter
+*   5 -- General Error (some error other than the ones listed above)
+*   6 -- Timeout, no response from agent (see SNMPSession::setRetryPolicy)
+*/
+int SNMPSession::getValueFromGetResponse(SNMPValue &receivedValue, SNMPMessageView &response)
+{
+    SNMPVarbindView varbind;
+
+    // if there is a problem, return the error code
+    if( response.errorStatus != 0)
+	{
+        return response.errorStatus;
+	}
+
+    if( !response.nextVarbind(varbind) || !receivedValue.decode(varbind.value) )
+        return 5;
+
+    // a v2c agent answers a missing object with an exception instead of noSuchName
+    if( receivedValue.isException() )
+        return 2;
+
+    return 0;
+}
+
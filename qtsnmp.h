@@ -17,7 +17,25 @@
 #include <QByteArray>
 #include <QString>
 #include <QUdpSocket>
-#include <vector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+#include <QPair>
+#include <QSharedPointer>
+#include "snmpber.h"
+#include "snmpdatagramtransport.h"
+#include "snmpmetrics.h"
+#include "snmpoid.h"
+#include "snmppdulimits.h"
+#include "snmppreparedrequest.h"
+#include "snmprequesttable.h"
+#include "snmpretrypolicy.h"
+#include "snmptimerwheel.h"
+#include "snmpusm.h"
+#include "snmpvalue.h"
  
 class SNMPSession : public QObject {
  
@@ -32,12 +50,27 @@ public:
     QHostAddress *getAgentAddress() const;
     qint16 getAgentPort() const;
     qint16 getSocketPort() const;
+    int getVersion() const;
+    int getMaxMessageSize() const;
     QString getAgentMACAddress() const;
     void setAgentAddress(const QString &agentAddress);
     void setAgentPort(qint16 agentPort);
     void setSocketPort(qint16 socketPort);
+    void setVersion(int version);
+    void setUser(const QString &userName, const QString &authPassword,
+                 const QString &privPassword = QString());
+    QByteArray getEngineId() const;
+    void setMaxMessageSize(int maxMessageSize);
+    const SNMPPduLimits &getPduLimits() const;
+    void setPduLimitCeilings(int maxVarbinds, int maxRepetitions);
+    bool setBatchedTransport(bool enabled);
+    SNMPDatagramTransport *getBatchedTransport() const;
+    QSharedPointer<SNMPRetryPolicy> getRetryPolicy() const;
+    void setRetryPolicy(const QSharedPointer<SNMPRetryPolicy> &retryPolicy);
+    QSharedPointer<SNMPMetrics> getMetrics() const;
+    void setMetrics(const QSharedPointer<SNMPMetrics> &metrics);
  
-// SNMP message methods
+// SNMP message methods (blocking, kept for compatibility)
     int sendSetRequest(const QString &communityStringParameter, 
                        const QString oidParameter, int value);
     int sendSetRequest(const QString &communityStringParameter,
@@ -45,28 +78,161 @@ public:
     int sendGetRequest(QString &receivedValue,
                        const QString &communityStringParameter, const QString &oidParameter);
  
+// SNMP message methods (non-blocking)
+    quint32 sendSetRequestAsync(const QString &communityStringParameter,
+                                const QString &oidParameter, int value);
+    quint32 sendSetRequestAsync(const QString &communityStringParameter,
+                                const QString &oidParameter, const QString &valueParameter);
+    quint32 sendGetRequestAsync(const QString &communityStringParameter,
+                                const QString &oidParameter);
+    quint32 sendSetRequestAsync(const QString &communityStringParameter,
+                                const SNMPOid &oid, int value);
+    quint32 sendSetRequestAsync(const QString &communityStringParameter,
+                                const SNMPOid &oid, const QString &valueParameter);
+    quint32 sendGetRequestAsync(const QString &communityStringParameter, const SNMPOid &oid);
+    bool cancelRequest(quint32 requestId);
+    int pendingRequestCount() const;
+
+// SNMP multi-varbind requests (non-blocking)
+    quint32 getBatch(const QString &communityStringParameter, const QStringList &oidParameters);
+    quint32 getBatch(const QString &communityStringParameter, const QVector<SNMPOid> &oids);
+    quint32 setBatch(const QString &communityStringParameter,
+                     const QList<QPair<QString, QVariant> > &values);
+
+// SNMP prepared requests (non-blocking)
+    SNMPPreparedRequest prepareGetRequest(const QString &communityStringParameter,
+                                          const QVector<SNMPOid> &oids);
+    quint32 sendPreparedRequest(const SNMPPreparedRequest &request);
+
+// SNMP subtree walks (non-blocking)
+    quint32 walk(const QString &communityStringParameter, const QString &rootOidParameter);
+    quint32 walk(const QString &communityStringParameter, const SNMPOid &rootOid);
+    quint32 bulkWalk(const QString &communityStringParameter, const QString &rootOidParameter,
+                     int maxRepetitions = 10);
+    quint32 bulkWalk(const QString &communityStringParameter, const SNMPOid &rootOid,
+                     int maxRepetitions = 10);
+    bool cancelWalk(quint32 walkId);
+
 // additional public methods
- 
+
+signals:
+    void responseReceived(quint32 requestId, int errorStatus, const QString &receivedValue);
+    void requestFailed(quint32 requestId, int errorCode);
+    void walkVarbindReceived(quint32 walkId, const QString &oid, const QString &value);
+    void walkFinished(quint32 walkId, int errorStatus);
+    void batchValueReceived(quint32 batchId, int index, int errorStatus, const QString &value);
+    void batchFinished(quint32 batchId);
+
+    // the same results as typed values, see SNMPValue; connect with a direct connection
+    void responseValueReceived(quint32 requestId, int errorStatus, const SNMPValue &value);
+    void walkValueReceived(quint32 walkId, const SNMPValue &oid, const SNMPValue &value);
+    void batchTypedValueReceived(quint32 batchId, int index, int errorStatus, const SNMPValue &value);
+
+private slots:
+    void readPendingDatagrams();
+    void readBatchedDatagrams();
+    void flushBatchedTransport();
+    void checkRequestTimeouts();
+
 private:
-    int getValueFromGetResponse(QString &receivedValue, QByteArray &receivedDatagram);
-    QByteArray convertIntAccordingToBER(int valueToConvert);
-    void convertOIDAccordingToBER(QByteArray &oid);
+    struct PendingRequest {
+        PendingRequest() : pduType(0), repetitions(0), size(0), attempt(0), sentAt(0),
+                           sentAtNanoseconds(0), timer(-1), walkId(0), batchId(0), messageId(0) {}
+
+        QByteArray datagram;
+        int pduType;
+        int repetitions;
+        int size;
+        int attempt;
+        qint64 sentAt;
+        qint64 sentAtNanoseconds;
+        int timer;
+        quint32 walkId;
+        quint32 batchId;
+        quint32 messageId;
+        QVector<int> indexes;
+        QSharedPointer<SNMPPreparedRequest::Data> prepared;
+        QByteArray pdu;
+    };
+
+    struct Walk {
+        QByteArray communityString;
+        QByteArray rootOid;
+        QByteArray lastOid;
+        int maxRepetitions;
+        int repetitions;
+        quint32 requestId;
+    };
+
+    struct Batch {
+        int pduType;
+        QByteArray communityString;
+        QByteArray varbinds;
+        QVector<int> offsets;
+        int outstanding;
+    };
+
+    quint32 startRequest(int pduType, const QString &communityStringParameter, const SNMPOid &oid);
+    quint32 sendRequest(const QByteArray &communityString, const PendingRequest &pending,
+                        int errorStatus = 0, int errorIndex = 0);
+    void scheduleRetry(quint32 requestId, PendingRequest &request, qint64 now);
+    bool takePendingRequest(quint32 requestId, PendingRequest *request);
+    void transmitPrepared(quint32 requestId, PendingRequest &request);
+    void transmit(const char *data, int size);
+    void transmitSecure(PendingRequest &request);
+    quint32 allocateMessageId();
+    void sendDiscovery(quint32 messageId);
+    void resendSecureRequests();
+    void failReportedRequest(quint32 requestId, quint32 messageId);
+    static void writeStringValue(SNMPBerWriter &writer, const QByteArray &value);
+    quint32 startBatch(int pduType, const QString &communityStringParameter,
+                       const SNMPBerWriter &varbinds, int count);
+    void sendBatchRequests(quint32 batchId, Batch &batch, const QVector<int> &indexes, int maxVarbinds);
+    void sendBatchRequest(quint32 batchId, Batch &batch, const QVector<int> &indexes);
+    void handleBatchResponse(const PendingRequest &request, SNMPMessageView &response);
+    void failBatchRequest(const PendingRequest &request, int errorStatus);
+    void completeBatchRequest(quint32 batchId);
+    void reportBatchValue(quint32 batchId, int index, int errorStatus, const SNMPValue &value);
+    quint32 startWalk(const QString &communityStringParameter, const SNMPOid &rootOid,
+                      int maxRepetitions);
+    bool sendWalkRequest(quint32 walkId, Walk &walk);
+    void handleWalkResponse(quint32 walkId, SNMPMessageView &response);
+    void finishWalk(quint32 walkId, int errorStatus);
+    int waitForRequest(quint32 requestId, QString *receivedValue);
+    void handleDatagram(const char *data, int size);
+    static int varbindCount(const PendingRequest &request);
+    void initSession();
+    const QByteArray &latin1Community(const QString &communityStringParameter);
+
+    int getValueFromGetResponse(SNMPValue &receivedValue, SNMPMessageView &response);
  
     QUdpSocket udpSocket;
+    SNMPDatagramTransport *batchedTransport;
+    QTimer flushTimer;
+    bool receivingBatch;
     QHostAddress *agentAddress;
     qint16 agentPort;
     qint16 socketPort;
+    int version;
 
-    int buildInt(int numBytes, QByteArray dataPart);
-    bool decodeSNMP( QByteArray data );
-    int errorStatus() { return snmpTlvParts[5].value.at(0); }
-
-    struct tlv {
-        int type;
-        int len;
-        QByteArray value;
-    };
-    std::vector<tlv> snmpTlvParts;
+    SNMPRequestTable<PendingRequest> pendingRequests;
+    SNMPBerWriter encoder;
+    QByteArray receiveBuffer;
+    SNMPRequestTable<Walk> walks;
+    SNMPRequestTable<Batch> batches;
+    SNMPBerWriter varbindEncoder;
+    QString lastCommunityString;
+    QByteArray lastCommunityBytes;
+    SNMPPduLimits pduLimits;
+    QSharedPointer<SNMPRetryPolicy> retryPolicy;
+    QSharedPointer<SNMPMetrics> metrics;
+    int metricsAgent;
+    SNMPUsm usm;
+    quint32 nextMessageId;
+    qint64 discoverySentAt;
+    SNMPTimerWheel retryTimers;
+    QTimer retryTimer;
+    QElapsedTimer clock;
 };
  
 #endif // QTSNMP_H
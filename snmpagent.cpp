@@ -0,0 +1,841 @@
+#include "snmpagent.h"
+#include <cstring>
+
+// Largest request accepted
+static const int maxRequestSize = 65535;
+
+// Room kept for the message header around the varbinds of a GetBulk response
+static const int responseHeaderSize = 32;
+
+// Error statuses of a Response
+static const int tooBig = 1;
+static const int noSuchName = 2;
+static const int badValue = 3;
+static const int noAccess = 6;
+static const int wrongType = 7;
+static const int wrongLength = 8;
+static const int wrongValue = 10;
+static const int noCreation = 11;
+static const int notWritable = 17;
+
+static bool isCommunity(const QByteArray &communityString, const SNMPBerElement &community)
+{
+    return !communityString.isEmpty() && communityString.size() == community.length
+           && memcmp(communityString.constData(), community.value, community.length) == 0;
+}
+
+/**
+*   Returns the size of an element with content of the given size, tag and length included.
+*/
+static int encodedSize(int contentSize)
+{
+    if(contentSize < 0x80)
+        return 2 + contentSize;
+    if(contentSize < 0x100)
+        return 3 + contentSize;
+    if(contentSize < 0x10000)
+        return 4 + contentSize;
+    return 5 + contentSize;
+}
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   The agent answers reads with the community "public" and refuses sets until a
+*   write community is given.
+*/
+SNMPAgent::SNMPAgent(QObject *parent)
+        : QObject(parent)
+{
+    this->readCommunity = "public";
+    this->maxResponseSize = 1472;
+    this->transport = NULL;
+    this->udpSocket = NULL;
+    resetStatistics();
+}
+
+SNMPAgent::~SNMPAgent()
+{
+    close();
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will start answering requests on the given UDP port, on all
+*   addresses. Ports below 1024 need the matching privilege.
+*   Returns false if the port cannot be bound.
+*/
+bool SNMPAgent::listen(quint16 port)
+{
+    close();
+
+    if(SNMPDatagramTransport::isSupported())
+    {
+        transport = new SNMPDatagramTransport(64, maxRequestSize, this);
+        if(transport->bind(port))
+        {
+            connect(transport, &SNMPDatagramTransport::readyRead, this, &SNMPAgent::readBatchedDatagrams);
+            return true;
+        }
+
+        delete transport;
+        transport = NULL;
+    }
+
+    udpSocket = new QUdpSocket(this);
+    if(!udpSocket->bind(QHostAddress::Any, port))
+    {
+        delete udpSocket;
+        udpSocket = NULL;
+        return false;
+    }
+
+    receiveBuffer.resize(maxRequestSize);
+    connect(udpSocket, &QUdpSocket::readyRead, this, &SNMPAgent::readPendingDatagrams);
+    return true;
+}
+
+/**
+*   This method will stop answering. It may be called from objectChanged: the
+*   sockets are deleted once control is back in the event loop.
+*/
+void SNMPAgent::close()
+{
+    if(transport)
+    {
+        transport->close();
+        transport->deleteLater();
+        transport = NULL;
+    }
+
+    if(udpSocket)
+    {
+        udpSocket->close();
+        udpSocket->deleteLater();
+        udpSocket = NULL;
+    }
+}
+
+bool SNMPAgent::isListening() const
+{
+    return transport || udpSocket;
+}
+
+/**
+*   Returns the port the agent listens on, the one chosen by the system if listen()
+*   was given 0.
+*/
+quint16 SNMPAgent::getLocalPort() const
+{
+    if(transport)
+        return transport->localPort();
+    return udpSocket ? udpSocket->localPort() : 0;
+}
+
+QString SNMPAgent::getReadCommunity() const
+{
+    return QString::fromLatin1(readCommunity);
+}
+
+void SNMPAgent::setReadCommunity(const QString &communityStringParameter)
+{
+    this->readCommunity = communityStringParameter.toLatin1();
+}
+
+QString SNMPAgent::getWriteCommunity() const
+{
+    return QString::fromLatin1(writeCommunity);
+}
+
+/**
+*   Sets the community which may read and set writable objects. Sets are refused
+*   while it is empty, as by default.
+*/
+void SNMPAgent::setWriteCommunity(const QString &communityStringParameter)
+{
+    this->writeCommunity = communityStringParameter.toLatin1();
+}
+
+int SNMPAgent::getMaxResponseSize() const
+{
+    return maxResponseSize;
+}
+
+/**
+*   Sets the largest response sent, 1472 bytes (one Ethernet frame) by default.
+*   GetBulk responses are cut to fit; other requests get a tooBig error.
+*/
+void SNMPAgent::setMaxResponseSize(int maxResponseSize)
+{
+    this->maxResponseSize = qBound(484, maxResponseSize, 65507);
+}
+
+/**
+*   This method will publish an object, with a zero or empty value until it is set.
+*   type is one of the SNMPBer value types. If the OID is already published its
+*   type and access are changed and its handle is returned.
+*   Returns the handle of the object, or -1 for an invalid OID.
+*/
+int SNMPAgent::addObject(const SNMPOid &oid, int type, bool writable)
+{
+    if(!oid.isValid())
+        return -1;
+
+    const QByteArray &encoded = oid.encoded();
+    const int position = lowerBound(encoded.constData(), encoded.size());
+
+    int object;
+    if(position < int(order.size()) && objects[order[position]].oid == encoded)
+    {
+        object = order[position];
+    } else
+    {
+        if(!freeObjects.empty())
+        {
+            object = freeObjects.back();
+            freeObjects.pop_back();
+        } else
+        {
+            object = int(objects.size());
+            objects.push_back(Object());
+        }
+
+        objects[object].oid = encoded;
+        objects[object].used = true;
+        order.insert(order.begin() + position, object);
+    }
+
+    objects[object].type = type;
+    objects[object].writable = writable;
+    objects[object].number = 0;
+    objects[object].bytes.clear();
+    return object;
+}
+
+/**
+*   Returns the handle of the object published with the OID, or -1.
+*/
+int SNMPAgent::findObject(const SNMPOid &oid) const
+{
+    return findExact(oid.encoded().constData(), oid.encoded().size());
+}
+
+bool SNMPAgent::removeObject(int object)
+{
+    if(!isObject(object))
+        return false;
+
+    const QByteArray &oid = objects[object].oid;
+    order.erase(order.begin() + lowerBound(oid.constData(), oid.size()));
+
+    objects[object].used = false;
+    objects[object].oid.clear();
+    objects[object].bytes.clear();
+    freeObjects.push_back(object);
+    return true;
+}
+
+SNMPOid SNMPAgent::getObjectOid(int object) const
+{
+    return isObject(object) ? SNMPOid::fromEncoded(objects[object].oid) : SNMPOid();
+}
+
+int SNMPAgent::getObjectType(int object) const
+{
+    return isObject(object) ? objects[object].type : 0;
+}
+
+/**
+*   Sets the value of an INTEGER object.
+*/
+void SNMPAgent::setInteger(int object, qint64 value)
+{
+    if(isObject(object))
+        objects[object].number = quint64(value);
+}
+
+/**
+*   Sets the value of a Counter32, Gauge32, TimeTicks or Counter64 object.
+*/
+void SNMPAgent::setUnsigned(int object, quint64 value)
+{
+    if(isObject(object))
+        objects[object].number = value;
+}
+
+/**
+*   Sets the value of an OCTET STRING, IpAddress (4 bytes) or Opaque object.
+*/
+void SNMPAgent::setOctetString(int object, const QByteArray &value)
+{
+    if(isObject(object))
+        objects[object].bytes = value;
+}
+
+void SNMPAgent::setObjectIdentifier(int object, const SNMPOid &value)
+{
+    if(isObject(object))
+        objects[object].bytes = value.encoded();
+}
+
+qint64 SNMPAgent::getInteger(int object) const
+{
+    return isObject(object) ? qint64(objects[object].number) : 0;
+}
+
+quint64 SNMPAgent::getUnsigned(int object) const
+{
+    return isObject(object) ? objects[object].number : 0;
+}
+
+QByteArray SNMPAgent::getOctetString(int object) const
+{
+    return isObject(object) ? objects[object].bytes : QByteArray();
+}
+
+void SNMPAgent::resetStatistics()
+{
+    answeredCount = 0;
+    malformedCount = 0;
+    rejectedCount = 0;
+}
+
+
+//----[ Private slots ]------------------------------------------------------------------
+
+/**
+*   Answers the requests waiting on the socket, one ring at a time; the responses of
+*   a ring are sent with one flush.
+*/
+void SNMPAgent::readBatchedDatagrams()
+{
+    QHostAddress sender;
+    quint16 senderPort;
+
+    do
+    {
+        const int count = transport->receive();
+        for(int i = 0; i < count && transport; i++)
+        {
+            if(transport->datagramSender(i, &sender, &senderPort)
+               && handleRequest(transport->datagramData(i), transport->datagramSize(i)))
+                sendResponse(encoder.data(), encoder.size(), sender, senderPort);
+        }
+
+        flushResponses();
+    } while(transport && transport->hasPendingDatagrams());
+}
+
+void SNMPAgent::readPendingDatagrams()
+{
+    QHostAddress sender;
+    quint16 senderPort;
+
+    while(udpSocket && udpSocket->hasPendingDatagrams())
+    {
+        const qint64 size = udpSocket->readDatagram(receiveBuffer.data(), receiveBuffer.size(),
+                                                    &sender, &senderPort);
+        if(size >= 0 && handleRequest(receiveBuffer.constData(), int(size)))
+            sendResponse(encoder.data(), encoder.size(), sender, senderPort);
+    }
+}
+
+
+//----[ Protected methods ]--------------------------------------------------------------
+
+/**
+*   This method will send a response, or queue it on the batched transport until
+*   flushResponses(). Subclasses may override it to hold responses back or drop them.
+*/
+void SNMPAgent::sendResponse(const char *data, int size, const QHostAddress &address, quint16 port)
+{
+    if(transport)
+        transport->queueDatagram(data, size, address, port);
+    else if(udpSocket)
+        udpSocket->writeDatagram(data, size, address, port);
+}
+
+/**
+*   This method will send the responses queued on the batched transport.
+*/
+void SNMPAgent::flushResponses()
+{
+    if(transport)
+        transport->flush();
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+bool SNMPAgent::isObject(int object) const
+{
+    return object >= 0 && object < int(objects.size()) && objects[object].used;
+}
+
+/**
+*   Returns the position in the sorted order of the first object whose OID is not
+*   before the given one.
+*/
+int SNMPAgent::lowerBound(const char *oid, int size) const
+{
+    int first = 0;
+    int count = int(order.size());
+
+    while(count > 0)
+    {
+        const int half = count / 2;
+        const QByteArray &candidate = objects[order[first + half]].oid;
+        if(SNMPBer::compareObjectIdentifiers(candidate.constData(), candidate.size(), oid, size) < 0)
+        {
+            first += half + 1;
+            count -= half + 1;
+        } else
+        {
+            count = half;
+        }
+    }
+
+    return first;
+}
+
+/**
+*   Returns the position of the first object whose OID is after the given one, as
+*   GetNext wants it.
+*/
+int SNMPAgent::nextPosition(const char *oid, int size) const
+{
+    const int position = lowerBound(oid, size);
+    if(position < int(order.size()))
+    {
+        const QByteArray &candidate = objects[order[position]].oid;
+        if(candidate.size() == size && memcmp(candidate.constData(), oid, size) == 0)
+            return position + 1;
+    }
+    return position;
+}
+
+int SNMPAgent::findExact(const char *oid, int size) const
+{
+    const int position = lowerBound(oid, size);
+    if(position == int(order.size()))
+        return -1;
+
+    const QByteArray &candidate = objects[order[position]].oid;
+    if(candidate.size() != size || memcmp(candidate.constData(), oid, size) != 0)
+        return -1;
+    return order[position];
+}
+
+/**
+*   This method will decode a request and encode its response into the encoder.
+*   Returns false if there is nothing to answer: not a request, or not one of
+*   our communities.
+*/
+bool SNMPAgent::handleRequest(const char *data, int size)
+{
+    SNMPMessageView request;
+
+    if(!request.decode(data, size)
+       || (request.version != SNMPBer::Version1 && request.version != SNMPBer::Version2c))
+    {
+        malformedCount++;
+        return false;
+    }
+
+    const bool version1 = request.version == SNMPBer::Version1;
+    const bool canWrite = isCommunity(writeCommunity, request.community);
+    if(!canWrite && !isCommunity(readCommunity, request.community))
+    {
+        rejectedCount++;
+        return false;
+    }
+
+    requestVarbinds.resize(0);
+    SNMPVarbindView varbind;
+    while(request.nextVarbind(varbind))
+        requestVarbinds.append(varbind);
+
+    if(!request.varbinds.atEnd())
+    {
+        malformedCount++;
+        return false;
+    }
+
+    int errorStatus = 0;
+    int errorIndex = 0;
+    bool echoVarbinds = false;
+
+    switch(request.pduType)
+    {
+    case SNMPBer::GetRequest:
+    case SNMPBer::GetNextRequest:
+        errorIndex = resolveGet(request.pduType == SNMPBer::GetNextRequest);
+        if(version1 && errorIndex)
+        {
+            // SNMPv1 has no exceptions, the whole request fails
+            errorStatus = noSuchName;
+            echoVarbinds = true;
+        } else
+        {
+            errorIndex = 0;
+        }
+        break;
+
+    case SNMPBer::GetBulkRequest:
+        if(version1)
+        {
+            malformedCount++;
+            return false;
+        }
+        resolveBulk(request);
+        break;
+
+    case SNMPBer::SetRequest:
+        echoVarbinds = true;
+        changedObjects.resize(0);
+        if(!canWrite)
+        {
+            errorStatus = version1 ? noSuchName : noAccess;
+            errorIndex = requestVarbinds.isEmpty() ? 0 : 1;
+        } else
+        {
+            errorStatus = applySet(version1, errorIndex);
+        }
+        break;
+
+    default:
+        malformedCount++;
+        return false;
+    }
+
+    encodeResponse(request, errorStatus, errorIndex, echoVarbinds);
+
+    if(encoder.size() > maxResponseSize)
+    {
+        // SNMPv1 echoes the request, SNMPv2 sends no varbinds at all
+        results.resize(0);
+        encodeResponse(request, tooBig, 0, version1);
+    }
+
+    answeredCount++;
+
+    if(request.pduType == SNMPBer::SetRequest)
+    {
+        for(int i = 0; i < changedObjects.size(); i++)
+            emit objectChanged(changedObjects[i]);
+    }
+    return true;
+}
+
+/**
+*   This method will look up the objects of a Get or GetNext request.
+*   Returns the (1-based) index of the first varbind without an object, or 0.
+*/
+int SNMPAgent::resolveGet(bool next)
+{
+    int failed = 0;
+
+    results.resize(requestVarbinds.size());
+    for(int i = 0; i < requestVarbinds.size(); i++)
+    {
+        const SNMPBerElement &oid = requestVarbinds[i].oid;
+        Result &result = results[i];
+        result.oid = oid.value;
+        result.oidLength = oid.length;
+        result.exception = 0;
+
+        if(next)
+        {
+            const int position = nextPosition(oid.value, oid.length);
+            result.object = position < int(order.size()) ? order[position] : -1;
+        } else
+        {
+            result.object = findExact(oid.value, oid.length);
+        }
+
+        if(result.object == -1)
+        {
+            result.exception = next ? SNMPBer::EndOfMibView : SNMPBer::NoSuchObject;
+            if(!failed)
+                failed = i + 1;
+        } else if(next)
+        {
+            result.oid = objects[result.object].oid.constData();
+            result.oidLength = objects[result.object].oid.size();
+        }
+    }
+
+    return failed;
+}
+
+/**
+*   This method will look up the objects of a GetBulk request: one GetNext for each
+*   of the first non-repeaters varbinds, then up to max-repetitions rows of GetNext
+*   for the others, each row going on from the previous one. Rows stop once every
+*   column has reached the end of the MIB; varbinds stop when the response is full.
+*/
+void SNMPAgent::resolveBulk(const SNMPMessageView &request)
+{
+    const int varbindCount = requestVarbinds.size();
+    const int nonRepeaters = qBound(0, request.errorStatus, varbindCount);
+    const int repeaters = varbindCount - nonRepeaters;
+    const int maxRepetitions = repeaters ? request.errorIndex : 0;
+    int budget = maxResponseSize - responseHeaderSize - request.community.length;
+    Result result;
+
+    results.resize(0);
+    for(int i = 0; i < nonRepeaters; i++)
+    {
+        const SNMPBerElement &oid = requestVarbinds[i].oid;
+        const int position = nextPosition(oid.value, oid.length);
+
+        result.oid = oid.value;
+        result.oidLength = oid.length;
+        result.object = position < int(order.size()) ? order[position] : -1;
+        result.exception = result.object == -1 ? SNMPBer::EndOfMibView : 0;
+        if(result.object != -1)
+        {
+            result.oid = objects[result.object].oid.constData();
+            result.oidLength = objects[result.object].oid.size();
+        }
+
+        // non-repeaters which do not fit give a tooBig error
+        budget -= estimateVarbindSize(result);
+        results.append(result);
+    }
+
+    bulkCursors.resize(repeaters);
+    for(int j = 0; j < repeaters; j++)
+    {
+        const SNMPBerElement &oid = requestVarbinds[nonRepeaters + j].oid;
+        bulkCursors[j] = nextPosition(oid.value, oid.length);
+    }
+
+    for(int row = 0; row < maxRepetitions; row++)
+    {
+        bool more = false;
+
+        for(int j = 0; j < repeaters; j++)
+        {
+            const int position = bulkCursors[j];
+
+            if(position < int(order.size()))
+            {
+                result.object = order[position];
+                result.exception = 0;
+                result.oid = objects[result.object].oid.constData();
+                result.oidLength = objects[result.object].oid.size();
+                bulkCursors[j]++;
+                more = true;
+            } else
+            {
+                // the column keeps the OID it ended on
+                if(row)
+                {
+                    result = results[results.size() - repeaters];
+                } else
+                {
+                    result.oid = requestVarbinds[nonRepeaters + j].oid.value;
+                    result.oidLength = requestVarbinds[nonRepeaters + j].oid.length;
+                }
+                result.object = -1;
+                result.exception = SNMPBer::EndOfMibView;
+            }
+
+            // the response may end anywhere, even within a row
+            budget -= estimateVarbindSize(result);
+            if(budget < 0)
+                return;
+            results.append(result);
+        }
+
+        if(!more)
+            break;
+    }
+}
+
+/**
+*   This method will check every varbind of a Set request and, if they are all
+*   right, store their values. A Set is applied completely or not at all.
+*   Returns the error status, with the (1-based) index of the varbind in errorIndex.
+*/
+int SNMPAgent::applySet(bool version1, int &errorIndex)
+{
+    for(int i = 0; i < requestVarbinds.size(); i++)
+    {
+        const SNMPVarbindView &varbind = requestVarbinds[i];
+        const int object = findExact(varbind.oid.value, varbind.oid.length);
+        int errorStatus;
+
+        if(object == -1)
+            errorStatus = version1 ? noSuchName : noCreation;
+        else if(!objects[object].writable)
+            errorStatus = version1 ? noSuchName : notWritable;
+        else if((errorStatus = checkSetValue(objects[object], varbind.value)) != 0 && version1)
+            errorStatus = badValue;
+
+        if(errorStatus)
+        {
+            errorIndex = i + 1;
+            return errorStatus;
+        }
+    }
+
+    for(int i = 0; i < requestVarbinds.size(); i++)
+    {
+        const SNMPBerElement &value = requestVarbinds[i].value;
+        const int object = findExact(requestVarbinds[i].oid.value, requestVarbinds[i].oid.length);
+        Object &target = objects[object];
+        qint64 integer;
+
+        if(target.type == SNMPBer::Integer)
+        {
+            SNMPBerReader::toInteger(value, integer);
+            target.number = quint64(integer);
+        } else if(target.type == SNMPBer::Counter32 || target.type == SNMPBer::Gauge32
+                  || target.type == SNMPBer::TimeTicks || target.type == SNMPBer::Counter64)
+        {
+            SNMPBerReader::toUnsigned(value, target.number);
+        } else
+        {
+            target.bytes = QByteArray(value.value, value.length);
+        }
+
+        changedObjects.append(object);
+    }
+
+    errorIndex = 0;
+    return 0;
+}
+
+/**
+*   Returns 0 if the value may be stored in the object, or the SNMPv2 error status.
+*/
+int SNMPAgent::checkSetValue(const Object &object, const SNMPBerElement &value) const
+{
+    qint64 integer;
+    quint64 unsignedInteger;
+
+    if(value.type != object.type)
+        return wrongType;
+
+    switch(object.type)
+    {
+    case SNMPBer::Integer:
+        return SNMPBerReader::toInteger(value, integer) ? 0 : wrongLength;
+
+    case SNMPBer::Counter32:
+    case SNMPBer::Gauge32:
+    case SNMPBer::TimeTicks:
+        if(!SNMPBerReader::toUnsigned(value, unsignedInteger))
+            return wrongLength;
+        return unsignedInteger <= 0xFFFFFFFFu ? 0 : wrongValue;
+
+    case SNMPBer::Counter64:
+        return SNMPBerReader::toUnsigned(value, unsignedInteger) ? 0 : wrongLength;
+
+    case SNMPBer::IpAddress:
+        return value.length == 4 ? 0 : wrongLength;
+
+    default:
+        return 0;
+    }
+}
+
+void SNMPAgent::writeValue(const Object &object)
+{
+    switch(object.type)
+    {
+    case SNMPBer::Integer:
+        encoder.writeInteger(qint64(object.number));
+        break;
+
+    case SNMPBer::Counter32:
+    case SNMPBer::Gauge32:
+    case SNMPBer::TimeTicks:
+    case SNMPBer::Counter64:
+        encoder.writeUnsigned(object.number, object.type);
+        break;
+
+    case SNMPBer::Null:
+        encoder.writeNull();
+        break;
+
+    default:
+        encoder.writeOctetString(object.bytes.constData(), object.bytes.size(), object.type);
+        break;
+    }
+}
+
+/**
+*   This method will encode the response: the varbinds of the request as they came,
+*   or the looked up results.
+*/
+void SNMPAgent::encodeResponse(const SNMPMessageView &request, int errorStatus, int errorIndex, bool echoVarbinds)
+{
+    encoder.reset();
+
+// include Varbind fields, from the last one
+    if(echoVarbinds)
+    {
+        for(int i = requestVarbinds.size() - 1; i >= 0; i--)
+        {
+            const SNMPVarbindView &varbind = requestVarbinds[i];
+            const int varbindEnd = encoder.mark();
+            encoder.writeOctetString(varbind.value.value, varbind.value.length, varbind.value.type);
+            encoder.writeOctetString(varbind.oid.value, varbind.oid.length, SNMPBer::ObjectIdentifier);
+            encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+        }
+    } else
+    {
+        for(int i = results.size() - 1; i >= 0; i--)
+        {
+            const Result &result = results[i];
+            const int varbindEnd = encoder.mark();
+            if(result.object != -1)
+                writeValue(objects[result.object]);
+            else
+                encoder.writeNull(result.exception);
+            encoder.writeOctetString(result.oid, result.oidLength, SNMPBer::ObjectIdentifier);
+            encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+        }
+    }
+
+    encoder.writeMessageHeader(int(request.version),
+                               QByteArray::fromRawData(request.community.value, request.community.length),
+                               SNMPBer::GetResponse, request.requestId, errorStatus, errorIndex);
+}
+
+/**
+*   Returns an upper bound of the encoded size of the varbind.
+*/
+int SNMPAgent::estimateVarbindSize(const Result &result) const
+{
+    int valueSize = 2;
+
+    if(result.object != -1)
+    {
+        const Object &object = objects[result.object];
+        switch(object.type)
+        {
+        case SNMPBer::Integer:
+        case SNMPBer::Counter32:
+        case SNMPBer::Gauge32:
+        case SNMPBer::TimeTicks:
+        case SNMPBer::Counter64:
+            valueSize = 11;
+            break;
+
+        case SNMPBer::Null:
+            break;
+
+        default:
+            valueSize = encodedSize(object.bytes.size());
+            break;
+        }
+    }
+
+    return encodedSize(encodedSize(result.oidLength) + valueSize);
+}
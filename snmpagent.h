@@ -0,0 +1,145 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class answers SNMP requests for objects the application publishes,
+ * so that a service can expose its own counters over SNMPv1 and SNMPv2c.
+ *
+ * Objects are registered with their OID and type and referred to by a
+ * handle, so that updating a live counter is a plain store. The MIB is kept
+ * as handles sorted in SNMP (arc by arc) order of their OIDs: Get is a
+ * binary search for the OID, GetNext and GetBulk a binary search for the
+ * first OID after it, and walking on is a step to the next handle.
+ *
+ * Get, GetNext, GetBulk and Set requests are decoded in place and answered
+ * with the shared SNMPBerWriter. On Linux requests are drained and answered
+ * by the batch through a SNMPDatagramTransport (recvmmsg/sendmmsg);
+ * elsewhere a QUdpSocket is used.
+ *
+ */
+
+
+#ifndef SNMPAGENT_H
+#define SNMPAGENT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHostAddress>
+#include <QString>
+#include <QUdpSocket>
+#include <QVector>
+#include <vector>
+#include "snmpber.h"
+#include "snmpdatagramtransport.h"
+#include "snmpoid.h"
+
+class SNMPAgent : public QObject {
+
+    Q_OBJECT
+
+public:
+    explicit SNMPAgent(QObject *parent = 0);
+    ~SNMPAgent();
+
+    bool listen(quint16 port = 161);
+    void close();
+    bool isListening() const;
+    quint16 getLocalPort() const;
+
+// get/set methods
+    QString getReadCommunity() const;
+    void setReadCommunity(const QString &communityStringParameter);
+    QString getWriteCommunity() const;
+    void setWriteCommunity(const QString &communityStringParameter);
+    int getMaxResponseSize() const;
+    void setMaxResponseSize(int maxResponseSize);
+
+// objects
+    int addObject(const SNMPOid &oid, int type, bool writable = false);
+    int findObject(const SNMPOid &oid) const;
+    bool removeObject(int object);
+    int objectCount() const { return int(order.size()); }
+    SNMPOid getObjectOid(int object) const;
+    int getObjectType(int object) const;
+
+    void setInteger(int object, qint64 value);
+    void setUnsigned(int object, quint64 value);
+    void setOctetString(int object, const QByteArray &value);
+    void setObjectIdentifier(int object, const SNMPOid &value);
+    qint64 getInteger(int object) const;
+    quint64 getUnsigned(int object) const;
+    QByteArray getOctetString(int object) const;
+
+// statistics
+    quint64 getRequestsAnswered() const { return answeredCount; }
+    quint64 getMalformedDatagrams() const { return malformedCount; }
+    quint64 getRejectedDatagrams() const { return rejectedCount; }
+    void resetStatistics();
+
+signals:
+    void objectChanged(int object);
+
+protected:
+    virtual void sendResponse(const char *data, int size, const QHostAddress &address, quint16 port);
+    void flushResponses();
+
+private slots:
+    void readBatchedDatagrams();
+    void readPendingDatagrams();
+
+private:
+    struct Object {
+        QByteArray oid;
+        QByteArray bytes;
+        quint64 number;
+        int type;
+        bool writable;
+        bool used;
+    };
+
+    // a varbind of the response: an object, or an exception for the OID
+    struct Result {
+        const char *oid;
+        int oidLength;
+        int object;
+        int exception;
+    };
+
+    bool isObject(int object) const;
+    int lowerBound(const char *oid, int size) const;
+    int nextPosition(const char *oid, int size) const;
+    int findExact(const char *oid, int size) const;
+
+    bool handleRequest(const char *data, int size);
+    int resolveGet(bool next);
+    void resolveBulk(const SNMPMessageView &request);
+    int applySet(bool version1, int &errorIndex);
+    int checkSetValue(const Object &object, const SNMPBerElement &value) const;
+    void writeValue(const Object &object);
+    void encodeResponse(const SNMPMessageView &request, int errorStatus, int errorIndex, bool echoVarbinds);
+    int estimateVarbindSize(const Result &result) const;
+
+    QByteArray readCommunity;
+    QByteArray writeCommunity;
+    int maxResponseSize;
+
+    std::vector<Object> objects;
+    std::vector<int> order;
+    std::vector<int> freeObjects;
+
+    SNMPDatagramTransport *transport;
+    QUdpSocket *udpSocket;
+    QByteArray receiveBuffer;
+    SNMPBerWriter encoder;
+    QVector<SNMPVarbindView> requestVarbinds;
+    QVector<Result> results;
+    QVector<int> bulkCursors;
+    QVector<int> changedObjects;
+
+    quint64 answeredCount;
+    quint64 malformedCount;
+    quint64 rejectedCount;
+};
+
+#endif // SNMPAGENT_H
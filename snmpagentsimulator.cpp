@@ -0,0 +1,211 @@
+#include "snmpagentsimulator.h"
+#include <cstdlib>
+
+// Columns of the simulated ifTable (1.3.6.1.2.1.2.2.1): ifIndex, ifDescr, ifInOctets,
+// ifInErrors and ifOutOctets
+static const int interfaceColumns[] = { 1, 2, 10, 14, 16 };
+static const int interfaceColumnCount = sizeof(interfaceColumns) / sizeof(interfaceColumns[0]);
+
+/**
+*   Appends an arc to an encoded OID, in base 128.
+*/
+static void appendArc(QByteArray &oid, quint32 arc)
+{
+    int groups = 1;
+    while(groups < 5 && (arc >> (7 * groups)) != 0)
+        groups++;
+
+    for(int group = groups - 1; group >= 0; group--)
+        oid.append(char(((arc >> (7 * group)) & 0x7f) | (group ? 0x80 : 0)));
+}
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   The simulator starts empty, without latency or loss.
+*/
+SNMPAgentSimulator::SNMPAgentSimulator(QObject *parent)
+        : SNMPAgent(parent)
+{
+    this->latency = 0;
+    this->jitter = 0;
+    this->lossRate = 0.0;
+    this->droppedCount = 0;
+    this->firstDelayed = 0;
+
+    delayTimer.setSingleShot(true);
+    connect(&delayTimer, &QTimer::timeout, this, &SNMPAgentSimulator::sendDueResponses);
+    clock.start();
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will publish a MIB of size objects: the system group, then
+*   the ifIndex, ifDescr, ifInOctets, ifInErrors and ifOutOctets columns of as many
+*   ifTable rows as needed. The counters start at values which differ per row.
+*   Returns the number of objects published.
+*/
+int SNMPAgentSimulator::populate(int size)
+{
+    static const SNMPOid sysDescr = "1.3.6.1.2.1.1.1.0"_oid;
+    static const SNMPOid sysObjectId = "1.3.6.1.2.1.1.2.0"_oid;
+    static const SNMPOid sysUpTime = "1.3.6.1.2.1.1.3.0"_oid;
+    static const SNMPOid sysName = "1.3.6.1.2.1.1.5.0"_oid;
+    static const SNMPOid ifEntry = "1.3.6.1.2.1.2.2.1"_oid;
+
+    int published = 0;
+    int object;
+
+    if(published++ < size)
+    {
+        object = addObject(sysDescr, SNMPBer::OctetString);
+        setOctetString(object, "SNMP agent simulator");
+    }
+    if(published++ < size)
+    {
+        object = addObject(sysObjectId, SNMPBer::ObjectIdentifier);
+        setObjectIdentifier(object, "0.0"_oid);
+    }
+    if(published++ < size)
+        addObject(sysUpTime, SNMPBer::TimeTicks);
+    if(published++ < size)
+    {
+        object = addObject(sysName, SNMPBer::OctetString, true);
+        setOctetString(object, "simulator");
+    }
+
+    const int remaining = qMax(0, size - 4);
+    const int rows = (remaining + interfaceColumnCount - 1) / interfaceColumnCount;
+
+    // a table is laid out column by column, the last column may be short
+    for(int column = 0; column < interfaceColumnCount; column++)
+    {
+        QByteArray columnOid = ifEntry.encoded();
+        appendArc(columnOid, interfaceColumns[column]);
+
+        for(int row = 1; row <= rows && published < size; row++, published++)
+        {
+            QByteArray oid = columnOid;
+            appendArc(oid, row);
+            const SNMPOid instance = SNMPOid::fromEncoded(oid);
+
+            switch(interfaceColumns[column])
+            {
+            case 1:
+                setInteger(addObject(instance, SNMPBer::Integer), row);
+                break;
+            case 2:
+                setOctetString(addObject(instance, SNMPBer::OctetString),
+                               QByteArray("eth") + QByteArray::number(row - 1));
+                break;
+            case 14:
+                addObject(instance, SNMPBer::Counter32);
+                break;
+            default:
+                setUnsigned(addObject(instance, SNMPBer::Counter32),
+                            quint64(row) * 1000 * quint64(interfaceColumns[column]));
+                break;
+            }
+        }
+    }
+
+    return objectCount();
+}
+
+int SNMPAgentSimulator::getLatency() const
+{
+    return latency;
+}
+
+int SNMPAgentSimulator::getJitter() const
+{
+    return jitter;
+}
+
+/**
+*   Holds every response back for latency milliseconds plus a random 0 to jitter
+*   milliseconds; responses with jitter may overtake each other, as on a network.
+*/
+void SNMPAgentSimulator::setLatency(int latency, int jitter)
+{
+    this->latency = qMax(0, latency);
+    this->jitter = qMax(0, jitter);
+}
+
+double SNMPAgentSimulator::getLossRate() const
+{
+    return lossRate;
+}
+
+/**
+*   Drops each response with the given probability, from 0.0 to 1.0.
+*/
+void SNMPAgentSimulator::setLossRate(double lossRate)
+{
+    this->lossRate = qBound(0.0, lossRate, 1.0);
+}
+
+
+//----[ Protected methods ]--------------------------------------------------------------
+
+void SNMPAgentSimulator::sendResponse(const char *data, int size, const QHostAddress &address, quint16 port)
+{
+    if(lossRate > 0.0 && double(rand()) < lossRate * (double(RAND_MAX) + 1.0))
+    {
+        droppedCount++;
+        return;
+    }
+
+    if(latency == 0 && jitter == 0)
+    {
+        SNMPAgent::sendResponse(data, size, address, port);
+        return;
+    }
+
+    DelayedResponse response;
+    response.due = clock.elapsed() + latency + (jitter ? rand() % (jitter + 1) : 0);
+    response.datagram = QByteArray(data, size);
+    response.address = address;
+    response.port = port;
+
+    // keep the responses sorted by due time; without jitter this is an append
+    int position = delayedResponses.size();
+    while(position > firstDelayed && delayedResponses[position - 1].due > response.due)
+        position--;
+    delayedResponses.insert(position, response);
+
+    if(position == firstDelayed)
+        delayTimer.start(int(qMax(qint64(0), response.due - clock.elapsed())));
+}
+
+
+//----[ Private slots ]------------------------------------------------------------------
+
+/**
+*   Sends the responses whose time has come, with one flush, and waits for the next.
+*/
+void SNMPAgentSimulator::sendDueResponses()
+{
+    const qint64 now = clock.elapsed();
+
+    while(firstDelayed < delayedResponses.size() && delayedResponses[firstDelayed].due <= now)
+    {
+        const DelayedResponse &response = delayedResponses[firstDelayed];
+        SNMPAgent::sendResponse(response.datagram.constData(), response.datagram.size(),
+                                response.address, response.port);
+        firstDelayed++;
+    }
+    flushResponses();
+
+    // drop the sent responses once they are half of the queue
+    if(firstDelayed * 2 >= delayedResponses.size())
+    {
+        delayedResponses.remove(0, firstDelayed);
+        firstDelayed = 0;
+    }
+
+    if(firstDelayed < delayedResponses.size())
+        delayTimer.start(int(qMax(qint64(0), delayedResponses[firstDelayed].due - now)));
+}
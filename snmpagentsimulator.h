@@ -0,0 +1,75 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class is a SNMPAgent which stands in for a real device in the same
+ * process, to exercise SNMPSession, SNMPManager or SNMPEngine over the
+ * loopback interface without a network.
+ *
+ * populate() publishes a MIB of the requested size shaped like a device's:
+ * the system group followed by rows of an interface table. Responses can
+ * be held back by a fixed latency plus a random jitter, and dropped with a
+ * given probability, to see how retries, adaptive timeouts and throughput
+ * behave against a slow or lossy agent.
+ *
+ */
+
+
+#ifndef SNMPAGENTSIMULATOR_H
+#define SNMPAGENTSIMULATOR_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTimer>
+#include <QVector>
+#include "snmpagent.h"
+
+class SNMPAgentSimulator : public SNMPAgent {
+
+    Q_OBJECT
+
+public:
+    explicit SNMPAgentSimulator(QObject *parent = 0);
+
+    int populate(int size);
+
+// get/set methods
+    int getLatency() const;
+    int getJitter() const;
+    void setLatency(int latency, int jitter = 0);
+    double getLossRate() const;
+    void setLossRate(double lossRate);
+
+// statistics
+    quint64 getResponsesDropped() const { return droppedCount; }
+    int delayedResponseCount() const { return delayedResponses.size() - firstDelayed; }
+
+protected:
+    void sendResponse(const char *data, int size, const QHostAddress &address, quint16 port);
+
+private slots:
+    void sendDueResponses();
+
+private:
+    struct DelayedResponse {
+        qint64 due;
+        QByteArray datagram;
+        QHostAddress address;
+        quint16 port;
+    };
+
+    int latency;
+    int jitter;
+    double lossRate;
+    quint64 droppedCount;
+
+    QVector<DelayedResponse> delayedResponses;
+    int firstDelayed;
+    QTimer delayTimer;
+    QElapsedTimer clock;
+};
+
+#endif // SNMPAGENTSIMULATOR_H
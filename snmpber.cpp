@@ -0,0 +1,863 @@
+#include "snmpber.h"
+#include <cstring>
+
+/**
+*   Reads one base 128 subidentifier of an encoded OID and steps over it.
+*   Returns false at the end of the OID or if the subidentifier is truncated.
+*/
+static bool readSubidentifier(const char *&position, const char *end, quint64 &value)
+{
+    value = 0;
+    while(position < end)
+    {
+        const quint8 byte = quint8(*position++);
+        value = (value << 7) | (byte & 0x7f);
+        if(!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+
+//----[ Object identifiers ]--------------------------------------------------------------
+
+/**
+*   Compares two encoded OIDs arc by arc, the way SNMP orders them.
+*   Returns a negative number, zero or a positive number as for strcmp.
+*/
+int SNMPBer::compareObjectIdentifiers(const char *first, int firstSize, const char *second, int secondSize)
+{
+    const char *firstEnd = first + firstSize;
+    const char *secondEnd = second + secondSize;
+    quint64 firstArc, secondArc;
+
+    for(;;)
+    {
+        const bool firstMore = readSubidentifier(first, firstEnd, firstArc);
+        const bool secondMore = readSubidentifier(second, secondEnd, secondArc);
+
+        if(!firstMore || !secondMore)
+            return int(firstMore) - int(secondMore);
+        if(firstArc != secondArc)
+            return firstArc < secondArc ? -1 : 1;
+    }
+}
+
+/**
+*   Returns true if the encoded OID lies strictly below the encoded root OID.
+*   Subidentifiers are self delimiting, so a byte prefix is also an arc prefix.
+*/
+bool SNMPBer::isInSubtree(const char *oid, int oidSize, const char *root, int rootSize)
+{
+    return oidSize > rootSize && memcmp(oid, root, rootSize) == 0;
+}
+
+/**
+*   Returns the dotted form of an encoded OID, e.g. "1.3.6.1.2.1.1.5.0".
+*/
+QString SNMPBer::objectIdentifierToString(const char *oid, int size)
+{
+    const char *end = oid + size;
+    QString dotted;
+    quint64 arc;
+
+    if(!readSubidentifier(oid, end, arc))
+        return dotted;
+
+    // the first subidentifier holds the first two arcs
+    const quint64 firstArc = arc < 80 ? arc / 40 : 2;
+    dotted = QString::number(firstArc) + "." + QString::number(arc - firstArc * 40);
+
+    while(readSubidentifier(oid, end, arc))
+        dotted += "." + QString::number(arc);
+
+    return dotted;
+}
+
+/**
+*   Converts a varbind value to its text form.
+*   Returns 0 on success, 5 for a malformed number or IpAddress, or 6 for a value type it does not know.
+*/
+int SNMPBer::valueToString(const SNMPBerElement &value, QString &receivedValue)
+{
+    const int valueType = value.type;
+    const int valueLength = value.length;
+    const char *data = value.value;
+
+    // if it's integer
+    if( valueType == SNMPBer::Integer)
+    {
+        qint64 number;
+        if( !SNMPBerReader::toInteger(value, number) )
+            return 5;
+        receivedValue = QString::number(number);
+        return 0;
+    }
+
+    // if it's a counter, a gauge or time ticks
+    if( valueType == SNMPBer::Counter32 || valueType == SNMPBer::Gauge32
+        || valueType == SNMPBer::TimeTicks || valueType == SNMPBer::Counter64)
+    {
+        quint64 number;
+        if( !SNMPBerReader::toUnsigned(value, number) )
+            return 5;
+        receivedValue = QString::number(number);
+        return 0;
+    }
+
+    // if it's an object identifier
+    if( valueType == SNMPBer::ObjectIdentifier)
+    {
+        receivedValue = SNMPBer::objectIdentifierToString(data, valueLength);
+        return 0;
+    }
+
+    // if it's null
+    if( valueType == SNMPBer::Null)
+    {
+        receivedValue.clear();
+        return 0;
+    }
+    // if it's an  IP address
+    if( valueType == SNMPBer::IpAddress)
+    {
+        if( valueLength != 4 )
+            return 5;
+
+        QString octet;
+        for(int i = 0;i < valueLength; i++){
+            octet = QString::number((unsigned char)data[i], 10);
+            receivedValue.push_back(octet);
+            receivedValue.push_back(".");
+        }
+		
+        receivedValue.truncate(receivedValue.size()-1);
+		
+        return 0;
+    }
+	
+   // if it's an octet string
+   if( valueType == SNMPBer::OctetString)
+    {
+        receivedValue = QString::fromLatin1(data, valueLength);
+        return 0;
+    }
+	
+    return 6;
+}
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   The writer allocates its buffer once. The default capacity holds any message
+*   which fits in a single Ethernet frame; larger messages grow the buffer.
+*/
+SNMPBerWriter::SNMPBerWriter(int capacity)
+{
+    buffer.resize(capacity);
+    bufferData = buffer.data();
+    bufferSize = capacity;
+    start = capacity;
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will discard the encoded message and keep the buffer for the next one.
+*/
+void SNMPBerWriter::reset()
+{
+    start = bufferSize;
+}
+
+/**
+*   This method will close a constructed element (SEQUENCE or PDU) whose content is
+*   everything written since the given mark was taken.
+*/
+void SNMPBerWriter::endConstructed(int mark, int type)
+{
+    writeLength(size() - mark);
+    writeTag(type);
+}
+
+/**
+*   This method will write a signed integer, or one of the application types based
+*   on it, using the minimal number of two's complement bytes.
+*/
+void SNMPBerWriter::writeInteger(qint64 value, int type)
+{
+    reserve(10);
+
+    int length = 0;
+    for(;;)
+    {
+        const char byte = char(value & 0xff);
+        bufferData[--start] = byte;
+        length++;
+        value >>= 8;
+
+        // stop once the remaining bytes are only sign extension of the last one
+        if((value == 0 && !(byte & 0x80)) || (value == -1 && (byte & 0x80)))
+            break;
+    }
+
+    writeLength(length);
+    writeTag(type);
+}
+
+/**
+*   This method will write an unsigned value (Counter32, Gauge32, TimeTicks, Counter64).
+*   A leading zero byte is added when the top bit is set, to keep the value positive.
+*/
+void SNMPBerWriter::writeUnsigned(quint64 value, int type)
+{
+    reserve(11);
+
+    int length = 0;
+    do
+    {
+        bufferData[--start] = char(value & 0xff);
+        length++;
+        value >>= 8;
+    } while(value != 0);
+
+    if(bufferData[start] & 0x80)
+    {
+        bufferData[--start] = 0;
+        length++;
+    }
+
+    writeLength(length);
+    writeTag(type);
+}
+
+void SNMPBerWriter::writeOctetString(const char *data, int size, int type)
+{
+    writeRaw(data, size);
+    writeLength(size);
+    writeTag(type);
+}
+
+void SNMPBerWriter::writeOctetString(const QByteArray &value, int type)
+{
+    writeOctetString(value.constData(), value.size(), type);
+}
+
+void SNMPBerWriter::writeNull(int type)
+{
+    writeLength(0);
+    writeTag(type);
+}
+
+/**
+*   This method will encode a dotted OID ("1.3.6.1.2.1.1.1.0", with or without a
+*   leading dot) straight from its text. The arcs are parsed from the last one
+*   backwards, so no intermediate list is needed.
+*   Returns false, leaving the writer unchanged, if the OID is malformed.
+*/
+bool SNMPBerWriter::writeObjectIdentifier(const char *dottedOid, int size)
+{
+    if(size > 0 && dottedOid[0] == '.')
+    {
+        dottedOid++;
+        size--;
+    }
+
+    if(size == 0 || dottedOid[size - 1] == '.')
+        return false;
+
+    // the first two arcs are combined into a single subidentifier
+    int firstDot = 0;
+    while(firstDot < size && dottedOid[firstDot] != '.')
+        firstDot++;
+
+    int secondDot = firstDot + 1;
+    while(secondDot < size && dottedOid[secondDot] != '.')
+        secondDot++;
+
+    quint32 firstArc, secondArc;
+    if(firstDot >= size || !parseArc(dottedOid, 0, firstDot, firstArc)
+       || !parseArc(dottedOid, firstDot + 1, secondDot, secondArc))
+        return false;
+
+    if(firstArc > 2 || (firstArc < 2 && secondArc > 39) || secondArc > 0xFFFFFFFFu - 80)
+        return false;
+
+    // remaining arcs, from the end of the string back to the second dot
+    const int restart = mark();
+    int end = size;
+    while(end > secondDot)
+    {
+        int arcStart = end;
+        while(dottedOid[arcStart - 1] != '.')
+            arcStart--;
+
+        quint32 value;
+        if(!parseArc(dottedOid, arcStart, end, value))
+        {
+            start = bufferSize - restart;
+            return false;
+        }
+
+        writeBase128(value);
+        end = arcStart - 1;
+    }
+
+    writeBase128(firstArc * 40 + secondArc);
+    writeLength(mark() - restart);
+    writeTag(SNMPBer::ObjectIdentifier);
+    return true;
+}
+
+bool SNMPBerWriter::writeObjectIdentifier(const QByteArray &dottedOid)
+{
+    return writeObjectIdentifier(dottedOid.constData(), dottedOid.size());
+}
+
+/**
+*   This method will write already encoded bytes in front of the message.
+*/
+void SNMPBerWriter::writeRaw(const char *data, int size)
+{
+    reserve(size);
+    start -= size;
+    memcpy(bufferData + start, data, size);
+}
+
+/**
+*   This method will write everything in front of the varbinds, which the caller
+*   has already written, and close the message.
+*   Returns the mark taken right before the Request ID was written.
+*/
+int SNMPBerWriter::writeMessageHeader(int version, const QByteArray &communityString, int pduType,
+                                      quint32 requestId, int errorStatus, int errorIndex)
+{
+    const int requestIdEnd = writePduHeader(pduType, requestId, errorStatus, errorIndex);
+
+// include Community string
+    writeOctetString(communityString);
+
+// include SNMP version
+    writeInteger(version);
+
+// finish the construction with the SNMP Message length and type code
+    endConstructed(0, SNMPBer::Sequence);
+
+    return requestIdEnd;
+}
+
+/**
+*   This method will write the PDU fields in front of the varbinds, which the caller
+*   has already written, and close the PDU; the buffer then holds the PDU alone, as
+*   SNMPv3 needs it for its scoped PDU.
+*   Returns the mark taken right before the Request ID was written.
+*/
+int SNMPBerWriter::writePduHeader(int pduType, quint32 requestId, int errorStatus, int errorIndex)
+{
+// include Varbind List field
+    endConstructed(0, SNMPBer::Sequence);
+
+// include Error Index field
+    writeInteger(errorIndex);
+
+// include Error field
+    writeInteger(errorStatus);
+
+// include Request ID
+    const int requestIdEnd = mark();
+    writeInteger(qint32(requestId));
+
+// include PDU field
+    endConstructed(0, pduType);
+
+    return requestIdEnd;
+}
+
+QByteArray SNMPBerWriter::toByteArray() const
+{
+    return QByteArray(data(), size());
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+/**
+*   Parses the decimal arc text[from..to). Returns false if it is empty, holds
+*   anything but digits or does not fit in 32 bits.
+*/
+bool SNMPBerWriter::parseArc(const char *text, int from, int to, quint32 &value)
+{
+    if(from >= to)
+        return false;
+
+    quint64 total = 0;
+    for(int i = from; i < to; i++)
+    {
+        if(text[i] < '0' || text[i] > '9')
+            return false;
+        total = total * 10 + (text[i] - '0');
+        if(total > 0xFFFFFFFFu)
+            return false;
+    }
+
+    value = quint32(total);
+    return true;
+}
+
+/**
+*   Lengths below 128 use the short form, longer ones the long form
+*   (0x81 nn, 0x82 nn nn, ...).
+*/
+void SNMPBerWriter::writeLength(int length)
+{
+    reserve(5);
+
+    if(length < 0x80)
+    {
+        bufferData[--start] = char(length);
+        return;
+    }
+
+    int numBytes = 0;
+    while(length > 0)
+    {
+        bufferData[--start] = char(length & 0xff);
+        length >>= 8;
+        numBytes++;
+    }
+    bufferData[--start] = char(0x80 | numBytes);
+}
+
+void SNMPBerWriter::writeTag(int type)
+{
+    reserve(1);
+    bufferData[--start] = char(type);
+}
+
+/**
+*   Writes an OID subidentifier in base 128, most significant group first,
+*   with the high bit set on every byte but the last.
+*/
+void SNMPBerWriter::writeBase128(quint32 value)
+{
+    reserve(5);
+
+    bufferData[--start] = char(value & 0x7f);
+    value >>= 7;
+    while(value != 0)
+    {
+        bufferData[--start] = char(0x80 | (value & 0x7f));
+        value >>= 7;
+    }
+}
+
+/**
+*   Makes room for the given number of bytes in front of the message. The buffer is
+*   only reallocated when a message is larger than any encoded before.
+*/
+void SNMPBerWriter::reserve(int bytes)
+{
+    if(start >= bytes)
+        return;
+
+    const int used = size();
+    int capacity = bufferSize * 2;
+    while(capacity - used < bytes)
+        capacity *= 2;
+
+    QByteArray grown(capacity, 0);
+    memcpy(grown.data() + capacity - used, data(), used);
+    buffer.swap(grown);
+    bufferData = buffer.data();
+    bufferSize = capacity;
+    start = capacity - used;
+}
+
+
+//----[ SNMPBerReader ]-------------------------------------------------------------------
+
+SNMPBerReader::SNMPBerReader()
+{
+    position = end = NULL;
+}
+
+SNMPBerReader::SNMPBerReader(const char *data, int size)
+{
+    position = data;
+    end = data + size;
+}
+
+/**
+*   Creates a reader over the content of a constructed element.
+*/
+SNMPBerReader::SNMPBerReader(const SNMPBerElement &constructed)
+{
+    position = constructed.value;
+    end = constructed.value + constructed.length;
+}
+
+/**
+*   Reads the element at position and steps over it, see SNMPBerReader::read. Kept
+*   apart so that the loops of decodeMessage and nextVarbind have it inlined.
+*/
+static inline SNMPBer::DecodeResult readElement(const char *&position, const char *end,
+                                                SNMPBerElement &element)
+{
+    const unsigned char *cursor = (const unsigned char *)position;
+    const unsigned char *limit = (const unsigned char *)end;
+
+    if(limit - cursor < 2)
+        return SNMPBer::DecodeTruncated;
+
+    const int type = *cursor++;
+    if((type & 0x1f) == 0x1f) // multi byte tag, never used by SNMP
+        return SNMPBer::DecodeInvalidTag;
+
+    quint32 length = *cursor++;
+    if(length & 0x80) // long form
+    {
+        const int numBytes = length & 0x7f;
+        if(numBytes == 0 || numBytes > 4)
+            return SNMPBer::DecodeInvalidLength;
+        if(limit - cursor < numBytes)
+            return SNMPBer::DecodeTruncated;
+
+        length = 0;
+        for(int n = 0; n < numBytes; n++)
+            length = (length << 8) | *cursor++;
+    }
+
+    if(length > quint32(limit - cursor))
+        return SNMPBer::DecodeTruncated;
+
+    element.type = type;
+    element.value = (const char *)cursor;
+    element.length = int(length);
+    position = element.value + element.length;
+    return SNMPBer::DecodeOk;
+}
+
+/**
+*   This method will read the element at the current position and step over it.
+*   Only single byte tags and definite lengths of up to four bytes are accepted, and
+*   the element must fit in what is left of the enclosing one.
+*   Returns why the input is malformed or truncated, without moving, or DecodeOk.
+*/
+SNMPBer::DecodeResult SNMPBerReader::read(SNMPBerElement &element)
+{
+    return readElement(position, end, element);
+}
+
+/**
+*   Same as read(), for callers which only need to know whether it worked.
+*/
+bool SNMPBerReader::next(SNMPBerElement &element)
+{
+    return read(element) == SNMPBer::DecodeOk;
+}
+
+/**
+*   Same as next(), but also fails if the element is not of the expected type.
+*/
+bool SNMPBerReader::next(SNMPBerElement &element, int expectedType)
+{
+    const char *restart = position;
+    if(!next(element))
+        return false;
+
+    if(element.type != expectedType)
+    {
+        position = restart;
+        return false;
+    }
+    return true;
+}
+
+/**
+*   This method will read a constructed element of the expected type and set
+*   content to a reader over its inside.
+*/
+bool SNMPBerReader::enter(SNMPBerReader &content, int expectedType)
+{
+    SNMPBerElement element;
+    if(!next(element, expectedType))
+        return false;
+
+    content = SNMPBerReader(element);
+    return true;
+}
+
+bool SNMPBerReader::readInteger(qint64 &value)
+{
+    SNMPBerElement element;
+    const char *restart = position;
+
+    if(!next(element, SNMPBer::Integer) || !toInteger(element, value))
+    {
+        position = restart;
+        return false;
+    }
+    return true;
+}
+
+/**
+*   Decodes a two's complement INTEGER of one to eight bytes.
+*/
+bool SNMPBerReader::toInteger(const SNMPBerElement &element, qint64 &value)
+{
+    if(element.length < 1 || element.length > 8)
+        return false;
+
+    quint64 total = quint64(qint64(qint8(element.value[0])));
+    for(int i = 1; i < element.length; i++)
+        total = (total << 8) | quint8(element.value[i]);
+
+    value = qint64(total);
+    return true;
+}
+
+/**
+*   Decodes an unsigned value (Counter32, Gauge32, TimeTicks, Counter64). A ninth
+*   byte is accepted only as the leading zero which keeps the top bit clear.
+*   Agents which leave that zero out are tolerated, the bytes are read as unsigned.
+*/
+bool SNMPBerReader::toUnsigned(const SNMPBerElement &element, quint64 &value)
+{
+    int i = 0;
+    if(element.length == 9 && element.value[0] == 0)
+        i = 1;
+
+    if(element.length < 1 || element.length - i > 8)
+        return false;
+
+    quint64 total = 0;
+    for(; i < element.length; i++)
+        total = (total << 8) | quint8(element.value[i]);
+
+    value = total;
+    return true;
+}
+
+
+//----[ SNMPMessageView ]-----------------------------------------------------------------
+
+/**
+*   Reads the next field of a message, which must be of the expected type.
+*/
+static inline SNMPBer::DecodeResult readField(const char *&position, const char *end,
+                                              SNMPBerElement &element, int expectedType)
+{
+    const SNMPBer::DecodeResult result = readElement(position, end, element);
+    if(result != SNMPBer::DecodeOk)
+        return result;
+
+    return element.type == expectedType ? SNMPBer::DecodeOk : SNMPBer::DecodeUnexpectedType;
+}
+
+/**
+*   Reads the next field of a message as an INTEGER from minimum to maximum.
+*/
+static inline SNMPBer::DecodeResult readIntegerField(const char *&position, const char *end, qint64 &value,
+                                                     qint64 minimum, qint64 maximum)
+{
+    SNMPBerElement element;
+    const SNMPBer::DecodeResult result = readField(position, end, element, SNMPBer::Integer);
+    if(result != SNMPBer::DecodeOk)
+        return result;
+
+    if(!SNMPBerReader::toInteger(element, value) || value < minimum || value > maximum)
+        return SNMPBer::DecodeInvalidInteger;
+    return SNMPBer::DecodeOk;
+}
+
+/**
+*   Returns true for the content of an OBJECT IDENTIFIER: at least one subidentifier,
+*   the last one complete.
+*/
+static bool isObjectIdentifier(const SNMPBerElement &element)
+{
+    return element.length > 0 && !(element.value[element.length - 1] & 0x80);
+}
+
+/**
+*   Checks the content of a varbind list, position..end: every varbind must be an OID
+*   followed by exactly one value, and the last one must end the list.
+*/
+static inline SNMPBer::DecodeResult decodeVarbinds(const char *position, const char *end)
+{
+    using namespace SNMPBer;
+    DecodeResult result;
+
+    while(position != end)
+    {
+        SNMPBerElement varbind, oid, varbindValue;
+        if((result = readField(position, end, varbind, Sequence)) != DecodeOk)
+            return result;
+
+        const char *field = varbind.value;
+        const char *varbindEnd = varbind.value + varbind.length;
+        if(readField(field, varbindEnd, oid, ObjectIdentifier) != DecodeOk || !isObjectIdentifier(oid)
+           || readElement(field, varbindEnd, varbindValue) != DecodeOk || field != varbindEnd)
+            return DecodeInvalidVarbind;
+    }
+
+    return DecodeOk;
+}
+
+/**
+*   Decodes the PDU which must fill position..end: its type, the Request ID, Error
+*   Status and Error Index fields, and the varbind list, each varbind checked.
+*/
+static inline SNMPBer::DecodeResult decodePduField(const char *position, const char *end,
+                                                   SNMPMessageView &message)
+{
+    using namespace SNMPBer;
+    SNMPBerElement element;
+    DecodeResult result;
+    qint64 value;
+
+// include PDU field
+    if((result = readElement(position, end, element)) != DecodeOk)
+        return result;
+    if((element.type & 0xE0) != 0xA0)
+        return DecodeUnexpectedType;
+    if(position != end)
+        return DecodeTrailingData;
+
+    message.pduType = element.type;
+    position = element.value;
+    const char *pduEnd = element.value + element.length;
+
+// include Request ID, Error Status and Error Index fields
+    if((result = readIntegerField(position, pduEnd, value, -2147483648LL, 4294967295LL)) != DecodeOk)
+        return result;
+    message.requestId = quint32(value);
+
+    if((result = readIntegerField(position, pduEnd, value, 0, 0x7fffffff)) != DecodeOk)
+        return result;
+    message.errorStatus = int(value);
+
+    if((result = readIntegerField(position, pduEnd, value, 0, 0x7fffffff)) != DecodeOk)
+        return result;
+    message.errorIndex = int(value);
+
+// include Varbind List field
+    if((result = readField(position, pduEnd, element, Sequence)) != DecodeOk)
+        return result;
+    if(position != pduEnd)
+        return DecodeTrailingData;
+
+    if((result = decodeVarbinds(element.value, element.value + element.length)) != DecodeOk)
+        return result;
+
+    message.varbinds = SNMPBerReader(element);
+    return DecodeOk;
+}
+
+/**
+*   This method will decode a SNMP v1/v2c message: version, community, the PDU
+*   fields, and the varbind list, which is left in message for nextVarbind().
+*   Every element is checked against the datagram and its enclosing element before
+*   it is read, nothing may follow the last field of the message or of the PDU, and
+*   every varbind must be an OID followed by exactly one value; so once a message
+*   is accepted, nextVarbind() only returns false at the end of the list.
+*   The function keeps no state and only reads data. message is complete only when
+*   DecodeOk is returned; otherwise the result says what is wrong.
+*/
+SNMPBer::DecodeResult SNMPBer::decodeMessage(const char *data, int size, SNMPMessageView &message)
+{
+    const char *position = data;
+    SNMPBerElement element;
+    DecodeResult result;
+
+// include Message field
+    if((result = readField(position, data + size, element, Sequence)) != DecodeOk)
+        return result;
+    if(position != data + size)
+        return DecodeTrailingData;
+
+    position = element.value;
+    const char *messageEnd = element.value + element.length;
+
+// include Version and Community fields
+    if((result = readIntegerField(position, messageEnd, message.version, 0, 0x7fffffff)) != DecodeOk
+       || (result = readField(position, messageEnd, message.community, OctetString)) != DecodeOk)
+        return result;
+
+// include PDU field
+    return decodePduField(position, messageEnd, message);
+}
+
+/**
+*   This method will decode a PDU on its own, as found in the scoped PDU of a SNMPv3
+*   message, with the same checks as decodeMessage. data must hold the PDU and nothing
+*   else; the version and community of message are left alone.
+*/
+SNMPBer::DecodeResult SNMPBer::decodePdu(const char *data, int size, SNMPMessageView &message)
+{
+    return decodePduField(data, data + size, message);
+}
+
+/**
+*   This method will check the content of a varbind list with the same checks as
+*   decodeMessage, for PDUs which carry one after other fields, as the SNMPv1
+*   Trap-PDU does. data must hold the content of the list and nothing else.
+*/
+SNMPBer::DecodeResult SNMPBer::decodeVarbindList(const char *data, int size)
+{
+    return decodeVarbinds(data, data + size);
+}
+
+/**
+*   Returns a short English description of a decode result, for logs.
+*/
+const char *SNMPBer::decodeResultString(DecodeResult result)
+{
+    switch(result)
+    {
+    case DecodeOk:
+        return "no error";
+    case DecodeTruncated:
+        return "truncated element";
+    case DecodeInvalidTag:
+        return "multi byte tag";
+    case DecodeInvalidLength:
+        return "unsupported length";
+    case DecodeUnexpectedType:
+        return "unexpected element type";
+    case DecodeInvalidInteger:
+        return "invalid integer";
+    case DecodeTrailingData:
+        return "trailing data";
+    case DecodeInvalidVarbind:
+        return "invalid varbind";
+    }
+    return "unknown error";
+}
+
+/**
+*   This method will decode a SNMP v1/v2c message with SNMPBer::decodeMessage.
+*   Returns false if the message is malformed.
+*/
+bool SNMPMessageView::decode(const char *data, int size)
+{
+    return SNMPBer::decodeMessage(data, size, *this) == SNMPBer::DecodeOk;
+}
+
+/**
+*   This method will return the next varbind of the message as views on its name
+*   and value. Returns false at the end of the list.
+*/
+bool SNMPMessageView::nextVarbind(SNMPVarbindView &varbind)
+{
+    SNMPBerElement sequence;
+    if(!varbinds.next(sequence, SNMPBer::Sequence))
+        return false;
+
+    const char *field = sequence.value;
+    const char *end = sequence.value + sequence.length;
+    return readElement(field, end, varbind.oid) == SNMPBer::DecodeOk
+           && varbind.oid.type == SNMPBer::ObjectIdentifier
+           && readElement(field, end, varbind.value) == SNMPBer::DecodeOk;
+}
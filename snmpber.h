@@ -0,0 +1,188 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Basic Encoding Rules (BER) support for SNMP messages.
+ *
+ * SNMPBerWriter encodes a message back to front into a preallocated buffer:
+ * the innermost element is written first and every constructed element is
+ * closed once its content is complete, so each length is known when it is
+ * written and the whole message is produced in one pass without moving data.
+ *
+ * SNMPBerReader walks a received datagram in place. Elements are returned as
+ * views (type, pointer to the value, length) into the datagram, every length
+ * is checked against the enclosing element, and nothing is copied or allocated.
+ * SNMPMessageView uses it to decode the header and varbinds of a SNMP message.
+ *
+ * SNMPBer::decodeMessage() is the single entry point for untrusted datagrams:
+ * it checks the whole structure of a message, varbinds included, before any of
+ * it is used, and says what is wrong with a message it rejects.
+ *
+ */
+
+
+#ifndef SNMPBER_H
+#define SNMPBER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+struct SNMPBerElement;
+class SNMPMessageView;
+
+namespace SNMPBer {
+
+// Universal types
+const int Integer = 0x02;
+const int OctetString = 0x04;
+const int Null = 0x05;
+const int ObjectIdentifier = 0x06;
+const int Sequence = 0x30;
+
+// Application types
+const int IpAddress = 0x40;
+const int Counter32 = 0x41;
+const int Gauge32 = 0x42;
+const int TimeTicks = 0x43;
+const int Opaque = 0x44;
+const int Counter64 = 0x46;
+
+// PDU types
+const int GetRequest = 0xA0;
+const int GetNextRequest = 0xA1;
+const int GetResponse = 0xA2;
+const int SetRequest = 0xA3;
+const int Trap = 0xA4;
+const int GetBulkRequest = 0xA5;
+const int InformRequest = 0xA6;
+const int SNMPv2Trap = 0xA7;
+const int Report = 0xA8;
+
+// SNMPv2 exceptions, found in place of a varbind value
+const int NoSuchObject = 0x80;
+const int NoSuchInstance = 0x81;
+const int EndOfMibView = 0x82;
+
+// Message versions
+const int Version1 = 0;
+const int Version2c = 1;
+const int Version3 = 3;
+
+// Results of decoding a message or an element
+enum DecodeResult {
+    DecodeOk = 0,
+    DecodeTruncated,        // an element runs past its datagram or enclosing element
+    DecodeInvalidTag,       // a multi byte tag, which SNMP never uses
+    DecodeInvalidLength,    // an indefinite length, or a length of over four bytes
+    DecodeUnexpectedType,   // an element of the wrong type for its field
+    DecodeInvalidInteger,   // an INTEGER field which is empty, too long or out of range
+    DecodeTrailingData,     // bytes after the last field of the message or of the PDU
+    DecodeInvalidVarbind    // a varbind which is not an OID followed by one value
+};
+
+DecodeResult decodeMessage(const char *data, int size, SNMPMessageView &message);
+DecodeResult decodePdu(const char *data, int size, SNMPMessageView &message);
+DecodeResult decodeVarbindList(const char *data, int size);
+const char *decodeResultString(DecodeResult result);
+
+int compareObjectIdentifiers(const char *first, int firstSize, const char *second, int secondSize);
+bool isInSubtree(const char *oid, int oidSize, const char *root, int rootSize);
+QString objectIdentifierToString(const char *oid, int size);
+int valueToString(const SNMPBerElement &value, QString &text);
+
+}
+
+class SNMPBerWriter {
+
+public:
+    explicit SNMPBerWriter(int capacity = 1472);
+
+    void reset();
+
+    int mark() const { return bufferSize - start; }
+    void endConstructed(int mark, int type);
+
+    void writeInteger(qint64 value, int type = SNMPBer::Integer);
+    void writeUnsigned(quint64 value, int type);
+    void writeOctetString(const char *data, int size, int type = SNMPBer::OctetString);
+    void writeOctetString(const QByteArray &value, int type = SNMPBer::OctetString);
+    void writeNull(int type = SNMPBer::Null);
+    bool writeObjectIdentifier(const char *dottedOid, int size);
+    bool writeObjectIdentifier(const QByteArray &dottedOid);
+    void writeRaw(const char *data, int size);
+    int writeMessageHeader(int version, const QByteArray &communityString, int pduType,
+                           quint32 requestId, int errorStatus = 0, int errorIndex = 0);
+    int writePduHeader(int pduType, quint32 requestId, int errorStatus = 0, int errorIndex = 0);
+
+    const char *data() const { return bufferData + start; }
+    char *data() { return bufferData + start; }
+    int size() const { return bufferSize - start; }
+    QByteArray toByteArray() const;
+
+private:
+    // bufferData points into buffer, a copy would write into the original's buffer
+    Q_DISABLE_COPY(SNMPBerWriter)
+
+    void writeLength(int length);
+    void writeTag(int type);
+    void writeBase128(quint32 value);
+    static bool parseArc(const char *text, int from, int to, quint32 &value);
+    void reserve(int bytes);
+
+    QByteArray buffer;
+    char *bufferData;
+    int bufferSize;
+    int start;
+};
+
+struct SNMPBerElement {
+    int type;
+    const char *value;
+    int length;
+};
+
+class SNMPBerReader {
+
+public:
+    SNMPBerReader();
+    SNMPBerReader(const char *data, int size);
+    explicit SNMPBerReader(const SNMPBerElement &constructed);
+
+    bool atEnd() const { return position == end; }
+    SNMPBer::DecodeResult read(SNMPBerElement &element);
+    bool next(SNMPBerElement &element);
+    bool next(SNMPBerElement &element, int expectedType);
+    bool enter(SNMPBerReader &content, int expectedType = SNMPBer::Sequence);
+    bool readInteger(qint64 &value);
+
+    static bool toInteger(const SNMPBerElement &element, qint64 &value);
+    static bool toUnsigned(const SNMPBerElement &element, quint64 &value);
+
+private:
+    const char *position;
+    const char *end;
+};
+
+struct SNMPVarbindView {
+    SNMPBerElement oid;
+    SNMPBerElement value;
+};
+
+class SNMPMessageView {
+
+public:
+    bool decode(const char *data, int size);
+    bool nextVarbind(SNMPVarbindView &varbind);
+
+    qint64 version;
+    SNMPBerElement community;
+    int pduType;
+    quint32 requestId;
+    int errorStatus;
+    int errorIndex;
+    SNMPBerReader varbinds;
+};
+
+#endif // SNMPBER_H
@@ -0,0 +1,56 @@
+#include "snmpbufferpool.h"
+#include <string.h>
+
+// Capacity of a new buffer: a message of an Ethernet frame, which most are
+static const int minBufferCapacity = 1472;
+
+// Buffers kept per thread, and the largest kept: the largest UDP payload
+static const int maxFreeBuffers = 4096;
+static const int maxBufferCapacity = 65507;
+
+/**
+*   Returns a buffer holding a copy of size bytes at data, taken from the free list
+*   of the calling thread when it has one.
+*/
+QByteArray SNMPBufferPool::acquire(const char *data, int size)
+{
+    QVector<QByteArray> &buffers = freeBuffers();
+    QByteArray buffer;
+    if(!buffers.isEmpty())
+        buffer = buffers.takeLast();
+
+    // a reserved capacity survives resizing to a smaller size
+    buffer.reserve(qMax(size, minBufferCapacity));
+    buffer.resize(size);
+    memcpy(buffer.data(), data, size);
+    return buffer;
+}
+
+/**
+*   This method will put the buffer on the free list of the calling thread, unless
+*   it is shared, too large or the list is full, and leave it empty.
+*/
+void SNMPBufferPool::release(QByteArray &buffer)
+{
+    QVector<QByteArray> &buffers = freeBuffers();
+
+    if(buffer.isDetached() && buffer.capacity() > 0 && buffer.capacity() <= maxBufferCapacity
+       && buffers.size() < maxFreeBuffers)
+        buffers.append(buffer);
+
+    buffer.clear();
+}
+
+/**
+*   Returns the number of buffers on the free list of the calling thread.
+*/
+int SNMPBufferPool::freeCount()
+{
+    return freeBuffers().size();
+}
+
+QVector<QByteArray> &SNMPBufferPool::freeBuffers()
+{
+    static thread_local QVector<QByteArray> buffers;
+    return buffers;
+}
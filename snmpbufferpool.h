@@ -0,0 +1,36 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class recycles the byte buffers which requests keep their messages in
+ * until they are answered, so steady polling does not allocate them anew.
+ *
+ * Every thread has its own free list, so taking and giving back a buffer
+ * needs no lock. A buffer given back keeps its capacity; a request takes one
+ * from the free list of its thread and copies its message in. Once the lists
+ * hold as many buffers as requests are in flight at the busiest moment, no
+ * more memory is allocated for them. A buffer still shared with another
+ * QByteArray is simply dropped instead of recycled.
+ *
+ */
+
+
+#ifndef SNMPBUFFERPOOL_H
+#define SNMPBUFFERPOOL_H
+
+#include <QByteArray>
+#include <QVector>
+
+class SNMPBufferPool {
+
+public:
+    static QByteArray acquire(const char *data, int size);
+    static void release(QByteArray &buffer);
+    static int freeCount();
+
+private:
+    static QVector<QByteArray> &freeBuffers();
+};
+
+#endif // SNMPBUFFERPOOL_H
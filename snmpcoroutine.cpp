@@ -0,0 +1,194 @@
+#include "snmpcoroutine.h"
+
+#ifdef SNMP_HAS_COROUTINES
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   The session must outlive this object. Its signals still reach other receivers.
+*/
+SNMPCoroutineSession::SNMPCoroutineSession(SNMPSession &session)
+        : session(session)
+{
+    QObject::connect(&session, &SNMPSession::responseReceived, &context,
+                     [this](quint32 requestId, int errorStatus, const QString &receivedValue) {
+        RequestAwaitable *awaitable = requests.take(requestId);
+        if(!awaitable)
+            return;
+
+        awaitable->result.errorStatus = errorStatus;
+        awaitable->result.value = receivedValue;
+        awaitable->handle.resume();
+    });
+
+    QObject::connect(&session, &SNMPSession::requestFailed, &context,
+                     [this](quint32 requestId, int errorCode) {
+        RequestAwaitable *awaitable = requests.take(requestId);
+        if(!awaitable)
+            return;
+
+        awaitable->result.errorStatus = errorCode;
+        awaitable->handle.resume();
+    });
+
+    QObject::connect(&session, &SNMPSession::walkVarbindReceived, &context,
+                     [this](quint32 walkId, const QString &oid, const QString &value) {
+        WalkAwaitable *awaitable = walks.value(walkId);
+        if(awaitable)
+            awaitable->result.varbinds.append(qMakePair(oid, value));
+    });
+
+    QObject::connect(&session, &SNMPSession::walkFinished, &context,
+                     [this](quint32 walkId, int errorStatus) {
+        WalkAwaitable *awaitable = walks.take(walkId);
+        if(!awaitable)
+            return;
+
+        awaitable->result.errorStatus = errorStatus;
+        awaitable->handle.resume();
+    });
+}
+
+/**
+*   The requests and walks still awaited are cancelled, and their coroutines resumed
+*   with error 5 so that they can release what they hold.
+*/
+SNMPCoroutineSession::~SNMPCoroutineSession()
+{
+    while(!requests.isEmpty())
+    {
+        const quint32 requestId = requests.begin().key();
+        RequestAwaitable *awaitable = requests.take(requestId);
+        session.cancelRequest(requestId);
+        awaitable->result.errorStatus = 5;
+        awaitable->handle.resume();
+    }
+
+    while(!walks.isEmpty())
+    {
+        const quint32 walkId = walks.begin().key();
+        WalkAwaitable *awaitable = walks.take(walkId);
+        session.cancelWalk(walkId);
+        awaitable->result.errorStatus = 5;
+        awaitable->handle.resume();
+    }
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   Returns an awaitable which sends a get-request once it is awaited, and gives the
+*   result of SNMPSession::sendGetRequestAsync: the value, or the error status.
+*/
+SNMPCoroutineSession::RequestAwaitable SNMPCoroutineSession::get(const QString &communityStringParameter,
+                                                                 const SNMPOid &oid)
+{
+    return RequestAwaitable(this, RequestAwaitable::Get, communityStringParameter, oid);
+}
+
+SNMPCoroutineSession::RequestAwaitable SNMPCoroutineSession::set(const QString &communityStringParameter,
+                                                                 const SNMPOid &oid, int value)
+{
+    RequestAwaitable awaitable(this, RequestAwaitable::SetInteger, communityStringParameter, oid);
+    awaitable.integerValue = value;
+    return awaitable;
+}
+
+SNMPCoroutineSession::RequestAwaitable SNMPCoroutineSession::set(const QString &communityStringParameter,
+                                                                 const SNMPOid &oid,
+                                                                 const QString &valueParameter)
+{
+    RequestAwaitable awaitable(this, RequestAwaitable::SetString, communityStringParameter, oid);
+    awaitable.stringValue = valueParameter;
+    return awaitable;
+}
+
+/**
+*   Returns an awaitable which walks the subtree once it is awaited, and gives all
+*   its varbinds with the status the walk finished with.
+*/
+SNMPCoroutineSession::WalkAwaitable SNMPCoroutineSession::walk(const QString &communityStringParameter,
+                                                               const SNMPOid &rootOid)
+{
+    return WalkAwaitable(this, communityStringParameter, rootOid, 0);
+}
+
+SNMPCoroutineSession::WalkAwaitable SNMPCoroutineSession::bulkWalk(const QString &communityStringParameter,
+                                                                   const SNMPOid &rootOid, int maxRepetitions)
+{
+    return WalkAwaitable(this, communityStringParameter, rootOid, qMax(maxRepetitions, 1));
+}
+
+
+//----[ Awaitables ]---------------------------------------------------------------------
+
+SNMPCoroutineSession::RequestAwaitable::RequestAwaitable(SNMPCoroutineSession *owner, Kind kind,
+                                                         const QString &communityString,
+                                                         const SNMPOid &oid)
+{
+    this->owner = owner;
+    this->kind = kind;
+    this->communityString = communityString;
+    this->oid = oid;
+    this->integerValue = 0;
+}
+
+/**
+*   Sends the request. The coroutine does not suspend if it could not be sent,
+*   and then gets error 5.
+*/
+bool SNMPCoroutineSession::RequestAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    SNMPSession &session = owner->session;
+    quint32 requestId;
+
+    if(kind == Get)
+        requestId = session.sendGetRequestAsync(communityString, oid);
+    else if(kind == SetInteger)
+        requestId = session.sendSetRequestAsync(communityString, oid, integerValue);
+    else
+        requestId = session.sendSetRequestAsync(communityString, oid, stringValue);
+
+    if(!requestId)
+    {
+        result.errorStatus = 5;
+        return false;
+    }
+
+    this->handle = handle;
+    owner->requests.insert(requestId, this);
+    return true;
+}
+
+SNMPCoroutineSession::WalkAwaitable::WalkAwaitable(SNMPCoroutineSession *owner, const QString &communityString,
+                                                   const SNMPOid &rootOid, int maxRepetitions)
+{
+    this->owner = owner;
+    this->communityString = communityString;
+    this->rootOid = rootOid;
+    this->maxRepetitions = maxRepetitions;
+}
+
+/**
+*   Starts the walk, with GetBulk requests if maxRepetitions is set. The coroutine
+*   does not suspend if it could not be started, and then gets error 5.
+*/
+bool SNMPCoroutineSession::WalkAwaitable::await_suspend(std::coroutine_handle<> handle)
+{
+    SNMPSession &session = owner->session;
+    const quint32 walkId = maxRepetitions ? session.bulkWalk(communityString, rootOid, maxRepetitions)
+                                          : session.walk(communityString, rootOid);
+
+    if(!walkId)
+    {
+        result.errorStatus = 5;
+        return false;
+    }
+
+    this->handle = handle;
+    owner->walks.insert(walkId, this);
+    return true;
+}
+
+#endif // SNMP_HAS_COROUTINES
@@ -0,0 +1,159 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * C++20 coroutine support for SNMPSession, so that multi-step workflows
+ * read top to bottom while thousands of them share one event loop thread:
+ *
+ *     SNMPTask identify(SNMPCoroutineSession &agent)
+ *     {
+ *         SNMPResult objectId = co_await agent.get("public", "1.3.6.1.2.1.1.2.0"_oid);
+ *         if(objectId.errorStatus == 0 && objectId.value.startsWith("1.3.6.1.4.1.9."))
+ *         {
+ *             SNMPWalkResult interfaces = co_await agent.bulkWalk("public", "1.3.6.1.2.1.2.2"_oid);
+ *             ...
+ *         }
+ *     }
+ *
+ * SNMPCoroutineSession connects once to the signals of a session and keeps
+ * the suspended coroutines by request and walk ID; a coroutine is resumed
+ * right from the slot handling its response, on the thread of the session.
+ * The awaitables keep their state in the coroutine frame, so awaiting does
+ * not allocate beyond the request itself.
+ *
+ * Everything here needs a compiler with C++20 coroutines; with older
+ * standards the header declares nothing.
+ *
+ */
+
+
+#ifndef SNMPCOROUTINE_H
+#define SNMPCOROUTINE_H
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define SNMP_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef SNMP_HAS_COROUTINES
+
+#include <QObject>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <coroutine>
+#include <exception>
+#include "qtsnmp.h"
+#include "snmpoid.h"
+
+struct SNMPResult {
+    SNMPResult() : errorStatus(0) {}
+
+    int errorStatus;
+    QString value;
+};
+
+struct SNMPWalkResult {
+    SNMPWalkResult() : errorStatus(0) {}
+
+    int errorStatus;
+    QVector<QPair<QString, QString> > varbinds;
+};
+
+/**
+*   The return type of a coroutine nobody waits for: it starts at once, runs up to
+*   its first co_await and frees itself when it finishes.
+*/
+class SNMPTask {
+
+public:
+    struct promise_type {
+        SNMPTask get_return_object() { return SNMPTask(); }
+        std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+        std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+class SNMPCoroutineSession {
+
+public:
+    class RequestAwaitable;
+    class WalkAwaitable;
+
+    explicit SNMPCoroutineSession(SNMPSession &session);
+    ~SNMPCoroutineSession();
+
+    SNMPSession &getSession() const { return session; }
+
+    RequestAwaitable get(const QString &communityStringParameter, const SNMPOid &oid);
+    RequestAwaitable set(const QString &communityStringParameter, const SNMPOid &oid, int value);
+    RequestAwaitable set(const QString &communityStringParameter, const SNMPOid &oid,
+                         const QString &valueParameter);
+    WalkAwaitable walk(const QString &communityStringParameter, const SNMPOid &rootOid);
+    WalkAwaitable bulkWalk(const QString &communityStringParameter, const SNMPOid &rootOid,
+                           int maxRepetitions = 10);
+
+    class RequestAwaitable {
+
+    public:
+        bool await_ready() const { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        SNMPResult await_resume() const { return result; }
+
+    private:
+        friend class SNMPCoroutineSession;
+
+        enum Kind { Get, SetInteger, SetString };
+
+        RequestAwaitable(SNMPCoroutineSession *owner, Kind kind, const QString &communityString,
+                         const SNMPOid &oid);
+
+        SNMPCoroutineSession *owner;
+        Kind kind;
+        QString communityString;
+        SNMPOid oid;
+        int integerValue;
+        QString stringValue;
+        std::coroutine_handle<> handle;
+        SNMPResult result;
+    };
+
+    class WalkAwaitable {
+
+    public:
+        bool await_ready() const { return false; }
+        bool await_suspend(std::coroutine_handle<> handle);
+        SNMPWalkResult await_resume() const { return result; }
+
+    private:
+        friend class SNMPCoroutineSession;
+
+        WalkAwaitable(SNMPCoroutineSession *owner, const QString &communityString,
+                      const SNMPOid &rootOid, int maxRepetitions);
+
+        SNMPCoroutineSession *owner;
+        QString communityString;
+        SNMPOid rootOid;
+        int maxRepetitions;
+        std::coroutine_handle<> handle;
+        SNMPWalkResult result;
+    };
+
+private:
+    SNMPCoroutineSession(const SNMPCoroutineSession &);
+    SNMPCoroutineSession &operator=(const SNMPCoroutineSession &);
+
+    SNMPSession &session;
+    QObject context;
+    QHash<quint32, RequestAwaitable *> requests;
+    QHash<quint32, WalkAwaitable *> walks;
+};
+
+#endif // SNMP_HAS_COROUTINES
+
+#endif // SNMPCOROUTINE_H
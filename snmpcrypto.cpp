@@ -0,0 +1,362 @@
+#include "snmpcrypto.h"
+#include <string.h>
+
+static inline quint32 rotateLeft(quint32 value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static inline quint32 readBigEndian(const quint8 *data)
+{
+    return (quint32(data[0]) << 24) | (quint32(data[1]) << 16) | (quint32(data[2]) << 8) | data[3];
+}
+
+static inline void writeBigEndian(quint32 value, quint8 *data)
+{
+    data[0] = quint8(value >> 24);
+    data[1] = quint8(value >> 16);
+    data[2] = quint8(value >> 8);
+    data[3] = quint8(value);
+}
+
+//----[ SNMPSha1 ]-----------------------------------------------------------------------
+
+SNMPSha1::SNMPSha1()
+{
+    reset();
+}
+
+void SNMPSha1::reset()
+{
+    state[0] = 0x67452301;
+    state[1] = 0xEFCDAB89;
+    state[2] = 0x98BADCFE;
+    state[3] = 0x10325476;
+    state[4] = 0xC3D2E1F0;
+    length = 0;
+    bufferSize = 0;
+}
+
+void SNMPSha1::addData(const char *data, int size)
+{
+    const quint8 *input = reinterpret_cast<const quint8 *>(data);
+    length += quint64(size);
+
+    if(bufferSize > 0) {
+        const int bytes = qMin(size, int(BlockSize) - bufferSize);
+        memcpy(buffer + bufferSize, input, bytes);
+        bufferSize += bytes;
+        input += bytes;
+        size -= bytes;
+        if(bufferSize < BlockSize)
+            return;
+        processBlock(buffer);
+        bufferSize = 0;
+    }
+
+    // whole blocks are hashed straight from the input
+    while(size >= BlockSize) {
+        processBlock(input);
+        input += BlockSize;
+        size -= BlockSize;
+    }
+
+    memcpy(buffer, input, size);
+    bufferSize = size;
+}
+
+/**
+*   This method will write the digest of the data added so far to digest (DigestSize bytes).
+*   The padding is added to a copy, so more data can still be added to this hash.
+*/
+void SNMPSha1::result(char *digest) const
+{
+    SNMPSha1 last(*this);
+    const quint64 bits = length * 8;
+
+    const char one = char(0x80);
+    const char zeros[BlockSize] = {};
+    last.addData(&one, 1);
+    last.addData(zeros, (BlockSize * 2 - 8 - last.bufferSize) % BlockSize);
+
+    quint8 trailer[8];
+    writeBigEndian(quint32(bits >> 32), trailer);
+    writeBigEndian(quint32(bits), trailer + 4);
+    last.addData(reinterpret_cast<const char *>(trailer), 8);
+
+    for(int i = 0; i < 5; i++)
+        writeBigEndian(last.state[i], reinterpret_cast<quint8 *>(digest) + i * 4);
+}
+
+QByteArray SNMPSha1::result() const
+{
+    QByteArray digest(DigestSize, Qt::Uninitialized);
+    result(digest.data());
+    return digest;
+}
+
+QByteArray SNMPSha1::hash(const QByteArray &data)
+{
+    SNMPSha1 sha;
+    sha.addData(data);
+    return sha.result();
+}
+
+void SNMPSha1::processBlock(const quint8 *block)
+{
+    // the message schedule is kept as a ring of its last 16 words
+    quint32 w[16];
+    for(int i = 0; i < 16; i++)
+        w[i] = readBigEndian(block + i * 4);
+
+    quint32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+    for(int i = 0; i < 80; i++) {
+        if(i >= 16)
+            w[i & 15] = rotateLeft(w[(i - 3) & 15] ^ w[(i - 8) & 15] ^ w[(i - 14) & 15] ^ w[i & 15], 1);
+
+        quint32 f, k;
+        if(i < 20) {
+            f = d ^ (b & (c ^ d));
+            k = 0x5A827999;
+        } else if(i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if(i < 60) {
+            f = (b & c) | (d & (b | c));
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        const quint32 temp = rotateLeft(a, 5) + f + e + k + w[i & 15];
+        e = d;
+        d = c;
+        c = rotateLeft(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+//----[ SNMPHmacSha1 ]-------------------------------------------------------------------
+
+SNMPHmacSha1::SNMPHmacSha1()
+{
+    setKey(QByteArray());
+}
+
+SNMPHmacSha1::SNMPHmacSha1(const QByteArray &key)
+{
+    setKey(key);
+}
+
+/**
+*   This method will key the HMAC (RFC 2104). The inner and outer hashes are started
+*   here with the padded key, so a message only hashes its own data.
+*/
+void SNMPHmacSha1::setKey(const QByteArray &key)
+{
+    char block[SNMPSha1::BlockSize] = {};
+    if(key.size() > SNMPSha1::BlockSize)
+        memcpy(block, SNMPSha1::hash(key).constData(), SNMPSha1::DigestSize);
+    else
+        memcpy(block, key.constData(), key.size());
+
+    char pad[SNMPSha1::BlockSize];
+    for(int i = 0; i < SNMPSha1::BlockSize; i++)
+        pad[i] = char(block[i] ^ 0x36);
+    innerKeyed.reset();
+    innerKeyed.addData(pad, SNMPSha1::BlockSize);
+
+    for(int i = 0; i < SNMPSha1::BlockSize; i++)
+        pad[i] = char(block[i] ^ 0x5C);
+    outerKeyed.reset();
+    outerKeyed.addData(pad, SNMPSha1::BlockSize);
+
+    inner = innerKeyed;
+}
+
+/**
+*   This method will start the MAC of a new message from the pre-keyed inner hash.
+*/
+void SNMPHmacSha1::start()
+{
+    inner = innerKeyed;
+}
+
+/**
+*   This method will write the MAC of the data added since start() to mac
+*   (SNMPSha1::DigestSize bytes).
+*/
+void SNMPHmacSha1::result(char *mac) const
+{
+    char innerDigest[SNMPSha1::DigestSize];
+    inner.result(innerDigest);
+
+    SNMPSha1 outer(outerKeyed);
+    outer.addData(innerDigest, SNMPSha1::DigestSize);
+    outer.result(mac);
+}
+
+//----[ SNMPAes128 ]---------------------------------------------------------------------
+
+// The S-box and the round tables which combine SubBytes, ShiftRows and MixColumns,
+// generated once on first use
+struct SNMPAesTables {
+    SNMPAesTables();
+
+    quint8 sbox[256];
+    quint32 te[4][256];
+};
+
+SNMPAesTables::SNMPAesTables()
+{
+    // walk the multiplicative group with generator 3, p = 3^n and q = 3^-n
+    quint8 p = 1, q = 1;
+    do {
+        p = quint8(p ^ (p << 1) ^ (p & 0x80 ? 0x1B : 0));
+
+        q ^= quint8(q << 1);
+        q ^= quint8(q << 2);
+        q ^= quint8(q << 4);
+        if(q & 0x80)
+            q ^= 0x09;
+
+        const quint8 affine = quint8(q ^ ((q << 1) | (q >> 7)) ^ ((q << 2) | (q >> 6))
+                                     ^ ((q << 3) | (q >> 5)) ^ ((q << 4) | (q >> 4)));
+        sbox[p] = quint8(affine ^ 0x63);
+    } while(p != 1);
+    sbox[0] = 0x63;
+
+    for(int i = 0; i < 256; i++) {
+        const quint32 s = sbox[i];
+        const quint32 s2 = quint8((s << 1) ^ (s & 0x80 ? 0x1B : 0));
+        const quint32 s3 = s2 ^ s;
+        const quint32 word = (s2 << 24) | (s << 16) | (s << 8) | s3;
+        te[0][i] = word;
+        te[1][i] = (word >> 8) | (word << 24);
+        te[2][i] = (word >> 16) | (word << 16);
+        te[3][i] = (word >> 24) | (word << 8);
+    }
+}
+
+static const SNMPAesTables &aesTables()
+{
+    static const SNMPAesTables tables;
+    return tables;
+}
+
+SNMPAes128::SNMPAes128()
+{
+    const char zeros[KeySize] = {};
+    setKey(zeros);
+}
+
+SNMPAes128::SNMPAes128(const char *key)
+{
+    setKey(key);
+}
+
+/**
+*   This method will expand a key of KeySize bytes into the round keys.
+*/
+void SNMPAes128::setKey(const char *key)
+{
+    const quint8 *sbox = aesTables().sbox;
+    quint32 roundConstant = 0x01;
+
+    for(int i = 0; i < 4; i++)
+        roundKeys[i] = readBigEndian(reinterpret_cast<const quint8 *>(key) + i * 4);
+
+    for(int i = 4; i < 44; i++) {
+        quint32 temp = roundKeys[i - 1];
+        if(i % 4 == 0) {
+            temp = (quint32(sbox[(temp >> 16) & 0xFF]) << 24) | (quint32(sbox[(temp >> 8) & 0xFF]) << 16)
+                 | (quint32(sbox[temp & 0xFF]) << 8) | sbox[temp >> 24];
+            temp ^= roundConstant << 24;
+            roundConstant = quint8((roundConstant << 1) ^ (roundConstant & 0x80 ? 0x1B : 0));
+        }
+        roundKeys[i] = roundKeys[i - 4] ^ temp;
+    }
+}
+
+void SNMPAes128::encryptBlock(const quint8 *input, quint8 *output) const
+{
+    const SNMPAesTables &tables = aesTables();
+    const quint32 *te0 = tables.te[0], *te1 = tables.te[1], *te2 = tables.te[2], *te3 = tables.te[3];
+    const quint32 *key = roundKeys;
+
+    quint32 s0 = readBigEndian(input) ^ key[0];
+    quint32 s1 = readBigEndian(input + 4) ^ key[1];
+    quint32 s2 = readBigEndian(input + 8) ^ key[2];
+    quint32 s3 = readBigEndian(input + 12) ^ key[3];
+
+    for(int round = 1; round < 10; round++) {
+        key += 4;
+        const quint32 t0 = te0[s0 >> 24] ^ te1[(s1 >> 16) & 0xFF] ^ te2[(s2 >> 8) & 0xFF] ^ te3[s3 & 0xFF] ^ key[0];
+        const quint32 t1 = te0[s1 >> 24] ^ te1[(s2 >> 16) & 0xFF] ^ te2[(s3 >> 8) & 0xFF] ^ te3[s0 & 0xFF] ^ key[1];
+        const quint32 t2 = te0[s2 >> 24] ^ te1[(s3 >> 16) & 0xFF] ^ te2[(s0 >> 8) & 0xFF] ^ te3[s1 & 0xFF] ^ key[2];
+        const quint32 t3 = te0[s3 >> 24] ^ te1[(s0 >> 16) & 0xFF] ^ te2[(s1 >> 8) & 0xFF] ^ te3[s2 & 0xFF] ^ key[3];
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    // the last round has no MixColumns
+    const quint8 *sbox = tables.sbox;
+    key += 4;
+    writeBigEndian(((quint32(sbox[s0 >> 24]) << 24) | (quint32(sbox[(s1 >> 16) & 0xFF]) << 16)
+                    | (quint32(sbox[(s2 >> 8) & 0xFF]) << 8) | sbox[s3 & 0xFF]) ^ key[0], output);
+    writeBigEndian(((quint32(sbox[s1 >> 24]) << 24) | (quint32(sbox[(s2 >> 16) & 0xFF]) << 16)
+                    | (quint32(sbox[(s3 >> 8) & 0xFF]) << 8) | sbox[s0 & 0xFF]) ^ key[1], output + 4);
+    writeBigEndian(((quint32(sbox[s2 >> 24]) << 24) | (quint32(sbox[(s3 >> 16) & 0xFF]) << 16)
+                    | (quint32(sbox[(s0 >> 8) & 0xFF]) << 8) | sbox[s1 & 0xFF]) ^ key[2], output + 8);
+    writeBigEndian(((quint32(sbox[s3 >> 24]) << 24) | (quint32(sbox[(s0 >> 16) & 0xFF]) << 16)
+                    | (quint32(sbox[(s1 >> 8) & 0xFF]) << 8) | sbox[s2 & 0xFF]) ^ key[3], output + 12);
+}
+
+/**
+*   This method will encrypt size bytes in CFB-128 mode (RFC 3826 section 3.1.3). The last
+*   block may be partial; input and output may be the same buffer.
+*/
+void SNMPAes128::encryptCfb(const char *iv, const char *input, char *output, int size) const
+{
+    quint8 feedback[BlockSize];
+    memcpy(feedback, iv, BlockSize);
+
+    for(int offset = 0; offset < size; offset += BlockSize) {
+        quint8 keyStream[BlockSize];
+        encryptBlock(feedback, keyStream);
+
+        const int bytes = qMin(int(BlockSize), size - offset);
+        for(int i = 0; i < bytes; i++) {
+            output[offset + i] = char(input[offset + i] ^ keyStream[i]);
+            feedback[i] = quint8(output[offset + i]);
+        }
+    }
+}
+
+void SNMPAes128::decryptCfb(const char *iv, const char *input, char *output, int size) const
+{
+    quint8 feedback[BlockSize];
+    memcpy(feedback, iv, BlockSize);
+
+    for(int offset = 0; offset < size; offset += BlockSize) {
+        quint8 keyStream[BlockSize];
+        encryptBlock(feedback, keyStream);
+
+        const int bytes = qMin(int(BlockSize), size - offset);
+        for(int i = 0; i < bytes; i++) {
+            feedback[i] = quint8(input[offset + i]);
+            output[offset + i] = char(feedback[i] ^ keyStream[i]);
+        }
+    }
+}
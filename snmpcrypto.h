@@ -0,0 +1,85 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The cryptographic primitives of the SNMPv3 User-based Security Model
+ * (RFC 3414, RFC 3826): SHA-1, HMAC-SHA-1 and AES-128 in CFB mode.
+ *
+ * They are implemented here rather than taken from QCryptographicHash and
+ * QMessageAuthenticationCode because USM needs what those do not offer: a
+ * hash state which can be copied, so that a HMAC is keyed once and every
+ * message starts from the pre-keyed inner and outer states, and AES, which
+ * Qt does not have. Only the encryption direction of AES is needed, CFB
+ * uses it to decrypt too.
+ *
+ */
+
+
+#ifndef SNMPCRYPTO_H
+#define SNMPCRYPTO_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+class SNMPSha1 {
+
+public:
+    enum { DigestSize = 20, BlockSize = 64 };
+
+    SNMPSha1();
+
+    void reset();
+    void addData(const char *data, int size);
+    void addData(const QByteArray &data) { addData(data.constData(), data.size()); }
+    void result(char *digest) const;
+    QByteArray result() const;
+
+    static QByteArray hash(const QByteArray &data);
+
+private:
+    void processBlock(const quint8 *block);
+
+    quint32 state[5];
+    quint64 length;
+    quint8 buffer[BlockSize];
+    int bufferSize;
+};
+
+class SNMPHmacSha1 {
+
+public:
+    SNMPHmacSha1();
+    explicit SNMPHmacSha1(const QByteArray &key);
+
+    void setKey(const QByteArray &key);
+
+    void start();
+    void addData(const char *data, int size) { inner.addData(data, size); }
+    void result(char *mac) const;
+
+private:
+    SNMPSha1 innerKeyed;
+    SNMPSha1 outerKeyed;
+    SNMPSha1 inner;
+};
+
+class SNMPAes128 {
+
+public:
+    enum { KeySize = 16, BlockSize = 16 };
+
+    SNMPAes128();
+    explicit SNMPAes128(const char *key);
+
+    void setKey(const char *key);
+    void encryptBlock(const quint8 *input, quint8 *output) const;
+
+    void encryptCfb(const char *iv, const char *input, char *output, int size) const;
+    void decryptCfb(const char *iv, const char *input, char *output, int size) const;
+
+private:
+    quint32 roundKeys[44];
+};
+
+#endif // SNMPCRYPTO_H
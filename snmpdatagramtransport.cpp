@@ -0,0 +1,474 @@
+#include "snmpdatagramtransport.h"
+#include <QAbstractSocket>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#ifdef Q_OS_LINUX
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+struct SNMPDatagramTransport::MessageHeaders {
+    std::vector<mmsghdr> send;
+    std::vector<iovec> sendVectors;
+    std::vector<mmsghdr> receive;
+    std::vector<iovec> receiveVectors;
+};
+#else
+struct SNMPDatagramTransport::MessageHeaders {
+};
+#endif
+
+// Expected size of a request, the send buffer starts with room for a full ring of them
+static const int typicalDatagramSize = 1472;
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   At most ringSize datagrams are queued before they are sent, and received per
+*   system call. Received datagrams longer than receiveBufferSize are dropped.
+*/
+SNMPDatagramTransport::SNMPDatagramTransport(int ringSize, int receiveBufferSize, QObject *parent)
+        : QObject(parent)
+{
+    this->ringSize = qMax(1, ringSize);
+    this->receiveBufferSize = qMax(1, receiveBufferSize);
+    this->socketDescriptor = -1;
+    this->family = 0;
+    this->notifier = NULL;
+    this->headers = new MessageHeaders;
+
+    sendBuffer.reserve(this->ringSize * typicalDatagramSize);
+    sendOffsets.resize(this->ringSize + 1);
+    sendAddresses.resize(this->ringSize);
+    queuedDatagrams = 0;
+
+    receiveBuffer.resize(this->ringSize * this->receiveBufferSize);
+    receivedSizes.resize(this->ringSize);
+    receivedAddresses.resize(this->ringSize);
+    receivedDatagrams = 0;
+    ringFilled = false;
+
+#ifdef Q_OS_LINUX
+    headers->send.resize(this->ringSize);
+    headers->sendVectors.resize(this->ringSize);
+    headers->receive.resize(this->ringSize);
+    headers->receiveVectors.resize(this->ringSize);
+
+    // the receive headers always point at the same ring of buffers
+    for(int i = 0; i < this->ringSize; i++)
+    {
+        headers->receiveVectors[i].iov_base = receiveBuffer.data() + i * this->receiveBufferSize;
+        headers->receiveVectors[i].iov_len = this->receiveBufferSize;
+    }
+#endif
+
+    resetStatistics();
+}
+
+SNMPDatagramTransport::~SNMPDatagramTransport()
+{
+    close();
+    delete headers;
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+bool SNMPDatagramTransport::isSupported()
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+*   This method will open a non-blocking UDP socket bound to the given port (0 for
+*   any), accepting IPv6 and IPv4 peers where the system allows it.
+*   Returns false if batching is not supported or the socket cannot be bound.
+*/
+bool SNMPDatagramTransport::bind(quint16 port)
+{
+#ifdef Q_OS_LINUX
+    close();
+
+    int descriptor = ::socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(descriptor >= 0)
+    {
+        const int off = 0;
+        sockaddr_in6 local;
+        memset(&local, 0, sizeof(local));
+        local.sin6_family = AF_INET6;
+        local.sin6_addr = in6addr_any;
+        local.sin6_port = htons(port);
+
+        if(::setsockopt(descriptor, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off)) != 0
+           || ::bind(descriptor, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+        family = AF_INET6;
+    } else
+    {
+        // no IPv6 on this host
+        descriptor = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(descriptor < 0)
+            return false;
+
+        sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+
+        if(::bind(descriptor, reinterpret_cast<sockaddr *>(&local), sizeof(local)) != 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+        family = AF_INET;
+    }
+
+    socketDescriptor = descriptor;
+    notifier = new QSocketNotifier(socketDescriptor, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &SNMPDatagramTransport::readyRead);
+    return true;
+#else
+    Q_UNUSED(port);
+    return false;
+#endif
+}
+
+/**
+*   Returns the port the socket is bound to, the one chosen by the system if bind()
+*   was given 0; 0 if the socket is closed.
+*/
+quint16 SNMPDatagramTransport::localPort() const
+{
+#ifdef Q_OS_LINUX
+    sockaddr_in6 local;
+    socklen_t length = sizeof(local);
+
+    if(!isOpen() || ::getsockname(socketDescriptor, reinterpret_cast<sockaddr *>(&local), &length) != 0)
+        return 0;
+
+    // sin_port and sin6_port are at the same offset
+    return ntohs(local.sin6_port);
+#else
+    return 0;
+#endif
+}
+
+/**
+*   This method will ask the kernel to buffer up to the given number of bytes of
+*   datagrams not yet received, to ride out bursts; the kernel may cap it.
+*   Returns false if the socket is closed or the size was refused.
+*/
+bool SNMPDatagramTransport::setSocketReceiveBufferSize(int bytes)
+{
+#ifdef Q_OS_LINUX
+    return isOpen() && ::setsockopt(socketDescriptor, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) == 0;
+#else
+    Q_UNUSED(bytes);
+    return false;
+#endif
+}
+
+/**
+*   This method will drop the queued datagrams and close the socket.
+*/
+void SNMPDatagramTransport::close()
+{
+    delete notifier;
+    notifier = NULL;
+
+#ifdef Q_OS_LINUX
+    if(socketDescriptor >= 0)
+        ::close(socketDescriptor);
+#endif
+    socketDescriptor = -1;
+    sendBuffer.resize(0);
+    queuedDatagrams = 0;
+    receivedDatagrams = 0;
+    ringFilled = false;
+}
+
+/**
+*   This method will copy the datagram into the send queue, flushing the queue
+*   first if it is full. Nothing is sent before the next flush().
+*   Returns false if the socket is closed or the address cannot be used with it.
+*/
+bool SNMPDatagramTransport::queueDatagram(const char *data, int size, const QHostAddress &address, quint16 port)
+{
+    if(!isOpen())
+        return false;
+
+    if(queuedDatagrams == ringSize)
+        flush();
+
+    if(!toSocketAddress(address, port, sendAddresses[queuedDatagrams]))
+        return false;
+
+    sendOffsets[queuedDatagrams] = sendBuffer.size();
+    sendBuffer.append(data, size);
+    queuedDatagrams++;
+    return true;
+}
+
+/**
+*   This method will send every queued datagram, with as few sendmmsg calls as the
+*   kernel allows. A datagram the kernel refuses is dropped, the pending request
+*   it belongs to is sent again on its next retry.
+*   Returns the number of datagrams sent.
+*/
+int SNMPDatagramTransport::flush()
+{
+#ifdef Q_OS_LINUX
+    if(queuedDatagrams == 0)
+        return 0;
+
+    sendOffsets[queuedDatagrams] = sendBuffer.size();
+    for(int i = 0; i < queuedDatagrams; i++)
+    {
+        iovec &vector = headers->sendVectors[i];
+        vector.iov_base = sendBuffer.data() + sendOffsets[i];
+        vector.iov_len = sendOffsets[i + 1] - sendOffsets[i];
+
+        mmsghdr &header = headers->send[i];
+        memset(&header, 0, sizeof(header));
+        header.msg_hdr.msg_name = sendAddresses[i].storage;
+        header.msg_hdr.msg_namelen = sendAddresses[i].length;
+        header.msg_hdr.msg_iov = &vector;
+        header.msg_hdr.msg_iovlen = 1;
+    }
+
+    int sent = 0;
+    int position = 0;
+    while(position < queuedDatagrams)
+    {
+        const int result = ::sendmmsg(socketDescriptor, &headers->send[position],
+                                      queuedDatagrams - position, 0);
+        sendCalls++;
+
+        if(result > 0)
+        {
+            sent += result;
+            position += result;
+        } else if(result < 0 && errno == EINTR)
+        {
+            continue;
+        } else if(result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            // the socket buffer is full, the rest is left to the retries
+            datagramsDropped += queuedDatagrams - position;
+            break;
+        } else
+        {
+            // the datagram at position failed on its own (unreachable, too large...)
+            datagramsDropped++;
+            position++;
+        }
+    }
+
+    datagramsSent += sent;
+    sendBuffer.resize(0);
+    queuedDatagrams = 0;
+    return sent;
+#else
+    return 0;
+#endif
+}
+
+/**
+*   This method will read the datagrams waiting on the socket into the receive ring,
+*   up to its size, with a single recvmmsg call. The previous ones are overwritten.
+*   Returns the number of datagrams received, use datagramData() and datagramSize()
+*   to read them. If the ring was filled, hasPendingDatagrams() is true afterwards.
+*/
+int SNMPDatagramTransport::receive()
+{
+    receivedDatagrams = 0;
+    ringFilled = false;
+
+#ifdef Q_OS_LINUX
+    if(!isOpen())
+        return 0;
+
+    for(int i = 0; i < ringSize; i++)
+    {
+        mmsghdr &header = headers->receive[i];
+        memset(&header, 0, sizeof(header));
+        header.msg_hdr.msg_iov = &headers->receiveVectors[i];
+        header.msg_hdr.msg_iovlen = 1;
+        header.msg_hdr.msg_name = receivedAddresses[i].storage;
+        header.msg_hdr.msg_namelen = sizeof(receivedAddresses[i].storage);
+    }
+
+    int result;
+    do
+    {
+        result = ::recvmmsg(socketDescriptor, headers->receive.data(), ringSize, MSG_DONTWAIT, NULL);
+    } while(result < 0 && errno == EINTR);
+
+    receiveCalls++;
+    if(result <= 0)
+        return 0;
+
+    for(int i = 0; i < result; i++)
+    {
+        const mmsghdr &header = headers->receive[i];
+        if(header.msg_hdr.msg_flags & MSG_TRUNC)
+        {
+            datagramsDropped++;
+            continue;
+        }
+
+        receivedSizes[receivedDatagrams] = int(header.msg_len);
+        receivedAddresses[i].length = int(header.msg_hdr.msg_namelen);
+        // close the gap left by a dropped datagram
+        if(receivedDatagrams != i)
+        {
+            memcpy(receiveBuffer.data() + receivedDatagrams * receiveBufferSize,
+                   receiveBuffer.constData() + i * receiveBufferSize, header.msg_len);
+            receivedAddresses[receivedDatagrams] = receivedAddresses[i];
+        }
+        receivedDatagrams++;
+    }
+
+    datagramsReceived += receivedDatagrams;
+    ringFilled = result == ringSize;
+    return receivedDatagrams;
+#else
+    return 0;
+#endif
+}
+
+const char *SNMPDatagramTransport::datagramData(int index) const
+{
+    return receiveBuffer.constData() + index * receiveBufferSize;
+}
+
+int SNMPDatagramTransport::datagramSize(int index) const
+{
+    return receivedSizes[index];
+}
+
+/**
+*   This method will give the address and port a received datagram came from; IPv4
+*   peers of a dual-stack socket are given as IPv4 addresses.
+*/
+bool SNMPDatagramTransport::datagramSender(int index, QHostAddress *address, quint16 *port) const
+{
+#ifdef Q_OS_LINUX
+    if(index < 0 || index >= receivedDatagrams)
+        return false;
+
+    const Address &socketAddress = receivedAddresses[index];
+    const sockaddr *name = reinterpret_cast<const sockaddr *>(socketAddress.storage);
+
+    if(name->sa_family == AF_INET && socketAddress.length >= int(sizeof(sockaddr_in)))
+    {
+        const sockaddr_in *ipv4 = reinterpret_cast<const sockaddr_in *>(name);
+        address->setAddress(quint32(ntohl(ipv4->sin_addr.s_addr)));
+        *port = ntohs(ipv4->sin_port);
+        return true;
+    }
+
+    if(name->sa_family == AF_INET6 && socketAddress.length >= int(sizeof(sockaddr_in6)))
+    {
+        const sockaddr_in6 *ipv6 = reinterpret_cast<const sockaddr_in6 *>(name);
+        const quint8 *bytes = ipv6->sin6_addr.s6_addr;
+        static const quint8 mappedPrefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff };
+
+        if(memcmp(bytes, mappedPrefix, sizeof(mappedPrefix)) == 0)
+            address->setAddress((quint32(bytes[12]) << 24) | (quint32(bytes[13]) << 16)
+                                | (quint32(bytes[14]) << 8) | quint32(bytes[15]));
+        else
+            address->setAddress(bytes);
+        *port = ntohs(ipv6->sin6_port);
+        return true;
+    }
+#else
+    Q_UNUSED(index);
+    Q_UNUSED(address);
+    Q_UNUSED(port);
+#endif
+    return false;
+}
+
+double SNMPDatagramTransport::datagramsPerSendCall() const
+{
+    return sendCalls ? double(datagramsSent) / double(sendCalls) : 0.0;
+}
+
+double SNMPDatagramTransport::datagramsPerReceiveCall() const
+{
+    return receiveCalls ? double(datagramsReceived) / double(receiveCalls) : 0.0;
+}
+
+void SNMPDatagramTransport::resetStatistics()
+{
+    sendCalls = 0;
+    datagramsSent = 0;
+    receiveCalls = 0;
+    datagramsReceived = 0;
+    datagramsDropped = 0;
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+/**
+*   This method will convert the address to the socket address family; IPv4
+*   addresses are mapped into IPv6 on a dual-stack socket.
+*   Returns false for an IPv6 address on an IPv4-only socket.
+*/
+bool SNMPDatagramTransport::toSocketAddress(const QHostAddress &address, quint16 port,
+                                            Address &socketAddress) const
+{
+#ifdef Q_OS_LINUX
+    memset(socketAddress.storage, 0, sizeof(socketAddress.storage));
+    const bool isIPv4 = address.protocol() == QAbstractSocket::IPv4Protocol;
+
+    if(family == AF_INET)
+    {
+        if(!isIPv4)
+            return false;
+
+        sockaddr_in *ipv4 = reinterpret_cast<sockaddr_in *>(socketAddress.storage);
+        ipv4->sin_family = AF_INET;
+        ipv4->sin_port = htons(port);
+        ipv4->sin_addr.s_addr = htonl(address.toIPv4Address());
+        socketAddress.length = sizeof(sockaddr_in);
+        return true;
+    }
+
+    sockaddr_in6 *ipv6 = reinterpret_cast<sockaddr_in6 *>(socketAddress.storage);
+    ipv6->sin6_family = AF_INET6;
+    ipv6->sin6_port = htons(port);
+    if(isIPv4)
+    {
+        const quint32 ipv4Address = address.toIPv4Address();
+        ipv6->sin6_addr.s6_addr[10] = 0xff;
+        ipv6->sin6_addr.s6_addr[11] = 0xff;
+        for(int i = 0; i < 4; i++)
+            ipv6->sin6_addr.s6_addr[12 + i] = quint8(ipv4Address >> (24 - 8 * i));
+    } else
+    {
+        const Q_IPV6ADDR ipv6Address = address.toIPv6Address();
+        memcpy(ipv6->sin6_addr.s6_addr, &ipv6Address, 16);
+    }
+    socketAddress.length = sizeof(sockaddr_in6);
+    return true;
+#else
+    Q_UNUSED(address);
+    Q_UNUSED(port);
+    Q_UNUSED(socketAddress);
+    return false;
+#endif
+}
@@ -0,0 +1,106 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class represents a UDP socket which moves datagrams in batches,
+ * for sessions sending and receiving tens of thousands of PDUs per second.
+ *
+ * Outgoing datagrams are queued and handed to the kernel with one sendmmsg
+ * call per flush. Incoming datagrams are drained with recvmmsg into a ring
+ * of receive buffers allocated once, and read in place from there. The
+ * counters tell how many datagrams each of these system calls carried.
+ *
+ * Batching needs the Linux sendmmsg/recvmmsg calls; on other systems bind()
+ * fails and SNMPSession keeps using its QUdpSocket.
+ *
+ */
+
+
+#ifndef SNMPDATAGRAMTRANSPORT_H
+#define SNMPDATAGRAMTRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHostAddress>
+#include <QSocketNotifier>
+#include <QVector>
+#include <QtGlobal>
+
+class SNMPDatagramTransport : public QObject {
+
+    Q_OBJECT
+
+public:
+    explicit SNMPDatagramTransport(int ringSize = 32, int receiveBufferSize = 8192,
+                                   QObject *parent = 0);
+    ~SNMPDatagramTransport();
+
+    static bool isSupported();
+
+    bool bind(quint16 port);
+    void close();
+    bool isOpen() const { return socketDescriptor >= 0; }
+    quint16 localPort() const;
+    bool setSocketReceiveBufferSize(int bytes);
+
+// sending
+    bool queueDatagram(const char *data, int size, const QHostAddress &address, quint16 port);
+    int queuedDatagramCount() const { return queuedDatagrams; }
+    int flush();
+
+// receiving
+    int receive();
+    bool hasPendingDatagrams() const { return ringFilled; }
+    const char *datagramData(int index) const;
+    int datagramSize(int index) const;
+    bool datagramSender(int index, QHostAddress *address, quint16 *port) const;
+
+// statistics
+    quint64 getSendCalls() const { return sendCalls; }
+    quint64 getDatagramsSent() const { return datagramsSent; }
+    quint64 getReceiveCalls() const { return receiveCalls; }
+    quint64 getDatagramsReceived() const { return datagramsReceived; }
+    quint64 getDatagramsDropped() const { return datagramsDropped; }
+    double datagramsPerSendCall() const;
+    double datagramsPerReceiveCall() const;
+    void resetStatistics();
+
+signals:
+    void readyRead();
+
+private:
+    struct Address {
+        quint32 storage[7];     // large enough for a sockaddr_in6
+        int length;
+    };
+    struct MessageHeaders;
+
+    bool toSocketAddress(const QHostAddress &address, quint16 port, Address &socketAddress) const;
+
+    int ringSize;
+    int receiveBufferSize;
+    int socketDescriptor;
+    int family;
+    QSocketNotifier *notifier;
+    MessageHeaders *headers;
+
+    QByteArray sendBuffer;
+    QVector<int> sendOffsets;
+    QVector<Address> sendAddresses;
+    int queuedDatagrams;
+
+    QByteArray receiveBuffer;
+    QVector<int> receivedSizes;
+    QVector<Address> receivedAddresses;
+    int receivedDatagrams;
+    bool ringFilled;
+
+    quint64 sendCalls;
+    quint64 datagramsSent;
+    quint64 receiveCalls;
+    quint64 datagramsReceived;
+    quint64 datagramsDropped;
+};
+
+#endif // SNMPDATAGRAMTRANSPORT_H
@@ -0,0 +1,321 @@
+#include "snmpengine.h"
+#include "snmpmanager.h"
+#include <QMetaObject>
+
+//----[ SNMPEngineWorker ]---------------------------------------------------------------
+
+SNMPEngineWorker::SNMPEngineWorker(int workerIndex, int workerCount, int queueCapacity)
+        : QObject(), commands(queueCapacity), completions(queueCapacity),
+          wakePending(0), completionsSignalled(0), backlogged(0)
+{
+    this->workerIndex = workerIndex;
+    this->workerCount = workerCount;
+    this->manager = NULL;
+}
+
+/**
+*   Runs first in the worker thread: creates the manager there, so that its socket
+*   and timers belong to this thread, and registers the targets of the partition.
+*   Manager target i is engine target i * workerCount + workerIndex.
+*/
+void SNMPEngineWorker::initialize()
+{
+    manager = new SNMPManager(1, this);
+    manager->setMetrics(metrics);
+
+    for(int i = 0; i < targets.size(); i++)
+        manager->addTarget(targets[i].address, targets[i].port, targets[i].communityString,
+                           targets[i].version);
+
+    connect(manager, &SNMPManager::responseReceived, this,
+            [this](quint32 requestId, int target, int errorStatus, const QStringList &values) {
+        SNMPCompletion completion;
+        completion.requestId = requests.take(requestId);
+        completion.target = target * workerCount + workerIndex;
+        completion.errorStatus = errorStatus;
+        completion.values = values;
+        complete(completion);
+    });
+    connect(manager, &SNMPManager::requestFailed, this,
+            [this](quint32 requestId, int target, int errorCode) {
+        SNMPCompletion completion;
+        completion.requestId = requests.take(requestId);
+        completion.target = target * workerCount + workerIndex;
+        completion.errorStatus = errorCode;
+        complete(completion);
+    });
+
+    processCommands();
+}
+
+/**
+*   Sends every request queued by the engine. A request which cannot be encoded
+*   completes at once with error 5.
+*/
+void SNMPEngineWorker::processCommands()
+{
+    // cleared before draining: a command pushed after this point wakes us again
+    wakePending.fetchAndStoreOrdered(0);
+
+    if(!manager)
+        return;
+
+    flushBacklog();
+
+    Command command;
+    while(commands.pop(command))
+    {
+        const quint32 requestId = manager->get(command.target / workerCount, command.oids);
+        if(requestId)
+        {
+            requests.insert(requestId, command.requestId);
+            continue;
+        }
+
+        SNMPCompletion completion;
+        completion.requestId = command.requestId;
+        completion.target = command.target;
+        completion.errorStatus = 5;
+        complete(completion);
+    }
+}
+
+/**
+*   Moves the completions which did not fit in the queue earlier into it.
+*/
+void SNMPEngineWorker::flushBacklog()
+{
+    int flushed = 0;
+    while(flushed < backlog.size() && completions.push(backlog[flushed]))
+        flushed++;
+    backlog.remove(0, flushed);
+
+    if(!backlog.isEmpty())
+        backlogged.storeRelease(1);
+    if(flushed && completionsSignalled.testAndSetOrdered(0, 1))
+        emit completionsQueued();
+}
+
+/**
+*   Runs last in the worker thread: the manager goes before the thread stops.
+*/
+void SNMPEngineWorker::shutdown()
+{
+    delete manager;
+    manager = NULL;
+    requests.clear();
+}
+
+/**
+*   This method will hand a completion to the consumer, keeping it aside while the
+*   queue is full. The consumer is signalled once until it drains the queue.
+*/
+void SNMPEngineWorker::complete(const SNMPCompletion &completion)
+{
+    if(!backlog.isEmpty() || !completions.push(completion))
+    {
+        backlog.append(completion);
+        backlogged.storeRelease(1);
+
+        // the consumer may have drained the queue before it could see the flag
+        flushBacklog();
+        return;
+    }
+
+    if(completionsSignalled.testAndSetOrdered(0, 1))
+        emit completionsQueued();
+}
+
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   A workerCount of 0 starts one worker per core. Each worker queues at most
+*   queueCapacity requests and as many completions.
+*/
+SNMPEngine::SNMPEngine(int workerCount, int queueCapacity, QObject *parent)
+        : QObject(parent)
+{
+    this->workerCount = workerCount > 0 ? workerCount : qMax(1, QThread::idealThreadCount());
+    this->queueCapacity = qMax(1, queueCapacity);
+    this->nextRequestId = 1;
+}
+
+SNMPEngine::~SNMPEngine()
+{
+    stop();
+}
+
+
+//----[ Targets ]------------------------------------------------------------------------
+
+/**
+*   This method will register an agent. Targets are only added while the engine is
+*   stopped; they are given to the workers by start().
+*   Returns the target, or -1 if the engine is running.
+*/
+int SNMPEngine::addTarget(const QHostAddress &address, quint16 port,
+                          const QString &communityStringParameter, int version)
+{
+    if(isRunning())
+        return -1;
+
+    SNMPEngineWorker::Target target;
+    target.address = address;
+    target.port = port;
+    target.communityString = communityStringParameter;
+    target.version = version;
+    targets.append(target);
+
+    return targets.size() - 1;
+}
+
+int SNMPEngine::targetCount() const
+{
+    return targets.size();
+}
+
+
+//----[ Get/Set methods ]----------------------------------------------------------------
+
+QSharedPointer<SNMPMetrics> SNMPEngine::getMetrics() const
+{
+    return metrics;
+}
+
+/**
+*   Sets the metrics all the workers record into, each thread into its own shard;
+*   see SNMPMetrics::snapshot. Takes effect with the next start().
+*/
+void SNMPEngine::setMetrics(const QSharedPointer<SNMPMetrics> &metrics)
+{
+    this->metrics = metrics;
+}
+
+
+//----[ Workers ]------------------------------------------------------------------------
+
+/**
+*   This method will start the worker threads, each with its partition of the targets.
+*   Returns false if the engine is already running.
+*/
+bool SNMPEngine::start()
+{
+    if(isRunning())
+        return false;
+
+    for(int i = 0; i < workerCount; i++)
+    {
+        SNMPEngineWorker *worker = new SNMPEngineWorker(i, workerCount, queueCapacity);
+        for(int target = i; target < targets.size(); target += workerCount)
+            worker->targets.append(targets[target]);
+        worker->metrics = metrics;
+
+        QThread *thread = new QThread(this);
+        worker->moveToThread(thread);
+        connect(thread, &QThread::started, worker, &SNMPEngineWorker::initialize);
+        connect(worker, &SNMPEngineWorker::completionsQueued, this, &SNMPEngine::completionsReady);
+
+        workers.append(worker);
+        threads.append(thread);
+        thread->start();
+    }
+
+    return true;
+}
+
+/**
+*   This method will stop the worker threads. Outstanding requests are dropped and
+*   completions not taken yet are lost.
+*/
+void SNMPEngine::stop()
+{
+    for(int i = 0; i < workers.size(); i++)
+    {
+        QMetaObject::invokeMethod(workers[i], "shutdown", Qt::BlockingQueuedConnection);
+        threads[i]->quit();
+        threads[i]->wait();
+        delete workers[i];
+        delete threads[i];
+    }
+
+    workers.clear();
+    threads.clear();
+}
+
+bool SNMPEngine::isRunning() const
+{
+    return !workers.isEmpty();
+}
+
+int SNMPEngine::getWorkerCount() const
+{
+    return workerCount;
+}
+
+
+//----[ SNMP message methods ]-----------------------------------------------------------
+
+quint32 SNMPEngine::get(int target, const SNMPOid &oid)
+{
+    return get(target, QVector<SNMPOid>() << oid);
+}
+
+/**
+*   This method will queue a get-request for the worker of the target. The result
+*   comes back as a completion with the returned ID: the values, or the error
+*   status as for SNMPManager (6 on timeout).
+*   Returns the request ID, or 0 if the engine is not running, the target is
+*   unknown or the worker's queue is full.
+*/
+quint32 SNMPEngine::get(int target, const QVector<SNMPOid> &oids)
+{
+    if(!isRunning() || target < 0 || target >= targets.size())
+        return 0;
+
+    SNMPEngineWorker::Command command;
+    command.requestId = nextRequestId;
+    command.target = target;
+    command.oids = oids;
+
+    SNMPEngineWorker *worker = workers[target % workerCount];
+    if(!worker->commands.push(command))
+        return 0;
+
+    nextRequestId = nextRequestId + 1 ? nextRequestId + 1 : 1;
+
+    if(worker->wakePending.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(worker, "processCommands", Qt::QueuedConnection);
+
+    return command.requestId;
+}
+
+/**
+*   This method will move the completions of all workers to completions, at most
+*   maxCount of them (all for -1). Call it on completionsReady until it returns 0.
+*   Returns the number of completions taken.
+*/
+int SNMPEngine::takeCompletions(QVector<SNMPCompletion> &completions, int maxCount)
+{
+    int taken = 0;
+    SNMPCompletion completion;
+
+    for(int i = 0; i < workers.size(); i++)
+    {
+        SNMPEngineWorker *worker = workers[i];
+
+        // cleared before draining: a completion pushed after this point signals again
+        worker->completionsSignalled.fetchAndStoreOrdered(0);
+
+        while((maxCount < 0 || taken < maxCount) && worker->completions.pop(completion))
+        {
+            completions.append(completion);
+            taken++;
+        }
+
+        if(worker->backlogged.testAndSetOrdered(1, 0))
+            QMetaObject::invokeMethod(worker, "flushBacklog", Qt::QueuedConnection);
+    }
+
+    return taken;
+}
@@ -0,0 +1,140 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The classes spread the polling of many agents over several threads.
+ *
+ * SNMPEngine starts one SNMPEngineWorker per thread. Each worker owns an
+ * SNMPManager, with its own socket on its own source port, its own encoder
+ * and receive buffer, and a fixed partition of the targets: target n belongs
+ * to worker n % workerCount, so responses come back to the thread that sent
+ * the request and the threads share no state.
+ *
+ * The thread using the engine hands requests to a worker, and takes the
+ * completions back, through a pair of single-producer/single-consumer queues
+ * per worker; a worker is only woken when its command queue was idle, and
+ * completionsReady is only emitted when the consumer has caught up.
+ *
+ */
+
+
+#ifndef SNMPENGINE_H
+#define SNMPENGINE_H
+
+#include <QObject>
+#include <QAtomicInteger>
+#include <QHash>
+#include <QHostAddress>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QVector>
+#include "snmpber.h"
+#include "snmpmetrics.h"
+#include "snmpoid.h"
+#include "snmpspscqueue.h"
+
+class SNMPManager;
+
+struct SNMPCompletion {
+    SNMPCompletion() : requestId(0), target(-1), errorStatus(0) {}
+
+    quint32 requestId;
+    int target;
+    int errorStatus;
+    QStringList values;
+};
+
+class SNMPEngineWorker : public QObject {
+
+    Q_OBJECT
+
+public:
+    struct Target {
+        QHostAddress address;
+        quint16 port;
+        QString communityString;
+        int version;
+    };
+
+    struct Command {
+        Command() : requestId(0), target(-1) {}
+
+        quint32 requestId;
+        int target;
+        QVector<SNMPOid> oids;
+    };
+
+    SNMPEngineWorker(int workerIndex, int workerCount, int queueCapacity);
+
+    QVector<Target> targets;
+    QSharedPointer<SNMPMetrics> metrics;
+    SNMPSpscQueue<Command> commands;
+    SNMPSpscQueue<SNMPCompletion> completions;
+    QAtomicInteger<int> wakePending;
+    QAtomicInteger<int> completionsSignalled;
+    QAtomicInteger<int> backlogged;
+
+signals:
+    void completionsQueued();
+
+public slots:
+    void initialize();
+    void processCommands();
+    void flushBacklog();
+    void shutdown();
+
+private:
+    void complete(const SNMPCompletion &completion);
+
+    int workerIndex;
+    int workerCount;
+    SNMPManager *manager;
+    QHash<quint32, quint32> requests;
+    QVector<SNMPCompletion> backlog;
+};
+
+class SNMPEngine : public QObject {
+
+    Q_OBJECT
+
+public:
+    explicit SNMPEngine(int workerCount = 0, int queueCapacity = 4096, QObject *parent = 0);
+    ~SNMPEngine();
+
+// targets, added before start()
+    int addTarget(const QHostAddress &address, quint16 port,
+                  const QString &communityStringParameter, int version = SNMPBer::Version1);
+    int targetCount() const;
+
+// get/set methods
+    QSharedPointer<SNMPMetrics> getMetrics() const;
+    void setMetrics(const QSharedPointer<SNMPMetrics> &metrics);
+
+// workers
+    bool start();
+    void stop();
+    bool isRunning() const;
+    int getWorkerCount() const;
+
+// SNMP message methods (non-blocking), from the thread which owns the engine
+    quint32 get(int target, const SNMPOid &oid);
+    quint32 get(int target, const QVector<SNMPOid> &oids);
+    int takeCompletions(QVector<SNMPCompletion> &completions, int maxCount = -1);
+
+signals:
+    void completionsReady();
+
+private:
+    int workerCount;
+    int queueCapacity;
+    QVector<SNMPEngineWorker::Target> targets;
+    QSharedPointer<SNMPMetrics> metrics;
+    QVector<QThread *> threads;
+    QVector<SNMPEngineWorker *> workers;
+    quint32 nextRequestId;
+};
+
+#endif // SNMPENGINE_H
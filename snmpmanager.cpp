@@ -0,0 +1,436 @@
+#include "snmpmanager.h"
+#include "snmpbufferpool.h"
+#include <QMetaMethod>
+
+// Resolution of the retry deadlines, in milliseconds: the tick of the timer wheel
+static const int retryTimerInterval = 10;
+
+// Largest UDP payload, the receive buffer is allocated once with this size
+static const int maxDatagramSize = 65507;
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   The constructor will bind socketCount UDP sockets to ports chosen by the system.
+*/
+SNMPManager::SNMPManager(int socketCount, QObject *parent)
+        : QObject(parent), retryTimers(retryTimerInterval)
+{
+    for(int i = 0; i < qMax(1, socketCount); i++)
+    {
+        QUdpSocket *socket = new QUdpSocket(this);
+        socket->bind();
+        connect(socket, &QUdpSocket::readyRead, this, [this, i]() { readPendingDatagrams(i); });
+        sockets.append(socket);
+    }
+
+    activeTargets = 0;
+    retryPolicy = QSharedPointer<SNMPRetryPolicy>(new SNMPAdaptiveRetryPolicy);
+    receiveBuffer.resize(maxDatagramSize);
+    clock.start();
+
+    retryTimer.setInterval(retryTimerInterval);
+    connect(&retryTimer, &QTimer::timeout, this, &SNMPManager::checkRequestTimeouts);
+}
+
+SNMPManager::~SNMPManager()
+{
+}
+
+
+//----[ Get/Set methods ]----------------------------------------------------------------
+
+int SNMPManager::getSocketCount() const
+{
+    return sockets.size();
+}
+
+quint16 SNMPManager::getSocketPort(int socket) const
+{
+    return sockets[socket]->localPort();
+}
+
+QSharedPointer<SNMPRetryPolicy> SNMPManager::getRetryPolicy() const
+{
+    return retryPolicy;
+}
+
+/**
+*   Sets the policy for the requests sent from now on, a SNMPAdaptiveRetryPolicy by
+*   default, which keeps its round-trip time estimates per target address.
+*   A policy shared with sessions or managers in other threads must be thread-safe,
+*   as the library's own policies are. A null policy restores the default one.
+*/
+void SNMPManager::setRetryPolicy(const QSharedPointer<SNMPRetryPolicy> &retryPolicy)
+{
+    if(retryPolicy.isNull())
+        this->retryPolicy = QSharedPointer<SNMPRetryPolicy>(new SNMPAdaptiveRetryPolicy);
+    else
+        this->retryPolicy = retryPolicy;
+}
+
+QSharedPointer<SNMPMetrics> SNMPManager::getMetrics() const
+{
+    return metrics;
+}
+
+/**
+*   Records what the manager sends and receives into metrics, with the round-trip
+*   times per target address. The metrics may be shared with other managers and
+*   sessions in any thread. Nothing is recorded by default, or after setting a null
+*   pointer.
+*/
+void SNMPManager::setMetrics(const QSharedPointer<SNMPMetrics> &metrics)
+{
+    this->metrics = metrics;
+
+    for(int i = 0; i < targets.size(); i++)
+    {
+        if(targets[i].used)
+            targets[i].metricsAgent = metrics ? metrics->agentIndex(targets[i].address) : -1;
+    }
+}
+
+
+//----[ Targets ]------------------------------------------------------------------------
+
+/**
+*   This method will register an agent. The slots of removed targets are reused.
+*   Returns the target, to be passed to the request methods.
+*/
+int SNMPManager::addTarget(const QHostAddress &address, quint16 port,
+                           const QString &communityStringParameter, int version)
+{
+    int target;
+    if(!freeTargets.isEmpty())
+    {
+        target = freeTargets.last();
+        freeTargets.removeLast();
+    } else
+    {
+        target = targets.size();
+        targets.append(Target());
+    }
+
+    Target &entry = targets[target];
+    entry.address = address;
+    entry.communityString = communityStringParameter.toLatin1();
+    entry.metricsAgent = metrics ? metrics->agentIndex(address) : -1;
+    entry.port = port;
+    entry.version = qint8(version);
+    entry.used = true;
+    activeTargets++;
+
+    return target;
+}
+
+/**
+*   This method will remove a target and drop its outstanding requests without
+*   reporting them. Returns false if there is no such target.
+*/
+bool SNMPManager::removeTarget(int target)
+{
+    if(!isTarget(target))
+        return false;
+
+    QVector<quint32> requests;
+    pendingRequests.forEach([&](quint32 requestId, PendingRequest &request) {
+        if(request.target == target)
+            requests.append(requestId);
+    });
+    for(int i = 0; i < requests.size(); i++)
+        takePendingRequest(requests[i], NULL);
+
+    targets[target] = Target();
+    targets[target].used = false;
+    freeTargets.append(target);
+    activeTargets--;
+    return true;
+}
+
+int SNMPManager::targetCount() const
+{
+    return activeTargets;
+}
+
+QHostAddress SNMPManager::getTargetAddress(int target) const
+{
+    return isTarget(target) ? targets[target].address : QHostAddress();
+}
+
+quint16 SNMPManager::getTargetPort(int target) const
+{
+    return isTarget(target) ? targets[target].port : 0;
+}
+
+
+//----[ SNMP message methods ]-----------------------------------------------------------
+
+quint32 SNMPManager::get(int target, const SNMPOid &oid)
+{
+    if(!isTarget(target) || !oid.isValid())
+        return 0;
+
+    encoder.reset();
+    writeGetVarbind(oid);
+    return sendRequest(target, SNMPBer::GetRequest);
+}
+
+/**
+*   This method will send a get-request for all the OIDs to the target, in one message.
+*   The values come with responseReceived, in the order of the OIDs; a request which
+*   is not answered after all its attempts is reported by requestFailed with code 6.
+*   Returns the request ID, or 0 for an unknown target, no OIDs or an invalid OID.
+*/
+quint32 SNMPManager::get(int target, const QVector<SNMPOid> &oids)
+{
+    if(!isTarget(target) || oids.isEmpty())
+        return 0;
+
+    encoder.reset();
+    for(int i = oids.size() - 1; i >= 0; i--)
+    {
+        if(!oids[i].isValid())
+            return 0;
+        writeGetVarbind(oids[i]);
+    }
+
+    return sendRequest(target, SNMPBer::GetRequest);
+}
+
+/**
+*   This method will forget about an outstanding request. A response arriving later
+*   for it is discarded and no signal is emitted.
+*   Returns false if the request was not pending.
+*/
+bool SNMPManager::cancelRequest(quint32 requestId)
+{
+    return takePendingRequest(requestId, NULL);
+}
+
+int SNMPManager::pendingRequestCount() const
+{
+    return pendingRequests.size();
+}
+
+
+//----[ Private slots ]-------------------------------------------------------------
+
+/**
+*   Called by the retry timer on every tick of the timer wheel. Resends every request
+*   whose deadline has passed, and reports the ones which used all their attempts
+*   as timed out.
+*/
+void SNMPManager::checkRequestTimeouts()
+{
+    const qint64 now = clock.elapsed();
+
+    retryTimers.expire(now, [&](quint32 requestId) {
+        PendingRequest *request = pendingRequests.find(requestId);
+        if(!request)
+            return;
+
+        const Target &target = targets[request->target];
+        request->timer = -1;
+        request->attempt++;
+        if(request->attempt < retryPolicy->maxAttempts(target.address))
+        {
+            if(metrics)
+                metrics->count(SNMPMetrics::Retries);
+            request->sentAtNanoseconds = clock.nsecsElapsed();
+            transmit(requestId, request->datagram.constData(), request->datagram.size());
+            request->sentAt = now;
+            request->timer = retryTimers.schedule(now + retryPolicy->timeout(target.address, request->attempt),
+                                                  requestId);
+            return;
+        }
+
+        PendingRequest expired;
+        takePendingRequest(requestId, &expired);
+        retryPolicy->requestTimedOut(target.address);
+        if(metrics)
+            metrics->count(SNMPMetrics::Timeouts);
+        emit requestFailed(requestId, expired.target, 6);
+    });
+
+    if(retryTimers.isEmpty())
+        retryTimer.stop();
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+bool SNMPManager::isTarget(int target) const
+{
+    return target >= 0 && target < targets.size() && targets[target].used;
+}
+
+/**
+*   This method will write the varbind of a get-request for the OID in front of what
+*   the encoder holds.
+*/
+void SNMPManager::writeGetVarbind(const SNMPOid &oid)
+{
+// include Varbind field
+    const int varbindEnd = encoder.mark();
+    encoder.writeNull();
+    encoder.writeOctetString(oid.encoded(), SNMPBer::ObjectIdentifier);
+    encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+}
+
+/**
+*   This method will complete the message whose varbinds have already been written
+*   into the encoder, send it to the target and register it as pending.
+*   Returns the request ID.
+*/
+quint32 SNMPManager::sendRequest(int target, int pduType)
+{
+    const Target &entry = targets[target];
+    const qint64 now = clock.elapsed();
+
+    PendingRequest pending;
+    pending.target = target;
+    const quint32 requestId = pendingRequests.insert(pending);
+    PendingRequest *request = pendingRequests.find(requestId);
+
+    encoder.writeMessageHeader(entry.version, entry.communityString, pduType, requestId);
+    request->datagram = SNMPBufferPool::acquire(encoder.data(), encoder.size());
+    // stamped with or without metrics, which may be set while the request is pending
+    request->sentAt = now;
+    request->sentAtNanoseconds = clock.nsecsElapsed();
+    request->timer = retryTimers.schedule(now + retryPolicy->timeout(entry.address, 0), requestId);
+    transmit(requestId, encoder.data(), encoder.size());
+
+    if(!retryTimer.isActive())
+        retryTimer.start();
+
+    return requestId;
+}
+
+/**
+*   This method will send a datagram of the request to its target, on the socket
+*   picked by the request ID.
+*/
+void SNMPManager::transmit(quint32 requestId, const char *data, int size)
+{
+    const PendingRequest *request = pendingRequests.find(requestId);
+    const Target &target = targets[request->target];
+
+    if(metrics)
+        metrics->recordTransmission(size);
+    sockets[int(requestId % quint32(sockets.size()))]->writeDatagram(data, size, target.address, target.port);
+}
+
+/**
+*   This method will remove an outstanding request and stop its timer. Its datagram
+*   goes back to the buffer pool, so the request copied out has none.
+*   Returns false if the request was not pending.
+*/
+bool SNMPManager::takePendingRequest(quint32 requestId, PendingRequest *request)
+{
+    PendingRequest *pending = pendingRequests.find(requestId);
+    if(!pending)
+        return false;
+
+    retryTimers.cancel(pending->timer, requestId);
+    SNMPBufferPool::release(pending->datagram);
+    return pendingRequests.take(requestId, request);
+}
+
+/**
+*   Called on readyRead of a socket. Reads every datagram waiting on it.
+*/
+void SNMPManager::readPendingDatagrams(int socket)
+{
+    QUdpSocket *udpSocket = sockets[socket];
+    QHostAddress sender;
+    quint16 senderPort;
+
+    while(udpSocket->hasPendingDatagrams())
+    {
+        const qint64 size = udpSocket->readDatagram(receiveBuffer.data(), receiveBuffer.size(),
+                                                    &sender, &senderPort);
+        if(size >= 0)
+            handleDatagram(receiveBuffer.constData(), int(size), sender, senderPort);
+    }
+}
+
+/**
+*   This method will decode a response, match it to its request and report its values.
+*   The error status is the one of the response, or else the first error found in
+*   its varbinds: 2 for a SNMPv2 exception, 5 for a malformed value.
+*/
+void SNMPManager::handleDatagram(const char *data, int size, const QHostAddress &sender, quint16 senderPort)
+{
+    SNMPMessageView response;
+
+    if(!response.decode(data, size))
+    {
+        if(metrics)
+            metrics->recordReception(size, SNMPMetrics::DecodeErrors);
+        return;
+    }
+
+    const PendingRequest *pending = pendingRequests.find(response.requestId);
+    if(response.pduType != SNMPBer::GetResponse || !pending)
+    {
+        if(metrics)
+            metrics->recordReception(size, SNMPMetrics::StrayResponses);
+        return;
+    }
+
+    // a response from anywhere else is not an answer, even with a matching ID
+    const Target &target = targets[pending->target];
+    if(senderPort != target.port || !sender.isEqual(target.address, QHostAddress::TolerantConversion))
+    {
+        if(metrics)
+            metrics->recordReception(size, SNMPMetrics::StrayResponses);
+        return;
+    }
+
+    PendingRequest request;
+    takePendingRequest(response.requestId, &request);
+    retryPolicy->responseReceived(target.address, request.attempt, clock.elapsed() - request.sentAt);
+    if(metrics)
+        metrics->recordResponse(target.metricsAgent, size, (clock.nsecsElapsed() - request.sentAtNanoseconds) / 1000);
+
+    static const QMetaMethod textSignal = QMetaMethod::fromSignal(&SNMPManager::responseReceived);
+    const bool textConnected = isSignalConnected(textSignal);
+    int errorStatus = response.errorStatus;
+    int textStatus = response.errorStatus;
+    QStringList values;
+    SNMPVarbindView varbind;
+
+    // the vector keeps its capacity from one response to the next
+    receivedValues.resize(0);
+
+    while(response.nextVarbind(varbind))
+    {
+        SNMPValue value;
+        int varbindStatus = 0;
+
+        if(!value.decode(varbind.value))
+            varbindStatus = 5;
+        else if(value.isException())
+            varbindStatus = 2;
+
+        if(errorStatus == 0 && varbindStatus != 0)
+            errorStatus = varbindStatus;
+        receivedValues.append(value);
+
+        if(textConnected)
+        {
+            QString text;
+            if(varbindStatus == 0)
+                varbindStatus = SNMPBer::valueToString(varbind.value, text);
+            if(textStatus == 0 && varbindStatus != 0)
+                textStatus = varbindStatus;
+            values.append(text);
+        }
+    }
+
+    emit responseValuesReceived(response.requestId, request.target, errorStatus, receivedValues);
+
+    if(textConnected)
+        emit responseReceived(response.requestId, request.target, textStatus, values);
+}
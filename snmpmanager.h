@@ -0,0 +1,126 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class polls any number of SNMP agents over a few shared UDP sockets,
+ * instead of one SNMPSession (and one socket) per agent.
+ *
+ * Agents are registered as targets (address, port, community, version) and
+ * referred to by their index in a contiguous array of small records. All
+ * requests share one request ID table; the socket a request goes out on is
+ * picked from its ID, so responses spread evenly over the sockets and any
+ * socket can match a response to its request. A response is only accepted
+ * from the address and port its request was sent to.
+ *
+ */
+
+
+#ifndef SNMPMANAGER_H
+#define SNMPMANAGER_H
+
+#include <QObject>
+#include <QHostAddress>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QUdpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QVector>
+#include "snmpber.h"
+#include "snmpmetrics.h"
+#include "snmpoid.h"
+#include "snmprequesttable.h"
+#include "snmpretrypolicy.h"
+#include "snmptimerwheel.h"
+#include "snmpvalue.h"
+
+class SNMPManager : public QObject {
+
+    Q_OBJECT
+
+public:
+    explicit SNMPManager(int socketCount = 1, QObject *parent = 0);
+    ~SNMPManager();
+
+// get/set methods
+    int getSocketCount() const;
+    quint16 getSocketPort(int socket) const;
+    QSharedPointer<SNMPRetryPolicy> getRetryPolicy() const;
+    void setRetryPolicy(const QSharedPointer<SNMPRetryPolicy> &retryPolicy);
+    QSharedPointer<SNMPMetrics> getMetrics() const;
+    void setMetrics(const QSharedPointer<SNMPMetrics> &metrics);
+
+// targets
+    int addTarget(const QHostAddress &address, quint16 port,
+                  const QString &communityStringParameter, int version = SNMPBer::Version1);
+    bool removeTarget(int target);
+    int targetCount() const;
+    QHostAddress getTargetAddress(int target) const;
+    quint16 getTargetPort(int target) const;
+
+// SNMP message methods (non-blocking)
+    quint32 get(int target, const SNMPOid &oid);
+    quint32 get(int target, const QVector<SNMPOid> &oids);
+    bool cancelRequest(quint32 requestId);
+    int pendingRequestCount() const;
+
+signals:
+    void responseReceived(quint32 requestId, int target, int errorStatus, const QStringList &values);
+    void requestFailed(quint32 requestId, int target, int errorCode);
+
+    // the same values, typed; connect with a direct connection, see SNMPValue
+    void responseValuesReceived(quint32 requestId, int target, int errorStatus,
+                                const QVector<SNMPValue> &values);
+
+private slots:
+    void checkRequestTimeouts();
+
+private:
+    struct Target {
+        QHostAddress address;
+        QByteArray communityString;
+        int metricsAgent;
+        quint16 port;
+        qint8 version;
+        bool used;
+    };
+
+    struct PendingRequest {
+        PendingRequest() : target(-1), attempt(0), sentAt(0), sentAtNanoseconds(0), timer(-1) {}
+
+        QByteArray datagram;
+        int target;
+        int attempt;
+        qint64 sentAt;
+        qint64 sentAtNanoseconds;
+        int timer;
+    };
+
+    bool isTarget(int target) const;
+    void writeGetVarbind(const SNMPOid &oid);
+    quint32 sendRequest(int target, int pduType);
+    void transmit(quint32 requestId, const char *data, int size);
+    bool takePendingRequest(quint32 requestId, PendingRequest *request);
+    void readPendingDatagrams(int socket);
+    void handleDatagram(const char *data, int size, const QHostAddress &sender, quint16 senderPort);
+
+    QVector<QUdpSocket *> sockets;
+    QVector<Target> targets;
+    QVector<int> freeTargets;
+    int activeTargets;
+
+    SNMPRequestTable<PendingRequest> pendingRequests;
+    SNMPBerWriter encoder;
+    QByteArray receiveBuffer;
+    QVector<SNMPValue> receivedValues;
+    QSharedPointer<SNMPRetryPolicy> retryPolicy;
+    QSharedPointer<SNMPMetrics> metrics;
+    SNMPTimerWheel retryTimers;
+    QTimer retryTimer;
+    QElapsedTimer clock;
+};
+
+#endif // SNMPMANAGER_H
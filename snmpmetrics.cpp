@@ -0,0 +1,378 @@
+#include "snmpmetrics.h"
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <algorithm>
+
+// Names and help texts of the counters, in the order of SNMPMetrics::Counter
+static const char *const counterNames[] = {
+    "requests_sent", "retries", "timeouts", "responses_received",
+    "decode_errors", "stray_responses", "bytes_sent", "bytes_received"
+};
+static const char *const counterHelp[] = {
+    "Request datagrams sent, retransmissions included.",
+    "Requests retransmitted after a timeout.",
+    "Requests which used all their attempts without a response.",
+    "Responses matched to a pending request.",
+    "Received datagrams which are not a SNMP message.",
+    "Received messages for no pending request, or from the wrong sender.",
+    "Bytes of request datagrams sent.",
+    "Bytes of datagrams received."
+};
+
+// Upper bounds of the exported round-trip time buckets, in microseconds
+static const qint64 exportedBounds[] = {
+    500, 1000, 2500, 5000, 10000, 25000, 50000, 100000,
+    250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+static const char *const exportedBoundLabels[] = {
+    "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1",
+    "0.25", "0.5", "1", "2.5", "5", "10"
+};
+static const int exportedBoundCount = sizeof(exportedBounds) / sizeof(exportedBounds[0]);
+
+//----[ SNMPRttHistogram ]---------------------------------------------------------------
+
+SNMPRttHistogram::SNMPRttHistogram()
+        : counts(BucketCount, 0)
+{
+    this->total = 0;
+    this->totalTime = 0;
+    this->maximumTime = 0;
+}
+
+/**
+*   Adds count round-trip times of the given length. Negative times count as 0, times
+*   over the range go into the last bucket.
+*/
+void SNMPRttHistogram::record(qint64 microseconds, quint64 count)
+{
+    microseconds = qMax(microseconds, qint64(0));
+
+    counts[bucketIndex(microseconds)] += count;
+    total += count;
+    totalTime += quint64(microseconds) * count;
+    maximumTime = qMax(maximumTime, microseconds);
+}
+
+void SNMPRttHistogram::merge(const SNMPRttHistogram &other)
+{
+    for(int i = 0; i < BucketCount; i++)
+        counts[i] += other.counts[i];
+    total += other.total;
+    totalTime += other.totalTime;
+    maximumTime = qMax(maximumTime, other.maximumTime);
+}
+
+/**
+*   Returns the mean round-trip time in microseconds, 0 without any.
+*/
+double SNMPRttHistogram::mean() const
+{
+    return total ? double(totalTime) / double(total) : 0.0;
+}
+
+/**
+*   This method will return the round-trip time, in microseconds, which percent
+*   percent of the recorded ones do not exceed (50 for the median). As in HDR
+*   histograms, it is the highest time of the bucket the percentile falls in, so
+*   it may exceed the true one by up to 1/16, but never the maximum.
+*   Returns 0 without any recorded time.
+*/
+qint64 SNMPRttHistogram::percentile(double percent) const
+{
+    if(total == 0)
+        return 0;
+
+    const double wanted = qBound(0.0, percent, 100.0) / 100.0 * double(total);
+    quint64 rank = quint64(wanted);
+    if(double(rank) < wanted)
+        rank++;
+    rank = qBound(quint64(1), rank, total);
+
+    quint64 seen = 0;
+    for(int i = 0; i < BucketCount; i++)
+    {
+        seen += counts[i];
+        if(seen >= rank)
+            return qMin(bucketUpperBound(i) - 1, maximumTime);
+    }
+
+    return maximumTime;
+}
+
+quint64 SNMPRttHistogram::bucket(int index) const
+{
+    return counts[index];
+}
+
+/**
+*   This method will return the bucket of a round-trip time: below 16 us one bucket
+*   per microsecond, then 16 buckets for each power of two, indexed by the
+*   position of the highest bit and the 4 bits after it.
+*/
+int SNMPRttHistogram::bucketIndex(qint64 microseconds)
+{
+    if(microseconds < SubBuckets)
+        return microseconds < 0 ? 0 : int(microseconds);
+
+    const quint64 value = qMin(quint64(microseconds), quint64((Q_UINT64_C(1) << MaxValueBits) - 1));
+    const int highestBit = 63 - int(qCountLeadingZeroBits(value));
+    const int shift = highestBit - SubBucketBits;
+
+    return (shift + 1) * SubBuckets + int((value >> shift) & (SubBuckets - 1));
+}
+
+qint64 SNMPRttHistogram::bucketLowerBound(int index)
+{
+    if(index < SubBuckets)
+        return index;
+
+    const int shift = index / SubBuckets - 1;
+    return qint64(SubBuckets + index % SubBuckets) << shift;
+}
+
+/**
+*   Returns the first time after the bucket: the bucket holds the times from its
+*   lower bound up to, but excluding, this one.
+*/
+qint64 SNMPRttHistogram::bucketUpperBound(int index)
+{
+    if(index < SubBuckets)
+        return index + 1;
+
+    return bucketLowerBound(index) + (qint64(1) << (index / SubBuckets - 1));
+}
+
+
+//----[ SNMPMetrics ]--------------------------------------------------------------------
+
+SNMPMetrics::SNMPMetrics()
+{
+}
+
+SNMPMetrics::~SNMPMetrics()
+{
+    for(int i = 0; i < shards.size(); i++)
+    {
+        qDeleteAll(shards[i]->histograms);
+        delete shards[i];
+    }
+}
+
+/**
+*   This method will return the small number under which the round-trip times of
+*   an agent are recorded, the same for every thread. Sessions and managers look it
+*   up once, when the agent is set.
+*/
+int SNMPMetrics::agentIndex(const QHostAddress &agent)
+{
+    QMutexLocker locker(&mutex);
+
+    QHash<QHostAddress, int>::const_iterator it = agentIndexes.constFind(agent);
+    if(it != agentIndexes.constEnd())
+        return it.value();
+
+    agentIndexes.insert(agent, agents.size());
+    agents.append(agent);
+    return agents.size() - 1;
+}
+
+void SNMPMetrics::count(Counter counter, quint64 amount)
+{
+    add(localShard()->counters[counter], amount);
+}
+
+/**
+*   Counts a request datagram of the given size, first transmission or not.
+*/
+void SNMPMetrics::recordTransmission(int bytes)
+{
+    Shard *shard = localShard();
+
+    add(shard->counters[RequestsSent], 1);
+    add(shard->counters[BytesSent], quint64(bytes));
+}
+
+/**
+*   Counts a received datagram which answered nothing, as outcome: DecodeErrors or
+*   StrayResponses.
+*/
+void SNMPMetrics::recordReception(int bytes, Counter outcome)
+{
+    Shard *shard = localShard();
+
+    add(shard->counters[outcome], 1);
+    add(shard->counters[BytesReceived], quint64(bytes));
+}
+
+/**
+*   Counts a response matched to its request, which came roundTripTime
+*   microseconds after the last transmission, from the agent of the given index.
+*/
+void SNMPMetrics::recordResponse(int agent, int bytes, qint64 roundTripTime)
+{
+    Shard *shard = localShard();
+
+    add(shard->counters[ResponsesReceived], 1);
+    add(shard->counters[BytesReceived], quint64(bytes));
+
+    if(agent < 0)
+        return;
+
+    Histogram *times = histogram(shard, agent);
+    roundTripTime = qMax(roundTripTime, qint64(0));
+
+    QAtomicInteger<quint32> &bucket = times->counts[SNMPRttHistogram::bucketIndex(roundTripTime)];
+    bucket.storeRelease(bucket.loadAcquire() + 1);
+    add(times->total, 1);
+    add(times->totalTime, quint64(roundTripTime));
+    if(roundTripTime > times->maximumTime.loadAcquire())
+        times->maximumTime.storeRelease(roundTripTime);
+}
+
+/**
+*   This method will add up the shards of all the threads. It only blocks recording
+*   in a thread which meets a new agent at the same time.
+*/
+SNMPMetricsSnapshot SNMPMetrics::snapshot() const
+{
+    SNMPMetricsSnapshot snapshot;
+    QMutexLocker locker(&mutex);
+
+    for(int i = 0; i < shards.size(); i++)
+    {
+        const Shard *shard = shards[i];
+
+        for(int counter = 0; counter < CounterCount; counter++)
+            snapshot.counters[counter] += shard->counters[counter].loadAcquire();
+
+        for(int agent = 0; agent < shard->histograms.size(); agent++)
+        {
+            const Histogram *times = shard->histograms.at(agent);
+            if(!times || times->total.loadAcquire() == 0)
+                continue;
+
+            SNMPRttHistogram &merged = snapshot.roundTripTimes[agents[agent]];
+            for(int bucket = 0; bucket < SNMPRttHistogram::BucketCount; bucket++)
+                merged.counts[bucket] += times->counts[bucket].loadAcquire();
+            merged.total += times->total.loadAcquire();
+            merged.totalTime += times->totalTime.loadAcquire();
+            merged.maximumTime = qMax(merged.maximumTime, times->maximumTime.loadAcquire());
+        }
+    }
+
+    return snapshot;
+}
+
+const char *SNMPMetrics::counterName(Counter counter)
+{
+    return counterNames[counter];
+}
+
+/**
+*   Returns the shard of the calling thread, created on its first call.
+*/
+SNMPMetrics::Shard *SNMPMetrics::localShard()
+{
+    ShardReference &reference = localShards.localData();
+    if(reference.shard)
+        return reference.shard;
+
+    reference.shard = new Shard;
+    QMutexLocker locker(&mutex);
+    shards.append(reference.shard);
+    return reference.shard;
+}
+
+/**
+*   Returns the histogram of an agent in a shard of the calling thread. Only that
+*   thread changes the list, so it reads it without the lock; it takes the lock to
+*   add a histogram, as snapshot() may be reading the list.
+*/
+SNMPMetrics::Histogram *SNMPMetrics::histogram(Shard *shard, int agent)
+{
+    if(agent < shard->histograms.size() && shard->histograms.at(agent))
+        return shard->histograms.at(agent);
+
+    QMutexLocker locker(&mutex);
+    if(agent >= shard->histograms.size())
+        shard->histograms.resize(agent + 1);
+    shard->histograms[agent] = new Histogram;
+    return shard->histograms[agent];
+}
+
+/**
+*   A counter only has one writer, its shard's thread: a load and a store are
+*   enough, without a read-modify-write. On x86 they cost no more than on a plain
+*   integer.
+*/
+void SNMPMetrics::add(QAtomicInteger<quint64> &value, quint64 amount)
+{
+    value.storeRelease(value.loadAcquire() + amount);
+}
+
+
+//----[ SNMPMetricsSnapshot ]------------------------------------------------------------
+
+SNMPMetricsSnapshot::SNMPMetricsSnapshot()
+{
+    for(int i = 0; i < SNMPMetrics::CounterCount; i++)
+        counters[i] = 0;
+}
+
+/**
+*   This method will write the snapshot in the Prometheus text exposition format:
+*   one counter per SNMPMetrics::Counter, named prefix_<name>_total, and a
+*   prefix_round_trip_time_seconds histogram per agent. The exported buckets are
+*   coarser than the recorded ones; a recorded bucket is counted under the first
+*   exported bound it lies completely below.
+*/
+QByteArray SNMPMetricsSnapshot::toPrometheusText(const QByteArray &prefix) const
+{
+    QByteArray text;
+
+    for(int i = 0; i < SNMPMetrics::CounterCount; i++)
+    {
+        const QByteArray name = prefix + '_' + counterNames[i] + "_total";
+        text += "# HELP " + name + ' ' + counterHelp[i] + '\n';
+        text += "# TYPE " + name + " counter\n";
+        text += name + ' ' + QByteArray::number(counters[i]) + '\n';
+    }
+
+    if(roundTripTimes.isEmpty())
+        return text;
+
+    const QByteArray name = prefix + "_round_trip_time_seconds";
+    text += "# HELP " + name + " Time from the last transmission of a request to its response.\n";
+    text += "# TYPE " + name + " histogram\n";
+
+    // the agents in a stable order, from one scrape to the next
+    QList<QHostAddress> agents = roundTripTimes.keys();
+    std::sort(agents.begin(), agents.end(), [](const QHostAddress &a, const QHostAddress &b) {
+        return a.toString() < b.toString();
+    });
+
+    for(int i = 0; i < agents.size(); i++)
+    {
+        const SNMPRttHistogram times = roundTripTimes.value(agents[i]);
+        const QByteArray agent = "agent=\"" + agents[i].toString().toLatin1() + '"';
+        quint64 cumulative = 0;
+        int bucket = 0;
+
+        for(int bound = 0; bound < exportedBoundCount; bound++)
+        {
+            while(bucket < SNMPRttHistogram::BucketCount
+                  && SNMPRttHistogram::bucketUpperBound(bucket) <= exportedBounds[bound] + 1)
+                cumulative += times.bucket(bucket++);
+
+            text += name + "_bucket{" + agent + ",le=\"" + exportedBoundLabels[bound] + "\"} "
+                    + QByteArray::number(cumulative) + '\n';
+        }
+
+        text += name + "_bucket{" + agent + ",le=\"+Inf\"} " + QByteArray::number(times.count()) + '\n';
+        text += name + "_sum{" + agent + "} " + QByteArray::number(double(times.sum()) / 1e6, 'f', 6) + '\n';
+        text += name + "_count{" + agent + "} " + QByteArray::number(times.count()) + '\n';
+    }
+
+    return text;
+}
@@ -0,0 +1,94 @@
+#include "snmpoid.h"
+#include "snmpber.h"
+#include <QCache>
+
+// Number of dotted OIDs each thread keeps encoded in SNMPOid::intern
+static const int internCacheSize = 4096;
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+SNMPOid::SNMPOid()
+{
+}
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+SNMPOid::SNMPOid(const SNMPOidLiteral &literal)
+        : bytes(literal.data(), literal.length())
+{
+}
+#endif
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will parse and encode a dotted OID ("1.3.6.1.2.1.1.1.0", with or
+*   without a leading dot). Returns an invalid OID if the text is malformed.
+*/
+SNMPOid SNMPOid::fromString(const QString &dottedOid)
+{
+    SNMPBerWriter writer(64);
+    SNMPBerElement element;
+
+    if(!writer.writeObjectIdentifier(dottedOid.toLatin1())
+       || !SNMPBerReader(writer.data(), writer.size()).next(element))
+        return SNMPOid();
+
+    return fromEncoded(element.value, element.length);
+}
+
+/**
+*   Wraps the content bytes of an encoded OID, as found in a received varbind.
+*/
+SNMPOid SNMPOid::fromEncoded(const QByteArray &encoded)
+{
+    SNMPOid oid;
+    oid.bytes = encoded;
+    return oid;
+}
+
+SNMPOid SNMPOid::fromEncoded(const char *encoded, int size)
+{
+    return fromEncoded(QByteArray(encoded, size));
+}
+
+/**
+*   Same as SNMPOid::fromString, but remembers the result: the OIDs used most
+*   recently by the calling thread are returned without being parsed again.
+*/
+SNMPOid SNMPOid::intern(const QString &dottedOid)
+{
+    static thread_local QCache<QString, SNMPOid> cache(internCacheSize);
+
+    if(SNMPOid *cached = cache.object(dottedOid))
+        return *cached;
+
+    const SNMPOid oid = fromString(dottedOid);
+    if(oid.isValid())
+        cache.insert(dottedOid, new SNMPOid(oid));
+
+    return oid;
+}
+
+QString SNMPOid::toString() const
+{
+    return SNMPBer::objectIdentifierToString(bytes.constData(), bytes.size());
+}
+
+/**
+*   Returns true if other lies strictly below this OID.
+*/
+bool SNMPOid::isParentOf(const SNMPOid &other) const
+{
+    return SNMPBer::isInSubtree(other.bytes.constData(), other.bytes.size(),
+                                bytes.constData(), bytes.size());
+}
+
+/**
+*   Compares the OIDs arc by arc, in SNMP (lexicographic) order.
+*/
+int SNMPOid::compare(const SNMPOid &other) const
+{
+    return SNMPBer::compareObjectIdentifiers(bytes.constData(), bytes.size(),
+                                             other.bytes.constData(), other.bytes.size());
+}
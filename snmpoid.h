@@ -0,0 +1,201 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class represents an already encoded SNMP object identifier.
+ *
+ * SNMPOid keeps the BER content bytes of the OID (without tag and length),
+ * so sending it is a plain copy. Dotted strings are parsed once:
+ * SNMPOid::intern() keeps the most recently used ones in a per-thread LRU
+ * cache, and fixed OIDs can be encoded by the compiler with the _oid literal:
+ *
+ *     static const SNMPOid sysUpTime = "1.3.6.1.2.1.1.3.0"_oid;
+ *
+ * The literal is always evaluated by the compiler, consteval from C++20 and
+ * a literal operator template with GCC and Clang before, so a malformed one
+ * such as "1..3"_oid does not compile.
+ *
+ */
+
+
+#ifndef SNMPOID_H
+#define SNMPOID_H
+
+#include <QByteArray>
+#include <QString>
+#include <QHash>
+#include <QtGlobal>
+#include <cstddef>
+
+class SNMPOidLiteral;
+
+class SNMPOid {
+
+public:
+    SNMPOid();
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+    SNMPOid(const SNMPOidLiteral &literal);
+#endif
+
+    static SNMPOid fromString(const QString &dottedOid);
+    static SNMPOid fromEncoded(const QByteArray &encoded);
+    static SNMPOid fromEncoded(const char *encoded, int size);
+    static SNMPOid intern(const QString &dottedOid);
+
+    bool isValid() const { return !bytes.isEmpty(); }
+    const QByteArray &encoded() const { return bytes; }
+    QString toString() const;
+
+    bool isParentOf(const SNMPOid &other) const;
+    int compare(const SNMPOid &other) const;
+
+    bool operator==(const SNMPOid &other) const { return bytes == other.bytes; }
+    bool operator!=(const SNMPOid &other) const { return bytes != other.bytes; }
+    bool operator<(const SNMPOid &other) const { return compare(other) < 0; }
+
+private:
+    QByteArray bytes;
+};
+
+inline uint qHash(const SNMPOid &oid, uint seed = 0)
+{
+    return qHash(oid.encoded(), seed);
+}
+
+#if defined(__cpp_constexpr) && __cpp_constexpr >= 201304
+
+/**
+*   Called for a malformed OID literal. It is not constexpr, so reaching it while the
+*   compiler evaluates a literal is a compile error. Outside of constant evaluation the
+*   literal gives an invalid (empty) OID.
+*/
+inline void malformedOidLiteral()
+{
+}
+
+/**
+*   An OID encoded at compile time, see the _oid literal.
+*/
+class SNMPOidLiteral {
+
+public:
+    static const int MaxSize = 128;
+
+    constexpr SNMPOidLiteral(const char *text, std::size_t length)
+        : bytes(), size(0)
+    {
+        if(!parse(text, length))
+        {
+            size = 0;
+            malformedOidLiteral();
+        }
+    }
+
+    constexpr const char *data() const { return bytes; }
+    constexpr int length() const { return size; }
+
+private:
+    constexpr bool parse(const char *text, std::size_t length)
+    {
+        if(length > 0 && text[0] == '.')
+        {
+            text++;
+            length--;
+        }
+
+        quint32 arcs[2] = { 0, 0 };
+        std::size_t position = 0;
+        int arc = 0;
+
+        for(; position <= length; arc++)
+        {
+            // parse the next decimal arc up to a dot or the end of the text
+            quint64 value = 0;
+            const std::size_t arcStart = position;
+            while(position < length && text[position] != '.')
+            {
+                if(text[position] < '0' || text[position] > '9')
+                    return false;
+                value = value * 10 + quint64(text[position++] - '0');
+                if(value > 0xFFFFFFFFu)
+                    return false;
+            }
+            if(position == arcStart)
+                return false;
+            position++;
+
+            // the first two arcs are combined into a single subidentifier
+            if(arc < 2)
+            {
+                arcs[arc] = quint32(value);
+                if(arc == 0)
+                    continue;
+                if(arcs[0] > 2 || (arcs[0] < 2 && arcs[1] > 39) || arcs[1] > 0xFFFFFFFFu - 80)
+                    return false;
+                value = arcs[0] * 40 + arcs[1];
+            }
+
+            int groups = 1;
+            while(groups < 5 && (value >> (7 * groups)) != 0)
+                groups++;
+            if(size + groups > MaxSize)
+                return false;
+
+            for(int group = groups - 1; group >= 0; group--)
+                bytes[size++] = char(((value >> (7 * group)) & 0x7f) | (group ? 0x80 : 0));
+        }
+
+        return arc >= 2;
+    }
+
+    char bytes[MaxSize];
+    int size;
+};
+
+#if defined(__cpp_consteval) && __cpp_consteval >= 201811
+
+consteval SNMPOidLiteral operator"" _oid(const char *text, std::size_t length)
+{
+    return SNMPOidLiteral(text, length);
+}
+
+#elif defined(__GNUC__)
+
+// The literal operator template is a GNU extension before C++20: the text of the literal
+// becomes template arguments, and its encoding a constant the compiler has to evaluate
+template <typename Char, Char... text>
+struct SNMPOidLiteralConstant {
+    static constexpr char characters[sizeof...(text) + 1] = { text..., 0 };
+    static constexpr SNMPOidLiteral value = SNMPOidLiteral(characters, sizeof...(text));
+};
+
+#if __cplusplus < 201703L
+template <typename Char, Char... text>
+constexpr char SNMPOidLiteralConstant<Char, text...>::characters[];
+template <typename Char, Char... text>
+constexpr SNMPOidLiteral SNMPOidLiteralConstant<Char, text...>::value;
+#endif
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+template <typename Char, Char... text>
+constexpr SNMPOidLiteral operator"" _oid()
+{
+    return SNMPOidLiteralConstant<Char, text...>::value;
+}
+#pragma GCC diagnostic pop
+
+#else
+
+// other compilers check the literal only where it is used in a constant expression
+constexpr SNMPOidLiteral operator"" _oid(const char *text, std::size_t length)
+{
+    return SNMPOidLiteral(text, length);
+}
+
+#endif
+
+#endif
+
+#endif // SNMPOID_H
@@ -0,0 +1,164 @@
+#include "snmppdulimits.h"
+
+// Limits a new agent starts from: a few varbinds, the historical GetBulk repetitions,
+// and messages of an Ethernet frame minus the IP and UDP headers
+static const int initialVarbinds = 8;
+static const int initialRepetitions = 10;
+static const int defaultMessageSize = 1472;
+
+// Default ceilings for the varbinds and the repetitions
+static const int defaultVarbindCeiling = 64;
+static const int defaultRepetitionCeiling = 100;
+
+// Smallest message every SNMP agent must accept (RFC 3417), the floor of the size limit
+static const int minMessageSize = 484;
+
+// Growth of the size limit per answered request which came this close to it
+static const int messageSizeStep = 64;
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+SNMPPduLimits::SNMPPduLimits()
+{
+    this->varbindCeiling = defaultVarbindCeiling;
+    this->repetitionCeiling = defaultRepetitionCeiling;
+    this->messageSizeCeiling = defaultMessageSize;
+    reset();
+}
+
+
+//----[ Get/Set methods ]----------------------------------------------------------------
+
+int SNMPPduLimits::getMaxVarbinds() const
+{
+    return maxVarbinds;
+}
+
+int SNMPPduLimits::getMaxRepetitions() const
+{
+    return maxRepetitions;
+}
+
+int SNMPPduLimits::getMaxMessageSize() const
+{
+    return maxMessageSize;
+}
+
+int SNMPPduLimits::getVarbindCeiling() const
+{
+    return varbindCeiling;
+}
+
+int SNMPPduLimits::getRepetitionCeiling() const
+{
+    return repetitionCeiling;
+}
+
+int SNMPPduLimits::getMessageSizeCeiling() const
+{
+    return messageSizeCeiling;
+}
+
+/**
+*   Sets how far the limits may grow, 64 varbinds, 100 repetitions and 1472 bytes by
+*   default. Learned limits above the new ceilings are lowered to them.
+*/
+void SNMPPduLimits::setCeilings(int maxVarbinds, int maxRepetitions, int maxMessageSize)
+{
+    this->varbindCeiling = qMax(maxVarbinds, 1);
+    this->repetitionCeiling = qMax(maxRepetitions, 1);
+    this->messageSizeCeiling = qMax(maxMessageSize, minMessageSize);
+
+    this->maxVarbinds = qMin(this->maxVarbinds, varbindCeiling);
+    this->maxRepetitions = qMin(this->maxRepetitions, repetitionCeiling);
+    this->maxMessageSize = qMin(this->maxMessageSize, messageSizeCeiling);
+}
+
+/**
+*   Forgets what was learned, for a new agent. The message size starts at its
+*   ceiling, the varbinds and repetitions start low and grow.
+*/
+void SNMPPduLimits::reset()
+{
+    maxVarbinds = qMin(initialVarbinds, varbindCeiling);
+    maxRepetitions = qMin(initialRepetitions, repetitionCeiling);
+    maxMessageSize = messageSizeCeiling;
+
+    answeredVarbinds = 0;
+    answeredRepetitions = 0;
+    answeredSize = 0;
+    lastResponseAt = -1;
+}
+
+
+//----[ Feedback ]-----------------------------------------------------------------------
+
+/**
+*   The agent answered the request at time now (milliseconds) without tooBig. The
+*   limits the request reached grow by one varbind, one repetition or 64 bytes.
+*/
+void SNMPPduLimits::requestSucceeded(int varbinds, int repetitions, int size, qint64 now)
+{
+    lastResponseAt = now;
+    answeredVarbinds = qMax(answeredVarbinds, varbinds);
+    answeredRepetitions = qMax(answeredRepetitions, repetitions);
+    answeredSize = qMax(answeredSize, size);
+
+    if(repetitions > 0)
+    {
+        if(repetitions >= maxRepetitions)
+            maxRepetitions = qMin(maxRepetitions + 1, repetitionCeiling);
+        return;
+    }
+
+    if(varbinds >= maxVarbinds)
+        maxVarbinds = qMin(maxVarbinds + 1, varbindCeiling);
+    if(size + messageSizeStep > maxMessageSize)
+        maxMessageSize = qMin(maxMessageSize + messageSizeStep, messageSizeCeiling);
+}
+
+/**
+*   The agent answered tooBig: the response to the request did not fit its buffers.
+*   A GetBulkRequest halves the repetitions, any other request the varbinds and the
+*   message size, from what the request carried. A single varbind too large on its
+*   own says nothing about the limits.
+*/
+void SNMPPduLimits::requestTooBig(int varbinds, int repetitions, int size)
+{
+    if(repetitions > 0)
+    {
+        maxRepetitions = qMax(qMin(maxRepetitions, repetitions) / 2, 1);
+        return;
+    }
+
+    if(varbinds <= 1)
+        return;
+
+    maxVarbinds = qMax(qMin(maxVarbinds, varbinds) / 2, 1);
+    maxMessageSize = qMax(qMin(maxMessageSize, size) / 2, minMessageSize);
+}
+
+/**
+*   The request used all its attempts without a response; sentAt is the time of its
+*   last transmission. Returns true, after halving the limits like a tooBig, if this
+*   looks like fragmentation loss, so a smaller request is worth trying.
+*/
+bool SNMPPduLimits::requestTimedOut(int varbinds, int repetitions, int size, qint64 sentAt)
+{
+    const bool bulk = repetitions > 0;
+    if((bulk ? repetitions : varbinds) <= 1)
+        return false;
+
+    // the agent is alive, so it is this request which does not get through
+    const bool answeredSince = lastResponseAt >= sentAt;
+
+    const bool largerThanAnswered = lastResponseAt >= 0
+            && (bulk ? repetitions > answeredRepetitions
+                     : varbinds > answeredVarbinds || size > answeredSize);
+
+    if(!answeredSince && !largerThanAnswered)
+        return false;
+
+    requestTooBig(varbinds, repetitions, size);
+    return true;
+}
@@ -0,0 +1,61 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class learns how large the requests to one agent can be: the varbinds
+ * per get- or set-request, the max-repetitions of a GetBulkRequest and the
+ * size of the messages we build.
+ *
+ * The limits grow by a step for every answered request which reached them,
+ * up to their ceilings, and are halved when the agent answers tooBig or when
+ * a timeout looks like the loss of an oversized, fragmented datagram rather
+ * than of the agent (additive increase, multiplicative decrease). A timeout
+ * is taken for fragmentation loss when the request carried several varbinds
+ * or repetitions and either the agent answered something after its last
+ * transmission, or it was larger than anything the agent has answered.
+ *
+ */
+
+
+#ifndef SNMPPDULIMITS_H
+#define SNMPPDULIMITS_H
+
+#include <QtGlobal>
+
+class SNMPPduLimits {
+
+public:
+    SNMPPduLimits();
+
+// get/set methods
+    int getMaxVarbinds() const;
+    int getMaxRepetitions() const;
+    int getMaxMessageSize() const;
+    int getVarbindCeiling() const;
+    int getRepetitionCeiling() const;
+    int getMessageSizeCeiling() const;
+    void setCeilings(int maxVarbinds, int maxRepetitions, int maxMessageSize);
+    void reset();
+
+// feedback, for a request of varbinds varbinds (or of repetitions repetitions
+// for a GetBulkRequest, 0 otherwise) in a message of size bytes
+    void requestSucceeded(int varbinds, int repetitions, int size, qint64 now);
+    void requestTooBig(int varbinds, int repetitions, int size);
+    bool requestTimedOut(int varbinds, int repetitions, int size, qint64 sentAt);
+
+private:
+    int maxVarbinds;
+    int maxRepetitions;
+    int maxMessageSize;
+    int varbindCeiling;
+    int repetitionCeiling;
+    int messageSizeCeiling;
+
+    int answeredVarbinds;
+    int answeredRepetitions;
+    int answeredSize;
+    qint64 lastResponseAt;
+};
+
+#endif // SNMPPDULIMITS_H
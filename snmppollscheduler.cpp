@@ -0,0 +1,549 @@
+#include "snmppollscheduler.h"
+#include "snmpmanager.h"
+#include <QDateTime>
+
+// Resolution of the due times and of the rate limits, in milliseconds
+static const int tickInterval = 10;
+
+// Queued entries dropped from the front of an agent queue before it is compacted
+static const int queueCompactThreshold = 64;
+
+/**
+*   Returns a 64-bit FNV-1a hash of size bytes, continuing from hash.
+*/
+static quint64 hashBytes(quint64 hash, const char *data, int size)
+{
+    for(int i = 0; i < size; i++)
+    {
+        hash ^= quint8(data[i]);
+        hash *= Q_UINT64_C(0x100000001b3);
+    }
+    return hash;
+}
+
+//----[ SNMPTokenBucket ]----------------------------------------------------------------
+
+SNMPTokenBucket::SNMPTokenBucket()
+{
+    this->rate = 0;
+    this->burst = 1;
+    this->tokens = 1;
+    this->lastRefill = 0;
+}
+
+/**
+*   Sets the rate tokens come in at and the most the bucket holds. A rate of 0 or
+*   less lifts the limit. The bucket starts full.
+*/
+void SNMPTokenBucket::setRate(double tokensPerSecond, double burst, qint64 now)
+{
+    this->rate = tokensPerSecond;
+    this->burst = qMax(burst, 1.0);
+    this->tokens = this->burst;
+    this->lastRefill = now;
+}
+
+/**
+*   Returns true if a token is available at time now (milliseconds).
+*/
+bool SNMPTokenBucket::hasToken(qint64 now)
+{
+    if(isUnlimited())
+        return true;
+
+    refill(now);
+    return tokens >= 1;
+}
+
+/**
+*   Takes a token; check SNMPTokenBucket::hasToken first.
+*/
+void SNMPTokenBucket::take()
+{
+    if(!isUnlimited())
+        tokens -= 1;
+}
+
+void SNMPTokenBucket::refill(qint64 now)
+{
+    if(now > lastRefill)
+    {
+        tokens = qMin(burst, tokens + double(now - lastRefill) * rate / 1000);
+        lastRefill = now;
+    }
+}
+
+
+//----[ Constructors/Destructors ]-------------------------------------------------------
+
+/**
+*   The scheduler sends its polls through manager, which must outlive it, and takes
+*   the answers from its signals; requests of other users of the manager are ignored.
+*/
+SNMPPollScheduler::SNMPPollScheduler(SNMPManager *manager, QObject *parent)
+        : QObject(parent), dueTimers(tickInterval)
+{
+    this->manager = manager;
+    this->activeJobs = 0;
+    this->queuedPolls = 0;
+    this->defaultMaxOutstanding = 1;
+    this->defaultRate = 0;
+    this->defaultBurst = 1;
+    clock.start();
+
+    tickTimer.setInterval(tickInterval);
+    connect(&tickTimer, &QTimer::timeout, this, &SNMPPollScheduler::checkDueJobs);
+    connect(manager, &SNMPManager::responseValuesReceived, this, &SNMPPollScheduler::handleResponse,
+            Qt::DirectConnection);
+    connect(manager, &SNMPManager::requestFailed, this, &SNMPPollScheduler::handleFailure);
+}
+
+SNMPPollScheduler::~SNMPPollScheduler()
+{
+    for(int i = 0; i < jobs.size(); i++)
+    {
+        if(jobs[i].used && jobs[i].state == InFlight)
+            manager->cancelRequest(jobs[i].requestId);
+    }
+}
+
+
+//----[ Limits ]-------------------------------------------------------------------------
+
+/**
+*   Limits the polls sent to all agents together to pollsPerSecond, with bursts of up
+*   to burst polls. The burst is raised to at least what comes in during one tick of
+*   the scheduler (10 ms). A rate of 0, the default, sets no global limit.
+*/
+void SNMPPollScheduler::setGlobalRate(double pollsPerSecond, double burst)
+{
+    globalBucket.setRate(pollsPerSecond, qMax(burst, pollsPerSecond * tickInterval / 1000),
+                         clock.elapsed());
+}
+
+/**
+*   Sets the limits of the agents which have none of their own: at most maxOutstanding
+*   polls in flight (1 by default), and pollsPerSecond with bursts of burst polls
+*   (no rate limit by default, or with a rate of 0).
+*/
+void SNMPPollScheduler::setDefaultAgentLimits(int maxOutstanding, double pollsPerSecond, double burst)
+{
+    defaultMaxOutstanding = qMax(maxOutstanding, 1);
+    defaultRate = pollsPerSecond;
+    defaultBurst = qMax(burst, pollsPerSecond * tickInterval / 1000);
+
+    const qint64 now = clock.elapsed();
+    for(int i = 0; i < agents.size(); i++)
+    {
+        if(agents[i].customLimits)
+            continue;
+        agents[i].maxOutstanding = defaultMaxOutstanding;
+        agents[i].bucket.setRate(defaultRate, defaultBurst, now);
+        makeRunnable(i);
+    }
+}
+
+/**
+*   Sets the limits of one target, like SNMPPollScheduler::setDefaultAgentLimits.
+*/
+void SNMPPollScheduler::setAgentLimits(int target, int maxOutstanding, double pollsPerSecond, double burst)
+{
+    if(target < 0)
+        return;
+
+    Agent &limited = agent(target);
+    limited.customLimits = true;
+    limited.maxOutstanding = qMax(maxOutstanding, 1);
+    limited.bucket.setRate(pollsPerSecond, qMax(burst, pollsPerSecond * tickInterval / 1000),
+                           clock.elapsed());
+    makeRunnable(target);
+}
+
+
+//----[ Jobs ]---------------------------------------------------------------------------
+
+/**
+*   This method will poll the OIDs on the target every interval milliseconds, in one
+*   get-request, at the phase of the job in its interval. The results come with
+*   pollCompleted, failures with pollFailed.
+*   Returns the job index, or -1 if the target is unknown to the manager, the list is
+*   empty or the interval is not positive.
+*/
+int SNMPPollScheduler::addJob(int target, const QVector<SNMPOid> &oids, int interval)
+{
+    if(manager->getTargetPort(target) == 0 || oids.isEmpty() || interval <= 0)
+        return -1;
+
+    int index;
+    if(!freeJobs.isEmpty())
+    {
+        index = freeJobs.last();
+        freeJobs.removeLast();
+    }
+    else
+    {
+        index = jobs.size();
+        jobs.append(Job());
+    }
+
+    Job &job = jobs[index];
+    job = Job();
+    job.oids = oids;
+    job.target = target;
+    job.interval = interval;
+    job.used = true;
+    job.phase = phaseOf(job);
+    activeJobs++;
+
+    agent(target);
+    scheduleFirstPoll(index, clock.elapsed());
+    return index;
+}
+
+/**
+*   This method will stop a job. A poll in flight is cancelled and not reported.
+*   Returns false if there is no such job.
+*/
+bool SNMPPollScheduler::removeJob(int job)
+{
+    if(job < 0 || job >= jobs.size() || !jobs[job].used)
+        return false;
+
+    Job &removed = jobs[job];
+    dueTimers.cancel(removed.timer, quint32(job));
+
+    if(removed.state == InFlight)
+    {
+        manager->cancelRequest(removed.requestId);
+        finishPoll(job);
+    }
+    else if(removed.state == Queued)
+    {
+        Agent &queue = agents[removed.target];
+        const int position = queue.queue.indexOf(job, queue.queueHead);
+        if(position >= 0)
+            queue.queue.remove(position);
+        queuedPolls--;
+    }
+
+    jobs[job] = Job();
+    freeJobs.append(job);
+    activeJobs--;
+    return true;
+}
+
+int SNMPPollScheduler::jobCount() const
+{
+    return activeJobs;
+}
+
+int SNMPPollScheduler::getJobTarget(int job) const
+{
+    return job >= 0 && job < jobs.size() && jobs[job].used ? jobs[job].target : -1;
+}
+
+/**
+*   Returns the offset of the job's polls in their interval, in milliseconds from the
+*   start of each interval counted on the wall clock, or -1 if there is no such job.
+*/
+int SNMPPollScheduler::getJobPhase(int job) const
+{
+    return job >= 0 && job < jobs.size() && jobs[job].used ? jobs[job].phase : -1;
+}
+
+/**
+*   Returns the number of polls which are due and wait for the limits.
+*/
+int SNMPPollScheduler::queuedPollCount() const
+{
+    return queuedPolls;
+}
+
+/**
+*   Starts polling. Jobs are polled at their phase; a job whose phase passed while
+*   the scheduler was stopped is polled at once, then at its phase again.
+*/
+void SNMPPollScheduler::start()
+{
+    tickTimer.start();
+}
+
+/**
+*   Stops polling: polls in flight complete, queued polls wait until start().
+*/
+void SNMPPollScheduler::stop()
+{
+    tickTimer.stop();
+}
+
+bool SNMPPollScheduler::isRunning() const
+{
+    return tickTimer.isActive();
+}
+
+
+//----[ Private slots ]------------------------------------------------------------------
+
+/**
+*   Called by the tick timer. Queues the jobs whose time has come, schedules their
+*   next poll one interval later, and sends what the limits allow.
+*/
+void SNMPPollScheduler::checkDueJobs()
+{
+    const qint64 now = clock.elapsed();
+
+    dueTimers.expire(now, [&](quint32 key) {
+        const int index = int(key);
+        Job &job = jobs[index];
+
+        // keep the phase: when we are late by whole intervals (a stalled event loop),
+        // the missed polls are skipped rather than sent in a burst
+        job.nextDue += job.interval;
+        if(job.nextDue <= now)
+            job.nextDue += ((now - job.nextDue) / job.interval + 1) * job.interval;
+        job.timer = dueTimers.schedule(job.nextDue, key);
+
+        if(job.state == Idle)
+            enqueue(index);
+        else
+            skippedJobs.append(index);
+    });
+
+    dispatch();
+
+    for(int i = 0; i < skippedJobs.size(); i++)
+    {
+        if(jobs[skippedJobs[i]].used)
+            emit pollSkipped(skippedJobs[i]);
+    }
+    skippedJobs.clear();
+}
+
+void SNMPPollScheduler::handleResponse(quint32 requestId, int target, int errorStatus,
+                                       const QVector<SNMPValue> &values)
+{
+    const int job = findPoll(target, requestId);
+    if(job < 0)
+        return;
+
+    finishPoll(job);
+    emit pollCompleted(job, errorStatus, values);
+    dispatch();
+}
+
+void SNMPPollScheduler::handleFailure(quint32 requestId, int target, int errorCode)
+{
+    const int job = findPoll(target, requestId);
+    if(job < 0)
+        return;
+
+    finishPoll(job);
+    emit pollFailed(job, errorCode);
+    dispatch();
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+/**
+*   Returns the state of a target, created with the default limits on first use.
+*/
+SNMPPollScheduler::Agent &SNMPPollScheduler::agent(int target)
+{
+    while(agents.size() <= target)
+    {
+        agents.append(Agent());
+        Agent &created = agents.last();
+        created.maxOutstanding = defaultMaxOutstanding;
+        created.bucket.setRate(defaultRate, defaultBurst, clock.elapsed());
+    }
+    return agents[target];
+}
+
+/**
+*   Returns the phase of a job in its interval: a hash of the agent address and port,
+*   the OIDs and the interval, so it does not depend on the order jobs are added in.
+*/
+int SNMPPollScheduler::phaseOf(const Job &job) const
+{
+    const QByteArray address = manager->getTargetAddress(job.target).toString().toLatin1();
+    const quint16 port = manager->getTargetPort(job.target);
+    const char portBytes[2] = { char(port >> 8), char(port) };
+    const char intervalBytes[4] = { char(job.interval >> 24), char(job.interval >> 16),
+                                    char(job.interval >> 8), char(job.interval) };
+
+    quint64 hash = Q_UINT64_C(0xcbf29ce484222325);
+    hash = hashBytes(hash, address.constData(), address.size());
+    hash = hashBytes(hash, portBytes, 2);
+    hash = hashBytes(hash, intervalBytes, 4);
+    for(int i = 0; i < job.oids.size(); i++)
+        hash = hashBytes(hash, job.oids[i].encoded().constData(), job.oids[i].encoded().size());
+
+    return int(hash % quint64(job.interval));
+}
+
+/**
+*   This method will schedule the first poll of a job at the next time its phase comes
+*   round on the wall clock.
+*/
+void SNMPPollScheduler::scheduleFirstPoll(int index, qint64 now)
+{
+    Job &job = jobs[index];
+    const qint64 wallClock = QDateTime::currentMSecsSinceEpoch();
+    const qint64 delay = ((job.phase - wallClock % job.interval) % job.interval + job.interval) % job.interval;
+
+    job.nextDue = now + delay;
+    job.timer = dueTimers.schedule(job.nextDue, quint32(index));
+}
+
+/**
+*   This method will queue a due job on its agent.
+*/
+void SNMPPollScheduler::enqueue(int index)
+{
+    Job &job = jobs[index];
+    Agent &target = agents[job.target];
+
+    job.state = Queued;
+    target.queue.append(index);
+    queuedPolls++;
+    makeRunnable(job.target);
+}
+
+/**
+*   This method will send the queued polls, one per agent in turn, while the global
+*   budget lasts. An agent leaves the turn when its queue is empty or its polls in
+*   flight reach its limit, and comes back on a completion; an agent out of tokens
+*   keeps its place and is tried again on the next tick.
+*/
+void SNMPPollScheduler::dispatch()
+{
+    const qint64 now = clock.elapsed();
+    bool progress = true;
+
+    while(progress && !runnableAgents.isEmpty())
+    {
+        progress = false;
+        dispatchPass.clear();
+        dispatchPass.swap(runnableAgents);
+
+        for(int i = 0; i < dispatchPass.size(); i++)
+        {
+            const int target = dispatchPass[i];
+            Agent &current = agents[target];
+
+            if(current.queueHead == current.queue.size() || current.inFlight.size() >= current.maxOutstanding)
+            {
+                current.runnable = false;
+                continue;
+            }
+
+            if(!current.bucket.hasToken(now))
+            {
+                runnableAgents.append(target);
+                continue;
+            }
+
+            if(!globalBucket.hasToken(now))
+            {
+                // out of budget: the agents not served yet go first next time
+                dispatchPass.remove(0, i);
+                dispatchPass += runnableAgents;
+                dispatchPass.swap(runnableAgents);
+                return;
+            }
+
+            current.bucket.take();
+            globalBucket.take();
+
+            const int job = current.queue[current.queueHead++];
+            queuedPolls--;
+            if(current.queueHead == current.queue.size())
+            {
+                current.queue.clear();
+                current.queueHead = 0;
+            }
+            else if(current.queueHead >= queueCompactThreshold && current.queueHead * 2 >= current.queue.size())
+            {
+                current.queue.remove(0, current.queueHead);
+                current.queueHead = 0;
+            }
+
+            sendPoll(job);
+            progress = true;
+            runnableAgents.append(target);
+        }
+    }
+}
+
+/**
+*   This method will send the get-request of a job through the manager.
+*   Returns false, after reporting the job as failed with code 5, if the manager
+*   refused the request.
+*/
+bool SNMPPollScheduler::sendPoll(int index)
+{
+    Job &job = jobs[index];
+    const quint32 requestId = manager->get(job.target, job.oids);
+    if(requestId == 0)
+    {
+        job.state = Idle;
+        emit pollFailed(index, 5);
+        return false;
+    }
+
+    job.state = InFlight;
+    job.requestId = requestId;
+    agents[job.target].inFlight.append(index);
+    return true;
+}
+
+/**
+*   Returns the job whose poll of the target is the request, or -1 for a request
+*   of another user of the manager. An agent has at most its maxOutstanding polls
+*   in flight, so the search is short.
+*/
+int SNMPPollScheduler::findPoll(int target, quint32 requestId) const
+{
+    if(target < 0 || target >= agents.size())
+        return -1;
+
+    const QVector<int> &inFlight = agents[target].inFlight;
+    for(int i = 0; i < inFlight.size(); i++)
+    {
+        if(jobs[inFlight[i]].requestId == requestId)
+            return inFlight[i];
+    }
+    return -1;
+}
+
+/**
+*   This method will release the slot of a poll which is no longer in flight.
+*/
+void SNMPPollScheduler::finishPoll(int index)
+{
+    Job &job = jobs[index];
+    QVector<int> &inFlight = agents[job.target].inFlight;
+
+    // order does not matter: the last one takes the place of the finished one
+    const int position = inFlight.indexOf(index);
+    inFlight[position] = inFlight.last();
+    inFlight.removeLast();
+
+    job.state = Idle;
+    job.requestId = 0;
+    makeRunnable(job.target);
+}
+
+/**
+*   This method will give the target a turn in dispatch() if it has queued polls.
+*/
+void SNMPPollScheduler::makeRunnable(int target)
+{
+    Agent &current = agents[target];
+    if(current.runnable || current.queueHead == current.queue.size())
+        return;
+
+    current.runnable = true;
+    runnableAgents.append(target);
+}
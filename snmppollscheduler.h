@@ -0,0 +1,156 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class polls groups of OIDs on the targets of a SNMPManager at fixed
+ * intervals, spread evenly over each interval instead of all at its start.
+ *
+ * Every job (target, OIDs, interval) gets a phase in its interval from a hash
+ * of the agent address, port, OIDs and interval, taken against the wall
+ * clock, so a job polls at the same point of each interval, run after run,
+ * and many jobs fill the interval uniformly. Due jobs queue per agent and
+ * are sent round-robin across the agents while three limits allow it: the
+ * agent's number of polls in flight, the agent's token bucket, and a global
+ * token bucket of polls per second. A job still queued or in flight when it
+ * is due again skips that round rather than piling up.
+ *
+ * The budgets count polls, i.e. requests started by the scheduler; the
+ * retransmissions of the SNMPManager come on top of them.
+ *
+ */
+
+
+#ifndef SNMPPOLLSCHEDULER_H
+#define SNMPPOLLSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+#include "snmpoid.h"
+#include "snmptimerwheel.h"
+#include "snmpvalue.h"
+
+class SNMPManager;
+
+class SNMPTokenBucket {
+
+public:
+    SNMPTokenBucket();
+
+    void setRate(double tokensPerSecond, double burst, qint64 now);
+    double getRate() const { return rate; }
+    double getBurst() const { return burst; }
+
+    bool isUnlimited() const { return rate <= 0; }
+    bool hasToken(qint64 now);
+    void take();
+
+private:
+    void refill(qint64 now);
+
+    double rate;
+    double burst;
+    double tokens;
+    qint64 lastRefill;
+};
+
+class SNMPPollScheduler : public QObject {
+
+    Q_OBJECT
+
+public:
+    explicit SNMPPollScheduler(SNMPManager *manager, QObject *parent = 0);
+    ~SNMPPollScheduler();
+
+// limits
+    void setGlobalRate(double pollsPerSecond, double burst = 1);
+    void setDefaultAgentLimits(int maxOutstanding, double pollsPerSecond = 0, double burst = 1);
+    void setAgentLimits(int target, int maxOutstanding, double pollsPerSecond = 0, double burst = 1);
+
+// jobs
+    int addJob(int target, const QVector<SNMPOid> &oids, int interval);
+    bool removeJob(int job);
+    int jobCount() const;
+    int getJobTarget(int job) const;
+    int getJobPhase(int job) const;
+    int queuedPollCount() const;
+
+    void start();
+    void stop();
+    bool isRunning() const;
+
+signals:
+    // the values are views into the receive buffer of the manager; connect with a direct connection
+    void pollCompleted(int job, int errorStatus, const QVector<SNMPValue> &values);
+    void pollFailed(int job, int errorCode);
+    void pollSkipped(int job);
+
+private slots:
+    void checkDueJobs();
+    void handleResponse(quint32 requestId, int target, int errorStatus, const QVector<SNMPValue> &values);
+    void handleFailure(quint32 requestId, int target, int errorCode);
+
+private:
+    enum JobState { Idle, Queued, InFlight };
+
+    struct Job {
+        Job() : target(-1), interval(0), phase(0), nextDue(0), timer(-1), requestId(0),
+                state(Idle), used(false) {}
+
+        QVector<SNMPOid> oids;
+        int target;
+        int interval;
+        int phase;
+        qint64 nextDue;
+        int timer;
+        quint32 requestId;
+        qint8 state;
+        bool used;
+    };
+
+    struct Agent {
+        Agent() : maxOutstanding(1), queueHead(0), customLimits(false), runnable(false) {}
+
+        SNMPTokenBucket bucket;
+        QVector<int> queue;
+        QVector<int> inFlight;
+        int maxOutstanding;
+        int queueHead;
+        bool customLimits;
+        bool runnable;
+    };
+
+    Agent &agent(int target);
+    int phaseOf(const Job &job) const;
+    void scheduleFirstPoll(int job, qint64 now);
+    void enqueue(int job);
+    void dispatch();
+    bool sendPoll(int job);
+    int findPoll(int target, quint32 requestId) const;
+    void finishPoll(int job);
+    void makeRunnable(int target);
+
+    SNMPManager *manager;
+    QVector<Job> jobs;
+    QVector<int> freeJobs;
+    int activeJobs;
+    int queuedPolls;
+
+    QVector<Agent> agents;
+    QVector<int> runnableAgents;
+    QVector<int> dispatchPass;
+    QVector<int> skippedJobs;
+
+    int defaultMaxOutstanding;
+    double defaultRate;
+    double defaultBurst;
+    SNMPTokenBucket globalBucket;
+
+    SNMPTimerWheel dueTimers;
+    QTimer tickTimer;
+    QElapsedTimer clock;
+};
+
+#endif // SNMPPOLLSCHEDULER_H
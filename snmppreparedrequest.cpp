@@ -0,0 +1,55 @@
+#include "snmppreparedrequest.h"
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   Creates an invalid request. Valid ones come from SNMPSession::prepareGetRequest.
+*/
+SNMPPreparedRequest::SNMPPreparedRequest()
+{
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+int SNMPPreparedRequest::varbindCount() const
+{
+    return d ? d->indexes.size() : 0;
+}
+
+/**
+*   Returns the encoded message, with a placeholder request ID.
+*/
+QByteArray SNMPPreparedRequest::message() const
+{
+    return d ? d->message : QByteArray();
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+/**
+*   This method will write the request ID into a copy of the encoded message.
+*   Returns false, leaving the copy unchanged, if the minimal encoding of the
+*   new ID does not have the same length as the one in the message.
+*/
+bool SNMPPreparedRequest::patchRequestId(char *message, quint32 requestId) const
+{
+    const qint32 signedRequestId = qint32(requestId);
+
+    int length = 1;
+    while(length < 4 && (signedRequestId >> (length * 8 - 1)) != 0
+          && (signedRequestId >> (length * 8 - 1)) != -1)
+        length++;
+
+    if(length != d->requestIdLength)
+        return false;
+
+    char *bytes = message + d->requestIdOffset;
+    for(int i = length - 1; i >= 0; i--)
+    {
+        bytes[i] = char(requestId & 0xff);
+        requestId >>= 8;
+    }
+    return true;
+}
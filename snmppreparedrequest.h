@@ -0,0 +1,56 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class represents a request which is encoded once and sent many times,
+ * for pollers asking the same agent for the same OIDs every interval.
+ *
+ * SNMPSession::prepareGetRequest serializes the whole message. Each
+ * SNMPSession::sendPreparedRequest then only copies it into the session's
+ * encoder and overwrites the request ID bytes of the copy; when a new ID
+ * needs a different number of bytes, the message header is encoded again in
+ * front of the unchanged varbinds.
+ *
+ * The encoded message is never written after it is prepared, so copies of a
+ * prepared request, which share it, may be sent by sessions on any threads.
+ *
+ */
+
+
+#ifndef SNMPPREPAREDREQUEST_H
+#define SNMPPREPAREDREQUEST_H
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QVector>
+
+class SNMPPreparedRequest {
+
+public:
+    SNMPPreparedRequest();
+
+    bool isValid() const { return !d.isNull(); }
+    int varbindCount() const;
+    QByteArray message() const;
+
+private:
+    friend class SNMPSession;
+
+    struct Data {
+        QByteArray message;
+        int requestIdOffset;
+        int requestIdLength;
+        int pduType;
+        QByteArray communityString;
+        QByteArray varbinds;
+        QVector<int> offsets;
+        QVector<int> indexes;
+    };
+
+    bool patchRequestId(char *message, quint32 requestId) const;
+
+    QSharedPointer<Data> d;
+};
+
+#endif // SNMPPREPAREDREQUEST_H
@@ -0,0 +1,339 @@
+#include "snmprateengine.h"
+#include <cstring>
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   The table starts with room for initialCapacity series and doubles when it is
+*   half full.
+*/
+SNMPRateEngine::SNMPRateEngine(int initialCapacity)
+{
+    int capacity = 16;
+    while(capacity < initialCapacity * 2)
+        capacity <<= 1;
+
+    Bucket empty;
+    empty.hash = 0;
+    empty.series = -1;
+    buckets.assign(capacity, empty);
+    entries.reserve(qMax(1, initialCapacity));
+    oids.reserve(qMax(1, initialCapacity));
+    mask = quint64(capacity - 1);
+    count = 0;
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will return the series of the OID polled from the agent, and create
+*   it if needed. The agent is any number the caller identifies it with, such as a
+*   target of SNMPManager. The index stays valid until the series is removed.
+*/
+int SNMPRateEngine::series(quint32 agent, const SNMPOid &oid)
+{
+    return series(agent, oid.encoded().constData(), oid.encoded().size());
+}
+
+/**
+*   The same with the encoded OID given as bytes, such as the view of a varbind.
+*/
+int SNMPRateEngine::series(quint32 agent, const char *oid, int size)
+{
+    const quint64 hash = hashKey(agent, oid, size);
+    const int bucket = findBucket(hash, agent, oid, size);
+    if(bucket != -1)
+        return buckets[bucket].series;
+
+    if(quint64(count + 1) * 2 > mask + 1)
+        grow();
+
+    int index;
+    if(!freeSeries.empty())
+    {
+        index = freeSeries.back();
+        freeSeries.pop_back();
+    } else
+    {
+        index = int(entries.size());
+        entries.push_back(Series());
+        oids.push_back(QByteArray());
+    }
+
+    Series &entry = entries[index];
+    entry.hash = hash;
+    entry.value = 0;
+    entry.timestamp = 0;
+    entry.upTime = -1;
+    entry.agent = agent;
+    entry.used = true;
+    entry.sampled = false;
+    oids[index] = QByteArray(oid, size);
+
+    insertBucket(hash, index);
+    count++;
+    return index;
+}
+
+/**
+*   Returns the series of the OID polled from the agent, or -1 if there is none.
+*/
+int SNMPRateEngine::findSeries(quint32 agent, const SNMPOid &oid) const
+{
+    return findSeries(agent, oid.encoded().constData(), oid.encoded().size());
+}
+
+int SNMPRateEngine::findSeries(quint32 agent, const char *oid, int size) const
+{
+    const int bucket = findBucket(hashKey(agent, oid, size), agent, oid, size);
+    return bucket == -1 ? -1 : buckets[bucket].series;
+}
+
+/**
+*   This method will forget the series and its previous sample. Its index may be
+*   given to a new series.
+*/
+bool SNMPRateEngine::removeSeries(int series)
+{
+    if(series < 0 || series >= int(entries.size()) || !entries[series].used)
+        return false;
+
+    quint64 bucket = entries[series].hash & mask;
+    while(buckets[bucket].series != series)
+        bucket = (bucket + 1) & mask;
+
+    removeBucket(int(bucket));
+    entries[series].used = false;
+    oids[series] = QByteArray();
+    freeSeries.push_back(series);
+    count--;
+    return true;
+}
+
+/**
+*   This method will remove all the series of the agent.
+*   Returns the number of series removed.
+*/
+int SNMPRateEngine::removeAgent(quint32 agent)
+{
+    int removed = 0;
+
+    for(int series = 0; series < int(entries.size()); series++)
+    {
+        if(entries[series].used && entries[series].agent == agent)
+        {
+            removeSeries(series);
+            removed++;
+        }
+    }
+
+    return removed;
+}
+
+void SNMPRateEngine::clear()
+{
+    Bucket empty;
+    empty.hash = 0;
+    empty.series = -1;
+    buckets.assign(buckets.size(), empty);
+    entries.clear();
+    oids.clear();
+    freeSeries.clear();
+    count = 0;
+}
+
+/**
+*   This method will take a new sample of a Counter32 or Counter64 series and return
+*   the delta and rate since the previous one, see SNMPRate.
+*/
+SNMPRate SNMPRateEngine::update(int series, const SNMPValue &value, qint64 timestamp, qint64 upTime)
+{
+    return update(series, value.toUnsigned(), value.type(), timestamp, upTime);
+}
+
+/**
+*   The same with the value already decoded; type is SNMPBer::Counter32 or Counter64.
+*
+*   The agent restarted if its sysUpTime went back (unless the 32-bit TimeTicks
+*   wrapped, after 497 days) or if it has been up for less time than passed since
+*   the previous sample. The sample then only starts the series over.
+*/
+SNMPRate SNMPRateEngine::update(int series, quint64 value, int type, qint64 timestamp, qint64 upTime)
+{
+    SNMPRate rate;
+
+    if(series < 0 || series >= int(entries.size()) || !entries[series].used
+       || (type != SNMPBer::Counter32 && type != SNMPBer::Counter64))
+    {
+        rate.status = SNMPRate::Invalid;
+        return rate;
+    }
+
+    Series &entry = entries[series];
+    if(!entry.sampled)
+    {
+        entry.value = value;
+        entry.timestamp = timestamp;
+        entry.upTime = upTime;
+        entry.sampled = true;
+        return rate;
+    }
+
+    qint64 interval = timestamp - entry.timestamp;
+    bool restarted = false;
+
+    if(upTime >= 0 && entry.upTime >= 0)
+    {
+        const qint64 ticks = qint64(quint32(quint32(upTime) - quint32(entry.upTime)));
+
+        if(upTime < entry.upTime)
+            restarted = ticks * 10 > interval * 2 + 1000;
+        else
+            restarted = upTime * 10 + 1000 < interval;
+
+        if(!restarted && ticks > 0)
+            interval = ticks * 10;
+    }
+
+    if(!restarted && interval <= 0)
+    {
+        rate.status = SNMPRate::Invalid;
+        return rate;
+    }
+
+    if(!restarted && value < entry.value)
+    {
+        if(type == SNMPBer::Counter32)
+            rate.delta = quint32(value - entry.value);
+        else
+            restarted = true;
+    } else
+    {
+        rate.delta = value - entry.value;
+    }
+
+    entry.value = value;
+    entry.timestamp = timestamp;
+    entry.upTime = upTime;
+
+    if(restarted)
+    {
+        rate.status = SNMPRate::Discontinuity;
+        rate.delta = 0;
+        return rate;
+    }
+
+    rate.status = SNMPRate::Valid;
+    rate.interval = interval;
+    rate.rate = double(rate.delta) * 1000.0 / double(interval);
+    return rate;
+}
+
+/**
+*   The same, looking the series up (or creating it) by agent and OID.
+*/
+SNMPRate SNMPRateEngine::update(quint32 agent, const SNMPOid &oid, const SNMPValue &value,
+                                qint64 timestamp, qint64 upTime)
+{
+    return update(series(agent, oid), value, timestamp, upTime);
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+/**
+*   FNV-1a over the agent and the OID bytes, with a final mix so that the low bits
+*   used to pick the bucket depend on all of them.
+*/
+quint64 SNMPRateEngine::hashKey(quint32 agent, const char *oid, int size)
+{
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+
+    for(int i = 0; i < 4; i++)
+    {
+        hash ^= (agent >> (8 * i)) & 0xff;
+        hash *= Q_UINT64_C(1099511628211);
+    }
+
+    for(int i = 0; i < size; i++)
+    {
+        hash ^= quint8(oid[i]);
+        hash *= Q_UINT64_C(1099511628211);
+    }
+
+    hash ^= hash >> 33;
+    hash *= Q_UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+*   Returns the bucket of the series with the key, or -1.
+*/
+int SNMPRateEngine::findBucket(quint64 hash, quint32 agent, const char *oid, int size) const
+{
+    quint64 bucket = hash & mask;
+
+    while(buckets[bucket].series != -1)
+    {
+        const Bucket &candidate = buckets[bucket];
+        if(candidate.hash == hash && entries[candidate.series].agent == agent)
+        {
+            const QByteArray &bytes = oids[candidate.series];
+            if(bytes.size() == size && memcmp(bytes.constData(), oid, size) == 0)
+                return int(bucket);
+        }
+        bucket = (bucket + 1) & mask;
+    }
+
+    return -1;
+}
+
+void SNMPRateEngine::insertBucket(quint64 hash, int series)
+{
+    quint64 bucket = hash & mask;
+    while(buckets[bucket].series != -1)
+        bucket = (bucket + 1) & mask;
+
+    buckets[bucket].hash = hash;
+    buckets[bucket].series = series;
+}
+
+/**
+*   This method will empty the bucket and shift back the buckets after it which are
+*   not in their home bucket, so that lookups need no tombstones.
+*/
+void SNMPRateEngine::removeBucket(int bucket)
+{
+    quint64 hole = quint64(bucket);
+    quint64 next = (hole + 1) & mask;
+
+    while(buckets[next].series != -1)
+    {
+        const quint64 home = buckets[next].hash & mask;
+        if(((next - home) & mask) >= ((next - hole) & mask))
+        {
+            buckets[hole] = buckets[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    buckets[hole].series = -1;
+}
+
+void SNMPRateEngine::grow()
+{
+    Bucket empty;
+    empty.hash = 0;
+    empty.series = -1;
+    buckets.assign(buckets.size() * 2, empty);
+    mask = quint64(buckets.size() - 1);
+
+    for(int series = 0; series < int(entries.size()); series++)
+    {
+        if(entries[series].used)
+            insertBucket(entries[series].hash, series);
+    }
+}
@@ -0,0 +1,106 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class turns successive polls of counters into deltas and rates, per
+ * (agent, OID) series, so that consumers store ifHCInOctets per second or
+ * error deltas instead of raw counter values.
+ *
+ * Each series keeps its previous sample. The series live in a contiguous
+ * array, found through an open-addressing hash table of (hash, index) pairs
+ * with linear probing, so an update is a probe or two into flat memory and
+ * never allocates; callers which poll the same OIDs again and again can keep
+ * the series index and skip the lookup altogether.
+ *
+ * A Counter32 lower than its previous sample has wrapped once (poll often
+ * enough that it cannot wrap twice: every 34 s at 1 Gbit/s). A Counter64
+ * cannot wrap in practice, so a lower sample is a discontinuity. When the
+ * samples come with the agent's sysUpTime, a restart of the agent is
+ * detected from it and the interval between samples is measured on the
+ * agent's clock, which is immune to the jitter of the network.
+ *
+ */
+
+
+#ifndef SNMPRATEENGINE_H
+#define SNMPRATEENGINE_H
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <vector>
+#include "snmpoid.h"
+#include "snmpvalue.h"
+
+struct SNMPRate {
+    enum Status {
+        Valid,          // delta and rate over interval
+        FirstSample,    // the sample is the first of the series
+        Discontinuity,  // the agent restarted or the counter was reset; the sample starts over
+        Invalid         // not a counter, or no time passed; the previous sample is kept
+    };
+
+    SNMPRate() : status(FirstSample), delta(0), interval(0), rate(0) {}
+
+    bool isValid() const { return status == Valid; }
+
+    int status;
+    quint64 delta;
+    qint64 interval;    // milliseconds
+    double rate;        // delta per second
+};
+
+class SNMPRateEngine {
+
+public:
+    explicit SNMPRateEngine(int initialCapacity = 1024);
+
+// series
+    int series(quint32 agent, const SNMPOid &oid);
+    int series(quint32 agent, const char *oid, int size);
+    int findSeries(quint32 agent, const SNMPOid &oid) const;
+    int findSeries(quint32 agent, const char *oid, int size) const;
+    bool removeSeries(int series);
+    int removeAgent(quint32 agent);
+    void clear();
+
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+
+// samples; timestamps in milliseconds, upTime the agent's sysUpTime in TimeTicks or -1
+    SNMPRate update(int series, const SNMPValue &value, qint64 timestamp, qint64 upTime = -1);
+    SNMPRate update(int series, quint64 value, int type, qint64 timestamp, qint64 upTime = -1);
+    SNMPRate update(quint32 agent, const SNMPOid &oid, const SNMPValue &value,
+                    qint64 timestamp, qint64 upTime = -1);
+
+private:
+    struct Bucket {
+        quint64 hash;
+        int series;
+    };
+
+    struct Series {
+        quint64 hash;
+        quint64 value;
+        qint64 timestamp;
+        qint64 upTime;
+        quint32 agent;
+        bool used;
+        bool sampled;
+    };
+
+    static quint64 hashKey(quint32 agent, const char *oid, int size);
+    int findBucket(quint64 hash, quint32 agent, const char *oid, int size) const;
+    void insertBucket(quint64 hash, int series);
+    void removeBucket(int bucket);
+    void grow();
+
+    std::vector<Bucket> buckets;
+    std::vector<Series> entries;
+    std::vector<QByteArray> oids;
+    std::vector<int> freeSeries;
+    quint64 mask;
+    int count;
+};
+
+#endif // SNMPRATEENGINE_H
@@ -0,0 +1,204 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class keeps the outstanding requests of a socket, keyed by their
+ * SNMP request ID. Request IDs are allocated monotonically from a 32-bit
+ * space and map directly to a slot of a power-of-two ring, so allocation,
+ * lookup and removal are O(1) and need no hashing.
+ *
+ */
+
+
+#ifndef SNMPREQUESTTABLE_H
+#define SNMPREQUESTTABLE_H
+
+#include <QRandomGenerator>
+#include <QtGlobal>
+#include <vector>
+
+template <typename T>
+class SNMPRequestTable {
+
+public:
+    explicit SNMPRequestTable(int initialCapacity = 64);
+
+    quint32 insert(const T &value);
+    T *find(quint32 requestId);
+    bool take(quint32 requestId, T *value);
+    bool remove(quint32 requestId);
+    void clear();
+
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+    int capacity() const { return int(entries.size()); }
+
+    template <typename Function>
+    void forEach(Function function);
+
+private:
+    struct Entry {
+        quint32 requestId;
+        bool used;
+        T value;
+    };
+
+    void grow();
+
+    std::vector<Entry> entries;
+    quint32 mask;
+    quint32 nextRequestId;
+    int count;
+};
+
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   The initial capacity is rounded up to a power of two. The first request ID
+*   is random so that late answers to a previous process are not mistaken for ours.
+*/
+template <typename T>
+SNMPRequestTable<T>::SNMPRequestTable(int initialCapacity)
+{
+    int capacity = 1;
+    while(capacity < initialCapacity)
+        capacity <<= 1;
+
+    entries.resize(capacity);
+    mask = capacity - 1;
+    nextRequestId = QRandomGenerator::global()->generate();
+    count = 0;
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will store the value under a newly allocated request ID and return it.
+*   IDs only ever increase (modulo 2^32); an ID whose slot is still held by an older
+*   request is skipped, and so is 0, which callers may use as an invalid ID. The
+*   table doubles once it is half full, so a free slot is always found after a few steps.
+*/
+template <typename T>
+quint32 SNMPRequestTable<T>::insert(const T &value)
+{
+    if((count + 1) * 2 > int(entries.size()))
+        grow();
+
+    while(nextRequestId == 0 || entries[nextRequestId & mask].used)
+        nextRequestId++;
+
+    const quint32 requestId = nextRequestId++;
+    Entry &entry = entries[requestId & mask];
+    entry.requestId = requestId;
+    entry.used = true;
+    entry.value = value;
+    count++;
+
+    return requestId;
+}
+
+/**
+*   Returns the value stored for the request ID, or NULL for stray and already
+*   answered requests.
+*/
+template <typename T>
+T *SNMPRequestTable<T>::find(quint32 requestId)
+{
+    Entry &entry = entries[requestId & mask];
+    if(!entry.used || entry.requestId != requestId)
+        return NULL;
+    return &entry.value;
+}
+
+/**
+*   This method will remove the request and copy its value out.
+*   Returns false if the request was not pending.
+*/
+template <typename T>
+bool SNMPRequestTable<T>::take(quint32 requestId, T *value)
+{
+    Entry &entry = entries[requestId & mask];
+    if(!entry.used || entry.requestId != requestId)
+        return false;
+
+    if(value)
+        *value = entry.value;
+    entry.used = false;
+    entry.value = T();
+    count--;
+    return true;
+}
+
+template <typename T>
+bool SNMPRequestTable<T>::remove(quint32 requestId)
+{
+    return take(requestId, NULL);
+}
+
+template <typename T>
+void SNMPRequestTable<T>::clear()
+{
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        entries[i].used = false;
+        entries[i].value = T();
+    }
+    count = 0;
+}
+
+/**
+*   Calls function(requestId, value) for every pending request.
+*   The function must not insert into or remove from the table.
+*/
+template <typename T>
+template <typename Function>
+void SNMPRequestTable<T>::forEach(Function function)
+{
+    for(size_t i = 0; i < entries.size(); i++)
+    {
+        if(entries[i].used)
+            function(entries[i].requestId, entries[i].value);
+    }
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+/**
+*   Doubles the ring. Pending requests keep their IDs; two of them may land on the
+*   same slot of the larger ring only if their IDs are further apart than its size,
+*   in which case the ring keeps doubling.
+*/
+template <typename T>
+void SNMPRequestTable<T>::grow()
+{
+    size_t capacity = entries.size();
+    std::vector<Entry> grown;
+
+    for(bool placed = false; !placed; )
+    {
+        capacity *= 2;
+        grown.assign(capacity, Entry());
+
+        placed = true;
+        for(size_t i = 0; i < entries.size() && placed; i++)
+        {
+            if(!entries[i].used)
+                continue;
+
+            Entry &target = grown[entries[i].requestId & (capacity - 1)];
+            if(target.used)
+                placed = false;
+            else
+                target = entries[i];
+        }
+    }
+
+    entries.swap(grown);
+    mask = quint32(capacity - 1);
+}
+
+#endif // SNMPREQUESTTABLE_H
@@ -0,0 +1,169 @@
+#include "snmpretrypolicy.h"
+#include <QMutexLocker>
+
+// The historical schedule: sent once and retried twice
+static const int defaultTimeouts[] = { 3000, 3000, 500 };
+
+// A timed out request doubles the timeout of the following ones up to 2^maxBackoff times
+static const int maxBackoff = 4;
+
+//----[ SNMPRetryPolicy ]----------------------------------------------------------------
+
+SNMPRetryPolicy::~SNMPRetryPolicy()
+{
+}
+
+void SNMPRetryPolicy::responseReceived(const QHostAddress &agent, int attempt, qint64 roundTripTime)
+{
+    Q_UNUSED(agent);
+    Q_UNUSED(attempt);
+    Q_UNUSED(roundTripTime);
+}
+
+void SNMPRetryPolicy::requestTimedOut(const QHostAddress &agent)
+{
+    Q_UNUSED(agent);
+}
+
+
+//----[ SNMPFixedRetryPolicy ]-----------------------------------------------------------
+
+SNMPFixedRetryPolicy::SNMPFixedRetryPolicy()
+{
+    for(size_t i = 0; i < sizeof(defaultTimeouts) / sizeof(defaultTimeouts[0]); i++)
+        timeouts.append(defaultTimeouts[i]);
+}
+
+/**
+*   One transmission per entry, each followed by a wait of that many milliseconds.
+*/
+SNMPFixedRetryPolicy::SNMPFixedRetryPolicy(const QVector<int> &timeouts)
+{
+    this->timeouts = timeouts;
+}
+
+int SNMPFixedRetryPolicy::maxAttempts(const QHostAddress &agent) const
+{
+    Q_UNUSED(agent);
+    return timeouts.size();
+}
+
+int SNMPFixedRetryPolicy::timeout(const QHostAddress &agent, int attempt) const
+{
+    Q_UNUSED(agent);
+    return timeouts.value(attempt, 0);
+}
+
+
+//----[ SNMPAdaptiveRetryPolicy ]--------------------------------------------------------
+
+/**
+*   initialTimeout is used for agents without a round-trip time sample yet. Every
+*   timeout is kept between minTimeout and maxTimeout, backoff included.
+*/
+SNMPAdaptiveRetryPolicy::SNMPAdaptiveRetryPolicy(int maxAttempts, int initialTimeout,
+                                                 int minTimeout, int maxTimeout)
+{
+    this->attempts = qMax(1, maxAttempts);
+    this->initialTimeout = initialTimeout;
+    this->minTimeout = minTimeout;
+    this->maxTimeout = qMax(minTimeout, maxTimeout);
+}
+
+int SNMPAdaptiveRetryPolicy::maxAttempts(const QHostAddress &agent) const
+{
+    Q_UNUSED(agent);
+    return attempts;
+}
+
+/**
+*   The retransmission timeout of the agent, doubled for every retransmission.
+*/
+int SNMPAdaptiveRetryPolicy::timeout(const QHostAddress &agent, int attempt) const
+{
+    qint64 timeout = retransmissionTimeout(agent);
+    for(int i = 0; i < attempt && timeout < maxTimeout; i++)
+        timeout *= 2;
+
+    return int(qMin(timeout, qint64(maxTimeout)));
+}
+
+/**
+*   Only responses to a first transmission are sampled: a retransmitted request
+*   carries the same request ID, so its response may answer any of the copies
+*   (Karn's algorithm).
+*/
+void SNMPAdaptiveRetryPolicy::responseReceived(const QHostAddress &agent, int attempt, qint64 roundTripTime)
+{
+    QMutexLocker locker(&mutex);
+    Estimate &estimate = estimates[agent];
+    estimate.backoff = 0;
+
+    if(attempt != 0)
+        return;
+
+    if(!estimate.measured)
+    {
+        // SRTT = R, RTTVAR = R/2
+        estimate.measured = true;
+        estimate.smoothed = roundTripTime << 3;
+        estimate.variance = roundTripTime << 1;
+        return;
+    }
+
+    // SRTT += (R - SRTT)/8, RTTVAR += (|R - SRTT| - RTTVAR)/4
+    qint64 delta = roundTripTime - (estimate.smoothed >> 3);
+    estimate.smoothed += delta;
+    if(delta < 0)
+        delta = -delta;
+    estimate.variance += delta - (estimate.variance >> 2);
+}
+
+/**
+*   The agent keeps a doubled timeout for its next requests, until one is answered.
+*/
+void SNMPAdaptiveRetryPolicy::requestTimedOut(const QHostAddress &agent)
+{
+    QMutexLocker locker(&mutex);
+    Estimate &estimate = estimates[agent];
+    if(estimate.backoff < maxBackoff)
+        estimate.backoff++;
+}
+
+/**
+*   Returns the smoothed round-trip time of the agent in milliseconds, or -1
+*   if none of its responses has been sampled yet.
+*/
+qint64 SNMPAdaptiveRetryPolicy::smoothedRoundTripTime(const QHostAddress &agent) const
+{
+    QMutexLocker locker(&mutex);
+    const Estimate estimate = estimates.value(agent);
+    return estimate.measured ? estimate.smoothed >> 3 : -1;
+}
+
+/**
+*   Returns the round-trip time variance of the agent in milliseconds, or -1
+*   if none of its responses has been sampled yet.
+*/
+qint64 SNMPAdaptiveRetryPolicy::roundTripTimeVariance(const QHostAddress &agent) const
+{
+    QMutexLocker locker(&mutex);
+    const Estimate estimate = estimates.value(agent);
+    return estimate.measured ? estimate.variance >> 2 : -1;
+}
+
+/**
+*   RTO = SRTT + 4 * RTTVAR, doubled for each of the last requests which timed out,
+*   within [minTimeout, maxTimeout].
+*/
+int SNMPAdaptiveRetryPolicy::retransmissionTimeout(const QHostAddress &agent) const
+{
+    QMutexLocker locker(&mutex);
+    const Estimate estimate = estimates.value(agent);
+
+    qint64 timeout = estimate.measured ? (estimate.smoothed >> 3) + estimate.variance
+                                       : qint64(initialTimeout);
+    timeout <<= estimate.backoff;
+
+    return int(qBound(qint64(minTimeout), timeout, qint64(maxTimeout)));
+}
@@ -0,0 +1,100 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The classes decide how long a session waits for a response before it
+ * retransmits a request, and how many times it tries.
+ *
+ * SNMPRetryPolicy is the interface SNMPSession calls for every transmission,
+ * response and timeout. SNMPFixedRetryPolicy keeps a fixed schedule, by
+ * default the historical 3000/3000/500 ms one. SNMPAdaptiveRetryPolicy keeps
+ * TCP-style smoothed round-trip time and variance estimates per agent
+ * address (RFC 6298) and doubles the timeout on every retransmission.
+ *
+ * A policy may be shared by sessions and managers in several threads, so
+ * its methods may be called concurrently. SNMPFixedRetryPolicy has no state
+ * to update, and SNMPAdaptiveRetryPolicy guards its estimates with a mutex;
+ * other implementations must be thread-safe too, or not be shared across
+ * threads.
+ *
+ */
+
+
+#ifndef SNMPRETRYPOLICY_H
+#define SNMPRETRYPOLICY_H
+
+#include <QHash>
+#include <QHostAddress>
+#include <QMutex>
+#include <QVector>
+#include <QtGlobal>
+
+class SNMPRetryPolicy {
+
+public:
+    virtual ~SNMPRetryPolicy();
+
+    // Number of transmissions of a request, the first one included
+    virtual int maxAttempts(const QHostAddress &agent) const = 0;
+
+    // Time to wait after transmission number attempt (0 for the first), in milliseconds
+    virtual int timeout(const QHostAddress &agent, int attempt) const = 0;
+
+    // A response arrived roundTripTime milliseconds after the last transmission
+    virtual void responseReceived(const QHostAddress &agent, int attempt, qint64 roundTripTime);
+
+    // A request used all its attempts without a response
+    virtual void requestTimedOut(const QHostAddress &agent);
+};
+
+class SNMPFixedRetryPolicy : public SNMPRetryPolicy {
+
+public:
+    SNMPFixedRetryPolicy();
+    explicit SNMPFixedRetryPolicy(const QVector<int> &timeouts);
+
+    int maxAttempts(const QHostAddress &agent) const;
+    int timeout(const QHostAddress &agent, int attempt) const;
+
+private:
+    QVector<int> timeouts;
+};
+
+class SNMPAdaptiveRetryPolicy : public SNMPRetryPolicy {
+
+public:
+    SNMPAdaptiveRetryPolicy(int maxAttempts = 3, int initialTimeout = 1000,
+                            int minTimeout = 100, int maxTimeout = 3000);
+
+    int maxAttempts(const QHostAddress &agent) const;
+    int timeout(const QHostAddress &agent, int attempt) const;
+    void responseReceived(const QHostAddress &agent, int attempt, qint64 roundTripTime);
+    void requestTimedOut(const QHostAddress &agent);
+
+    qint64 smoothedRoundTripTime(const QHostAddress &agent) const;
+    qint64 roundTripTimeVariance(const QHostAddress &agent) const;
+
+private:
+    // Jacobson's fixed point: the smoothed round-trip time is kept in 1/8 ms and the
+    // variance in 1/4 ms, so the RFC 6298 gains of 1/8 and 1/4 are shifts
+    struct Estimate {
+        Estimate() : measured(false), smoothed(0), variance(0), backoff(0) {}
+
+        bool measured;
+        qint64 smoothed;
+        qint64 variance;
+        int backoff;
+    };
+
+    int retransmissionTimeout(const QHostAddress &agent) const;
+
+    int attempts;
+    int initialTimeout;
+    int minTimeout;
+    int maxTimeout;
+    mutable QMutex mutex;
+    QHash<QHostAddress, Estimate> estimates;
+};
+
+#endif // SNMPRETRYPOLICY_H
@@ -0,0 +1,127 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class is a bounded, lock-free queue between exactly one producer
+ * thread and one consumer thread.
+ *
+ * The slots form a power-of-two ring. The producer only writes the tail and
+ * the consumer only writes the head, each publishing its index with release
+ * semantics once the slot is filled or emptied; the two indexes sit on their
+ * own cache lines, and each side keeps a private copy of the other's index
+ * so that it only reads the shared one when the ring looks full or empty.
+ *
+ */
+
+
+#ifndef SNMPSPSCQUEUE_H
+#define SNMPSPSCQUEUE_H
+
+#include <QAtomicInteger>
+#include <QtGlobal>
+#include <vector>
+
+template <typename T>
+class SNMPSpscQueue {
+
+public:
+    explicit SNMPSpscQueue(int capacity = 1024);
+
+    bool push(const T &value);
+    bool pop(T &value);
+
+    bool isEmpty() const;
+    int capacity() const { return int(entries.size()); }
+
+private:
+    SNMPSpscQueue(const SNMPSpscQueue &);
+    SNMPSpscQueue &operator=(const SNMPSpscQueue &);
+
+    std::vector<T> entries;
+    quint32 mask;
+
+    // written by the producer
+    alignas(64) QAtomicInteger<quint32> tail;
+    quint32 cachedHead;
+
+    // written by the consumer
+    alignas(64) QAtomicInteger<quint32> head;
+    quint32 cachedTail;
+};
+
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   The capacity is rounded up to a power of two.
+*/
+template <typename T>
+SNMPSpscQueue<T>::SNMPSpscQueue(int capacity)
+        : tail(0), cachedHead(0), head(0), cachedTail(0)
+{
+    int size = 1;
+    while(size < capacity)
+        size <<= 1;
+
+    entries.resize(size);
+    mask = quint32(size - 1);
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   Called by the producer only. Returns false, without copying the value, if the
+*   queue is full.
+*/
+template <typename T>
+bool SNMPSpscQueue<T>::push(const T &value)
+{
+    const quint32 position = tail.loadAcquire();
+
+    if(position - cachedHead == entries.size())
+    {
+        cachedHead = head.loadAcquire();
+        if(position - cachedHead == entries.size())
+            return false;
+    }
+
+    entries[position & mask] = value;
+    tail.storeRelease(position + 1);
+    return true;
+}
+
+/**
+*   Called by the consumer only. Returns false if the queue is empty.
+*/
+template <typename T>
+bool SNMPSpscQueue<T>::pop(T &value)
+{
+    const quint32 position = head.loadAcquire();
+
+    if(position == cachedTail)
+    {
+        cachedTail = tail.loadAcquire();
+        if(position == cachedTail)
+            return false;
+    }
+
+    // leave a default value behind, so the slot does not keep shared data alive
+    T &entry = entries[position & mask];
+    value = entry;
+    entry = T();
+    head.storeRelease(position + 1);
+    return true;
+}
+
+/**
+*   May be called from either side; the answer can be outdated as soon as it is given.
+*/
+template <typename T>
+bool SNMPSpscQueue<T>::isEmpty() const
+{
+    return head.loadAcquire() == tail.loadAcquire();
+}
+
+#endif // SNMPSPSCQUEUE_H
@@ -0,0 +1,205 @@
+#include "snmptimerwheel.h"
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   Deadlines are rounded up to whole ticks of tickInterval milliseconds. The node
+*   pool starts with room for initialCapacity timers and doubles when it runs out.
+*/
+SNMPTimerWheel::SNMPTimerWheel(int tickInterval, int initialCapacity)
+{
+    this->tickInterval = qMax(1, tickInterval);
+    currentTick = 0;
+    count = 0;
+    rootCount = 0;
+    freeNodes = -1;
+    slotHeads.assign(SlotCount + 1, -1);
+    nodes.reserve(qMax(1, initialCapacity));
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will start a timer which expires with the given key once the time
+*   passed to expire() reaches the deadline (both in milliseconds of the same clock).
+*   Returns the timer, to be passed with the same key to cancel().
+*/
+int SNMPTimerWheel::schedule(qint64 deadline, quint32 key)
+{
+    int node = freeNodes;
+    if(node != -1)
+    {
+        freeNodes = nodes[node].next;
+    } else
+    {
+        node = int(nodes.size());
+        nodes.push_back(Node());
+    }
+
+    nodes[node].tick = (deadline + tickInterval - 1) / tickInterval;
+    nodes[node].key = key;
+    count++;
+    place(node);
+    return node;
+}
+
+/**
+*   This method will stop the timer. The key guards against a timer which has
+*   already expired and whose node is in use by a newer timer.
+*   Returns false if the timer was not running.
+*/
+bool SNMPTimerWheel::cancel(int timer, quint32 key)
+{
+    if(timer < 0 || timer >= int(nodes.size()) || nodes[timer].slot == -1 || nodes[timer].key != key)
+        return false;
+
+    release(timer);
+    return true;
+}
+
+void SNMPTimerWheel::clear()
+{
+    nodes.clear();
+    slotHeads.assign(SlotCount + 1, -1);
+    count = 0;
+    rootCount = 0;
+    freeNodes = -1;
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+/**
+*   This method will link the node into the slot its tick falls in, relative to the
+*   current tick. Ticks already passed go to the current one.
+*/
+void SNMPTimerWheel::place(int node)
+{
+    qint64 tick = nodes[node].tick;
+    if(tick < currentTick)
+        tick = currentTick;
+
+    const qint64 distance = tick - currentTick;
+
+    if(distance < RootSlots)
+    {
+        link(node, int(tick & (RootSlots - 1)));
+        return;
+    }
+
+    for(int level = 1; level < Levels; level++)
+    {
+        const int shift = RootBits + level * LevelBits;
+        if(distance < (qint64(1) << shift) || level == Levels - 1)
+        {
+            // beyond the last level, wait in its farthest slot and cascade again later
+            if(distance >= (qint64(1) << shift))
+                tick = currentTick + (qint64(1) << shift) - 1;
+
+            const int index = int((tick >> (shift - LevelBits)) & (LevelSlots - 1));
+            link(node, RootSlots + (level - 1) * LevelSlots + index);
+            return;
+        }
+    }
+}
+
+void SNMPTimerWheel::link(int node, int slot)
+{
+    Node &entry = nodes[node];
+    entry.slot = slot;
+    entry.previous = -1;
+    entry.next = slotHeads[slot];
+    if(entry.next != -1)
+        nodes[entry.next].previous = node;
+    slotHeads[slot] = node;
+
+    if(slot < RootSlots)
+        rootCount++;
+}
+
+void SNMPTimerWheel::unlink(int node)
+{
+    Node &entry = nodes[node];
+    if(entry.previous != -1)
+        nodes[entry.previous].next = entry.next;
+    else
+        slotHeads[entry.slot] = entry.next;
+    if(entry.next != -1)
+        nodes[entry.next].previous = entry.previous;
+
+    if(entry.slot < RootSlots)
+        rootCount--;
+    entry.slot = -1;
+}
+
+void SNMPTimerWheel::release(int node)
+{
+    unlink(node);
+    nodes[node].next = freeNodes;
+    freeNodes = node;
+    count--;
+}
+
+/**
+*   This method will move the timers of a slot of an upper level down to the levels
+*   below it.
+*/
+void SNMPTimerWheel::cascade(int level, int index)
+{
+    const int slot = RootSlots + (level - 1) * LevelSlots + index;
+
+    while(slotHeads[slot] != -1)
+    {
+        const int node = slotHeads[slot];
+        unlink(node);
+        place(node);
+    }
+}
+
+/**
+*   This method will move every timer whose tick is not after the given one to the
+*   expiring list. A first level without timers is skipped a whole turn at a time.
+*/
+void SNMPTimerWheel::advanceTo(qint64 tick)
+{
+    while(currentTick <= tick)
+    {
+        if(count == 0)
+        {
+            currentTick = tick + 1;
+            return;
+        }
+
+        const int index = int(currentTick & (RootSlots - 1));
+
+        if(index == 0)
+        {
+            for(int level = 1; level < Levels; level++)
+            {
+                const int shift = RootBits + (level - 1) * LevelBits;
+                const int levelIndex = int((currentTick >> shift) & (LevelSlots - 1));
+                cascade(level, levelIndex);
+                if(levelIndex != 0)
+                    break;
+            }
+        }
+
+        if(rootCount == 0)
+        {
+            // nothing before the next cascade
+            const qint64 nextTurn = (currentTick | (RootSlots - 1)) + 1;
+            currentTick = qMin(nextTurn, tick + 1);
+            continue;
+        }
+
+        while(slotHeads[index] != -1)
+        {
+            const int node = slotHeads[index];
+            unlink(node);
+            link(node, ExpiringSlot);
+        }
+
+        currentTick++;
+    }
+}
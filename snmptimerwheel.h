@@ -0,0 +1,108 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class keeps the deadlines of the outstanding requests of a session in
+ * a hierarchical timing wheel, so that scheduling, cancelling and expiring a
+ * deadline are O(1) whatever the number of requests.
+ *
+ * Time is counted in ticks of a fixed interval. The first level has one slot
+ * per tick for the next 256 ticks; each of the three upper levels has 64
+ * slots, each covering a whole turn of the level below. When the first level
+ * wraps, the next slot of the level above is cascaded down into it. With
+ * 10 ms ticks the wheel reaches about 7.7 days ahead; later deadlines wait in
+ * the last slot and are cascaded again.
+ *
+ * Timers live in a pool of nodes linked into their slot by index, so a
+ * running wheel does not allocate.
+ *
+ */
+
+
+#ifndef SNMPTIMERWHEEL_H
+#define SNMPTIMERWHEEL_H
+
+#include <QtGlobal>
+#include <vector>
+
+class SNMPTimerWheel {
+
+public:
+    explicit SNMPTimerWheel(int tickInterval = 10, int initialCapacity = 64);
+
+    int schedule(qint64 deadline, quint32 key);
+    bool cancel(int timer, quint32 key);
+    void clear();
+
+    template <typename Function>
+    int expire(qint64 now, Function function);
+
+    int size() const { return count; }
+    bool isEmpty() const { return count == 0; }
+    int getTickInterval() const { return tickInterval; }
+
+private:
+    enum {
+        RootBits = 8,
+        LevelBits = 6,
+        Levels = 4,
+        RootSlots = 1 << RootBits,
+        LevelSlots = 1 << LevelBits,
+        SlotCount = RootSlots + (Levels - 1) * LevelSlots,
+        ExpiringSlot = SlotCount
+    };
+
+    struct Node {
+        qint64 tick;
+        quint32 key;
+        int slot;
+        int previous;
+        int next;
+    };
+
+    void place(int node);
+    void link(int node, int slot);
+    void unlink(int node);
+    void release(int node);
+    void cascade(int level, int index);
+    void advanceTo(qint64 tick);
+
+    int tickInterval;
+    qint64 currentTick;
+    int count;
+    int rootCount;
+    int freeNodes;
+    std::vector<Node> nodes;
+    std::vector<int> slotHeads;
+};
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will call function(key) for every timer whose deadline is not after
+*   now, and release it. The function may schedule and cancel timers, including
+*   the ones which are expiring in the same call.
+*   Returns the number of expired timers.
+*/
+template <typename Function>
+int SNMPTimerWheel::expire(qint64 now, Function function)
+{
+    int expired = 0;
+
+    advanceTo(now / tickInterval);
+
+    while(slotHeads[ExpiringSlot] != -1)
+    {
+        const int node = slotHeads[ExpiringSlot];
+        const quint32 key = nodes[node].key;
+        release(node);
+        expired++;
+        function(key);
+    }
+
+    return expired;
+}
+
+#endif // SNMPTIMERWHEEL_H
@@ -0,0 +1,425 @@
+#include "snmptrapreceiver.h"
+#include <cstring>
+
+// Largest notification accepted, longer datagrams are dropped
+static const int maxDatagramSize = 8192;
+
+// Socket buffer asked for by default, about 30000 typical traps
+static const int defaultSocketReceiveBufferSize = 4 * 1024 * 1024;
+
+// sysUpTime.0 and snmpTrapOID.0, the first two varbinds of a SNMPv2 notification
+static const char sysUpTimeOid[] = "\x2b\x06\x01\x02\x01\x01\x03\x00";
+static const char snmpTrapOid[] = "\x2b\x06\x01\x06\x03\x01\x01\x04\x01\x00";
+
+//----[ SNMPTrapView ]-------------------------------------------------------------------
+
+/**
+*   This method will decode a notification: a SNMPv1 Trap-PDU, or a SNMPv2c
+*   SNMPv2-Trap or InformRequest. The fields which the PDU type does not have are
+*   cleared. The sender is left to the caller.
+*   A SNMPv2 PDU is decoded by SNMPBer::decodePdu and the varbind list of a Trap-PDU
+*   checked by SNMPBer::decodeVarbindList, as the responses of the sessions are:
+*   every varbind is checked, and nothing may follow the varbind list, the PDU or
+*   the message; so once a notification is accepted, nextVarbind() only returns
+*   false at the end of the list.
+*   Returns false for anything else or a malformed message.
+*/
+bool SNMPTrapView::decode(const char *data, int size)
+{
+    SNMPBerReader reader(data, size);
+    SNMPBerReader message, pdu;
+    SNMPBerElement pduElement, element;
+    qint64 value;
+    quint64 unsignedValue;
+
+    requestId = 0;
+    enterprise.type = 0;
+    enterprise.value = NULL;
+    enterprise.length = 0;
+    agentAddress = 0;
+    genericTrap = 0;
+    specificTrap = 0;
+    timeStamp = 0;
+    trapOid = enterprise;
+
+    if(!reader.enter(message) || !reader.atEnd() || !message.readInteger(version)
+       || !message.next(community, SNMPBer::OctetString) || !message.next(pduElement)
+       || !message.atEnd())
+        return false;
+
+    pduType = pduElement.type;
+    pdu = SNMPBerReader(pduElement);
+
+    if(pduType == SNMPBer::Trap)
+    {
+        if(version != SNMPBer::Version1)
+            return false;
+
+// include Enterprise and Agent Address fields
+        if(!pdu.next(enterprise, SNMPBer::ObjectIdentifier)
+           || !pdu.next(element, SNMPBer::IpAddress) || element.length != 4)
+            return false;
+        agentAddress = (quint32(quint8(element.value[0])) << 24) | (quint32(quint8(element.value[1])) << 16)
+                       | (quint32(quint8(element.value[2])) << 8) | quint32(quint8(element.value[3]));
+
+// include Generic Trap and Specific Trap fields
+        if(!pdu.readInteger(value) || value < 0 || value > 6)
+            return false;
+        genericTrap = int(value);
+
+        if(!pdu.readInteger(value) || value < -2147483648LL || value > 2147483647LL)
+            return false;
+        specificTrap = int(value);
+
+// include Time Stamp field
+        if(!pdu.next(element, SNMPBer::TimeTicks) || !SNMPBerReader::toUnsigned(element, unsignedValue)
+           || unsignedValue > 0xFFFFFFFFu)
+            return false;
+        timeStamp = quint32(unsignedValue);
+
+// include Varbind List field
+        if(!pdu.next(varbindList, SNMPBer::Sequence) || !pdu.atEnd()
+           || SNMPBer::decodeVarbindList(varbindList.value, varbindList.length) != SNMPBer::DecodeOk)
+            return false;
+        varbinds = SNMPBerReader(varbindList);
+        return true;
+    }
+
+    if(version != SNMPBer::Version2c || (pduType != SNMPBer::SNMPv2Trap && pduType != SNMPBer::InformRequest))
+        return false;
+
+    // the PDU follows the community and ends the message
+    SNMPMessageView notification;
+    const char *pduStart = community.value + community.length;
+    if(SNMPBer::decodePdu(pduStart, int(pduElement.value + pduElement.length - pduStart), notification)
+       != SNMPBer::DecodeOk)
+        return false;
+    requestId = notification.requestId;
+
+    // skip the request ID, error status and error index to keep the list for acknowledge()
+    pdu.readInteger(value);
+    pdu.readInteger(value);
+    pdu.readInteger(value);
+    pdu.next(varbindList);
+    varbinds = notification.varbinds;
+
+    // pick sysUpTime.0 and snmpTrapOID.0 out of the first two varbinds
+    SNMPVarbindView varbind;
+    for(int i = 0; i < 2 && nextVarbind(varbind); i++)
+    {
+        if(varbind.oid.length == int(sizeof(sysUpTimeOid)) - 1
+           && memcmp(varbind.oid.value, sysUpTimeOid, varbind.oid.length) == 0
+           && varbind.value.type == SNMPBer::TimeTicks
+           && SNMPBerReader::toUnsigned(varbind.value, unsignedValue) && unsignedValue <= 0xFFFFFFFFu)
+            timeStamp = quint32(unsignedValue);
+        else if(varbind.oid.length == int(sizeof(snmpTrapOid)) - 1
+                && memcmp(varbind.oid.value, snmpTrapOid, varbind.oid.length) == 0
+                && varbind.value.type == SNMPBer::ObjectIdentifier)
+            trapOid = varbind.value;
+    }
+    varbinds = notification.varbinds;
+
+    return true;
+}
+
+/**
+*   This method will return the next varbind of the notification, starting with
+*   the first one. Returns false at the end of the list; decode() has checked
+*   every varbind.
+*/
+bool SNMPTrapView::nextVarbind(SNMPVarbindView &varbind)
+{
+    SNMPBerReader sequence;
+
+    return varbinds.enter(sequence)
+           && sequence.next(varbind.oid, SNMPBer::ObjectIdentifier)
+           && sequence.next(varbind.value);
+}
+
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   Up to batchSize notifications are received with one system call and delivered
+*   with one signal.
+*/
+SNMPTrapReceiver::SNMPTrapReceiver(int batchSize, QObject *parent)
+        : QObject(parent)
+{
+    this->batchSize = qMax(1, batchSize);
+    this->socketReceiveBufferSize = defaultSocketReceiveBufferSize;
+    this->transport = NULL;
+    this->udpSocket = NULL;
+    batch.reserve(this->batchSize);
+    resetStatistics();
+}
+
+SNMPTrapReceiver::~SNMPTrapReceiver()
+{
+    close();
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will start listening for notifications on the given UDP port, on
+*   all addresses. Ports below 1024 need the matching privilege.
+*   Returns false if the port cannot be bound.
+*/
+bool SNMPTrapReceiver::listen(quint16 port)
+{
+    close();
+
+    if(SNMPDatagramTransport::isSupported())
+    {
+        transport = new SNMPDatagramTransport(batchSize, maxDatagramSize, this);
+        if(transport->bind(port))
+        {
+            transport->setSocketReceiveBufferSize(socketReceiveBufferSize);
+            connect(transport, &SNMPDatagramTransport::readyRead,
+                    this, &SNMPTrapReceiver::readBatchedDatagrams);
+            return true;
+        }
+
+        delete transport;
+        transport = NULL;
+    }
+
+    udpSocket = new QUdpSocket(this);
+    if(!udpSocket->bind(QHostAddress::Any, port))
+    {
+        delete udpSocket;
+        udpSocket = NULL;
+        return false;
+    }
+
+    udpSocket->setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, socketReceiveBufferSize);
+    receiveBuffer.resize(batchSize * maxDatagramSize);
+    connect(udpSocket, &QUdpSocket::readyRead, this, &SNMPTrapReceiver::readPendingDatagrams);
+    return true;
+}
+
+/**
+*   This method will stop listening. It may be called while a batch is delivered:
+*   the sockets are deleted once control is back in the event loop.
+*/
+void SNMPTrapReceiver::close()
+{
+    if(transport)
+    {
+        transport->close();
+        transport->deleteLater();
+        transport = NULL;
+    }
+
+    if(udpSocket)
+    {
+        udpSocket->close();
+        udpSocket->deleteLater();
+        udpSocket = NULL;
+    }
+}
+
+bool SNMPTrapReceiver::isListening() const
+{
+    return transport || udpSocket;
+}
+
+/**
+*   Returns the port the receiver listens on, the one chosen by the system if listen()
+*   was given 0.
+*/
+quint16 SNMPTrapReceiver::getLocalPort() const
+{
+    if(transport)
+        return transport->localPort();
+    return udpSocket ? udpSocket->localPort() : 0;
+}
+
+QStringList SNMPTrapReceiver::getCommunities() const
+{
+    QStringList list;
+    for(int i = 0; i < communities.size(); i++)
+        list.append(QString::fromLatin1(communities[i]));
+    return list;
+}
+
+/**
+*   Only notifications with one of these community strings are delivered (and
+*   acknowledged); all of them are when the list is empty, as by default.
+*/
+void SNMPTrapReceiver::setCommunities(const QStringList &communities)
+{
+    this->communities.clear();
+    for(int i = 0; i < communities.size(); i++)
+        this->communities.append(communities[i].toLatin1());
+}
+
+int SNMPTrapReceiver::getSocketReceiveBufferSize() const
+{
+    return socketReceiveBufferSize;
+}
+
+/**
+*   Sets how many bytes of notifications the kernel may hold while the receiver is
+*   busy, 4 MB by default. Takes effect with the next listen().
+*/
+void SNMPTrapReceiver::setSocketReceiveBufferSize(int bytes)
+{
+    this->socketReceiveBufferSize = bytes;
+}
+
+/**
+*   Returns the number of datagrams dropped because they were longer than the
+*   receive buffers. Datagrams the kernel dropped because its buffer was full are
+*   not known here.
+*/
+quint64 SNMPTrapReceiver::getDroppedDatagrams() const
+{
+    return transport ? transport->getDatagramsDropped() : 0;
+}
+
+void SNMPTrapReceiver::resetStatistics()
+{
+    receivedCount = 0;
+    acknowledgedCount = 0;
+    malformedCount = 0;
+    rejectedCount = 0;
+    if(transport)
+        transport->resetStatistics();
+}
+
+
+//----[ Private slots ]------------------------------------------------------------------
+
+/**
+*   Drains the socket one ring of datagrams at a time. Each ring is decoded in place,
+*   its informs acknowledged with one flush, and delivered as one batch.
+*/
+void SNMPTrapReceiver::readBatchedDatagrams()
+{
+    QHostAddress sender;
+    quint16 senderPort;
+
+    do
+    {
+        const int count = transport->receive();
+        for(int i = 0; i < count; i++)
+        {
+            if(transport->datagramSender(i, &sender, &senderPort))
+                acceptDatagram(transport->datagramData(i), transport->datagramSize(i), sender, senderPort);
+        }
+
+        transport->flush();
+        deliverBatch();
+    } while(transport && transport->hasPendingDatagrams());
+}
+
+/**
+*   The same for the QUdpSocket used where batching is not supported, with the
+*   datagrams of a batch read into consecutive receive buffers.
+*/
+void SNMPTrapReceiver::readPendingDatagrams()
+{
+    QHostAddress sender;
+    quint16 senderPort;
+
+    while(udpSocket && udpSocket->hasPendingDatagrams())
+    {
+        for(int i = 0; i < batchSize && udpSocket->hasPendingDatagrams(); i++)
+        {
+            char *data = receiveBuffer.data() + i * maxDatagramSize;
+            const qint64 size = udpSocket->readDatagram(data, maxDatagramSize, &sender, &senderPort);
+            if(size >= 0)
+                acceptDatagram(data, int(size), sender, senderPort);
+        }
+
+        deliverBatch();
+    }
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+/**
+*   This method will decode a datagram into the batch, and acknowledge it if it is
+*   an InformRequest. A datagram is only acknowledged once it has been decoded in
+*   full, varbinds included; a malformed one is counted and dropped.
+*/
+void SNMPTrapReceiver::acceptDatagram(const char *data, int size, const QHostAddress &sender, quint16 senderPort)
+{
+    batch.resize(batch.size() + 1);
+    SNMPTrapView &notification = batch.last();
+
+    if(!notification.decode(data, size))
+    {
+        malformedCount++;
+        batch.removeLast();
+        return;
+    }
+
+    if(!isAcceptedCommunity(notification.community))
+    {
+        rejectedCount++;
+        batch.removeLast();
+        return;
+    }
+
+    notification.sender = sender;
+    notification.senderPort = senderPort;
+    receivedCount++;
+
+    if(notification.pduType == SNMPBer::InformRequest)
+        acknowledge(notification);
+}
+
+bool SNMPTrapReceiver::isAcceptedCommunity(const SNMPBerElement &community) const
+{
+    if(communities.isEmpty())
+        return true;
+
+    for(int i = 0; i < communities.size(); i++)
+    {
+        if(communities[i].size() == community.length
+           && memcmp(communities[i].constData(), community.value, community.length) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+*   This method will answer the inform with a Response carrying the same request ID
+*   and varbinds, as RFC 3416 asks. The varbind list is copied as received, which
+*   decode() has checked varbind by varbind. On the batched transport it goes out with the
+*   next flush.
+*/
+void SNMPTrapReceiver::acknowledge(const SNMPTrapView &inform)
+{
+    encoder.reset();
+
+// include Varbind List field
+    encoder.writeRaw(inform.varbindList.value, inform.varbindList.length);
+    encoder.writeMessageHeader(int(inform.version),
+                               QByteArray::fromRawData(inform.community.value, inform.community.length),
+                               SNMPBer::GetResponse, inform.requestId);
+
+    if(transport)
+        transport->queueDatagram(encoder.data(), encoder.size(), inform.sender, inform.senderPort);
+    else
+        udpSocket->writeDatagram(encoder.data(), encoder.size(), inform.sender, inform.senderPort);
+    acknowledgedCount++;
+}
+
+/**
+*   This method will hand the batch to the subscribers and empty it.
+*/
+void SNMPTrapReceiver::deliverBatch()
+{
+    if(batch.isEmpty())
+        return;
+
+    emit notificationsReceived(batch);
+    batch.resize(0);
+}
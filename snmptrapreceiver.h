@@ -0,0 +1,116 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The classes receive SNMP notifications: SNMPv1 Trap-PDUs, SNMPv2-Trap PDUs
+ * and InformRequests, which are acknowledged with a Response as soon as they
+ * are decoded and checked in full. Malformed datagrams are counted and dropped,
+ * never acknowledged.
+ *
+ * SNMPTrapReceiver listens on a UDP port (162 by default) and is built for
+ * trap storms. On Linux the datagrams are drained from the kernel by the
+ * batch through the receive ring of a SNMPDatagramTransport, whose socket
+ * buffer is enlarged to absorb bursts; the acknowledgements of a batch go
+ * out with one sendmmsg call. Every batch is decoded in place into
+ * SNMPTrapViews and handed to the subscribers with a single signal, so the
+ * datagrams are neither copied nor signalled one by one.
+ *
+ * The views point into the receive ring, which is reused for the next
+ * batch: connect to notificationsReceived with a direct connection, and
+ * copy what must be kept.
+ *
+ */
+
+
+#ifndef SNMPTRAPRECEIVER_H
+#define SNMPTRAPRECEIVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHostAddress>
+#include <QStringList>
+#include <QUdpSocket>
+#include <QVector>
+#include "snmpber.h"
+#include "snmpdatagramtransport.h"
+
+class SNMPTrapView {
+
+public:
+    bool decode(const char *data, int size);
+    bool nextVarbind(SNMPVarbindView &varbind);
+
+    qint64 version;
+    SNMPBerElement community;
+    int pduType;                // SNMPBer::Trap, SNMPv2Trap or InformRequest
+    quint32 requestId;          // SNMPv2-Trap and InformRequest only
+    SNMPBerElement enterprise;  // Trap-PDU only
+    quint32 agentAddress;       // Trap-PDU only
+    int genericTrap;            // Trap-PDU only
+    int specificTrap;           // Trap-PDU only
+    quint32 timeStamp;          // time-stamp, or the sysUpTime.0 varbind of a SNMPv2 notification
+    SNMPBerElement trapOid;     // the snmpTrapOID.0 varbind of a SNMPv2 notification
+    SNMPBerElement varbindList;
+    SNMPBerReader varbinds;
+
+    QHostAddress sender;
+    quint16 senderPort;
+};
+
+class SNMPTrapReceiver : public QObject {
+
+    Q_OBJECT
+
+public:
+    explicit SNMPTrapReceiver(int batchSize = 256, QObject *parent = 0);
+    ~SNMPTrapReceiver();
+
+    bool listen(quint16 port = 162);
+    void close();
+    bool isListening() const;
+    quint16 getLocalPort() const;
+
+// get/set methods
+    QStringList getCommunities() const;
+    void setCommunities(const QStringList &communities);
+    int getSocketReceiveBufferSize() const;
+    void setSocketReceiveBufferSize(int bytes);
+
+// statistics
+    quint64 getNotificationsReceived() const { return receivedCount; }
+    quint64 getInformsAcknowledged() const { return acknowledgedCount; }
+    quint64 getMalformedDatagrams() const { return malformedCount; }
+    quint64 getRejectedDatagrams() const { return rejectedCount; }
+    quint64 getDroppedDatagrams() const;
+    void resetStatistics();
+
+signals:
+    void notificationsReceived(const QVector<SNMPTrapView> &notifications);
+
+private slots:
+    void readBatchedDatagrams();
+    void readPendingDatagrams();
+
+private:
+    void acceptDatagram(const char *data, int size, const QHostAddress &sender, quint16 senderPort);
+    bool isAcceptedCommunity(const SNMPBerElement &community) const;
+    void acknowledge(const SNMPTrapView &inform);
+    void deliverBatch();
+
+    int batchSize;
+    int socketReceiveBufferSize;
+    SNMPDatagramTransport *transport;
+    QUdpSocket *udpSocket;
+    QByteArray receiveBuffer;
+    QVector<QByteArray> communities;
+    QVector<SNMPTrapView> batch;
+    SNMPBerWriter encoder;
+
+    quint64 receivedCount;
+    quint64 acknowledgedCount;
+    quint64 malformedCount;
+    quint64 rejectedCount;
+};
+
+#endif // SNMPTRAPRECEIVER_H
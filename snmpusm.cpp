@@ -0,0 +1,483 @@
+#include "snmpusm.h"
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+#include <string.h>
+
+// msgFlags bits
+static const int authFlag = 0x01;
+static const int privFlag = 0x02;
+static const int reportableFlag = 0x04;
+
+// msgSecurityModel of USM
+static const int securityModelUsm = 3;
+
+// msgMaxSize we announce: the largest UDP payload, which SNMPSession can receive
+static const int maxMessageSize = 65507;
+
+// Length of msgAuthenticationParameters with HMAC-SHA-96, and of the AES salt
+static const int authParametersSize = 12;
+static const int saltSize = 8;
+
+// Seconds a message may lag behind the engine time we know (RFC 3414 section 3.2.7)
+static const qint64 timeWindow = 150;
+
+// Longest engine ID (RFC 3411 SnmpEngineID), for SNMPUsm::messageOverhead
+static const int maxEngineIdSize = 32;
+
+// Bytes of password hashed into a key (RFC 3414 section A.2)
+static const int passwordExpansion = 1048576;
+
+// The usmStats counters an agent reports errors with: 1.3.6.1.6.3.15.1.1.<n>.0
+static const char usmStatsPrefix[] = { 0x2B, 0x06, 0x01, 0x06, 0x03, 0x0F, 0x01, 0x01 };
+static const int usmStatsNotInTimeWindows = 2;
+static const int usmStatsUnknownEngineIds = 4;
+
+// Keys shared by every SNMPUsm: password -> Ku, and password + engine ID -> localized key
+static const int keyCacheSize = 1024;
+static QMutex keyCacheMutex;
+static QCache<QByteArray, QByteArray> masterKeys(keyCacheSize);
+static QCache<QByteArray, QByteArray> localizedKeys(keyCacheSize);
+
+static inline void writeBigEndian(quint64 value, int bytes, char *data)
+{
+    for(int i = bytes - 1; i >= 0; i--, value >>= 8)
+        data[i] = char(value);
+}
+
+// Compares a received field with bytes of ours, without wrapping it into a QByteArray
+static inline bool equals(const SNMPBerElement &field, const QByteArray &bytes)
+{
+    return field.length == bytes.size() && memcmp(field.value, bytes.constData(), field.length) == 0;
+}
+
+//----[ Constructors ]-------------------------------------------------------------------
+
+SNMPUsm::SNMPUsm()
+{
+    this->engineBoots = 0;
+    this->engineTimeAtSync = 0;
+    this->discovered = false;
+    this->salt = QRandomGenerator::global()->generate64();
+    syncClock.start();
+}
+
+
+//----[ Get/Set methods ]----------------------------------------------------------------
+
+QByteArray SNMPUsm::getUserName() const
+{
+    return userName;
+}
+
+/**
+*   Sets the user messages are sent as. The security level follows from the passwords:
+*   noAuthNoPriv without an authentication password, authNoPriv without a privacy
+*   password, authPriv with both. The keys are localized again for the current engine.
+*/
+void SNMPUsm::setUser(const QByteArray &userName, const QByteArray &authPassword,
+                      const QByteArray &privPassword)
+{
+    this->userName = userName;
+    this->authPassword = authPassword;
+    this->privPassword = authPassword.isEmpty() ? QByteArray() : privPassword;
+
+    if(discovered)
+        localizeKeys();
+}
+
+/**
+*   Returns true once the engine ID of the agent is known and messages can be sent.
+*/
+bool SNMPUsm::isDiscovered() const
+{
+    return discovered;
+}
+
+QByteArray SNMPUsm::getEngineId() const
+{
+    return engineId;
+}
+
+/**
+*   Returns an upper bound for the bytes a SNMPv3 message adds to its PDU: the header
+*   data, the security parameters and the scoped PDU header.
+*/
+int SNMPUsm::messageOverhead() const
+{
+    return 96 + 2 * maxEngineIdSize + userName.size();
+}
+
+
+//----[ Message methods ]----------------------------------------------------------------
+
+/**
+*   This method will encode the discovery probe of RFC 3414 section 4: an empty
+*   unauthenticated get-request, which the agent answers with a report carrying its
+*   engine ID, boots and time. encoder is reset first, and holds the datagram after.
+*   messageId must be in the msgID range of RFC 3412, 0 to 2^31 - 1.
+*/
+void SNMPUsm::encodeDiscovery(SNMPBerWriter &encoder, quint32 messageId)
+{
+    encoder.reset();
+    encoder.writePduHeader(SNMPBer::GetRequest, messageId);
+
+// include Context Name and Context Engine ID fields
+    encoder.writeOctetString(QByteArray());
+    encoder.writeOctetString(QByteArray());
+    encoder.endConstructed(0, SNMPBer::Sequence);
+
+    finishMessage(encoder, messageId, reportableFlag, QByteArray(), QByteArray());
+}
+
+/**
+*   This method will wrap the PDU the encoder holds into a SNMPv3 message for the
+*   discovered engine, encrypted and authenticated as the user's level requires.
+*   The encoder holds the datagram after. messageId must be in the msgID range of
+*   RFC 3412, 0 to 2^31 - 1.
+*/
+void SNMPUsm::encode(SNMPBerWriter &encoder, quint32 messageId)
+{
+    const int flags = securityFlags() | reportableFlag;
+
+// include Context Name and Context Engine ID fields
+    encoder.writeOctetString(QByteArray());
+    encoder.writeOctetString(engineId);
+    encoder.endConstructed(0, SNMPBer::Sequence);
+
+    finishMessage(encoder, messageId, flags, engineId, userName);
+}
+
+/**
+*   This method will check and unwrap a SNMPv3 message and decode its PDU into message.
+*   Authenticated messages must carry a valid HMAC from our user and lie in the time
+*   window of the engine; a reply must have at least the security level of our requests.
+*   The discovery report and reports of a message outside the time window update the
+*   engine and return Resynchronized; other reports return ReportReceived, with the
+*   request ID of the reported request in message, or 0 when the agent could not read
+*   the PDU. messageId, if not NULL, receives the message ID of any message whose
+*   header could be read, which for a report is the one of the reported message.
+*/
+SNMPUsm::DecodeStatus SNMPUsm::decode(const char *data, int size, SNMPMessageView &message,
+                                      quint32 *messageId)
+{
+    SNMPBerReader datagram(data, size), content, header, wrapper, parameters;
+    SNMPBerElement flagsField, securityParameters, engineIdField, userField, authField, privField, scopedData;
+    qint64 version, messageIdField, peerMaxSize, securityModel, boots, time;
+
+// include Message, Version and Header Data fields
+    if(!datagram.enter(content) || !datagram.atEnd()
+       || !content.readInteger(version) || version != SNMPBer::Version3
+       || !content.enter(header)
+       || !header.readInteger(messageIdField) || !header.readInteger(peerMaxSize)
+       || !header.next(flagsField, SNMPBer::OctetString) || flagsField.length != 1
+       || !header.readInteger(securityModel) || securityModel != securityModelUsm || !header.atEnd())
+        return Rejected;
+
+    if(messageId)
+        *messageId = quint32(messageIdField);
+
+    const int flags = quint8(flagsField.value[0]);
+    if((flags & privFlag) && !(flags & authFlag))
+        return Rejected;
+
+// include Security Parameters field
+    if(!content.next(securityParameters, SNMPBer::OctetString))
+        return Rejected;
+
+    wrapper = SNMPBerReader(securityParameters);
+    if(!wrapper.enter(parameters) || !wrapper.atEnd()
+       || !parameters.next(engineIdField, SNMPBer::OctetString)
+       || !parameters.readInteger(boots) || boots < 0 || boots > 0x7fffffff
+       || !parameters.readInteger(time) || time < 0 || time > 0x7fffffff
+       || !parameters.next(userField, SNMPBer::OctetString)
+       || !parameters.next(authField, SNMPBer::OctetString)
+       || !parameters.next(privField, SNMPBer::OctetString) || !parameters.atEnd())
+        return Rejected;
+
+// include Scoped PDU field, plain or encrypted
+    if(!content.next(scopedData, (flags & privFlag) ? SNMPBer::OctetString : SNMPBer::Sequence)
+       || !content.atEnd())
+        return Rejected;
+
+    if(flags & authFlag)
+    {
+        if(!discovered || authPassword.isEmpty() || !equals(engineIdField, engineId)
+           || !equals(userField, userName) || authField.length != authParametersSize)
+            return Rejected;
+
+        // the MAC is computed with the authentication parameters zeroed
+        static const char zeros[authParametersSize] = {};
+        const char *authEnd = authField.value + authParametersSize;
+        char mac[SNMPSha1::DigestSize];
+        hmac.start();
+        hmac.addData(data, int(authField.value - data));
+        hmac.addData(zeros, authParametersSize);
+        hmac.addData(authEnd, int(data + size - authEnd));
+        hmac.result(mac);
+
+        char difference = 0;
+        for(int i = 0; i < authParametersSize; i++)
+            difference |= char(mac[i] ^ authField.value[i]);
+        if(difference)
+            return Rejected;
+
+        const qint64 localTime = engineTime();
+        if(engineBoots == 0x7fffffff || boots < engineBoots
+           || (boots == engineBoots && time + timeWindow < localTime))
+            return Rejected;
+        if(boots > engineBoots || time > localTime)
+            setEngine(engineId, boots, time);
+    }
+
+    if(flags & privFlag)
+    {
+        if(privPassword.isEmpty() || privField.length != saltSize)
+            return Rejected;
+
+        char iv[SNMPAes128::BlockSize];
+        writeBigEndian(quint64(boots), 4, iv);
+        writeBigEndian(quint64(time), 4, iv + 4);
+        memcpy(iv + 8, privField.value, saltSize);
+
+        resizePrivacyBuffer(scopedData.length);
+        aes.decryptCfb(iv, scopedData.value, privacyBuffer.data(), scopedData.length);
+
+        // a cipher with padding may leave bytes after the scoped PDU
+        SNMPBerReader plaintext(privacyBuffer.constData(), privacyBuffer.size());
+        if(!plaintext.next(scopedData, SNMPBer::Sequence))
+            return Rejected;
+    }
+
+// include Context Engine ID, Context Name and PDU fields
+    SNMPBerReader scoped(scopedData);
+    SNMPBerElement contextEngineId;
+    if(!scoped.next(contextEngineId, SNMPBer::OctetString)
+       || !scoped.next(message.community, SNMPBer::OctetString))
+        return Rejected;
+
+    const char *pdu = message.community.value + message.community.length;
+    if(SNMPBer::decodePdu(pdu, int(scopedData.value + scopedData.length - pdu), message) != SNMPBer::DecodeOk)
+        return Rejected;
+    message.version = version;
+
+    if(message.pduType != SNMPBer::Report)
+        return (flags & securityFlags()) == securityFlags() ? Accepted : Rejected;
+
+// include the usmStats counter of the report
+    SNMPMessageView report = message;
+    SNMPVarbindView varbind;
+    int counter = 0;
+    if(report.nextVarbind(varbind) && varbind.oid.length == int(sizeof(usmStatsPrefix)) + 2
+       && memcmp(varbind.oid.value, usmStatsPrefix, sizeof(usmStatsPrefix)) == 0
+       && varbind.oid.value[sizeof(usmStatsPrefix) + 1] == 0)
+        counter = varbind.oid.value[sizeof(usmStatsPrefix)];
+
+    // the discovery report is not authenticated, so it is only taken before discovery
+    if(counter == usmStatsUnknownEngineIds && !discovered && engineIdField.length > 0)
+    {
+        setEngine(QByteArray(engineIdField.value, engineIdField.length), boots, time);
+        return Resynchronized;
+    }
+
+    // only an authentic report may move the clock, and it was moved above
+    if(counter == usmStatsNotInTimeWindows && (flags & authFlag))
+    {
+        setEngine(engineId, boots, time);
+        return Resynchronized;
+    }
+
+    return ReportReceived;
+}
+
+/**
+*   Returns the key of a password (RFC 3414 section A.2.2): the SHA-1 of the password
+*   repeated over a megabyte. The key is computed once per password and kept in a
+*   cache shared by all threads. Returns an empty key for an empty password.
+*/
+QByteArray SNMPUsm::passwordToKey(const QByteArray &password)
+{
+    if(password.isEmpty())
+        return QByteArray();
+
+    {
+        QMutexLocker locker(&keyCacheMutex);
+        if(const QByteArray *key = masterKeys.object(password))
+            return *key;
+    }
+
+    char block[SNMPSha1::BlockSize];
+    SNMPSha1 sha;
+    int index = 0;
+    for(int count = 0; count < passwordExpansion; count += SNMPSha1::BlockSize)
+    {
+        for(int i = 0; i < SNMPSha1::BlockSize; i++)
+            block[i] = password.at(index++ % password.size());
+        sha.addData(block, SNMPSha1::BlockSize);
+    }
+
+    const QByteArray key = sha.result();
+    QMutexLocker locker(&keyCacheMutex);
+    masterKeys.insert(password, new QByteArray(key));
+    return key;
+}
+
+/**
+*   Returns the key of a password localized to an engine (RFC 3414 section A.2.2):
+*   SHA-1 of Ku, engine ID, Ku. Cached like SNMPUsm::passwordToKey.
+*/
+QByteArray SNMPUsm::localizeKey(const QByteArray &password, const QByteArray &engineId)
+{
+    if(password.isEmpty())
+        return QByteArray();
+
+    QByteArray cacheKey = password;
+    cacheKey.append('\0');
+    cacheKey.append(engineId);
+    {
+        QMutexLocker locker(&keyCacheMutex);
+        if(const QByteArray *key = localizedKeys.object(cacheKey))
+            return *key;
+    }
+
+    const QByteArray masterKey = passwordToKey(password);
+    SNMPSha1 sha;
+    sha.addData(masterKey);
+    sha.addData(engineId);
+    sha.addData(masterKey);
+
+    const QByteArray key = sha.result();
+    QMutexLocker locker(&keyCacheMutex);
+    localizedKeys.insert(cacheKey, new QByteArray(key));
+    return key;
+}
+
+
+//----[ Private methods ]----------------------------------------------------------------
+
+/**
+*   This method will take the engine ID, boots and time of the agent, and localize
+*   the keys when the engine ID is new.
+*/
+void SNMPUsm::setEngine(const QByteArray &engineId, qint64 boots, qint64 time)
+{
+    const bool newEngine = !discovered || engineId != this->engineId;
+
+    this->engineId = engineId;
+    this->engineBoots = boots;
+    this->engineTimeAtSync = time;
+    this->discovered = true;
+    syncClock.restart();
+
+    if(newEngine)
+        localizeKeys();
+}
+
+/**
+*   This method will key the HMAC and the cipher with the user's passwords localized
+*   to the current engine ID.
+*/
+void SNMPUsm::localizeKeys()
+{
+    hmac.setKey(localizeKey(authPassword, engineId));
+
+    const QByteArray privKey = localizeKey(privPassword, engineId);
+    if(privKey.size() >= SNMPAes128::KeySize)
+        aes.setKey(privKey.constData());
+}
+
+/**
+*   Returns the msgFlags bits of the user's security level.
+*/
+int SNMPUsm::securityFlags() const
+{
+    return (authPassword.isEmpty() ? 0 : authFlag) | (privPassword.isEmpty() ? 0 : privFlag);
+}
+
+/**
+*   Returns the current time of the engine as we estimate it: its time at the last
+*   synchronization plus the seconds elapsed since.
+*/
+qint64 SNMPUsm::engineTime() const
+{
+    return qMin(engineTimeAtSync + syncClock.elapsed() / 1000, qint64(0x7fffffff));
+}
+
+/**
+*   This method will wrap the scoped PDU the encoder holds: encrypt it when the flags
+*   ask for privacy, then write the security parameters, the header data and the
+*   version, and patch the MAC into the finished message when they ask for
+*   authentication. The message is left in the encoder.
+*/
+void SNMPUsm::finishMessage(SNMPBerWriter &encoder, quint32 messageId, int flags,
+                            const QByteArray &engineId, const QByteArray &userName)
+{
+    const qint64 boots = engineId.isEmpty() ? 0 : engineBoots;
+    const qint64 time = engineId.isEmpty() ? 0 : engineTime();
+    char privParameters[saltSize];
+
+    if(flags & privFlag)
+    {
+        salt++;
+        writeBigEndian(salt, saltSize, privParameters);
+
+        char iv[SNMPAes128::BlockSize];
+        writeBigEndian(quint64(boots), 4, iv);
+        writeBigEndian(quint64(time), 4, iv + 4);
+        memcpy(iv + 8, privParameters, saltSize);
+
+        const int size = encoder.size();
+        resizePrivacyBuffer(size);
+        aes.encryptCfb(iv, encoder.data(), privacyBuffer.data(), size);
+
+// include Encrypted PDU field
+        encoder.reset();
+        encoder.writeOctetString(privacyBuffer.constData(), size);
+    }
+
+// include Security Parameters field
+    static const char zeros[authParametersSize] = {};
+    const int parametersEnd = encoder.mark();
+    encoder.writeOctetString(privParameters, (flags & privFlag) ? saltSize : 0);
+    const int authEnd = encoder.mark();
+    encoder.writeOctetString(zeros, (flags & authFlag) ? authParametersSize : 0);
+    encoder.writeOctetString(userName);
+    encoder.writeInteger(time);
+    encoder.writeInteger(boots);
+    encoder.writeOctetString(engineId);
+    encoder.endConstructed(parametersEnd, SNMPBer::Sequence);
+    encoder.endConstructed(parametersEnd, SNMPBer::OctetString);
+
+// include Header Data field
+    const int headerEnd = encoder.mark();
+    encoder.writeInteger(securityModelUsm);
+    const char flagsByte = char(flags);
+    encoder.writeOctetString(&flagsByte, 1);
+    encoder.writeInteger(maxMessageSize);
+    encoder.writeInteger(messageId);
+    encoder.endConstructed(headerEnd, SNMPBer::Sequence);
+
+// include SNMP version, and finish with the SNMP Message length and type code
+    encoder.writeInteger(SNMPBer::Version3);
+    encoder.endConstructed(0, SNMPBer::Sequence);
+
+    if(flags & authFlag)
+    {
+        char mac[SNMPSha1::DigestSize];
+        hmac.start();
+        hmac.addData(encoder.data(), encoder.size());
+        hmac.result(mac);
+        memcpy(encoder.data() + encoder.size() - authEnd - authParametersSize, mac, authParametersSize);
+    }
+}
+
+/**
+*   This method will size the buffer for encrypting or decrypting a scoped PDU. Its
+*   capacity is reserved, so it is not given back when a smaller PDU follows a larger one.
+*/
+void SNMPUsm::resizePrivacyBuffer(int size)
+{
+    privacyBuffer.reserve(qMax(size, privacyBuffer.capacity()));
+    privacyBuffer.resize(size);
+}
@@ -0,0 +1,83 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The SNMPv3 User-based Security Model (RFC 3414) on the side of a command
+ * generator: HMAC-SHA-96 authentication, AES-128 privacy (RFC 3826), the
+ * discovery of the agent's engine ID and the synchronization with its
+ * boots and time counters.
+ *
+ * SNMPUsm wraps PDUs encoded by SNMPBerWriter into SNMPv3 messages and
+ * unwraps the replies for SNMPMessageView. The expensive part of USM, turning
+ * a password into a key (a megabyte of SHA-1), is done once per password and
+ * engine ID and shared by every SNMPUsm in the process; the HMAC and the AES
+ * key schedule are set up once per engine ID, so a message only costs its own
+ * hashing and encryption.
+ *
+ */
+
+
+#ifndef SNMPUSM_H
+#define SNMPUSM_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include "snmpber.h"
+#include "snmpcrypto.h"
+
+class SNMPUsm {
+
+public:
+    // Outcome of unwrapping a received message, see SNMPUsm::decode
+    enum DecodeStatus {
+        Accepted,           // a PDU for the caller, in the message view
+        Resynchronized,     // a report which taught us the engine ID or time; resend pending requests
+        ReportReceived,     // an error report for the request ID in the message view
+        Rejected            // malformed, not authentic, or outside the time window
+    };
+
+    SNMPUsm();
+
+// get/set methods
+    QByteArray getUserName() const;
+    void setUser(const QByteArray &userName, const QByteArray &authPassword,
+                 const QByteArray &privPassword);
+    bool isDiscovered() const;
+    QByteArray getEngineId() const;
+    int messageOverhead() const;
+
+// message methods
+    void encodeDiscovery(SNMPBerWriter &encoder, quint32 messageId);
+    void encode(SNMPBerWriter &encoder, quint32 messageId);
+    DecodeStatus decode(const char *data, int size, SNMPMessageView &message, quint32 *messageId = NULL);
+
+    static QByteArray passwordToKey(const QByteArray &password);
+    static QByteArray localizeKey(const QByteArray &password, const QByteArray &engineId);
+
+private:
+    void setEngine(const QByteArray &engineId, qint64 boots, qint64 time);
+    void localizeKeys();
+    int securityFlags() const;
+    qint64 engineTime() const;
+    void finishMessage(SNMPBerWriter &encoder, quint32 messageId, int flags,
+                       const QByteArray &engineId, const QByteArray &userName);
+    void resizePrivacyBuffer(int size);
+
+    QByteArray userName;
+    QByteArray authPassword;
+    QByteArray privPassword;
+
+    QByteArray engineId;
+    qint64 engineBoots;
+    qint64 engineTimeAtSync;
+    QElapsedTimer syncClock;
+    bool discovered;
+
+    SNMPHmacSha1 hmac;
+    SNMPAes128 aes;
+    quint64 salt;
+    QByteArray privacyBuffer;
+};
+
+#endif // SNMPUSM_H
@@ -0,0 +1,138 @@
+#include "snmpvalue.h"
+
+//----[ Constructors/Destructors ]-----------------------------------------------------
+
+/**
+*   Creates an invalid value.
+*/
+SNMPValue::SNMPValue()
+{
+    raw.type = 0;
+    raw.value = NULL;
+    raw.length = 0;
+    number.unsignedInteger = 0;
+}
+
+
+//----[ Public methods ]-----------------------------------------------------------------
+
+/**
+*   This method will decode a varbind value. Numbers are converted at once, the other
+*   types keep a view of their bytes; unknown types are kept as raw bytes.
+*   Returns false, leaving the value invalid, for a malformed number or IpAddress.
+*/
+bool SNMPValue::decode(const SNMPBerElement &element)
+{
+    *this = SNMPValue();
+
+    switch(element.type)
+    {
+    case SNMPBer::Integer:
+        if(!SNMPBerReader::toInteger(element, number.integer))
+            return false;
+        break;
+
+    case SNMPBer::Counter32:
+    case SNMPBer::Gauge32:
+    case SNMPBer::TimeTicks:
+        if(!SNMPBerReader::toUnsigned(element, number.unsignedInteger) || number.unsignedInteger > 0xFFFFFFFFu)
+            return false;
+        break;
+
+    case SNMPBer::Counter64:
+        if(!SNMPBerReader::toUnsigned(element, number.unsignedInteger))
+            return false;
+        break;
+
+    case SNMPBer::IpAddress:
+        if(element.length != 4)
+            return false;
+        number.unsignedInteger = (quint32(quint8(element.value[0])) << 24) | (quint32(quint8(element.value[1])) << 16)
+                                 | (quint32(quint8(element.value[2])) << 8) | quint32(quint8(element.value[3]));
+        break;
+
+    default:
+        break;
+    }
+
+    raw = element;
+    return true;
+}
+
+bool SNMPValue::isException() const
+{
+    return raw.type == SNMPBer::NoSuchObject || raw.type == SNMPBer::NoSuchInstance
+           || raw.type == SNMPBer::EndOfMibView;
+}
+
+/**
+*   Returns true for the unsigned application types: Counter32, Gauge32, TimeTicks
+*   and Counter64.
+*/
+bool SNMPValue::isUnsigned() const
+{
+    return raw.type == SNMPBer::Counter32 || raw.type == SNMPBer::Gauge32
+           || raw.type == SNMPBer::TimeTicks || raw.type == SNMPBer::Counter64;
+}
+
+/**
+*   Returns the value of an INTEGER, or of an unsigned type if it fits; 0 otherwise.
+*/
+qint64 SNMPValue::toInteger() const
+{
+    if(isInteger())
+        return number.integer;
+    if(isUnsigned() && number.unsignedInteger <= quint64(Q_INT64_C(0x7FFFFFFFFFFFFFFF)))
+        return qint64(number.unsignedInteger);
+    return 0;
+}
+
+/**
+*   Returns the value of an unsigned type, or of a non-negative INTEGER; 0 otherwise.
+*/
+quint64 SNMPValue::toUnsigned() const
+{
+    if(isUnsigned())
+        return number.unsignedInteger;
+    if(isInteger() && number.integer >= 0)
+        return quint64(number.integer);
+    return 0;
+}
+
+/**
+*   Returns an IpAddress in host byte order, as QHostAddress takes it; 0 otherwise.
+*/
+quint32 SNMPValue::toIPv4Address() const
+{
+    return raw.type == SNMPBer::IpAddress ? quint32(number.unsignedInteger) : 0;
+}
+
+/**
+*   Returns a copy of the value bytes, which stays valid after the datagram is gone.
+*/
+QByteArray SNMPValue::toByteArray() const
+{
+    return raw.value ? QByteArray(raw.value, raw.length) : QByteArray();
+}
+
+/**
+*   Returns a copy of an OBJECT IDENTIFIER value, or an invalid OID for other types.
+*/
+SNMPOid SNMPValue::toOid() const
+{
+    if(raw.type != SNMPBer::ObjectIdentifier)
+        return SNMPOid();
+    return SNMPOid::fromEncoded(raw.value, raw.length);
+}
+
+/**
+*   Returns the text form SNMPSession reports values with, or an empty string for
+*   types it has no text for.
+*/
+QString SNMPValue::toString() const
+{
+    QString text;
+    if(isValid())
+        SNMPBer::valueToString(raw, text);
+    return text;
+}
@@ -0,0 +1,63 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * The class represents the value of a varbind, decoded straight from its
+ * BER bytes: INTEGER, Counter32, Gauge32, TimeTicks and Counter64 as native
+ * integers, IpAddress as a 32-bit address, OCTET STRING, OBJECT IDENTIFIER
+ * and Opaque as a view of their bytes, plus NULL and the SNMPv2 exceptions.
+ *
+ * A SNMPValue is a small tagged union and is decoded without allocating.
+ * Byte views point into the received datagram, so a value is only valid
+ * while the signal delivering it runs: connect to the typed signals with a
+ * direct connection, and copy what must be kept (toByteArray(), toOid()).
+ *
+ */
+
+
+#ifndef SNMPVALUE_H
+#define SNMPVALUE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+#include "snmpber.h"
+#include "snmpoid.h"
+
+class SNMPValue {
+
+public:
+    SNMPValue();
+
+    bool decode(const SNMPBerElement &element);
+
+    // the BER type, one of the SNMPBer type or exception constants; 0 when invalid
+    int type() const { return raw.type; }
+    const SNMPBerElement &element() const { return raw; }
+
+    bool isValid() const { return raw.type != 0; }
+    bool isNull() const { return raw.type == SNMPBer::Null; }
+    bool isException() const;
+    bool isInteger() const { return raw.type == SNMPBer::Integer; }
+    bool isUnsigned() const;
+
+    qint64 toInteger() const;
+    quint64 toUnsigned() const;
+    quint32 toIPv4Address() const;
+    const char *data() const { return raw.value; }
+    int size() const { return raw.length; }
+
+    QByteArray toByteArray() const;
+    SNMPOid toOid() const;
+    QString toString() const;
+
+private:
+    SNMPBerElement raw;
+    union {
+        qint64 integer;
+        quint64 unsignedInteger;
+    } number;
+};
+
+#endif // SNMPVALUE_H
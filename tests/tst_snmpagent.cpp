@@ -0,0 +1,439 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Loopback tests of SNMPAgent with requests encoded by hand and sent from a
+ * QUdpSocket, so that every field of the responses can be checked: the
+ * echoed varbinds of a SNMPv1 noSuchName, the non-repeaters and repetitions
+ * of GetBulk with a column which reaches the end of the MIB and keeps its
+ * OID, Sets applied completely or not at all, and responses over the
+ * maximum size answered with tooBig or, for GetBulk, cut short.
+ *
+ */
+
+
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QUdpSocket>
+#include "snmpagent.h"
+#include "snmpber.h"
+
+// The MIB of the test, under an enterprise arc: the set targets, a large value,
+// 100 rows for the truncated GetBulk, then the two columns which end the MIB
+static const SNMPOid writableInteger = "1.3.6.1.4.1.99999.1.1"_oid;
+static const SNMPOid writableString = "1.3.6.1.4.1.99999.1.2"_oid;
+static const SNMPOid readOnlyInteger = "1.3.6.1.4.1.99999.1.3"_oid;
+static const SNMPOid largeString = "1.3.6.1.4.1.99999.2.1"_oid;
+static const char rowsColumn[] = "1.3.6.1.4.1.99999.3";
+static const char firstColumn[] = "1.3.6.1.4.1.99999.8";
+static const char lastColumn[] = "1.3.6.1.4.1.99999.9";
+static const SNMPOid missing = "1.3.6.1.4.1.99999.5.1"_oid;
+static const SNMPOid pastTheEnd = "1.3.6.1.4.1.99999.10"_oid;
+
+static SNMPOid columnOid(const char *column, int row)
+{
+    return SNMPOid::fromString(QString("%1.%2").arg(column).arg(row));
+}
+
+struct RequestVarbind {
+    SNMPOid oid;
+    int type;
+    qint64 integer;
+    QByteArray string;
+};
+
+static RequestVarbind nullVarbind(const SNMPOid &oid)
+{
+    RequestVarbind varbind = { oid, SNMPBer::Null, 0, QByteArray() };
+    return varbind;
+}
+
+static RequestVarbind integerVarbind(const SNMPOid &oid, qint64 value)
+{
+    RequestVarbind varbind = { oid, SNMPBer::Integer, value, QByteArray() };
+    return varbind;
+}
+
+static RequestVarbind stringVarbind(const SNMPOid &oid, const QByteArray &value)
+{
+    RequestVarbind varbind = { oid, SNMPBer::OctetString, 0, value };
+    return varbind;
+}
+
+/**
+*   Encodes a request; for GetBulk errorStatus is non-repeaters and errorIndex
+*   max-repetitions.
+*/
+static QByteArray encodeRequest(int version, const QByteArray &community, int pduType,
+                                const QVector<RequestVarbind> &varbinds,
+                                int errorStatus = 0, int errorIndex = 0)
+{
+    SNMPBerWriter encoder;
+
+    // written back to front, the last varbind first
+    for(int i = varbinds.size() - 1; i >= 0; i--)
+    {
+        const RequestVarbind &varbind = varbinds[i];
+        const int varbindEnd = encoder.mark();
+        if(varbind.type == SNMPBer::Integer)
+            encoder.writeInteger(varbind.integer);
+        else if(varbind.type == SNMPBer::OctetString)
+            encoder.writeOctetString(varbind.string);
+        else
+            encoder.writeNull();
+        encoder.writeOctetString(varbind.oid.encoded(), SNMPBer::ObjectIdentifier);
+        encoder.endConstructed(varbindEnd, SNMPBer::Sequence);
+    }
+
+    encoder.writeMessageHeader(version, community, pduType, 1234, errorStatus, errorIndex);
+    return encoder.toByteArray();
+}
+
+struct ResponseVarbind {
+    QString oid;
+    int type;
+    QString value;
+};
+
+struct Response {
+    Response() : received(false), pduType(0), requestId(0), errorStatus(-1), errorIndex(-1), size(0) {}
+
+    bool received;
+    int pduType;
+    quint32 requestId;
+    int errorStatus;
+    int errorIndex;
+    QVector<ResponseVarbind> varbinds;
+    int size;
+};
+
+class TestSNMPAgent : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanup();
+    void getVersion1NoSuchName();
+    void getVersion2cExceptions();
+    void getNextVersion1PastTheEnd();
+    void getBulkRepetitions();
+    void getBulkEndOfMibView();
+    void setAllOrNothing_data();
+    void setAllOrNothing();
+    void tooBig_data();
+    void tooBig();
+    void getBulkTruncated();
+
+private:
+    Response exchange(const QByteArray &request);
+
+    SNMPAgent agent;
+    QUdpSocket client;
+};
+
+void TestSNMPAgent::initTestCase()
+{
+    agent.setWriteCommunity("private");
+
+    agent.setInteger(agent.addObject(writableInteger, SNMPBer::Integer, true), 1);
+    agent.setOctetString(agent.addObject(writableString, SNMPBer::OctetString, true), "before");
+    agent.setInteger(agent.addObject(readOnlyInteger, SNMPBer::Integer), 3);
+    agent.setOctetString(agent.addObject(largeString, SNMPBer::OctetString), QByteArray(600, 'x'));
+    for(int row = 1; row <= 100; row++)
+        agent.setOctetString(agent.addObject(columnOid(rowsColumn, row), SNMPBer::OctetString),
+                             QByteArray(40, 'r'));
+    for(int row = 1; row <= 3; row++)
+    {
+        agent.setInteger(agent.addObject(columnOid(firstColumn, row), SNMPBer::Integer), row);
+        agent.setOctetString(agent.addObject(columnOid(lastColumn, row), SNMPBer::OctetString),
+                             QByteArray("row") + QByteArray::number(row));
+    }
+
+    QVERIFY(agent.listen(0));
+    QVERIFY(client.bind(QHostAddress::LocalHost, 0));
+}
+
+void TestSNMPAgent::cleanup()
+{
+    agent.setMaxResponseSize(1472);
+}
+
+/**
+*   A SNMPv1 Get of an object the agent lacks fails as a whole: noSuchName with the
+*   index of that varbind, and the request's varbinds echoed unchanged.
+*/
+void TestSNMPAgent::getVersion1NoSuchName()
+{
+    const Response response = exchange(encodeRequest(SNMPBer::Version1, "public", SNMPBer::GetRequest,
+        { nullVarbind(readOnlyInteger), nullVarbind(missing), nullVarbind(writableInteger) }));
+
+    QVERIFY(response.received);
+    QCOMPARE(response.pduType, int(SNMPBer::GetResponse));
+    QCOMPARE(response.requestId, quint32(1234));
+    QCOMPARE(response.errorStatus, 2);
+    QCOMPARE(response.errorIndex, 2);
+    QCOMPARE(response.varbinds.size(), 3);
+    QCOMPARE(response.varbinds[0].oid, readOnlyInteger.toString());
+    QCOMPARE(response.varbinds[1].oid, missing.toString());
+    QCOMPARE(response.varbinds[2].oid, writableInteger.toString());
+    for(const ResponseVarbind &varbind : response.varbinds)
+        QCOMPARE(varbind.type, int(SNMPBer::Null));
+}
+
+void TestSNMPAgent::getVersion2cExceptions()
+{
+    const Response response = exchange(encodeRequest(SNMPBer::Version2c, "public", SNMPBer::GetRequest,
+        { nullVarbind(readOnlyInteger), nullVarbind(missing) }));
+
+    QVERIFY(response.received);
+    QCOMPARE(response.errorStatus, 0);
+    QCOMPARE(response.errorIndex, 0);
+    QCOMPARE(response.varbinds.size(), 2);
+    QCOMPARE(response.varbinds[0].type, int(SNMPBer::Integer));
+    QCOMPARE(response.varbinds[0].value, QString("3"));
+    QCOMPARE(response.varbinds[1].oid, missing.toString());
+    QCOMPARE(response.varbinds[1].type, int(SNMPBer::NoSuchObject));
+}
+
+void TestSNMPAgent::getNextVersion1PastTheEnd()
+{
+    const Response response = exchange(encodeRequest(SNMPBer::Version1, "public", SNMPBer::GetNextRequest,
+        { nullVarbind(readOnlyInteger), nullVarbind(columnOid(lastColumn, 3)) }));
+
+    QVERIFY(response.received);
+    QCOMPARE(response.errorStatus, 2);
+    QCOMPARE(response.errorIndex, 2);
+    QCOMPARE(response.varbinds.size(), 2);
+    QCOMPARE(response.varbinds[1].oid, columnOid(lastColumn, 3).toString());
+}
+
+/**
+*   One non-repeater, then rows of the two repeaters. The second column starts on
+*   the last object of the MIB: from the second row on it is endOfMibView, with
+*   the OID it ended on, while the first column goes on (past its table, as
+*   GetNext does) until max-repetitions.
+*/
+void TestSNMPAgent::getBulkRepetitions()
+{
+    const Response response = exchange(encodeRequest(SNMPBer::Version2c, "public", SNMPBer::GetBulkRequest,
+        { nullVarbind("1.3.6.1.4.1.99999.7"_oid), nullVarbind(SNMPOid::fromString(firstColumn)),
+          nullVarbind(columnOid(lastColumn, 2)) }, 1, 4));
+
+    QVERIFY(response.received);
+    QCOMPARE(response.errorStatus, 0);
+    QCOMPARE(response.varbinds.size(), 1 + 4 * 2);
+
+    QCOMPARE(response.varbinds[0].oid, columnOid(firstColumn, 1).toString());
+    QCOMPARE(response.varbinds[0].value, QString("1"));
+
+    const QString expectedFirst[] = {
+        columnOid(firstColumn, 1).toString(), columnOid(firstColumn, 2).toString(),
+        columnOid(firstColumn, 3).toString(), columnOid(lastColumn, 1).toString()
+    };
+    for(int row = 0; row < 4; row++)
+    {
+        const ResponseVarbind &first = response.varbinds[1 + row * 2];
+        const ResponseVarbind &second = response.varbinds[2 + row * 2];
+
+        QCOMPARE(first.oid, expectedFirst[row]);
+        QVERIFY(first.type != int(SNMPBer::EndOfMibView));
+        QCOMPARE(second.oid, columnOid(lastColumn, 3).toString());
+        QCOMPARE(second.type, row == 0 ? int(SNMPBer::OctetString) : int(SNMPBer::EndOfMibView));
+    }
+    QCOMPARE(response.varbinds[2].value, QString("row3"));
+}
+
+/**
+*   Columns past the end of the MIB: a non-repeater and a column which ends in the
+*   first row keep the OID of the request, and no further row is sent once every
+*   column has ended. Non-repeaters beyond the varbinds count as all of them.
+*/
+void TestSNMPAgent::getBulkEndOfMibView()
+{
+    Response response = exchange(encodeRequest(SNMPBer::Version2c, "public", SNMPBer::GetBulkRequest,
+        { nullVarbind(pastTheEnd), nullVarbind(pastTheEnd) }, 1, 5));
+
+    QVERIFY(response.received);
+    QCOMPARE(response.errorStatus, 0);
+    QCOMPARE(response.varbinds.size(), 2);
+    for(const ResponseVarbind &varbind : response.varbinds)
+    {
+        QCOMPARE(varbind.oid, pastTheEnd.toString());
+        QCOMPARE(varbind.type, int(SNMPBer::EndOfMibView));
+    }
+
+    response = exchange(encodeRequest(SNMPBer::Version2c, "public", SNMPBer::GetBulkRequest,
+        { nullVarbind(readOnlyInteger), nullVarbind(columnOid(lastColumn, 2)) }, 5, 10));
+
+    QVERIFY(response.received);
+    QCOMPARE(response.varbinds.size(), 2);
+    QCOMPARE(response.varbinds[0].oid, largeString.toString());
+    QCOMPARE(response.varbinds[1].oid, columnOid(lastColumn, 3).toString());
+}
+
+void TestSNMPAgent::setAllOrNothing_data()
+{
+    QTest::addColumn<int>("version");
+    QTest::addColumn<int>("readOnlyStatus");
+    QTest::addColumn<int>("wrongTypeStatus");
+
+    // SNMPv1 has noSuchName and badValue where SNMPv2 has notWritable and wrongType
+    QTest::newRow("v1") << int(SNMPBer::Version1) << 2 << 3;
+    QTest::newRow("v2c") << int(SNMPBer::Version2c) << 17 << 7;
+}
+
+void TestSNMPAgent::setAllOrNothing()
+{
+    QFETCH(int, version);
+    QFETCH(int, readOnlyStatus);
+    QFETCH(int, wrongTypeStatus);
+
+    const int integerObject = agent.findObject(writableInteger);
+    const int stringObject = agent.findObject(writableString);
+    agent.setInteger(integerObject, 1);
+    agent.setOctetString(stringObject, "before");
+
+    QVector<int> changed;
+    QMetaObject::Connection connection = connect(&agent, &SNMPAgent::objectChanged, this,
+                                                 [&changed](int object) { changed.append(object); });
+
+    // the third varbind is read-only: the first two are not stored either
+    Response response = exchange(encodeRequest(version, "private", SNMPBer::SetRequest,
+        { integerVarbind(writableInteger, 5), stringVarbind(writableString, "after"),
+          integerVarbind(readOnlyInteger, 5) }));
+    QVERIFY(response.received);
+    QCOMPARE(response.errorStatus, readOnlyStatus);
+    QCOMPARE(response.errorIndex, 3);
+    QCOMPARE(response.varbinds.size(), 3);
+    QCOMPARE(response.varbinds[0].value, QString("5"));
+    QCOMPARE(agent.getInteger(integerObject), qint64(1));
+    QCOMPARE(agent.getOctetString(stringObject), QByteArray("before"));
+
+    // an INTEGER for the OCTET STRING
+    response = exchange(encodeRequest(version, "private", SNMPBer::SetRequest,
+        { integerVarbind(writableInteger, 5), integerVarbind(writableString, 5) }));
+    QCOMPARE(response.errorStatus, wrongTypeStatus);
+    QCOMPARE(response.errorIndex, 2);
+    QCOMPARE(agent.getInteger(integerObject), qint64(1));
+    QVERIFY(changed.isEmpty());
+
+    // the read community may not set at all
+    response = exchange(encodeRequest(version, "public", SNMPBer::SetRequest,
+        { integerVarbind(writableInteger, 5) }));
+    QCOMPARE(response.errorStatus, version == SNMPBer::Version1 ? 2 : 6);
+    QCOMPARE(response.errorIndex, 1);
+    QCOMPARE(agent.getInteger(integerObject), qint64(1));
+
+    response = exchange(encodeRequest(version, "private", SNMPBer::SetRequest,
+        { integerVarbind(writableInteger, 5), stringVarbind(writableString, "after") }));
+    QCOMPARE(response.errorStatus, 0);
+    QCOMPARE(response.errorIndex, 0);
+    QCOMPARE(response.varbinds.size(), 2);
+    QCOMPARE(agent.getInteger(integerObject), qint64(5));
+    QCOMPARE(agent.getOctetString(stringObject), QByteArray("after"));
+    QCOMPARE(changed, QVector<int>({ integerObject, stringObject }));
+
+    disconnect(connection);
+}
+
+void TestSNMPAgent::tooBig_data()
+{
+    QTest::addColumn<int>("version");
+
+    QTest::newRow("v1") << int(SNMPBer::Version1);
+    QTest::newRow("v2c") << int(SNMPBer::Version2c);
+}
+
+/**
+*   A Get whose response would exceed the maximum size gets tooBig: with the
+*   request's varbinds echoed for SNMPv1, with none for SNMPv2c.
+*/
+void TestSNMPAgent::tooBig()
+{
+    QFETCH(int, version);
+    agent.setMaxResponseSize(484);
+
+    const Response response = exchange(encodeRequest(version, "public", SNMPBer::GetRequest,
+        { nullVarbind(readOnlyInteger), nullVarbind(largeString) }));
+
+    QVERIFY(response.received);
+    QCOMPARE(response.errorStatus, 1);
+    QCOMPARE(response.errorIndex, 0);
+    QVERIFY(response.size <= 484);
+    if(version == SNMPBer::Version1)
+    {
+        QCOMPARE(response.varbinds.size(), 2);
+        QCOMPARE(response.varbinds[1].oid, largeString.toString());
+        QCOMPARE(response.varbinds[1].type, int(SNMPBer::Null));
+    } else
+    {
+        QVERIFY(response.varbinds.isEmpty());
+    }
+}
+
+/**
+*   A GetBulk response is cut to the maximum size instead, in the middle of a row
+*   if need be, and without an error.
+*/
+void TestSNMPAgent::getBulkTruncated()
+{
+    agent.setMaxResponseSize(484);
+
+    const Response response = exchange(encodeRequest(SNMPBer::Version2c, "public", SNMPBer::GetBulkRequest,
+        { nullVarbind(SNMPOid::fromString(rowsColumn)) }, 0, 100));
+
+    QVERIFY(response.received);
+    QCOMPARE(response.errorStatus, 0);
+    QVERIFY(response.size <= 484);
+    QVERIFY(response.varbinds.size() > 1);
+    QVERIFY(response.varbinds.size() < 100);
+    for(int row = 0; row < response.varbinds.size(); row++)
+        QCOMPARE(response.varbinds[row].oid, columnOid(rowsColumn, row + 1).toString());
+}
+
+/**
+*   This method will send the request to the agent and wait up to 5 s for its
+*   response, running the event loop meanwhile.
+*/
+Response TestSNMPAgent::exchange(const QByteArray &request)
+{
+    Response response;
+    client.writeDatagram(request, QHostAddress::LocalHost, agent.getLocalPort());
+
+    QElapsedTimer clock;
+    clock.start();
+    while(!client.hasPendingDatagrams() && clock.elapsed() < 5000)
+        QTest::qWait(1);
+    if(!client.hasPendingDatagrams())
+        return response;
+
+    QByteArray datagram(int(client.pendingDatagramSize()), 0);
+    response.size = int(client.readDatagram(datagram.data(), datagram.size()));
+
+    SNMPMessageView message;
+    if(!message.decode(datagram.constData(), response.size))
+        return response;
+
+    response.received = true;
+    response.pduType = message.pduType;
+    response.requestId = message.requestId;
+    response.errorStatus = message.errorStatus;
+    response.errorIndex = message.errorIndex;
+
+    SNMPVarbindView varbind;
+    while(message.nextVarbind(varbind))
+    {
+        ResponseVarbind result;
+        result.oid = SNMPBer::objectIdentifierToString(varbind.oid.value, varbind.oid.length);
+        result.type = varbind.value.type;
+        SNMPBer::valueToString(varbind.value, result.value);
+        response.varbinds.append(result);
+    }
+    return response;
+}
+
+QTEST_GUILESS_MAIN(TestSNMPAgent)
+
+#include "tst_snmpagent.moc"
@@ -0,0 +1,198 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Counts the heap allocations of steady-state polling: SNMPSession sends
+ * get-requests to a SNMPAgentSimulator on another thread, over the batched
+ * transport, with results delivered by the typed signals. After a warm-up
+ * which fills the pools, N polls on the session's thread must not call
+ * malloc, calloc, realloc or operator new once.
+ *
+ * The count covers the session's thread only, Qt's event loop included,
+ * which is why the test runs the plain Unix event dispatcher (QT_NO_GLIB).
+ * The allocators are interposed through glibc; elsewhere, and under the
+ * sanitizers which interpose them themselves, the test is skipped.
+ *
+ */
+
+
+#include <QtTest>
+#include <QThread>
+#include <new>
+#include "qtsnmp.h"
+#include "snmpagentsimulator.h"
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#  if defined(__has_feature)
+#    if !__has_feature(address_sanitizer) && !__has_feature(thread_sanitizer) && !__has_feature(memory_sanitizer)
+#      define SNMP_COUNT_ALLOCATIONS
+#    endif
+#  else
+#    define SNMP_COUNT_ALLOCATIONS
+#  endif
+#endif
+
+// Allocations made by the thread which set countAllocations
+static thread_local bool countAllocations = false;
+static thread_local quint64 allocationCount = 0;
+
+#ifdef SNMP_COUNT_ALLOCATIONS
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size)
+{
+    if(countAllocations)
+        allocationCount++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    if(countAllocations)
+        allocationCount++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    if(countAllocations)
+        allocationCount++;
+    return __libc_realloc(pointer, size);
+}
+}
+
+void *operator new(size_t size)
+{
+    if(countAllocations)
+        allocationCount++;
+    void *pointer = __libc_malloc(size ? size : 1);
+    if(!pointer)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+#endif
+
+// The GLib event dispatcher allocates on its own; set before QCoreApplication exists
+static const bool plainEventDispatcher = qputenv("QT_NO_GLIB", "1");
+
+class TestSNMPAllocations : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void steadyStatePolling();
+
+private:
+    QThread agentThread;
+    QObject agentContext;
+    SNMPAgentSimulator *simulator = NULL;
+    QVector<SNMPOid> objects;
+    quint16 agentPort = 0;
+};
+
+void TestSNMPAllocations::initTestCase()
+{
+    Q_UNUSED(plainEventDispatcher);
+
+    // the agent runs on a thread of its own, created there so that its socket is too
+    agentContext.moveToThread(&agentThread);
+    agentThread.start();
+    QMetaObject::invokeMethod(&agentContext, [this]() {
+        simulator = new SNMPAgentSimulator;
+        simulator->populate(100);
+        if(simulator->listen(0))
+            agentPort = simulator->getLocalPort();
+        for(int object = 0; object < simulator->objectCount(); object++)
+            objects.append(simulator->getObjectOid(object));
+    }, Qt::BlockingQueuedConnection);
+
+    QVERIFY(agentPort != 0);
+}
+
+void TestSNMPAllocations::cleanupTestCase()
+{
+    QMetaObject::invokeMethod(&agentContext, [this]() { delete simulator; },
+                              Qt::BlockingQueuedConnection);
+    agentThread.quit();
+    agentThread.wait();
+}
+
+void TestSNMPAllocations::steadyStatePolling()
+{
+#ifndef SNMP_COUNT_ALLOCATIONS
+    QSKIP("the allocators cannot be interposed in this build");
+#endif
+
+    const int concurrency = 16;
+    const int warmUp = 2000;
+    const int polls = 10000;
+    const QString community("public");
+
+    SNMPSession session;
+    session.setAgentAddress("127.0.0.1");
+    session.setAgentPort(qint16(agentPort));
+    session.setVersion(SNMPBer::Version2c);
+    if(!session.setBatchedTransport(true))
+        QSKIP("the batched transport is not supported here");
+
+    QEventLoop loop;
+    int sent = 0;
+    int completed = 0;
+    int failed = 0;
+
+    // every response sends the next poll, until warmUp + polls have completed
+    auto sendNext = [&]() {
+        if(sent < warmUp + polls)
+        {
+            session.sendGetRequestAsync(community, objects[sent % objects.size()]);
+            sent++;
+        }
+    };
+    connect(&session, &SNMPSession::responseValueReceived, &loop,
+            [&](quint32, int errorStatus, const SNMPValue &) {
+        if(errorStatus != 0)
+            failed++;
+        completed++;
+        if(completed == warmUp)
+        {
+            allocationCount = 0;
+            countAllocations = true;
+        }
+        if(completed == warmUp + polls)
+        {
+            countAllocations = false;
+            loop.quit();
+        }
+        sendNext();
+    });
+    connect(&session, &SNMPSession::requestFailed, &loop, [&](quint32, int) {
+        failed++;
+        countAllocations = false;
+        loop.quit();
+    });
+
+    for(int i = 0; i < concurrency; i++)
+        sendNext();
+    QTimer::singleShot(60000, &loop, &QEventLoop::quit);
+    loop.exec();
+    countAllocations = false;
+
+    QCOMPARE(failed, 0);
+    QCOMPARE(completed, warmUp + polls);
+    QCOMPARE(allocationCount, quint64(0));
+}
+
+QTEST_GUILESS_MAIN(TestSNMPAllocations)
+
+#include "tst_snmpallocations.moc"
@@ -0,0 +1,174 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Tests of SNMPCoroutineSession against a SNMPAgentSimulator in the same
+ * thread: coroutines await gets, sets and walks and are resumed with their
+ * results or error statuses, a request which cannot be sent does not suspend,
+ * and destroying the wrapper resumes the coroutines still waiting with error 5.
+ *
+ * Built with C++20 whatever the standard of the library; without coroutine
+ * support in the compiler the test is skipped.
+ *
+ */
+
+
+#include <QtTest>
+#include <QUdpSocket>
+#include "snmpagentsimulator.h"
+#include "snmpcoroutine.h"
+
+#ifdef SNMP_HAS_COROUTINES
+
+static const SNMPOid systemGroup = "1.3.6.1.2.1.1"_oid;
+static const SNMPOid sysDescr = "1.3.6.1.2.1.1.1.0"_oid;
+static const SNMPOid sysName = "1.3.6.1.2.1.1.5.0"_oid;
+static const SNMPOid missing = "1.3.6.1.4.1.99999.1.0"_oid;
+
+struct WorkflowResults {
+    WorkflowResults() : finished(false) {}
+
+    SNMPResult name;
+    SNMPResult renamed;
+    SNMPResult nameAfterSet;
+    SNMPResult missingObject;
+    SNMPResult readOnly;
+    SNMPWalkResult walked;
+    SNMPWalkResult bulkWalked;
+    bool finished;
+};
+
+static SNMPTask runWorkflow(SNMPCoroutineSession &agent, WorkflowResults &results)
+{
+    results.name = co_await agent.get("public", sysName);
+    results.renamed = co_await agent.set("private", sysName, QString("renamed"));
+    results.nameAfterSet = co_await agent.get("public", sysName);
+    results.missingObject = co_await agent.get("public", missing);
+    results.readOnly = co_await agent.set("private", sysDescr, QString("read-only"));
+    results.walked = co_await agent.walk("public", systemGroup);
+    results.bulkWalked = co_await agent.bulkWalk("public", systemGroup, 3);
+    results.finished = true;
+}
+
+static SNMPTask awaitGet(SNMPCoroutineSession &agent, SNMPResult &result, bool &finished)
+{
+    result = co_await agent.get("public", sysName);
+    finished = true;
+}
+
+static SNMPTask awaitWalk(SNMPCoroutineSession &agent, SNMPWalkResult &result, bool &finished)
+{
+    result = co_await agent.walk("public", systemGroup);
+    finished = true;
+}
+
+#endif // SNMP_HAS_COROUTINES
+
+class TestSNMPCoroutine : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void awaitsRequestsAndWalks();
+    void failsWithoutSuspending();
+    void destructionResumesWithError();
+
+private:
+    SNMPAgentSimulator simulator;
+};
+
+void TestSNMPCoroutine::initTestCase()
+{
+#ifndef SNMP_HAS_COROUTINES
+    QSKIP("the compiler has no C++20 coroutines");
+#else
+    simulator.populate(30);
+    simulator.setWriteCommunity("private");
+    QVERIFY(simulator.listen(0));
+#endif
+}
+
+void TestSNMPCoroutine::awaitsRequestsAndWalks()
+{
+#ifdef SNMP_HAS_COROUTINES
+    SNMPSession session("127.0.0.1", qint16(simulator.getLocalPort()), 0);
+    session.setVersion(SNMPBer::Version2c);
+    WorkflowResults results;
+    SNMPCoroutineSession agent(session);
+
+    runWorkflow(agent, results);
+    QTRY_VERIFY(results.finished);
+
+    QCOMPARE(results.name.errorStatus, 0);
+    QCOMPARE(results.name.value, QString("simulator"));
+    QCOMPARE(results.renamed.errorStatus, 0);
+    QCOMPARE(results.nameAfterSet.errorStatus, 0);
+    QCOMPARE(results.nameAfterSet.value, QString("renamed"));
+    QCOMPARE(results.missingObject.errorStatus, 2);
+    QCOMPARE(results.readOnly.errorStatus, 17);
+
+    // sysDescr, sysObjectID, sysUpTime and sysName, then the walk leaves the subtree
+    QCOMPARE(results.walked.errorStatus, 0);
+    QCOMPARE(results.walked.varbinds.size(), 4);
+    QCOMPARE(results.walked.varbinds[3].first, QString("1.3.6.1.2.1.1.5.0"));
+    QCOMPARE(results.walked.varbinds[3].second, QString("renamed"));
+    QCOMPARE(results.bulkWalked.errorStatus, 0);
+    QCOMPARE(results.bulkWalked.varbinds, results.walked.varbinds);
+#endif
+}
+
+void TestSNMPCoroutine::failsWithoutSuspending()
+{
+#ifdef SNMP_HAS_COROUTINES
+    // without an agent address nothing can be sent
+    SNMPSession session;
+    SNMPCoroutineSession agent(session);
+    SNMPResult result;
+    SNMPWalkResult walked;
+    bool requestFinished = false;
+    bool walkFinished = false;
+
+    awaitGet(agent, result, requestFinished);
+    awaitWalk(agent, walked, walkFinished);
+
+    QVERIFY(requestFinished);
+    QCOMPARE(result.errorStatus, 5);
+    QVERIFY(walkFinished);
+    QCOMPARE(walked.errorStatus, 5);
+#endif
+}
+
+void TestSNMPCoroutine::destructionResumesWithError()
+{
+#ifdef SNMP_HAS_COROUTINES
+    // an agent which never answers: a socket nobody reads
+    QUdpSocket silentAgent;
+    QVERIFY(silentAgent.bind(QHostAddress::LocalHost, 0));
+
+    SNMPSession session("127.0.0.1", qint16(silentAgent.localPort()), 0);
+    SNMPResult result;
+    SNMPWalkResult walked;
+    bool requestFinished = false;
+    bool walkFinished = false;
+
+    {
+        SNMPCoroutineSession agent(session);
+        awaitGet(agent, result, requestFinished);
+        awaitWalk(agent, walked, walkFinished);
+        QVERIFY(!requestFinished);
+        QVERIFY(!walkFinished);
+    }
+
+    QVERIFY(requestFinished);
+    QCOMPARE(result.errorStatus, 5);
+    QVERIFY(walkFinished);
+    QCOMPARE(walked.errorStatus, 5);
+    QCOMPARE(session.pendingRequestCount(), 0);
+#endif
+}
+
+QTEST_GUILESS_MAIN(TestSNMPCoroutine)
+
+#include "tst_snmpcoroutine.moc"
@@ -0,0 +1,161 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Known-answer tests of the USM cryptography: SHA-1 (FIPS 180), HMAC-SHA-1
+ * (RFC 2202), AES-128 (FIPS 197) and its CFB mode (SP 800-38A), and the
+ * password to key and key localization algorithms (RFC 3414 A.3.2).
+ *
+ */
+
+
+#include <QtTest>
+#include "snmpcrypto.h"
+#include "snmpusm.h"
+
+static QByteArray hmacSha1(const QByteArray &key, const QByteArray &data)
+{
+    SNMPHmacSha1 hmac(key);
+    char mac[SNMPSha1::DigestSize];
+
+    hmac.start();
+    hmac.addData(data.constData(), data.size());
+    hmac.result(mac);
+    return QByteArray(mac, sizeof(mac));
+}
+
+class TestSNMPCrypto : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void sha1();
+    void sha1Incremental();
+    void hmacSha1Rfc2202();
+    void hmacSha1Restart();
+    void aes128Fips197();
+    void aes128Cfb();
+    void passwordToKeyRfc3414();
+};
+
+void TestSNMPCrypto::sha1()
+{
+    QCOMPARE(SNMPSha1::hash("").toHex(), QByteArray("da39a3ee5e6b4b0d3255bfef95601890afd80709"));
+    QCOMPARE(SNMPSha1::hash("abc").toHex(), QByteArray("a9993e364706816aba3e25717850c26c9cd0d89d"));
+    QCOMPARE(SNMPSha1::hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq").toHex(),
+             QByteArray("84983e441c3bd26ebaae4aa1f95129e5e54670f1"));
+    QCOMPARE(SNMPSha1::hash(QByteArray(1000000, 'a')).toHex(),
+             QByteArray("34aa973cd4c4daa4f61eeb2bdbad27316534016f"));
+}
+
+void TestSNMPCrypto::sha1Incremental()
+{
+    // the million 'a' fed in pieces which straddle the 64 byte blocks
+    const QByteArray piece(997, 'a');
+    SNMPSha1 sha;
+    int fed = 0;
+
+    for(; fed + piece.size() <= 1000000; fed += piece.size())
+        sha.addData(piece);
+    sha.addData(piece.constData(), 1000000 - fed);
+
+    QCOMPARE(sha.result().toHex(), QByteArray("34aa973cd4c4daa4f61eeb2bdbad27316534016f"));
+}
+
+void TestSNMPCrypto::hmacSha1Rfc2202()
+{
+    QCOMPARE(hmacSha1(QByteArray(20, char(0x0b)), "Hi There").toHex(),
+             QByteArray("b617318655057264e28bc0b6fb378c8ef146be00"));
+    QCOMPARE(hmacSha1("Jefe", "what do ya want for nothing?").toHex(),
+             QByteArray("effcdf6ae5eb2fa2d27416d5f184df9c259a7c79"));
+    QCOMPARE(hmacSha1(QByteArray(20, char(0xaa)), QByteArray(50, char(0xdd))).toHex(),
+             QByteArray("125d7342b9ac11cd91a39af48aa17b4f63f175d3"));
+    QCOMPARE(hmacSha1(QByteArray(80, char(0xaa)), "Test Using Larger Than Block-Size Key - Hash Key First").toHex(),
+             QByteArray("aa4ae5e15272d00e95705637ce8a3b55ed402112"));
+    QCOMPARE(hmacSha1(QByteArray(80, char(0xaa)),
+                      "Test Using Larger Than Block-Size Key and Larger Than One Block-Size Data").toHex(),
+             QByteArray("e8e99d0f45237d786d6bbaa7965c7808bbff1a91"));
+}
+
+void TestSNMPCrypto::hmacSha1Restart()
+{
+    // USM keys the HMAC once and starts it again for every message
+    SNMPHmacSha1 hmac("Jefe");
+    const QByteArray data("what do ya want for nothing?");
+    char mac[SNMPSha1::DigestSize];
+
+    for(int i = 0; i < 3; i++)
+    {
+        hmac.start();
+        hmac.addData(data.constData(), data.size());
+        hmac.result(mac);
+        QCOMPARE(QByteArray(mac, sizeof(mac)).toHex(), QByteArray("effcdf6ae5eb2fa2d27416d5f184df9c259a7c79"));
+    }
+}
+
+void TestSNMPCrypto::aes128Fips197()
+{
+    const struct {
+        const char *key;
+        const char *plaintext;
+        const char *ciphertext;
+    } vectors[] = {
+        // appendix B
+        { "2b7e151628aed2a6abf7158809cf4f3c", "3243f6a8885a308d313198a2e0370734", "3925841d02dc09fbdc118597196a0b32" },
+        // appendix C.1
+        { "000102030405060708090a0b0c0d0e0f", "00112233445566778899aabbccddeeff", "69c4e0d86a7b0430d8cdb78070b4c55a" }
+    };
+
+    for(const auto &vector : vectors)
+    {
+        const QByteArray key = QByteArray::fromHex(vector.key);
+        const QByteArray plaintext = QByteArray::fromHex(vector.plaintext);
+        QByteArray ciphertext(SNMPAes128::BlockSize, '\0');
+
+        SNMPAes128 aes(key.constData());
+        aes.encryptBlock((const quint8 *)plaintext.constData(), (quint8 *)ciphertext.data());
+        QCOMPARE(ciphertext.toHex(), QByteArray(vector.ciphertext));
+    }
+}
+
+void TestSNMPCrypto::aes128Cfb()
+{
+    // SP 800-38A F.3.13, CFB128-AES128.Encrypt, then cut short of a whole block
+    const QByteArray key = QByteArray::fromHex("2b7e151628aed2a6abf7158809cf4f3c");
+    const QByteArray iv = QByteArray::fromHex("000102030405060708090a0b0c0d0e0f");
+    const QByteArray plaintext = QByteArray::fromHex("6bc1bee22e409f96e93d7e117393172a"
+                                                     "ae2d8a571e03ac9c9eb76fac45af8e51"
+                                                     "30c81c46a35ce411e5fbc1191a0a52ef"
+                                                     "f69f2445df4f9b17ad2b417be66c3710");
+    const QByteArray expected = QByteArray::fromHex("3b3fd92eb72dad20333449f8e83cfb4a"
+                                                    "c8a64537a0b3a93fcde3cdad9f1ce58b"
+                                                    "26751f67a3cbb140b1808cf187a4f4df"
+                                                    "c04b05357c5d1c0eeac4c66f9ff7f2e6");
+    SNMPAes128 aes(key.constData());
+
+    for(int size : { 64, 37 })
+    {
+        QByteArray ciphertext(size, '\0');
+        aes.encryptCfb(iv.constData(), plaintext.constData(), ciphertext.data(), size);
+        QCOMPARE(ciphertext.toHex(), expected.left(size).toHex());
+
+        QByteArray decrypted(size, '\0');
+        aes.decryptCfb(iv.constData(), ciphertext.constData(), decrypted.data(), size);
+        QCOMPARE(decrypted.toHex(), plaintext.left(size).toHex());
+    }
+}
+
+void TestSNMPCrypto::passwordToKeyRfc3414()
+{
+    const QByteArray engineId = QByteArray::fromHex("000000000000000000000002");
+
+    QCOMPARE(SNMPUsm::passwordToKey("maplesyrup").toHex(),
+             QByteArray("9fb5cc0381497b3793528939ff788d5d79145211"));
+    QCOMPARE(SNMPUsm::localizeKey("maplesyrup", engineId).toHex(),
+             QByteArray("6695febc9288e36282235fc7151f128497b38f3f"));
+}
+
+QTEST_APPLESS_MAIN(TestSNMPCrypto)
+
+#include "tst_snmpcrypto.moc"
@@ -0,0 +1,49 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Tests of SNMPOid and the _oid literal. Built with SNMP_MALFORMED_OID_LITERAL
+ * defined, the file holds a malformed literal and must not compile; ctest
+ * checks that it does not.
+ *
+ */
+
+
+#include <QtTest>
+#include "snmpoid.h"
+
+#ifdef SNMP_MALFORMED_OID_LITERAL
+static const SNMPOid malformed = "1..3"_oid;
+#endif
+
+class TestSNMPOid : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void literalMatchesFromString();
+    void malformedStrings();
+};
+
+void TestSNMPOid::literalMatchesFromString()
+{
+    QCOMPARE(SNMPOid("1.3.6.1.2.1.1.3.0"_oid), SNMPOid::fromString("1.3.6.1.2.1.1.3.0"));
+    QCOMPARE(SNMPOid(".1.3.6.1.2.1.1.3.0"_oid), SNMPOid::fromString("1.3.6.1.2.1.1.3.0"));
+    QCOMPARE(SNMPOid("2.999.1"_oid), SNMPOid::fromString("2.999.1"));
+    QCOMPARE(SNMPOid("1.3.6.1.4.1.4294967295"_oid), SNMPOid::fromString("1.3.6.1.4.1.4294967295"));
+    QCOMPARE(SNMPOid("0.0"_oid), SNMPOid::fromEncoded(QByteArray(1, '\0')));
+}
+
+void TestSNMPOid::malformedStrings()
+{
+    QVERIFY(!SNMPOid::fromString("1..3").isValid());
+    QVERIFY(!SNMPOid::fromString("1").isValid());
+    QVERIFY(!SNMPOid::fromString("3.1").isValid());
+    QVERIFY(!SNMPOid::fromString("1.3.x").isValid());
+    QVERIFY(!SNMPOid::fromString("1.3.4294967296").isValid());
+}
+
+QTEST_APPLESS_MAIN(TestSNMPOid)
+
+#include "tst_snmpoid.moc"
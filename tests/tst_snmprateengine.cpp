@@ -0,0 +1,214 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Tests of SNMPRateEngine: deltas and rates of Counter32 and Counter64 series,
+ * a Counter32 wrap against a Counter64 discontinuity, the restart of an agent
+ * told from its sysUpTime, and a wrap of the TimeTicks told from a restart.
+ * The series table is checked against a plain map through many insertions
+ * and removals, for the backward shift which replaces tombstones.
+ *
+ */
+
+
+#include <QtTest>
+#include <map>
+#include <utility>
+#include "snmprateengine.h"
+
+class TestSNMPRateEngine : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void firstSampleThenRate();
+    void counter32Wrap();
+    void counter64Discontinuity();
+    void invalidSamples();
+    void intervalFromUpTime();
+    void upTimeReset();
+    void upTimeBelowInterval();
+    void timeTicksWrap();
+    void removalKeepsOtherSeries();
+    void removeAgent();
+};
+
+void TestSNMPRateEngine::firstSampleThenRate()
+{
+    SNMPRateEngine engine;
+    const int series = engine.series(1, "1.3.6.1.2.1.31.1.1.1.6.1"_oid);
+
+    SNMPRate rate = engine.update(series, 1000, SNMPBer::Counter64, 0);
+    QCOMPARE(rate.status, int(SNMPRate::FirstSample));
+
+    rate = engine.update(series, 3000, SNMPBer::Counter64, 2000);
+    QCOMPARE(rate.status, int(SNMPRate::Valid));
+    QCOMPARE(rate.delta, quint64(2000));
+    QCOMPARE(rate.interval, qint64(2000));
+    QCOMPARE(rate.rate, 1000.0);
+}
+
+void TestSNMPRateEngine::counter32Wrap()
+{
+    SNMPRateEngine engine;
+    const int series = engine.series(1, "1.3.6.1.2.1.2.2.1.10.1"_oid);
+
+    engine.update(series, 0xffffff00u, SNMPBer::Counter32, 0);
+    const SNMPRate rate = engine.update(series, 0x100, SNMPBer::Counter32, 1000);
+    QCOMPARE(rate.status, int(SNMPRate::Valid));
+    QCOMPARE(rate.delta, quint64(0x200));
+}
+
+void TestSNMPRateEngine::counter64Discontinuity()
+{
+    SNMPRateEngine engine;
+    const int series = engine.series(1, "1.3.6.1.2.1.31.1.1.1.6.1"_oid);
+
+    engine.update(series, 5000, SNMPBer::Counter64, 0);
+    SNMPRate rate = engine.update(series, 100, SNMPBer::Counter64, 1000);
+    QCOMPARE(rate.status, int(SNMPRate::Discontinuity));
+    QCOMPARE(rate.delta, quint64(0));
+
+    // the lower sample is the new base
+    rate = engine.update(series, 600, SNMPBer::Counter64, 2000);
+    QCOMPARE(rate.status, int(SNMPRate::Valid));
+    QCOMPARE(rate.delta, quint64(500));
+}
+
+void TestSNMPRateEngine::invalidSamples()
+{
+    SNMPRateEngine engine;
+    const int series = engine.series(1, "1.3.6.1.2.1.2.2.1.10.1"_oid);
+
+    QCOMPARE(engine.update(series, 10, SNMPBer::Gauge32, 0).status, int(SNMPRate::Invalid));
+    QCOMPARE(engine.update(series + 1, 10, SNMPBer::Counter32, 0).status, int(SNMPRate::Invalid));
+
+    engine.update(series, 10, SNMPBer::Counter32, 1000);
+    QCOMPARE(engine.update(series, 20, SNMPBer::Counter32, 1000).status, int(SNMPRate::Invalid));
+
+    // the sample without time passed was not taken
+    const SNMPRate rate = engine.update(series, 30, SNMPBer::Counter32, 2000);
+    QCOMPARE(rate.status, int(SNMPRate::Valid));
+    QCOMPARE(rate.delta, quint64(20));
+}
+
+void TestSNMPRateEngine::intervalFromUpTime()
+{
+    SNMPRateEngine engine;
+    const int series = engine.series(1, "1.3.6.1.2.1.2.2.1.10.1"_oid);
+
+    // the responses took different times: the agent's clock says 5 s passed
+    engine.update(series, 0, SNMPBer::Counter32, 0, 100000);
+    const SNMPRate rate = engine.update(series, 5000, SNMPBer::Counter32, 5300, 100500);
+    QCOMPARE(rate.status, int(SNMPRate::Valid));
+    QCOMPARE(rate.interval, qint64(5000));
+    QCOMPARE(rate.rate, 1000.0);
+}
+
+void TestSNMPRateEngine::upTimeReset()
+{
+    SNMPRateEngine engine;
+    const int series = engine.series(1, "1.3.6.1.2.1.2.2.1.10.1"_oid);
+
+    // the counter went up, but the agent restarted in between
+    engine.update(series, 1000, SNMPBer::Counter32, 0, 1000000);
+    SNMPRate rate = engine.update(series, 2000, SNMPBer::Counter32, 10000, 50);
+    QCOMPARE(rate.status, int(SNMPRate::Discontinuity));
+
+    rate = engine.update(series, 2500, SNMPBer::Counter32, 20000, 1050);
+    QCOMPARE(rate.status, int(SNMPRate::Valid));
+    QCOMPARE(rate.delta, quint64(500));
+    QCOMPARE(rate.interval, qint64(10000));
+}
+
+void TestSNMPRateEngine::upTimeBelowInterval()
+{
+    SNMPRateEngine engine;
+    const int series = engine.series(1, "1.3.6.1.2.1.2.2.1.10.1"_oid);
+
+    // a minute between the polls, but the agent has only been up for 12 s
+    engine.update(series, 1000, SNMPBer::Counter32, 0, 1000);
+    const SNMPRate rate = engine.update(series, 2000, SNMPBer::Counter32, 60000, 1200);
+    QCOMPARE(rate.status, int(SNMPRate::Discontinuity));
+}
+
+void TestSNMPRateEngine::timeTicksWrap()
+{
+    SNMPRateEngine engine;
+    const int series = engine.series(1, "1.3.6.1.2.1.2.2.1.10.1"_oid);
+
+    // sysUpTime wraps after 497 days: 0x1f0 ticks passed, not a restart
+    engine.update(series, 1000, SNMPBer::Counter32, 0, 0xffffff00u);
+    const SNMPRate rate = engine.update(series, 5960, SNMPBer::Counter32, 5000, 0xf0);
+    QCOMPARE(rate.status, int(SNMPRate::Valid));
+    QCOMPARE(rate.interval, qint64(4960));
+    QCOMPARE(rate.delta, quint64(4960));
+}
+
+void TestSNMPRateEngine::removalKeepsOtherSeries()
+{
+    // at most 8 series in 16 buckets: the table never grows, the probe
+    // sequences overlap and removals shift the buckets after them back
+    SNMPRateEngine engine(8);
+    std::map<std::pair<quint32, int>, int> expected;
+    quint32 state = 12345;
+
+    for(int step = 0; step < 20000; step++)
+    {
+        state = state * 1103515245u + 12345u;
+        const quint32 agent = (state >> 8) % 2;
+        const int row = int((state >> 12) % 4);
+        const SNMPOid oid = SNMPOid::fromString(QString("1.3.6.1.2.1.2.2.1.10.%1").arg(row));
+        const std::pair<quint32, int> key(agent, row);
+
+        if((state >> 20) % 3 == 0)
+        {
+            std::map<std::pair<quint32, int>, int>::iterator found = expected.find(key);
+            if(found != expected.end())
+            {
+                QVERIFY(engine.removeSeries(found->second));
+                expected.erase(found);
+            }
+        } else
+        {
+            const int series = engine.series(agent, oid);
+            std::map<std::pair<quint32, int>, int>::iterator found = expected.find(key);
+            if(found != expected.end())
+                QCOMPARE(series, found->second);
+            expected[key] = series;
+        }
+
+        QCOMPARE(engine.size(), int(expected.size()));
+    }
+
+    for(quint32 agent = 0; agent < 2; agent++)
+    {
+        for(int row = 0; row < 4; row++)
+        {
+            const SNMPOid oid = SNMPOid::fromString(QString("1.3.6.1.2.1.2.2.1.10.%1").arg(row));
+            std::map<std::pair<quint32, int>, int>::iterator found = expected.find(std::make_pair(agent, row));
+            QCOMPARE(engine.findSeries(agent, oid), found == expected.end() ? -1 : found->second);
+        }
+    }
+}
+
+void TestSNMPRateEngine::removeAgent()
+{
+    SNMPRateEngine engine;
+    const SNMPOid inOctets = "1.3.6.1.2.1.2.2.1.10.1"_oid;
+    const SNMPOid outOctets = "1.3.6.1.2.1.2.2.1.16.1"_oid;
+
+    engine.series(1, inOctets);
+    engine.series(1, outOctets);
+    const int kept = engine.series(2, inOctets);
+
+    QCOMPARE(engine.removeAgent(1), 2);
+    QCOMPARE(engine.size(), 1);
+    QCOMPARE(engine.findSeries(1, inOctets), -1);
+    QCOMPARE(engine.findSeries(2, inOctets), kept);
+}
+
+QTEST_APPLESS_MAIN(TestSNMPRateEngine)
+
+#include "tst_snmprateengine.moc"
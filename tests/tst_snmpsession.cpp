@@ -0,0 +1,179 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Loopback tests of SNMPSession against a SNMPAgentSimulator in the same
+ * thread: a get of an object the agent does not have is reported as error 2
+ * (noSuchName) through the typed and the text signals and by the blocking
+ * call alike, whether the agent answers with the SNMPv1 error status or with
+ * a SNMPv2c exception value. A response larger than the usual datagram is
+ * received whole over the batched transport as over the QUdpSocket. Sessions
+ * on two threads send the same prepared request at once, which they only read.
+ *
+ */
+
+
+#include <QtTest>
+#include <QAtomicInt>
+#include <QThread>
+#include "qtsnmp.h"
+#include "snmpagentsimulator.h"
+
+static const SNMPOid largeObject = "1.3.6.1.4.1.99999.2.0"_oid;
+static const int largeValueSize = 20000;
+
+class TestSNMPSession : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void getExistingObject();
+    void getMissingObject_data();
+    void getMissingObject();
+    void getLargeResponse_data();
+    void getLargeResponse();
+    void preparedRequestFromThreads();
+
+private:
+    SNMPAgentSimulator simulator;
+};
+
+void TestSNMPSession::initTestCase()
+{
+    simulator.populate(10);
+    simulator.setOctetString(simulator.addObject(largeObject, SNMPBer::OctetString),
+                             QByteArray(largeValueSize, 'x'));
+    simulator.setMaxResponseSize(65507);
+    QVERIFY(simulator.listen(0));
+}
+
+void TestSNMPSession::getExistingObject()
+{
+    SNMPSession session("127.0.0.1", qint16(simulator.getLocalPort()), 0);
+    session.setVersion(SNMPBer::Version2c);
+
+    QString receivedValue;
+    QCOMPARE(session.sendGetRequest(receivedValue, "public", "1.3.6.1.2.1.1.5.0"), 0);
+    QVERIFY(!receivedValue.isEmpty());
+}
+
+void TestSNMPSession::getMissingObject_data()
+{
+    QTest::addColumn<int>("version");
+
+    // SNMPv1 answers with the noSuchName error status, SNMPv2c with an exception value
+    QTest::newRow("v1") << int(SNMPBer::Version1);
+    QTest::newRow("v2c") << int(SNMPBer::Version2c);
+}
+
+void TestSNMPSession::getMissingObject()
+{
+    QFETCH(int, version);
+    const QString missing("1.3.6.1.4.1.99999.1.0");
+
+    SNMPSession session("127.0.0.1", qint16(simulator.getLocalPort()), 0);
+    session.setVersion(version);
+
+    int typedStatus = -1;
+    int typedValueType = -1;
+    int textStatus = -1;
+    connect(&session, &SNMPSession::responseValueReceived, this,
+            [&](quint32, int errorStatus, const SNMPValue &value) {
+        typedStatus = errorStatus;
+        typedValueType = value.type();
+    });
+    connect(&session, &SNMPSession::responseReceived, this,
+            [&](quint32, int errorStatus, const QString &) {
+        textStatus = errorStatus;
+    });
+
+    QVERIFY(session.sendGetRequestAsync("public", missing) != 0);
+    QTRY_VERIFY(textStatus != -1);
+    QCOMPARE(typedStatus, 2);
+    QCOMPARE(textStatus, 2);
+    if(version == SNMPBer::Version2c)
+        QCOMPARE(typedValueType, int(SNMPBer::NoSuchObject));
+
+    QString receivedValue;
+    QCOMPARE(session.sendGetRequest(receivedValue, "public", missing), 2);
+    QVERIFY(receivedValue.isEmpty());
+}
+
+void TestSNMPSession::getLargeResponse_data()
+{
+    QTest::addColumn<bool>("batched");
+
+    QTest::newRow("socket") << false;
+    QTest::newRow("batched") << true;
+}
+
+void TestSNMPSession::getLargeResponse()
+{
+    QFETCH(bool, batched);
+
+    SNMPSession session("127.0.0.1", qint16(simulator.getLocalPort()), 0);
+    session.setVersion(SNMPBer::Version2c);
+    if(batched && !session.setBatchedTransport(true))
+        QSKIP("the batched transport is not supported here");
+
+    QString receivedValue;
+    QCOMPARE(session.sendGetRequest(receivedValue, "public", largeObject.toString()), 0);
+    QCOMPARE(receivedValue, QString::fromLatin1(QByteArray(largeValueSize, 'x')));
+}
+
+void TestSNMPSession::preparedRequestFromThreads()
+{
+    const int sends = 200;
+    const quint16 agentPort = simulator.getLocalPort();
+    SNMPSession preparing;
+    preparing.setVersion(SNMPBer::Version2c);
+    const SNMPPreparedRequest prepared = preparing.prepareGetRequest("public",
+        { "1.3.6.1.2.1.1.1.0"_oid, "1.3.6.1.2.1.1.5.0"_oid });
+    QVERIFY(prepared.isValid());
+    const QByteArray message = prepared.message();
+
+    QAtomicInt rightValues(0);
+    QAtomicInt finishedThreads(0);
+
+    // each thread sends the prepared request again once the previous one is finished
+    auto poll = [&]() {
+        SNMPSession session("127.0.0.1", qint16(agentPort), 0);
+        session.setVersion(SNMPBer::Version2c);
+        QEventLoop loop;
+        int answered = 0;
+
+        connect(&session, &SNMPSession::batchValueReceived, &loop,
+                [&](quint32, int index, int errorStatus, const QString &value) {
+            const QString expected = index == 0 ? "SNMP agent simulator" : "simulator";
+            if(errorStatus == 0 && value == expected)
+                rightValues.ref();
+        });
+        connect(&session, &SNMPSession::batchFinished, &loop, [&](quint32) {
+            if(++answered == sends || session.sendPreparedRequest(prepared) == 0)
+                loop.quit();
+        }, Qt::QueuedConnection);
+
+        if(session.sendPreparedRequest(prepared) != 0)
+            loop.exec();
+        finishedThreads.ref();
+    };
+
+    QScopedPointer<QThread> first(QThread::create(poll));
+    QScopedPointer<QThread> second(QThread::create(poll));
+    first->start();
+    second->start();
+
+    // the simulator answers from this thread's event loop
+    QTRY_COMPARE_WITH_TIMEOUT(finishedThreads.loadAcquire(), 2, 30000);
+    first->wait();
+    second->wait();
+
+    QCOMPARE(rightValues.loadAcquire(), 2 * sends * 2);
+    QCOMPARE(prepared.message(), message);
+}
+
+QTEST_GUILESS_MAIN(TestSNMPSession)
+
+#include "tst_snmpsession.moc"
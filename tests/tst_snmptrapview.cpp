@@ -0,0 +1,127 @@
+/**
+ * @version 1.0
+ *
+ * @section DESCRIPTION
+ *
+ * Tests of SNMPTrapView: SNMPv1 traps and SNMPv2c notifications are decoded,
+ * and a datagram with a malformed varbind, or whose varbind list is not
+ * consumed exactly, is rejected as a whole, so that the receiver neither
+ * delivers nor acknowledges it.
+ *
+ */
+
+
+#include <QtTest>
+#include "snmptrapreceiver.h"
+
+// Short definite-length elements are enough for these notifications
+static QByteArray element(int type, const QByteArray &content)
+{
+    QByteArray encoded;
+    encoded.append(char(type));
+    encoded.append(char(content.size()));
+    return encoded + content;
+}
+
+static QByteArray varbind(const char *oid, const QByteArray &value)
+{
+    return element(SNMPBer::Sequence, element(SNMPBer::ObjectIdentifier, QByteArray::fromHex(oid)) + value);
+}
+
+static QByteArray notification(int version, const QByteArray &pdu)
+{
+    return element(SNMPBer::Sequence, element(SNMPBer::Integer, QByteArray(1, char(version)))
+                                      + element(SNMPBer::OctetString, "public") + pdu);
+}
+
+// An InformRequest with request ID 7, sysUpTime.0 = 5 and snmpTrapOID.0 = 1.3.6.1
+static QByteArray inform(const QByteArray &extraVarbinds, const QByteArray &afterList = QByteArray())
+{
+    const QByteArray list = varbind("2b06010201010300", element(SNMPBer::TimeTicks, QByteArray(1, char(5))))
+                            + varbind("2b060106030101040100", element(SNMPBer::ObjectIdentifier, QByteArray::fromHex("2b0601")))
+                            + extraVarbinds;
+    return notification(SNMPBer::Version2c, element(SNMPBer::InformRequest,
+                        element(SNMPBer::Integer, QByteArray(1, char(7))) + element(SNMPBer::Integer, QByteArray(1, char(0)))
+                        + element(SNMPBer::Integer, QByteArray(1, char(0))) + element(SNMPBer::Sequence, list) + afterList));
+}
+
+// A coldStart Trap-PDU from 127.0.0.1 with the given varbind list content
+static QByteArray trap(const QByteArray &list, int listType = SNMPBer::Sequence)
+{
+    return notification(SNMPBer::Version1, element(SNMPBer::Trap,
+                        element(SNMPBer::ObjectIdentifier, QByteArray::fromHex("2b0601"))
+                        + element(SNMPBer::IpAddress, QByteArray::fromHex("7f000001"))
+                        + element(SNMPBer::Integer, QByteArray(1, char(0))) + element(SNMPBer::Integer, QByteArray(1, char(0)))
+                        + element(SNMPBer::TimeTicks, QByteArray(1, char(5))) + element(listType, list)));
+}
+
+static int countVarbinds(SNMPTrapView &view)
+{
+    SNMPVarbindView varbind;
+    int count = 0;
+    while(view.nextVarbind(varbind))
+        count++;
+    return count;
+}
+
+class TestSNMPTrapView : public QObject {
+
+    Q_OBJECT
+
+private slots:
+    void decodesInform();
+    void decodesTrap();
+    void rejectsMalformedVarbindLists();
+};
+
+void TestSNMPTrapView::decodesInform()
+{
+    const QByteArray datagram = inform(varbind("2b0601040100", element(SNMPBer::Null, QByteArray())));
+    SNMPTrapView view;
+
+    QVERIFY(view.decode(datagram.constData(), datagram.size()));
+    QCOMPARE(view.pduType, SNMPBer::InformRequest);
+    QCOMPARE(view.requestId, quint32(7));
+    QCOMPARE(view.timeStamp, quint32(5));
+    QCOMPARE(QByteArray(view.trapOid.value, view.trapOid.length), QByteArray::fromHex("2b0601"));
+    QCOMPARE(countVarbinds(view), 3);
+}
+
+void TestSNMPTrapView::decodesTrap()
+{
+    const QByteArray datagram = trap(varbind("2b0601040100", element(SNMPBer::Null, QByteArray())));
+    SNMPTrapView view;
+
+    QVERIFY(view.decode(datagram.constData(), datagram.size()));
+    QCOMPARE(view.pduType, SNMPBer::Trap);
+    QCOMPARE(view.agentAddress, quint32(0x7f000001));
+    QCOMPARE(view.timeStamp, quint32(5));
+    QCOMPARE(countVarbinds(view), 1);
+}
+
+void TestSNMPTrapView::rejectsMalformedVarbindLists()
+{
+    const QByteArray null = element(SNMPBer::Null, QByteArray());
+    const QByteArray malformed[] = {
+        inform(element(SNMPBer::Null, QByteArray())),                             // not a varbind
+        inform(element(SNMPBer::Sequence, element(SNMPBer::ObjectIdentifier, QByteArray::fromHex("2b06")) + null + null)),
+        inform(element(SNMPBer::Sequence, element(SNMPBer::ObjectIdentifier, QByteArray::fromHex("2b06")))),
+        inform(QByteArray("\x30\x05\x06\x01", 4)),                                // runs past the list
+        inform(varbind("2b86", null)),                                            // incomplete OID
+        inform(QByteArray(), null),                                               // after the list
+        inform(QByteArray()) + null,                                              // after the message
+        trap(varbind("2b06", null) + null),
+        trap(varbind("2b06", null), SNMPBer::OctetString),
+        trap(varbind("2b86", null))
+    };
+
+    for(const QByteArray &datagram : malformed)
+    {
+        SNMPTrapView view;
+        QVERIFY2(!view.decode(datagram.constData(), datagram.size()), datagram.toHex().constData());
+    }
+}
+
+QTEST_APPLESS_MAIN(TestSNMPTrapView)
+
+#include "tst_snmptrapview.moc"